@@ -17,6 +17,17 @@
 
 #define CL_ERROR {g_printf("[OpenCL] Error in %s:%d@%s - %s\n", __FILE__, __LINE__, __func__, gegl_cl_errstring(cl_err)); goto error;}
 
+/* a batch enqueued on a device, read back once the device is done */
+typedef struct GeglBufferClBatch
+{
+  gint          n;
+  size_t        size    [GEGL_CL_BUFFER_MAX_ITERATORS][GEGL_CL_NTEX];
+  GeglRectangle roi     [GEGL_CL_BUFFER_MAX_ITERATORS][GEGL_CL_NTEX];
+  cl_mem        tex_buf [GEGL_CL_BUFFER_MAX_ITERATORS][GEGL_CL_NTEX];
+  cl_mem        tex_op  [GEGL_CL_BUFFER_MAX_ITERATORS][GEGL_CL_NTEX];
+  gboolean      tex_buf_from_cache [GEGL_CL_BUFFER_MAX_ITERATORS][GEGL_CL_NTEX];
+} GeglBufferClBatch;
+
 typedef struct GeglBufferClIterators
 {
   /* current region of interest */
@@ -35,6 +46,7 @@ typedef struct GeglBufferClIterators
   gint           iterators;
   gint           iteration_no;
   gboolean       is_finished;
+  gboolean       is_locked;
 
   guint          flags          [GEGL_CL_BUFFER_MAX_ITERATORS];
   gint           area           [GEGL_CL_BUFFER_MAX_ITERATORS][4];
@@ -58,6 +70,15 @@ typedef struct GeglBufferClIterators
   gint           roi_no;
   GeglRectangle *roi_all;
 
+  /* the batches of rois are handed to the devices in turn, the device
+   * of the current batch is kept here and not in the global OpenCL state
+   */
+  gint           device;
+  gint           rois_per_device;
+
+  /* the batch each device is still working on */
+  GeglBufferClBatch pending     [GEGL_CL_MAX_DEVICES];
+
 } GeglBufferClIterators;
 
 gint
@@ -140,25 +161,35 @@ gegl_buffer_cl_iterator_add_2 (GeglBufferClIterator  *iterator,
   else
     {
       gint x, y, j;
+      gint roi_width  = cl_state.max_image_width;
+      gint roi_height = cl_state.max_image_height;
+      gint n_devices  = gegl_cl_get_n_devices ();
+
+      /* give every device at least a band of rows to work on */
+      if (n_devices > 1)
+        roi_height = MIN (roi_height, MAX (1, (result->height + n_devices - 1) / n_devices));
 
       i->rois = 0;
-      for (y=result->y; y < result->y + result->height; y += cl_state.max_image_height)
-        for (x=result->x; x < result->x + result->width;  x += cl_state.max_image_width)
+      for (y=result->y; y < result->y + result->height; y += roi_height)
+        for (x=result->x; x < result->x + result->width;  x += roi_width)
           i->rois++;
 
       i->roi_no = 0;
       i->roi_all = g_new0 (GeglRectangle, i->rois);
 
       j = 0;
-      for (y=0; y < result->height; y += cl_state.max_image_height)
-        for (x=0; x < result->width;  x += cl_state.max_image_width)
+      for (y=0; y < result->height; y += roi_height)
+        for (x=0; x < result->width;  x += roi_width)
           {
             GeglRectangle r = {x, y,
-                               MIN(cl_state.max_image_width,  result->width  - x),
-                               MIN(cl_state.max_image_height, result->height - y)};
+                               MIN(roi_width,  result->width  - x),
+                               MIN(roi_height, result->height - y)};
             i->roi_all[j] = r;
             j++;
           }
+
+      i->device          = -1;
+      i->rois_per_device = MAX (1, (i->rois + n_devices - 1) / n_devices);
     }
 
   return self;
@@ -176,11 +207,219 @@ gegl_buffer_cl_iterator_add (GeglBufferClIterator  *iterator,
 
 #define OPENCL_USE_CACHE 1
 
+/* Hand the batch the operation has just enqueued over to its device: the
+ * output conversion is enqueued behind the operation's kernels and the
+ * queue is flushed, the readback waits until the device comes around again.
+ */
+static gboolean
+gegl_buffer_cl_iterator_submit (GeglBufferClIterators *i)
+{
+  GeglBufferClBatch *batch = &i->pending[i->device];
+  cl_int cl_err = 0;
+  gint no, j;
+
+  g_assert (batch->n == 0);
+
+  for (no=0; no<i->iterators;no++)
+    {
+      if (i->flags[no] == GEGL_CL_BUFFER_WRITE
+          && i->conv[no] == GEGL_CL_COLOR_CONVERT)
+        {
+          /* Wait Processing */
+          cl_err = gegl_clEnqueueBarrier(gegl_cl_get_command_queue());
+          if (cl_err != CL_SUCCESS) CL_ERROR;
+
+          /* color conversion in the GPU (output) */
+          for (j=0; j < i->n; j++)
+            {
+              cl_err = gegl_cl_color_conv (i->tex_op[no][j], i->tex_buf[no][j], i->size[no][j],
+                                           i->format[no], i->buffer[no]->format);
+              if (cl_err == FALSE) CL_ERROR;
+            }
+        }
+    }
+
+  /* Run! */
+  cl_err = gegl_clFlush(gegl_cl_get_command_queue());
+  if (cl_err != CL_SUCCESS) CL_ERROR;
+
+  batch->n = i->n;
+  memcpy (batch->size,    i->size,    sizeof (batch->size));
+  memcpy (batch->roi,     i->roi,     sizeof (batch->roi));
+  memcpy (batch->tex_buf, i->tex_buf, sizeof (batch->tex_buf));
+  memcpy (batch->tex_op,  i->tex_op,  sizeof (batch->tex_op));
+  memcpy (batch->tex_buf_from_cache, i->tex_buf_from_cache, sizeof (batch->tex_buf_from_cache));
+
+  memset (i->tex,     0, sizeof (i->tex));
+  memset (i->tex_buf, 0, sizeof (i->tex_buf));
+  memset (i->tex_op,  0, sizeof (i->tex_op));
+  memset (i->tex_buf_from_cache, 0, sizeof (i->tex_buf_from_cache));
+
+  return TRUE;
+
+error:
+  return FALSE;
+}
+
+static void
+gegl_buffer_cl_iterator_release (GeglBufferClIterators *i,
+                                 GeglBufferClBatch     *batch)
+{
+  gint no, j;
+
+  for (no=0; no < i->iterators; no++)
+    for (j=0; j < batch->n; j++)
+      {
+        if (batch->tex_buf[no][j] && !batch->tex_buf_from_cache [no][j])
+          gegl_clReleaseMemObject (batch->tex_buf[no][j]);
+
+        if (batch->tex_op [no][j])
+          gegl_clReleaseMemObject (batch->tex_op [no][j]);
+
+        batch->tex_buf[no][j] = NULL;
+        batch->tex_op [no][j] = NULL;
+        batch->tex_buf_from_cache [no][j] = FALSE;
+      }
+
+  batch->n = 0;
+}
+
+/* release everything the iterator holds, output that is still pending
+ * is dropped
+ */
+static void
+gegl_buffer_cl_iterator_free (GeglBufferClIterators *i)
+{
+  guint d;
+  gint  no, j;
+
+  gegl_cl_set_current_device (0);
+
+  for (no=0; no<i->iterators;no++)
+    for (j=0; j < i->n; j++)
+      {
+        if (i->tex_buf[no][j] && !i->tex_buf_from_cache [no][j])
+          gegl_clReleaseMemObject (i->tex_buf[no][j]);
+        if (i->tex_op [no][j])
+          gegl_clReleaseMemObject (i->tex_op [no][j]);
+
+        i->tex    [no][j] = NULL;
+        i->tex_buf[no][j] = NULL;
+        i->tex_op [no][j] = NULL;
+      }
+
+  for (d = 0; d < GEGL_CL_MAX_DEVICES; d++)
+    gegl_buffer_cl_iterator_release (i, &i->pending[d]);
+
+  for (no=0; no<i->iterators;no++)
+    {
+      if (i->buffer[no])
+        {
+          gboolean found = FALSE;
+          for (j=0; j<no; j++)
+            if (i->buffer[no]==i->buffer[j])
+              {
+                found = TRUE;
+                break;
+              }
+          if (!found && i->is_locked)
+            gegl_buffer_unlock (i->buffer[no]);
+
+          g_object_unref (i->buffer[no]);
+        }
+    }
+
+  i->is_finished = TRUE;
+
+  g_free (i->roi_all);
+  g_slice_free (GeglBufferClIterators, i);
+}
+
+/* wait for the batch pending on @device and write its output back */
+static gboolean
+gegl_buffer_cl_iterator_complete (GeglBufferClIterators *i,
+                                  guint                  device)
+{
+  GeglBufferClBatch *batch = &i->pending[device];
+  cl_command_queue   cq    = gegl_cl_get_nth_command_queue (device);
+  cl_int cl_err = 0;
+  gint no, j;
+
+  if (batch->n == 0)
+    return TRUE;
+
+  cl_err = gegl_clFinish(cq);
+  if (cl_err != CL_SUCCESS) CL_ERROR;
+
+  for (no=0; no<i->iterators;no++)
+    {
+      if (i->flags[no] != GEGL_CL_BUFFER_WRITE)
+        continue;
+
+      /* GPU -> CPU */
+      for (j=0; j < batch->n; j++)
+        {
+          gpointer data;
+
+          /* tile-ize */
+          if (i->conv[no] == GEGL_CL_COLOR_NOT_SUPPORTED)
+            {
+              data = gegl_clEnqueueMapBuffer(cq, batch->tex_op[no][j], CL_TRUE,
+                                             CL_MAP_READ,
+                                             0, batch->size[no][j] * i->op_cl_format_size [no],
+                                             0, NULL, NULL, &cl_err);
+              if (cl_err != CL_SUCCESS) CL_ERROR;
+
+              /* color conversion using BABL */
+              gegl_buffer_set (i->buffer[no], &batch->roi[no][j], i->format[no], data, GEGL_AUTO_ROWSTRIDE);
+
+              cl_err = gegl_clEnqueueUnmapMemObject (cq, batch->tex_op[no][j], data,
+                                                     0, NULL, NULL);
+              if (cl_err != CL_SUCCESS) CL_ERROR;
+            }
+          else
+#ifdef OPENCL_USE_CACHE
+            {
+              gegl_buffer_cl_cache_new (i->buffer[no], &batch->roi[no][j], batch->tex_buf[no][j]);
+              /* don't release this texture */
+              batch->tex_buf[no][j] = NULL;
+            }
+#else
+            {
+              data = gegl_clEnqueueMapBuffer(cq, batch->tex_buf[no][j], CL_TRUE,
+                                             CL_MAP_READ,
+                                             0, batch->size[no][j] * i->buf_cl_format_size [no],
+                                             0, NULL, NULL, &cl_err);
+              if (cl_err != CL_SUCCESS) CL_ERROR;
+
+              /* color conversion using BABL */
+              gegl_buffer_set (i->buffer[no], &batch->roi[no][j], i->format[no], data, GEGL_AUTO_ROWSTRIDE);
+
+              cl_err = gegl_clEnqueueUnmapMemObject (cq, batch->tex_buf[no][j], data,
+                                                     0, NULL, NULL);
+              if (cl_err != CL_SUCCESS) CL_ERROR;
+            }
+#endif
+        }
+    }
+
+  cl_err = gegl_clFinish(cq);
+  if (cl_err != CL_SUCCESS) CL_ERROR;
+
+  gegl_buffer_cl_iterator_release (i, batch);
+
+  return TRUE;
+
+error:
+  return FALSE;
+}
+
 gboolean
 gegl_buffer_cl_iterator_next (GeglBufferClIterator *iterator, gboolean *err)
 {
   GeglBufferClIterators *i = (gpointer)iterator;
-  gboolean result = FALSE;
+  guint n_devices = gegl_cl_get_n_devices ();
+  guint d;
   gint no, j;
   cl_int cl_err = 0;
 
@@ -211,102 +450,39 @@ gegl_buffer_cl_iterator_next (GeglBufferClIterator *iterator, gboolean *err)
                 }
             }
         }
+      i->is_locked = TRUE;
     }
   else
     {
-      /* complete pending write work */
-      for (no=0; no<i->iterators;no++)
-        {
-          if (i->flags[no] == GEGL_CL_BUFFER_WRITE)
-            {
-              /* Wait Processing */
-              cl_err = gegl_clEnqueueBarrier(gegl_cl_get_command_queue());
-              if (cl_err != CL_SUCCESS) CL_ERROR;
-
-              /* color conversion in the GPU (output) */
-              if (i->conv[no] == GEGL_CL_COLOR_CONVERT)
-                for (j=0; j < i->n; j++)
-                  {
-                    cl_err = gegl_cl_color_conv (i->tex_op[no][j], i->tex_buf[no][j], i->size[no][j],
-                                                 i->format[no], i->buffer[no]->format);
-                    if (cl_err == FALSE) CL_ERROR;
-                  }
-
-              /* Wait Processing */
-              cl_err = gegl_clEnqueueBarrier(gegl_cl_get_command_queue());
-              if (cl_err != CL_SUCCESS) CL_ERROR;
-
-              /* GPU -> CPU */
-              for (j=0; j < i->n; j++)
-                {
-                  gpointer data;
-
-                  /* tile-ize */
-                  if (i->conv[no] == GEGL_CL_COLOR_NOT_SUPPORTED)
-                    {
-                      data = gegl_clEnqueueMapBuffer(gegl_cl_get_command_queue(), i->tex_op[no][j], CL_TRUE,
-                                                     CL_MAP_READ,
-                                                     0, i->size[no][j] * i->op_cl_format_size [no],
-                                                     0, NULL, NULL, &cl_err);
-                      if (cl_err != CL_SUCCESS) CL_ERROR;
-
-                      /* color conversion using BABL */
-                      gegl_buffer_set (i->buffer[no], &i->roi[no][j], i->format[no], data, GEGL_AUTO_ROWSTRIDE);
-
-                      cl_err = gegl_clEnqueueUnmapMemObject (gegl_cl_get_command_queue(), i->tex_op[no][j], data,
-                                                             0, NULL, NULL);
-                      if (cl_err != CL_SUCCESS) CL_ERROR;
-                    }
-                  else
-#ifdef OPENCL_USE_CACHE
-                    {
-                      gegl_buffer_cl_cache_new (i->buffer[no], &i->roi[no][j], i->tex_buf[no][j]);
-                      /* don't release this texture */
-                      i->tex_buf[no][j] = NULL;
-                    }
-#else
-                    {
-                      data = gegl_clEnqueueMapBuffer(gegl_cl_get_command_queue(), i->tex_buf[no][j], CL_TRUE,
-                                                     CL_MAP_READ,
-                                                     0, i->size[no][j] * i->buf_cl_format_size [no],
-                                                     0, NULL, NULL, &cl_err);
-                      if (cl_err != CL_SUCCESS) CL_ERROR;
-
-                      /* color conversion using BABL */
-                      gegl_buffer_set (i->buffer[no], &i->roi[no][j], i->format[no], data, GEGL_AUTO_ROWSTRIDE);
-
-                      cl_err = gegl_clEnqueueUnmapMemObject (gegl_cl_get_command_queue(), i->tex_buf[no][j], data,
-                                                             0, NULL, NULL);
-                      if (cl_err != CL_SUCCESS) CL_ERROR;
-                    }
-#endif
-                }
-            }
-        }
+      if (!gegl_buffer_cl_iterator_submit (i))
+        goto error;
+    }
 
-      /* Run! */
-      cl_err = gegl_clFinish(gegl_cl_get_command_queue());
-      if (cl_err != CL_SUCCESS) CL_ERROR;
+  g_assert (i->iterators > 0);
 
-      for (no=0; no < i->iterators; no++)
-        for (j=0; j < i->n; j++)
-          {
-            if (i->tex_buf[no][j] && !i->tex_buf_from_cache [no][j])
-              gegl_clReleaseMemObject (i->tex_buf[no][j]);
+  if (i->roi_no >= i->rois)
+    {
+      /* wait for every device and write back what is still pending */
+      for (d = 0; d < n_devices; d++)
+        if (!gegl_buffer_cl_iterator_complete (i, d))
+          goto error;
 
-            if (i->tex_op [no][j])
-              gegl_clReleaseMemObject (i->tex_op [no][j]);
+      gegl_buffer_cl_iterator_free (i);
 
-            i->tex    [no][j] = NULL;
-            i->tex_buf[no][j] = NULL;
-            i->tex_op [no][j] = NULL;
-          }
+      *err = FALSE;
+      return FALSE;
     }
 
-  g_assert (i->iterators > 0);
-  result = (i->roi_no >= i->rois)? FALSE : TRUE;
+  i->n = MIN(GEGL_CL_NTEX, MIN(i->rois_per_device, i->rois - i->roi_no));
+
+  /* Next device. Its previous batch is only read back now, when every
+   * other device has been given work, so the devices run concurrently.
+   */
+  i->device = (i->device + 1) % n_devices;
+  gegl_cl_set_current_device (i->device);
 
-  i->n = MIN(GEGL_CL_NTEX, i->rois - i->roi_no);
+  if (!gegl_buffer_cl_iterator_complete (i, i->device))
+    goto error;
 
   /* then we iterate all */
   for (no=0; no<i->iterators;no++)
@@ -530,53 +706,28 @@ gegl_buffer_cl_iterator_next (GeglBufferClIterator *iterator, gboolean *err)
 
   i->iteration_no++;
 
-  if (result == FALSE)
-    {
-      for (no=0; no<i->iterators;no++)
-        {
-          if (i->buffer[no])
-            {
-              gint j;
-              gboolean found = FALSE;
-              for (j=0; j<no; j++)
-                if (i->buffer[no]==i->buffer[j])
-                  {
-                    found = TRUE;
-                    break;
-                  }
-              if (!found)
-                gegl_buffer_unlock (i->buffer[no]);
-
-              g_object_unref (i->buffer[no]);
-            }
-        }
-
-      i->is_finished = TRUE;
-
-      g_free (i->roi_all);
-      g_slice_free (GeglBufferClIterators, i);
-    }
-
   *err = FALSE;
-  return result;
+  return TRUE;
 
 error:
 
-  for (no=0; no<i->iterators;no++)
-    for (j=0; j < i->n; j++)
-      {
-        if (i->tex_buf[no][j]) gegl_clReleaseMemObject (i->tex_buf[no][j]);
-        if (i->tex_op [no][j]) gegl_clReleaseMemObject (i->tex_op [no][j]);
-
-        i->tex    [no][j] = NULL;
-        i->tex_buf[no][j] = NULL;
-        i->tex_op [no][j] = NULL;
-      }
+  gegl_buffer_cl_iterator_free (i);
 
   *err = TRUE;
   return FALSE;
 }
 
+void
+gegl_buffer_cl_iterator_stop (GeglBufferClIterator *iterator)
+{
+  GeglBufferClIterators *i = (gpointer)iterator;
+
+  if (i->is_finished)
+    g_error ("%s called on finished buffer iterator", G_STRFUNC);
+
+  gegl_buffer_cl_iterator_free (i);
+}
+
 GeglBufferClIterator *
 gegl_buffer_cl_iterator_new (GeglBuffer          *buffer,
                              const GeglRectangle *roi,
@@ -38,8 +38,14 @@ gint gegl_buffer_cl_iterator_add_2 (GeglBufferClIterator  *iterator,
                                     gint                   top,
                                     gint                   bottom);
 
+/* the iterator is freed once this returns FALSE, also on errors */
 gboolean gegl_buffer_cl_iterator_next (GeglBufferClIterator *iterator, gboolean *err);
 
+/* free an iterator that is left before it is finished, output which has
+ * not been written back yet is dropped
+ */
+void gegl_buffer_cl_iterator_stop (GeglBufferClIterator *iterator);
+
 GeglBufferClIterator *gegl_buffer_cl_iterator_new (GeglBuffer          *buffer,
                                                    const GeglRectangle *roi,
                                                    const Babl          *format,
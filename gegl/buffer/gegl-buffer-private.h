@@ -86,6 +86,8 @@ gint              gegl_buffer_leaks       (void);
 
 void              gegl_buffer_stats       (void);
 
+void              gegl_sampler_stats      (void);
+
 void              gegl_buffer_save        (GeglBuffer          *buffer,
                                            const gchar         *path,
                                            const GeglRectangle *roi);
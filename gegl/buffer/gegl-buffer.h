@@ -423,6 +423,45 @@ void  gegl_sampler_get         (GeglSampler *sampler,
                                 GeglMatrix2 *scale,
                                 void        *output);
 
+/**
+ * gegl_sampler_get_span:
+ * @sampler: a GeglSampler gotten from gegl_buffer_sampler_new
+ * @x: x coordinate of the first sample
+ * @y: y coordinate of the first sample
+ * @dx: x step between successive samples
+ * @dy: y step between successive samples
+ * @scale: matrix representing extent of sampling area in source buffer.
+ * @n_pixels: number of samples
+ * @output: memory location for @n_pixels samples of output data.
+ *
+ * Perform @n_pixels samplings with the provided @sampler, the i-th at
+ * (@x + i * @dx, @y + i * @dy), such as a row of an affine transform. The
+ * results are the same as those of as many calls to gegl_sampler_get() but
+ * samplers interpolate a span several pixels at a time.
+ */
+void  gegl_sampler_get_span    (GeglSampler *sampler,
+                                gdouble      x,
+                                gdouble      y,
+                                gdouble      dx,
+                                gdouble      dy,
+                                GeglMatrix2 *scale,
+                                gint         n_pixels,
+                                void        *output);
+
+/**
+ * gegl_sampler_get_level:
+ * @sampler: a GeglSampler gotten from gegl_buffer_sampler_new
+ * @scale: matrix representing extent of sampling area in source buffer.
+ *
+ * Returns: the level of the mipmap pyramid of the buffer that
+ * gegl_sampler_get() and gegl_sampler_get_span() read for @scale, 0 for
+ * the buffer itself. A pixel of level n is the average of 2^n×2^n pixels
+ * of the buffer, the region of the buffer a sampling depends on grows
+ * accordingly.
+ */
+gint  gegl_sampler_get_level   (GeglSampler *sampler,
+                                GeglMatrix2 *scale);
+
 /**
  * gegl_sampler_get_context_rect:
  * @sampler: a GeglSampler gotten from gegl_buffer_sampler_new
@@ -48,6 +48,14 @@ static void           gegl_sampler_lanczos_get (GeglSampler  *sampler,
                                                 gdouble       y,
                                                 GeglMatrix2  *scale,
                                                 void         *output);
+static void           gegl_sampler_lanczos_get_span (GeglSampler *sampler,
+                                                     gdouble      x,
+                                                     gdouble      y,
+                                                     gdouble      dx,
+                                                     gdouble      dy,
+                                                     GeglMatrix2 *scale,
+                                                     gint         n_pixels,
+                                                     void        *output);
 static void           get_property             (GObject      *gobject,
                                                 guint         prop_id,
                                                 GValue       *value,
@@ -78,7 +86,8 @@ gegl_sampler_lanczos_class_init (GeglSamplerLanczosClass *klass)
   object_class->get_property = get_property;
   object_class->constructor  = gegl_sampler_lanczos_constructor;
 
-  sampler_class->get     = gegl_sampler_lanczos_get;
+  sampler_class->get      = gegl_sampler_lanczos_get;
+  sampler_class->get_span = gegl_sampler_lanczos_get_span;
 
   g_object_class_install_property (object_class, PROP_LANCZOS_WIDTH,
                                    g_param_spec_int ("lanczos_width",
@@ -103,7 +112,7 @@ gegl_sampler_lanczos_class_init (GeglSamplerLanczosClass *klass)
 static void
 gegl_sampler_lanczos_init (GeglSamplerLanczos *self)
 {
-
+  GEGL_SAMPLER (self)->interpolate_format = babl_format ("RaGaBaA float");
 }
 
 static GObject *
@@ -204,6 +213,108 @@ gegl_sampler_lanczos_get (GeglSampler *self,
   babl_process (self->fish, newval, output, 1);
 }
 
+/* The same interpolation as gegl_sampler_lanczos_get, for blocks of
+ * GEGL_SAMPLER_SPAN_BLOCK pixels of a span. The kernels of the pixels of a
+ * block are looked up and normalised together, then every pixel is summed
+ * a row of taps at a time from the fetched rectangle of the sampler, which
+ * gegl_sampler_get_ptr keeps around the whole context of the pixel, with
+ * the four channels of a tap summed at once.
+ */
+static void
+gegl_sampler_lanczos_get_span (GeglSampler *self,
+                               gdouble      x,
+                               gdouble      y,
+                               gdouble      dx,
+                               gdouble      dy,
+                               GeglMatrix2 *scale,
+                               gint         n_pixels,
+                               void        *output)
+{
+  GeglSamplerLanczos *lanczos = GEGL_SAMPLER_LANCZOS (self);
+  gint                spp     = lanczos->lanczos_spp;
+  gint                width   = lanczos->lanczos_width;
+  gint                width2  = self->context_rect[0].width;
+  gint                bpp     = babl_format_get_bytes_per_pixel (self->format);
+  guchar             *out     = output;
+  gfloat             *x_kernel, /* width2 arrays of the coefficients */
+                     *y_kernel; /* of the pixels of a block          */
+  gint                done;
+
+  x_kernel = g_newa (gfloat, width2 * GEGL_SAMPLER_SPAN_BLOCK);
+  y_kernel = g_newa (gfloat, width2 * GEGL_SAMPLER_SPAN_BLOCK);
+
+  for (done = 0; done < n_pixels; done += GEGL_SAMPLER_SPAN_BLOCK)
+    {
+      const gint n = MIN (GEGL_SAMPLER_SPAN_BLOCK, n_pixels - done);
+
+      gint    ix[GEGL_SAMPLER_SPAN_BLOCK];
+      gint    iy[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat  x_sum[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat  y_sum[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat  newval[GEGL_SAMPLER_SPAN_BLOCK * 4];
+      gint    i, j, k, c;
+
+      for (i = 0; i < n; i++)
+        {
+          const gdouble sample_x = x + (done + i) * dx;
+          const gdouble sample_y = y + (done + i) * dy;
+          gint          phase_x, phase_y;
+
+          ix[i] = (gint) sample_x;
+          iy[i] = (gint) sample_y;
+          phase_x = (gint) ((sample_x - ix[i]) * spp + 0.5);
+          phase_y = (gint) ((sample_y - iy[i]) * spp + 0.5);
+
+          x_sum[i] = y_sum[i] = 0.0;
+          for (k = 0; k < width2; k++)
+            {
+              gint pos = (k - width) * spp;
+
+              x_kernel[k * GEGL_SAMPLER_SPAN_BLOCK + i] =
+                lanczos->lanczos_lookup[ABS (phase_x - pos)];
+              y_kernel[k * GEGL_SAMPLER_SPAN_BLOCK + i] =
+                lanczos->lanczos_lookup[ABS (phase_y - pos)];
+              x_sum[i] += x_kernel[k * GEGL_SAMPLER_SPAN_BLOCK + i];
+              y_sum[i] += y_kernel[k * GEGL_SAMPLER_SPAN_BLOCK + i];
+            }
+        }
+
+      /* normalise the weighted arrays */
+      for (k = 0; k < width2; k++)
+        for (i = 0; i < n; i++)
+          {
+            x_kernel[k * GEGL_SAMPLER_SPAN_BLOCK + i] /= x_sum[i];
+            y_kernel[k * GEGL_SAMPLER_SPAN_BLOCK + i] /= y_sum[i];
+          }
+
+      for (i = 0; i < n; i++)
+        {
+          const gfloat *sampler_bptr =
+            gegl_sampler_get_ptr (self, ix[i], iy[i]) - width * (64 + 1) * 4;
+          gfloat        sum[4] = {0.0, 0.0, 0.0, 0.0};
+
+          for (j = 0; j < width2; j++, sampler_bptr += 64 * 4)
+            {
+              gfloat row[4] = {0.0, 0.0, 0.0, 0.0};
+
+              for (k = 0; k < width2; k++)
+                for (c = 0; c < 4; c++)
+                  row[c] += x_kernel[k * GEGL_SAMPLER_SPAN_BLOCK + i] *
+                            sampler_bptr[k * 4 + c];
+
+              for (c = 0; c < 4; c++)
+                sum[c] += y_kernel[j * GEGL_SAMPLER_SPAN_BLOCK + i] * row[c];
+            }
+
+          for (c = 0; c < 4; c++)
+            newval[i * 4 + c] = sum[c];
+        }
+
+      babl_process (self->fish, newval, out, n);
+      out += n * bpp;
+    }
+}
+
 static void
 get_property (GObject    *object,
               guint       prop_id,
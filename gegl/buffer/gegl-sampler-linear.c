@@ -68,6 +68,15 @@ static void gegl_sampler_linear_get (GeglSampler* restrict self,
                                      GeglMatrix2          *scale,
                                      void*        restrict output);
 
+static void gegl_sampler_linear_get_span (GeglSampler *self,
+                                          gdouble      x,
+                                          gdouble      y,
+                                          gdouble      dx,
+                                          gdouble      dy,
+                                          GeglMatrix2 *scale,
+                                          gint         n_pixels,
+                                          void        *output);
+
 static void set_property (GObject*      gobject,
                           guint         property_id,
                           const GValue* value,
@@ -90,6 +99,7 @@ gegl_sampler_linear_class_init (GeglSamplerLinearClass *klass)
   object_class->get_property = get_property;
 
   sampler_class->get = gegl_sampler_linear_get;
+  sampler_class->get_span = gegl_sampler_linear_get_span;
 }
 
 static void
@@ -223,6 +233,83 @@ gegl_sampler_linear_get (GeglSampler* restrict self,
   }
 }
 
+/*
+ * The same interpolation as gegl_sampler_linear_get, for blocks of
+ * GEGL_SAMPLER_SPAN_BLOCK pixels of a span: the weights of the pixels of a
+ * block are computed together, then the four channels of every pixel are
+ * summed at once, loops the compiler turns into vector instructions. The
+ * results of a block are converted with a single babl_process.
+ */
+static void
+gegl_sampler_linear_get_span (GeglSampler *self,
+                              gdouble      absolute_x,
+                              gdouble      absolute_y,
+                              gdouble      dx,
+                              gdouble      dy,
+                              GeglMatrix2 *scale,
+                              gint         n_pixels,
+                              void        *output)
+{
+  const gint pixels_per_buffer_row = 64;
+  const gint channels = 4;
+  const gint bpp = babl_format_get_bytes_per_pixel (self->format);
+  guchar    *out = output;
+  gint       done;
+
+  for (done = 0; done < n_pixels; done += GEGL_SAMPLER_SPAN_BLOCK)
+    {
+      const gint n = MIN (GEGL_SAMPLER_SPAN_BLOCK, n_pixels - done);
+
+      gint   ix[GEGL_SAMPLER_SPAN_BLOCK];
+      gint   iy[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat x_times_y[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat w_times_y[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat x_times_z[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat w_times_z[GEGL_SAMPLER_SPAN_BLOCK];
+      gfloat newval[GEGL_SAMPLER_SPAN_BLOCK * 4];
+      gint   i, c;
+
+      for (i = 0; i < n; i++)
+        {
+          const gdouble sample_x = absolute_x + (done + i) * dx;
+          const gdouble sample_y = absolute_y + (done + i) * dy;
+
+          ix[i] = FAST_PSEUDO_FLOOR (sample_x);
+          iy[i] = FAST_PSEUDO_FLOOR (sample_y);
+
+          {
+          const gfloat x = sample_x - ix[i];
+          const gfloat y = sample_y - iy[i];
+
+          x_times_y[i] = x * y;
+          w_times_y[i] = y - x_times_y[i];
+          x_times_z[i] = x - x_times_y[i];
+          w_times_z[i] = 1.f - ( x + w_times_y[i] );
+          }
+        }
+
+      for (i = 0; i < n; i++)
+        {
+          const gfloat* restrict top_bptr = gegl_sampler_get_ptr (self, ix[i], iy[i]);
+          const gfloat* restrict bot_bptr =
+            top_bptr + pixels_per_buffer_row * channels;
+
+          for (c = 0; c < 4; c++)
+            newval[i * 4 + c] =
+              x_times_y[i] * bot_bptr[channels + c]
+              +
+              w_times_y[i] * bot_bptr[c]
+              +
+              x_times_z[i] * top_bptr[channels + c]
+              +
+              w_times_z[i] * top_bptr[c];
+        }
+
+      babl_process (self->fish, newval, out, n);
+      out += n * bpp;
+    }
+}
+
 static void
 set_property (GObject*      gobject,
               guint         property_id,
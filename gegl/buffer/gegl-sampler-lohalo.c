@@ -284,6 +284,9 @@ gegl_sampler_lohalo_class_init (GeglSamplerLohaloClass *klass)
   object_class->set_property = set_property;
   object_class->get_property = get_property;
   sampler_class->get = gegl_sampler_lohalo_get;
+
+  /* lohalo adapts to the scale itself, from level 0 and 1 */
+  sampler_class->levels = FALSE;
 }
 
 
@@ -29,6 +29,7 @@
 #include "gegl-buffer.h"
 #include "gegl-utils.h"
 #include "gegl-buffer-private.h"
+#include "gegl-tile-storage.h"
 
 #include "gegl-sampler-nearest.h"
 #include "gegl-sampler-linear.h"
@@ -66,8 +67,51 @@ static void set_property (      GObject      *gobject,
 static void set_buffer (GeglSampler  *self,
                         GeglBuffer   *buffer);
 
+static void get_span (GeglSampler *self,
+                      gdouble      x,
+                      gdouble      y,
+                      gdouble      dx,
+                      gdouble      dy,
+                      GeglMatrix2 *scale,
+                      gint         n_pixels,
+                      void        *output);
+
+static void tile_cache_clear (GeglSampler *self);
+
+static void gegl_sampler_fetch (GeglSampler         *self,
+                                const GeglRectangle *rect,
+                                gpointer             dest);
+
 G_DEFINE_TYPE (GeglSampler, gegl_sampler, G_TYPE_OBJECT)
 
+/*
+ * The number of source tiles a sampler keeps, enough for the tiles
+ * under a fetched rectangle and those next to it in any direction.
+ */
+#define GEGL_SAMPLER_CACHED_TILES 8
+
+typedef struct
+{
+  gint      x, y;       /* indices of the tile */
+  GeglTile *tile;       /* the tile, when its format is interpolate_format */
+  guchar   *converted;  /* its pixels in interpolate_format otherwise */
+  guchar   *data;       /* whichever of the two holds the pixels */
+  guint     last_use;
+} SamplerTile;
+
+typedef struct
+{
+  SamplerTile tiles[GEGL_SAMPLER_CACHED_TILES];
+  guint       clock;
+} SamplerTileCache;
+
+/* refetch traffic of all the samplers, reported by gegl_sampler_stats */
+static volatile gint fetched_rectangles = 0;
+static volatile gint tile_hits          = 0;
+static volatile gint tile_reads         = 0;
+static volatile gint tile_conversions   = 0;
+static volatile gint level_fetches      = 0;
+
 static void
 gegl_sampler_class_init (GeglSamplerClass *klass)
 {
@@ -78,7 +122,9 @@ gegl_sampler_class_init (GeglSamplerClass *klass)
 
   klass->prepare = NULL;
   klass->get     = NULL;
+  klass->levels  = TRUE;
   klass->set_buffer   = set_buffer;
+  klass->get_span     = get_span;
 
   object_class->set_property = set_property;
   object_class->get_property = get_property;
@@ -115,6 +161,62 @@ gegl_sampler_init (GeglSampler *self)
   }
 }
 
+/*
+ * The level of the pyramid of the buffer to sample for scale, the inverse
+ * jacobian of the transformation: the one where neighbouring output
+ * pixels are less than two pixels apart in the direction they are the
+ * furthest apart. A pixel of level n is the average of 2^n×2^n pixels of
+ * the buffer, sampling it instead of the buffer reads 4^n times fewer
+ * pixels and does not alias.
+ */
+gint
+gegl_sampler_get_level (GeglSampler *self,
+                        GeglMatrix2 *scale)
+{
+  gdouble footprint;
+  gint    level = 0;
+
+  if (!scale || !GEGL_SAMPLER_GET_CLASS (self)->levels)
+    return 0;
+
+  /* the level is picked for the axis reduced least, reading a level for
+   * the other one would blur this axis too, like scale_filter_level in
+   * affine.c does
+   */
+  footprint = MIN (hypot (scale->coeff[0][0], scale->coeff[1][0]),
+                   hypot (scale->coeff[0][1], scale->coeff[1][1]));
+
+  while (footprint >= 2.0 && level < GEGL_SAMPLER_MIPMAP_LEVELS - 1)
+    {
+      footprint /= 2.0;
+      level++;
+    }
+
+  return level;
+}
+
+/*
+ * Maps the coordinates and scale of the buffer to those of level, pixel x
+ * of the level is the average of pixels x * 2^level to
+ * (x + 1) * 2^level - 1 of the buffer.
+ */
+static void
+level_coordinates (gint         level,
+                   gdouble     *x,
+                   gdouble     *y,
+                   GeglMatrix2 *scale)
+{
+  gdouble factor = 1 << level;
+  gint    i, j;
+
+  *x = (*x - (factor - 1.0) / 2.0) / factor;
+  *y = (*y - (factor - 1.0) / 2.0) / factor;
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 2; j++)
+      scale->coeff[i][j] /= factor;
+}
+
 void
 gegl_sampler_get (GeglSampler *self,
                   gdouble      x,
@@ -122,13 +224,79 @@ gegl_sampler_get (GeglSampler *self,
                   GeglMatrix2 *scale,
                   void        *output)
 {
-  self->get (self, x, y, scale, output);
+  GeglMatrix2 level_scale;
+  gint        level = gegl_sampler_get_level (self, scale);
+
+  if (!level)
+    {
+      self->get (self, x, y, scale, output);
+      return;
+    }
+
+  level_scale = *scale;
+  level_coordinates (level, &x, &y, &level_scale);
+
+  self->level = level;
+  self->get (self, x, y, &level_scale, output);
+  self->level = 0;
+}
+
+void
+gegl_sampler_get_span (GeglSampler *self,
+                       gdouble      x,
+                       gdouble      y,
+                       gdouble      dx,
+                       gdouble      dy,
+                       GeglMatrix2 *scale,
+                       gint         n_pixels,
+                       void        *output)
+{
+  GeglSamplerClass *klass = GEGL_SAMPLER_GET_CLASS (self);
+  GeglMatrix2       level_scale;
+  gint              level = gegl_sampler_get_level (self, scale);
+
+  if (!level)
+    {
+      klass->get_span (self, x, y, dx, dy, scale, n_pixels, output);
+      return;
+    }
+
+  level_scale = *scale;
+  level_coordinates (level, &x, &y, &level_scale);
+  dx /= 1 << level;
+  dy /= 1 << level;
+
+  self->level = level;
+  klass->get_span (self, x, y, dx, dy, &level_scale, n_pixels, output);
+  self->level = 0;
+}
+
+/* samplers without a span implementation of their own sample the pixels
+ * of the span one at a time
+ */
+static void
+get_span (GeglSampler *self,
+          gdouble      x,
+          gdouble      y,
+          gdouble      dx,
+          gdouble      dy,
+          GeglMatrix2 *scale,
+          gint         n_pixels,
+          void        *output)
+{
+  const gint bpp = babl_format_get_bytes_per_pixel (self->format);
+  guchar    *out = output;
+  gint       i;
+
+  for (i = 0; i < n_pixels; i++, out += bpp)
+    self->get (self, x + i * dx, y + i * dy, scale, out);
 }
 
 void
 gegl_sampler_prepare (GeglSampler *self)
 {
   GeglSamplerClass *klass;
+  gint              i;
 
   g_return_if_fail (GEGL_IS_SAMPLER (self));
 
@@ -144,8 +312,12 @@ gegl_sampler_prepare (GeglSampler *self)
    * This makes the cache rect invalid, in case the data in the buffer
    * has changed:
    */
-  self->sampler_rectangle[0].width = 0;
-  self->sampler_rectangle[0].height = 0;
+  for (i = 0; i < GEGL_SAMPLER_MIPMAP_LEVELS; i++)
+    {
+      self->sampler_rectangle[i].width = 0;
+      self->sampler_rectangle[i].height = 0;
+    }
+  tile_cache_clear (self);
 
 #if 0
   if (self->cache_buffer) /* Force a regetting of the region, even
@@ -184,6 +356,14 @@ finalize (GObject *gobject)
           sampler->sampler_buffer[i] = NULL;
         }
     }
+  if (sampler->tile_cache)
+    {
+      tile_cache_clear (sampler);
+      for (i = 0; i < GEGL_SAMPLER_CACHED_TILES; i++)
+        g_free (((SamplerTileCache *) sampler->tile_cache)->tiles[i].converted);
+      g_slice_free (SamplerTileCache, sampler->tile_cache);
+      sampler->tile_cache = NULL;
+    }
   G_OBJECT_CLASS (gegl_sampler_parent_class)->finalize (gobject);
 }
 
@@ -191,6 +371,7 @@ static void
 dispose (GObject *gobject)
 {
   GeglSampler *sampler = GEGL_SAMPLER (gobject);
+  tile_cache_clear (sampler);
   if (sampler->buffer)
     {
       g_object_unref (sampler->buffer);
@@ -199,6 +380,203 @@ dispose (GObject *gobject)
   G_OBJECT_CLASS (gegl_sampler_parent_class)->dispose (gobject);
 }
 
+static void
+tile_cache_clear (GeglSampler *self)
+{
+  SamplerTileCache *cache = self->tile_cache;
+  gint              i;
+
+  if (!cache)
+    return;
+
+  for (i = 0; i < GEGL_SAMPLER_CACHED_TILES; i++)
+    {
+      if (cache->tiles[i].tile)
+        gegl_tile_unref (cache->tiles[i].tile);
+      cache->tiles[i].tile = NULL;
+      cache->tiles[i].data = NULL;
+    }
+}
+
+/*
+ * Returns the pixels of the tile at indices x, y of the buffer in
+ * interpolate_format, or NULL if the buffer has no such tile. Tiles
+ * already in interpolate_format are read in place, the others are
+ * converted once and kept until they are the least recently used of the
+ * cache.
+ */
+static guchar *
+tile_cache_get (GeglSampler *self,
+                gint         x,
+                gint         y)
+{
+  SamplerTileCache *cache  = self->tile_cache;
+  GeglBuffer       *buffer = self->buffer;
+  SamplerTile      *entry;
+  GeglTile         *tile;
+  gint              i;
+
+  if (!cache)
+    cache = self->tile_cache = g_slice_new0 (SamplerTileCache);
+
+  entry = &cache->tiles[0];
+  for (i = 0; i < GEGL_SAMPLER_CACHED_TILES; i++)
+    {
+      SamplerTile *candidate = &cache->tiles[i];
+
+      if (candidate->data && candidate->x == x && candidate->y == y)
+        {
+          g_atomic_int_inc (&tile_hits);
+          candidate->last_use = ++cache->clock;
+          return candidate->data;
+        }
+
+      if (!candidate->data)
+        entry = candidate;
+      else if (entry->data && candidate->last_use < entry->last_use)
+        entry = candidate;
+    }
+
+  if (entry->tile)
+    gegl_tile_unref (entry->tile);
+  entry->tile = NULL;
+  entry->data = NULL;
+
+  tile = gegl_tile_source_get_tile ((GeglTileSource *) buffer, x, y, 0);
+  if (!tile)
+    return NULL;
+
+  g_atomic_int_inc (&tile_reads);
+
+  if (buffer->format == self->interpolate_format)
+    {
+      entry->tile = tile;
+      entry->data = gegl_tile_get_data (tile);
+    }
+  else
+    {
+      gint tile_width  = buffer->tile_storage->tile_width;
+      gint tile_height = buffer->tile_storage->tile_height;
+
+      if (!entry->converted)
+        entry->converted =
+          g_malloc (tile_width * tile_height *
+                    babl_format_get_bytes_per_pixel (self->interpolate_format));
+
+      babl_process (babl_fish (buffer->format, self->interpolate_format),
+                    gegl_tile_get_data (tile), entry->converted,
+                    tile_width * tile_height);
+      gegl_tile_unref (tile);
+
+      g_atomic_int_inc (&tile_conversions);
+      entry->data = entry->converted;
+    }
+
+  entry->x        = x;
+  entry->y        = y;
+  entry->last_use = ++cache->clock;
+
+  return entry->data;
+}
+
+/*
+ * Fills dest, with the rowstride of rect, with the pixels of rect in
+ * interpolate_format, zero outside the abyss of the buffer like
+ * gegl_buffer_get. The pixels are copied from the tile cache, so that
+ * overlapping or neighbouring rectangles read and convert the source
+ * only once.
+ */
+static void
+gegl_sampler_fetch (GeglSampler         *self,
+                    const GeglRectangle *rect,
+                    gpointer             dest)
+{
+  GeglBuffer    *buffer = self->buffer;
+  gint           bpp;
+  gint           tile_width;
+  gint           tile_height;
+  GeglRectangle  inside;
+  gint           x, y;
+
+  g_atomic_int_inc (&fetched_rectangles);
+
+  /* the levels of the pyramid are made and cached by the zoom handler of
+   * the buffer
+   */
+  if (self->level > 0)
+    {
+      g_atomic_int_inc (&level_fetches);
+      gegl_buffer_get (buffer, 1.0 / (1 << self->level), rect,
+                       self->interpolate_format, dest, GEGL_AUTO_ROWSTRIDE);
+      return;
+    }
+
+  /* the tiles are not up to date while OpenCL holds the data */
+  if (cl_state.is_accelerated)
+    {
+      gegl_buffer_get (buffer, 1.0, rect, self->interpolate_format,
+                       dest, GEGL_AUTO_ROWSTRIDE);
+      return;
+    }
+
+  bpp         = babl_format_get_bytes_per_pixel (self->interpolate_format);
+  tile_width  = buffer->tile_storage->tile_width;
+  tile_height = buffer->tile_storage->tile_height;
+
+  if (!gegl_rectangle_intersect (&inside, rect, &buffer->abyss))
+    {
+      memset (dest, 0, rect->width * rect->height * bpp);
+      return;
+    }
+  if (!gegl_rectangle_equal (&inside, rect))
+    memset (dest, 0, rect->width * rect->height * bpp);
+
+  for (y = inside.y; y < inside.y + inside.height;)
+    {
+      gint tiled_y = y + buffer->shift_y;
+      gint offset_y = gegl_tile_offset (tiled_y, tile_height);
+      gint rows     = MIN (tile_height - offset_y,
+                           inside.y + inside.height - y);
+
+      for (x = inside.x; x < inside.x + inside.width;)
+        {
+          gint    tiled_x  = x + buffer->shift_x;
+          gint    offset_x = gegl_tile_offset (tiled_x, tile_width);
+          gint    columns  = MIN (tile_width - offset_x,
+                                  inside.x + inside.width - x);
+          guchar *src      = tile_cache_get (self,
+                                             gegl_tile_indice (tiled_x, tile_width),
+                                             gegl_tile_indice (tiled_y, tile_height));
+          guchar *dst      = (guchar *) dest +
+                             ((y - rect->y) * rect->width + x - rect->x) * bpp;
+          gint    row;
+
+          for (row = 0; row < rows; row++, dst += rect->width * bpp)
+            {
+              if (src)
+                memcpy (dst,
+                        src + ((offset_y + row) * tile_width + offset_x) * bpp,
+                        columns * bpp);
+              else
+                memset (dst, 0, columns * bpp);
+            }
+
+          x += columns;
+        }
+
+      y += rows;
+    }
+}
+
+void
+gegl_sampler_stats (void)
+{
+  g_warning ("Sampler statistics: fetched rectangles:%i tiles read:%i "
+             "converted:%i reused:%i from levels:%i",
+             fetched_rectangles, tile_reads, tile_conversions, tile_hits,
+             level_fetches);
+}
+
 /*
  * Gets a pointer to the center pixel, within a buffer that has a
  * rowstride of 64px * 16bpp:
@@ -213,6 +591,7 @@ gegl_sampler_get_ptr (GeglSampler *const sampler,
   gint    dy;
   gint    sof;
 
+  const gint level = sampler->level;
   const gint bpp =
     babl_format_get_bytes_per_pixel (sampler->interpolate_format);
 
@@ -225,21 +604,21 @@ gegl_sampler_get_ptr (GeglSampler *const sampler,
   g_assert (sampler->context_rect[0].width  <= maximum_width_and_height);
   g_assert (sampler->context_rect[0].height <= maximum_width_and_height);
 
-  if (( sampler->sampler_buffer[0] == NULL )
+  if (( sampler->sampler_buffer[level] == NULL )
       ||
-      ( x + sampler->context_rect[0].x < sampler->sampler_rectangle[0].x )
+      ( x + sampler->context_rect[0].x < sampler->sampler_rectangle[level].x )
       ||
-      ( y + sampler->context_rect[0].y < sampler->sampler_rectangle[0].y )
+      ( y + sampler->context_rect[0].y < sampler->sampler_rectangle[level].y )
       ||
       ( x + sampler->context_rect[0].x + sampler->context_rect[0].width
-        > sampler->sampler_rectangle[0].x + sampler->sampler_rectangle[0].width )
+        > sampler->sampler_rectangle[level].x + sampler->sampler_rectangle[level].width )
       ||
       ( y + sampler->context_rect[0].y + sampler->context_rect[0].height
-        > sampler->sampler_rectangle[0].y + sampler->sampler_rectangle[0].height ))
+        > sampler->sampler_rectangle[level].y + sampler->sampler_rectangle[level].height ))
     {
       /*
        * fetch_rectangle will become the value of
-       * sampler->sampler_rectangle[0]:
+       * sampler->sampler_rectangle[level]:
        */
       GeglRectangle fetch_rectangle;
 
@@ -266,30 +645,25 @@ gegl_sampler_get_ptr (GeglSampler *const sampler,
       fetch_rectangle.width  = maximum_width_and_height;
       fetch_rectangle.height = maximum_width_and_height;
 
-      if (sampler->sampler_buffer[0] == NULL)
+      if (sampler->sampler_buffer[level] == NULL)
         {
           /*
            * Always request the same amount of pixels:
            */
-          sampler->sampler_buffer[0] =
+          sampler->sampler_buffer[level] =
             g_malloc0 (( maximum_width_and_height * maximum_width_and_height )
                        * bpp);
         }
 
-      gegl_buffer_get (sampler->buffer,
-                       1.0,
-                       &fetch_rectangle,
-                       sampler->interpolate_format,
-                       sampler->sampler_buffer[0],
-                       GEGL_AUTO_ROWSTRIDE);
+      gegl_sampler_fetch (sampler, &fetch_rectangle, sampler->sampler_buffer[level]);
 
-      sampler->sampler_rectangle[0] = fetch_rectangle;
+      sampler->sampler_rectangle[level] = fetch_rectangle;
     }
 
-  dx = x - sampler->sampler_rectangle[0].x;
-  dy = y - sampler->sampler_rectangle[0].y;
-  buffer_ptr = (guchar *)sampler->sampler_buffer[0];
-  sof = ( dx + dy * sampler->sampler_rectangle[0].width ) * bpp;
+  dx = x - sampler->sampler_rectangle[level].x;
+  dy = y - sampler->sampler_rectangle[level].y;
+  buffer_ptr = (guchar *)sampler->sampler_buffer[level];
+  sof = ( dx + dy * sampler->sampler_rectangle[level].width ) * bpp;
 
   return (gfloat*)(buffer_ptr+sof);
 }
@@ -304,6 +678,7 @@ gegl_sampler_get_from_buffer (GeglSampler *const sampler,
   gint    dy;
   gint    sof;
 
+  const gint level = sampler->level;
   const gint bpp =
     babl_format_get_bytes_per_pixel (sampler->interpolate_format);
 
@@ -316,15 +691,15 @@ gegl_sampler_get_from_buffer (GeglSampler *const sampler,
   g_assert (sampler->context_rect[0].width  <= maximum_width_and_height);
   g_assert (sampler->context_rect[0].height <= maximum_width_and_height);
 
-  if (( sampler->sampler_buffer[0] == NULL )
+  if (( sampler->sampler_buffer[level] == NULL )
       ||
-      ( x < sampler->sampler_rectangle[0].x )
+      ( x < sampler->sampler_rectangle[level].x )
       ||
-      ( y < sampler->sampler_rectangle[0].y )
+      ( y < sampler->sampler_rectangle[level].y )
       ||
-      ( x >= sampler->sampler_rectangle[0].x + sampler->sampler_rectangle[0].width )
+      ( x >= sampler->sampler_rectangle[level].x + sampler->sampler_rectangle[level].width )
       ||
-      ( y >= sampler->sampler_rectangle[0].y + sampler->sampler_rectangle[0].height ))
+      ( y >= sampler->sampler_rectangle[level].y + sampler->sampler_rectangle[level].height ))
     {
       /*
        * fetch_rectangle will become the value of
@@ -340,30 +715,25 @@ gegl_sampler_get_from_buffer (GeglSampler *const sampler,
       fetch_rectangle.width  = maximum_width_and_height;
       fetch_rectangle.height = maximum_width_and_height;
 
-      if (sampler->sampler_buffer[0] == NULL)
+      if (sampler->sampler_buffer[level] == NULL)
         {
           /*
            * Always request the same amount of pixels:
            */
-          sampler->sampler_buffer[0] =
+          sampler->sampler_buffer[level] =
             g_malloc0 (( maximum_width_and_height * maximum_width_and_height )
                        * bpp);
         }
 
-      gegl_buffer_get (sampler->buffer,
-                       1.0,
-                       &fetch_rectangle,
-                       sampler->interpolate_format,
-                       sampler->sampler_buffer[0],
-                       GEGL_AUTO_ROWSTRIDE);
+      gegl_sampler_fetch (sampler, &fetch_rectangle, sampler->sampler_buffer[level]);
 
-      sampler->sampler_rectangle[0] = fetch_rectangle;
+      sampler->sampler_rectangle[level] = fetch_rectangle;
     }
 
-  dx = x - sampler->sampler_rectangle[0].x;
-  dy = y - sampler->sampler_rectangle[0].y;
-  buffer_ptr = (guchar *)sampler->sampler_buffer[0];
-  sof = ( dx + dy * sampler->sampler_rectangle[0].width ) * bpp;
+  dx = x - sampler->sampler_rectangle[level].x;
+  dy = y - sampler->sampler_rectangle[level].y;
+  buffer_ptr = (guchar *)sampler->sampler_buffer[level];
+  sof = ( dx + dy * sampler->sampler_rectangle[level].width ) * bpp;
 
   return (gfloat*)(buffer_ptr+sof);
 }
@@ -514,6 +884,14 @@ set_buffer (GeglSampler *self, GeglBuffer *buffer)
 {
    if (self->buffer != buffer)
      {
+       gint i;
+
+       tile_cache_clear (self);
+       for (i = 0; i < GEGL_SAMPLER_MIPMAP_LEVELS; i++)
+         {
+           self->sampler_rectangle[i].width = 0;
+           self->sampler_rectangle[i].height = 0;
+         }
        if (GEGL_IS_BUFFER(self->buffer))
          g_object_unref(self->buffer);
        if (GEGL_IS_BUFFER (buffer))
@@ -31,7 +31,12 @@ G_BEGIN_DECLS
 #define GEGL_IS_SAMPLER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEGL_TYPE_SAMPLER))
 #define GEGL_IS_SAMPLER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GEGL_TYPE_SAMPLER))
 #define GEGL_SAMPLER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GEGL_TYPE_SAMPLER, GeglSamplerClass))
-#define GEGL_SAMPLER_MIPMAP_LEVELS   3
+#define GEGL_SAMPLER_MIPMAP_LEVELS   8
+
+/* number of pixels of a span the samplers interpolate at once, their
+ * coordinates, weights and taps are kept in arrays of this size
+ */
+#define GEGL_SAMPLER_SPAN_BLOCK      64
 
 typedef struct _GeglSamplerClass GeglSamplerClass;
 
@@ -58,6 +63,11 @@ struct _GeglSampler
   GeglRectangle  sampler_rectangle[GEGL_SAMPLER_MIPMAP_LEVELS];
   gdouble        x; /* mirrors the currently requested */
   gdouble        y; /* coordinates in the instance     */
+  gpointer       tile_cache; /* source tiles in interpolate_format the
+                                fetched rectangles are copied from */
+  gint           level;      /* level of the pyramid get_ptr and
+                                get_from_buffer read, chosen from the
+                                scale by gegl_sampler_get */
 
 };
 
@@ -65,6 +75,11 @@ struct _GeglSamplerClass
 {
   GObjectClass  parent_class;
 
+  /* whether downscales sample a level of the pyramid of the buffer, the
+   * samplers that use the scale themselves turn it off
+   */
+  gboolean      levels;
+
   void (* prepare)   (GeglSampler *self);
   void (* get)       (GeglSampler *self,
                       gdouble      x,
@@ -73,6 +88,14 @@ struct _GeglSamplerClass
                       void        *output);
  void  (*set_buffer) (GeglSampler  *self,
                       GeglBuffer   *buffer);
+  void (* get_span)  (GeglSampler *self,
+                      gdouble      x,
+                      gdouble      y,
+                      gdouble      dx,
+                      gdouble      dy,
+                      GeglMatrix2 *scale,
+                      gint         n_pixels,
+                      void        *output);
 };
 
 GType gegl_sampler_get_type    (void) G_GNUC_CONST;
@@ -88,6 +111,18 @@ void  gegl_sampler_get         (GeglSampler *self,
                                 GeglMatrix2 *scale,
                                 void        *output);
 
+void  gegl_sampler_get_span    (GeglSampler *self,
+                                gdouble      x,
+                                gdouble      y,
+                                gdouble      dx,
+                                gdouble      dy,
+                                GeglMatrix2 *scale,
+                                gint         n_pixels,
+                                void        *output);
+
+gint  gegl_sampler_get_level   (GeglSampler *self,
+                                GeglMatrix2 *scale);
+
 gfloat * gegl_sampler_get_from_buffer (GeglSampler *sampler,
                                        gint         x,
                                        gint         y);
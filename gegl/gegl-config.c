@@ -41,7 +41,10 @@ enum
   PROP_TILE_WIDTH,
   PROP_TILE_HEIGHT,
   PROP_THREADS,
-  PROP_USE_OPENCL
+  PROP_USE_OPENCL,
+  PROP_MERGE_DUPLICATES,
+  PROP_DISK_CACHE,
+  PROP_DISK_CACHE_SIZE
 };
 
 static void
@@ -90,6 +93,18 @@ gegl_config_get_property (GObject    *gobject,
         g_value_set_boolean (value, config->use_opencl);
         break;
 
+      case PROP_MERGE_DUPLICATES:
+        g_value_set_boolean (value, config->merge_duplicates);
+        break;
+
+      case PROP_DISK_CACHE:
+        g_value_set_string (value, config->disk_cache);
+        break;
+
+      case PROP_DISK_CACHE_SIZE:
+        g_value_set_int (value, config->disk_cache_size);
+        break;
+
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
         break;
@@ -160,6 +175,16 @@ gegl_config_set_property (GObject      *gobject,
         if (config->use_opencl)
           gegl_cl_init (NULL);
 
+        break;
+      case PROP_MERGE_DUPLICATES:
+        config->merge_duplicates = g_value_get_boolean (value);
+        break;
+      case PROP_DISK_CACHE:
+        g_free (config->disk_cache);
+        config->disk_cache = g_value_dup_string (value);
+        break;
+      case PROP_DISK_CACHE_SIZE:
+        config->disk_cache_size = g_value_get_int (value);
         break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (gobject, property_id, pspec);
@@ -174,6 +199,7 @@ gegl_config_finalize (GObject *gobject)
 
   if (config->swap)
     g_free (config->swap);
+  g_free (config->disk_cache);
 
   G_OBJECT_CLASS (gegl_config_parent_class)->finalize (gobject);
 }
@@ -237,6 +263,22 @@ gegl_config_class_init (GeglConfigClass *klass)
                                                      TRUE,
                                                      G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_MERGE_DUPLICATES,
+                                   g_param_spec_boolean ("merge-duplicates", "Merge duplicate nodes",
+                                                     "compute the output of nodes of the same operation, properties and inputs once per evaluation",
+                                                     FALSE,
+                                                     G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_DISK_CACHE,
+                                   g_param_spec_string ("disk-cache", "Disk cache",
+                                                        "directory where the outputs of nodes are kept across runs", NULL,
+                                                        G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_DISK_CACHE_SIZE,
+                                   g_param_spec_int ("disk-cache-size", "Disk cache size", "size of the disk cache in megabytes",
+                                                     0, G_MAXINT, 1024,
+                                                     G_PARAM_READWRITE));
+
 }
 
 static void
@@ -250,4 +292,6 @@ gegl_config_init (GeglConfig *self)
   self->tile_height = 64;
   self->threads = 1;
   self->use_opencl = TRUE;
+  self->disk_cache = NULL;
+  self->disk_cache_size = 1024;
 }
@@ -46,6 +46,9 @@ struct _GeglConfig
   gint     tile_height;
   gint     threads;
   gboolean use_opencl;
+  gboolean merge_duplicates;
+  gchar   *disk_cache;      /* where node outputs are kept across runs */
+  gint     disk_cache_size; /* in megabytes */
 };
 
 struct _GeglConfigClass
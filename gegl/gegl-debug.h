@@ -14,7 +14,10 @@ typedef enum {
   GEGL_DEBUG_PROCESSOR       = 1 << 4,
   GEGL_DEBUG_CACHE           = 1 << 5,
   GEGL_DEBUG_MISC            = 1 << 6,
-  GEGL_DEBUG_INVALIDATION    = 1 << 7
+  GEGL_DEBUG_INVALIDATION    = 1 << 7,
+  GEGL_DEBUG_OPENCL          = 1 << 8,
+  GEGL_DEBUG_MERGE           = 1 << 9,
+  GEGL_DEBUG_DISK_CACHE      = 1 << 10
 } GeglDebugFlag;
 
 /* only compiled in from gegl-init.c but kept here to
@@ -30,12 +33,18 @@ static const GDebugKey gegl_debug_keys[] = {
   { "tile-backend",  GEGL_DEBUG_TILE_BACKEND},
   { "processor",     GEGL_DEBUG_PROCESSOR},
   { "invalidation",  GEGL_DEBUG_INVALIDATION},
+  { "opencl",        GEGL_DEBUG_OPENCL},
+  { "merge",         GEGL_DEBUG_MERGE},
+  { "disk-cache",    GEGL_DEBUG_DISK_CACHE},
   { "all",           GEGL_DEBUG_PROCESS|
                      GEGL_DEBUG_BUFFER_LOAD|
                      GEGL_DEBUG_BUFFER_SAVE|
                      GEGL_DEBUG_TILE_BACKEND|
                      GEGL_DEBUG_PROCESSOR|
-                     GEGL_DEBUG_CACHE},
+                     GEGL_DEBUG_CACHE|
+                     GEGL_DEBUG_OPENCL|
+                     GEGL_DEBUG_MERGE|
+                     GEGL_DEBUG_DISK_CACHE},
 };
 #endif /* GEGL_ENABLE_DEBUG */
 
@@ -94,6 +94,8 @@ guint gegl_debug_flags = 0;
 #include "buffer/gegl-buffer-private.h"
 #include "gegl-config.h"
 #include "graph/gegl-node.h"
+#include "opencl/gegl-cl-cost.h"
+#include "process/gegl-disk-cache.h"
 
 
 /* if this function is made to return NULL swapping is disabled */
@@ -307,6 +309,15 @@ GeglConfig *gegl_config (void)
       else
         config->use_opencl = FALSE;
 
+      if (g_getenv ("GEGL_MERGE_DUPLICATES") != NULL &&
+          strcmp (g_getenv ("GEGL_MERGE_DUPLICATES"), "yes") == 0)
+        config->merge_duplicates = TRUE;
+
+      if (g_getenv ("GEGL_DISK_CACHE"))
+        config->disk_cache = g_strdup (g_getenv ("GEGL_DISK_CACHE"));
+      if (g_getenv ("GEGL_DISK_CACHE_SIZE"))
+        config->disk_cache_size = atoi (g_getenv ("GEGL_DISK_CACHE_SIZE"));
+
       if (gegl_swap_dir())
         config->swap = g_strdup(gegl_swap_dir ());
     }
@@ -362,11 +373,15 @@ gegl_exit (void)
 {
   glong timing = gegl_ticks ();
 
+  gegl_disk_cache_stats ();
   gegl_tile_storage_cache_cleanup ();
   gegl_tile_cache_destroy ();
   gegl_operation_gtype_cleanup ();
   gegl_extension_handler_cleanup ();
 
+  if (cl_state.is_accelerated)
+    gegl_cl_cost_save ();
+
   if (module_db != NULL)
     {
       g_object_unref (module_db);
@@ -382,6 +397,7 @@ gegl_exit (void)
   if (g_getenv ("GEGL_DEBUG_BUFS") != NULL)
     {
       gegl_buffer_stats ();
+      gegl_sampler_stats ();
       gegl_tile_backend_ram_stats ();
       gegl_tile_backend_file_stats ();
       gegl_tile_backend_tiledir_stats ();
@@ -0,0 +1,29 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_OPENMP_H__
+#define __GEGL_OPENMP_H__
+
+/* _OMP (omp ...) marks a loop for OpenMP when the compiler supports it,
+ * HAVE_OPENMP is defined by configure
+ */
+#ifdef HAVE_OPENMP
+#define _OMP(x) _Pragma(#x)
+#else
+#define _OMP(x) /* OMP disabled: "#x" */
+#endif
+
+#endif
@@ -149,6 +149,7 @@ typedef struct
 #include <operation/gegl-operation-source.h>
 #include <operation/gegl-operation-sink.h>
 #include <operation/gegl-operation-meta.h>
+#include <operation/gegl-operation-statistics.h>
 
 #include <gegl-lookup.h>
 
@@ -29,6 +29,7 @@ typedef struct _GeglEvalVisitor      GeglEvalVisitor;
 typedef struct _GeglFinishVisitor    GeglFinishVisitor;
 typedef struct _GeglGraph            GeglGraph;
 typedef struct _GeglHaveVisitor      GeglHaveVisitor;
+typedef struct _GeglMergeVisitor     GeglMergeVisitor;
 typedef struct _GeglNeedVisitor      GeglNeedVisitor;
 typedef struct _GeglDotVisitor       GeglDotVisitor;
 #ifndef __GEGL_PLUGIN_H__
@@ -482,6 +482,25 @@ gegl_visitor_bfs_traverse (GeglVisitor   *self,
     }
 }
 
+/**
+ * gegl_visitor_list_traverse:
+ * @self: a #GeglVisitor
+ * @visitables: a list of #GeglVisitable.
+ *
+ * Visits the visitables of @visitables in the order of the list, without
+ * looking at what they depend on.  Traversing the visits list a dfs or bfs
+ * traversal left, reversed, visits the visitables in the same order again.
+ **/
+void
+gegl_visitor_list_traverse (GeglVisitor *self,
+                            GSList      *visitables)
+{
+  GSList *llink;
+
+  for (llink = visitables; llink; llink = g_slist_next (llink))
+    gegl_visitable_accept (llink->data, self);
+}
+
 /* should be called by extending classes when their visit_pad function
  * is called
  */
@@ -66,6 +66,8 @@ void     gegl_visitor_dfs_traverse    (GeglVisitor   *self,
                                        GeglVisitable *visitable);
 void     gegl_visitor_bfs_traverse    (GeglVisitor   *self,
                                        GeglVisitable *visitable);
+void     gegl_visitor_list_traverse   (GeglVisitor   *self,
+                                       GSList        *visitables);
 
 
 G_END_DECLS
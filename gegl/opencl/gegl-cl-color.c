@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "gegl.h"
 #include "gegl-cl-color.h"
 #include "gegl-cl-init.h"
@@ -6,7 +8,56 @@
 
 static gegl_cl_run_data *kernels_color = NULL;
 
-#define CL_FORMAT_N 9
+/* Every format listed here can be converted to any other one on the device,
+ * going through "RGBA float" with a generated pair of kernels when there is
+ * no direct kernel for the conversion.
+ */
+typedef struct
+{
+  const gchar *name;          /* babl format name            */
+  const gchar *kernel;        /* stem of the kernel names    */
+  const gchar *type;          /* OpenCL type of a component  */
+  const gchar *scale;         /* value of 1.0 in that type   */
+  gint         components;
+  gboolean     gamma;
+  gboolean     premultiplied;
+} ClColorFormat;
+
+static const ClColorFormat cl_format[] =
+{
+  /* "RGBA float" is the pivot format and must stay first */
+  {"RGBA float",       "rgbaf",           "float",  "1.0f",     4, FALSE, FALSE},
+  {"RGBA u8",          "rgbau8",          "uchar",  "255.0f",   4, FALSE, FALSE},
+  {"RGBA u16",         "rgbau16",         "ushort", "65535.0f", 4, FALSE, FALSE},
+  {"R'G'B'A float",    "rgba_gamma_f",    "float",  "1.0f",     4, TRUE,  FALSE},
+  {"R'G'B'A u8",       "rgba_gamma_u8",   "uchar",  "255.0f",   4, TRUE,  FALSE},
+  {"R'G'B'A u16",      "rgba_gamma_u16",  "ushort", "65535.0f", 4, TRUE,  FALSE},
+  {"RaGaBaA float",    "ragabaf",         "float",  "1.0f",     4, FALSE, TRUE },
+  {"R'aG'aB'aA float", "ragaba_gamma_f",  "float",  "1.0f",     4, TRUE,  TRUE },
+  {"RGB float",        "rgbf",            "float",  "1.0f",     3, FALSE, FALSE},
+  {"RGB u8",           "rgbu8",           "uchar",  "255.0f",   3, FALSE, FALSE},
+  {"RGB u16",          "rgbu16",          "ushort", "65535.0f", 3, FALSE, FALSE},
+  {"R'G'B' float",     "rgb_gamma_f",     "float",  "1.0f",     3, TRUE,  FALSE},
+  {"R'G'B' u8",        "rgb_gamma_u8",    "uchar",  "255.0f",   3, TRUE,  FALSE},
+  {"R'G'B' u16",       "rgb_gamma_u16",   "ushort", "65535.0f", 3, TRUE,  FALSE},
+  {"YA float",         "yaf",             "float",  "1.0f",     2, FALSE, FALSE},
+  {"YA u8",            "yau8",            "uchar",  "255.0f",   2, FALSE, FALSE},
+  {"YA u16",           "yau16",           "ushort", "65535.0f", 2, FALSE, FALSE},
+  {"Y'A float",        "ya_gamma_f",      "float",  "1.0f",     2, TRUE,  FALSE},
+  {"Y'A u8",           "ya_gamma_u8",     "uchar",  "255.0f",   2, TRUE,  FALSE},
+  {"Y'A u16",          "ya_gamma_u16",    "ushort", "65535.0f", 2, TRUE,  FALSE},
+  {"YaA float",        "yaaf",            "float",  "1.0f",     2, FALSE, TRUE },
+  {"Y'aA float",       "yaa_gamma_f",     "float",  "1.0f",     2, TRUE,  TRUE },
+  {"Y float",          "yf",              "float",  "1.0f",     1, FALSE, FALSE},
+  {"Y u8",             "yu8",             "uchar",  "255.0f",   1, FALSE, FALSE},
+  {"Y u16",            "yu16",            "ushort", "65535.0f", 1, FALSE, FALSE},
+  {"Y' float",         "y_gamma_f",       "float",  "1.0f",     1, TRUE,  FALSE},
+  {"Y' u8",            "y_gamma_u8",      "uchar",  "255.0f",   1, TRUE,  FALSE},
+  {"Y' u16",           "y_gamma_u16",     "ushort", "65535.0f", 1, TRUE,  FALSE},
+  {"Y'CbCrA float",    NULL,              "float",  "1.0f",     4, FALSE, FALSE}
+};
+
+#define CL_FORMAT_N G_N_ELEMENTS (cl_format)
 
 static const Babl *format[CL_FORMAT_N];
 
@@ -39,54 +90,206 @@ CL_RGBAF_TO_YAF           = 17,
 CL_YAF_TO_RGBAF           = 18,
 CL_RGBAU8_TO_YAF          = 19,
 CL_YAF_TO_RGBAU8          = 20,
+
+/* generated kernels start here, two per entry of cl_format[] after the first */
+CL_GENERIC                = 21
 };
 
+#define CL_GENERIC_TO_RGBAF(f)   (CL_GENERIC + 2 * ((f) - 1))
+#define CL_GENERIC_FROM_RGBAF(f) (CL_GENERIC + 2 * ((f) - 1) + 1)
+
+static const gchar *cl_vector_width[] = {"", "", "2", "3", "4"};
+
+static void
+append_generic_kernels (GString             *source,
+                        const ClColorFormat *f)
+{
+  const gchar *n   = cl_vector_width[f->components];
+  const gchar *sat = strcmp (f->type, "float") ? "_sat_rte" : "";
+
+  /* <format> -> RGBA float */
+  g_string_append_printf (source,
+    "__kernel void %s_to_rgbaf (__global const %s * in,\n"
+    "                           __global     float4 * out)\n"
+    "{\n"
+    "  int gid = get_global_id(0);\n",
+    f->kernel, f->type);
+
+  switch (f->components)
+    {
+      case 1:
+        g_string_append_printf (source,
+          "  float4 v = (float4)((float3)(convert_float (in[gid]) / %s), 1.0f);\n",
+          f->scale);
+        break;
+      case 2:
+        g_string_append_printf (source,
+          "  float4 v = (convert_float2 (vload2 (gid, in)) / %s).xxxy;\n",
+          f->scale);
+        break;
+      case 3:
+        g_string_append_printf (source,
+          "  float4 v = (float4)(convert_float3 (vload3 (gid, in)) / %s, 1.0f);\n",
+          f->scale);
+        break;
+      default:
+        g_string_append_printf (source,
+          "  float4 v = convert_float4 (vload4 (gid, in)) / %s;\n",
+          f->scale);
+        break;
+    }
+
+  if (f->premultiplied)
+    g_string_append (source,
+      "  v.xyz = (v.w > BABL_ALPHA_THRESHOLD)? v.xyz / v.w : (float3)(0.0f);\n");
+
+  if (f->gamma)
+    g_string_append (source,
+      "  v.xyz = (float3)(gamma_2_2_to_linear (v.x),\n"
+      "                   gamma_2_2_to_linear (v.y),\n"
+      "                   gamma_2_2_to_linear (v.z));\n");
+
+  g_string_append (source,
+    "  out[gid] = v;\n"
+    "}\n");
+
+  /* RGBA float -> <format> */
+  g_string_append_printf (source,
+    "__kernel void rgbaf_to_%s (__global const float4 * in,\n"
+    "                           __global       %s * out)\n"
+    "{\n"
+    "  int gid = get_global_id(0);\n"
+    "  float4 v = in[gid];\n",
+    f->kernel, f->type);
+
+  if (f->components <= 2)
+    g_string_append (source,
+      "  v.xyz = (float3)(dot (v.xyz, (float3)(RGB_LUMINANCE_RED,\n"
+      "                                        RGB_LUMINANCE_GREEN,\n"
+      "                                        RGB_LUMINANCE_BLUE)));\n");
+
+  if (f->gamma)
+    g_string_append (source,
+      "  v.xyz = (float3)(linear_to_gamma_2_2 (v.x),\n"
+      "                   linear_to_gamma_2_2 (v.y),\n"
+      "                   linear_to_gamma_2_2 (v.z));\n");
+
+  if (f->premultiplied)
+    g_string_append (source,
+      "  v.xyz *= v.w;\n");
+
+  switch (f->components)
+    {
+      case 1:
+        g_string_append_printf (source,
+          "  out[gid] = convert_%s%s (%s * v.x);\n",
+          f->type, sat, f->scale);
+        break;
+      case 2:
+        g_string_append_printf (source,
+          "  vstore2 (convert_%s2%s (%s * v.xw), gid, out);\n",
+          f->type, sat, f->scale);
+        break;
+      case 3:
+        g_string_append_printf (source,
+          "  vstore3 (convert_%s3%s (%s * v.xyz), gid, out);\n",
+          f->type, sat, f->scale);
+        break;
+      default:
+        g_string_append_printf (source,
+          "  vstore%s (convert_%s%s%s (%s * v), gid, out);\n",
+          n, f->type, n, sat, f->scale);
+        break;
+    }
+
+  g_string_append (source,
+    "}\n");
+}
+
 void
 gegl_cl_color_compile_kernels(void)
 {
-  const char *kernel_name[] = {"rgbau8_to_rgbaf",         /* 0  */
-                               "rgbaf_to_rgbau8",         /* 1  */
-
-                               "rgbaf_to_ragabaf",        /* 2  */
-                               "ragabaf_to_rgbaf",        /* 3  */
-                               "rgbau8_to_ragabaf",       /* 4  */
-                               "ragabaf_to_rgbau8",       /* 5  */
-
-                               "rgbaf_to_rgba_gamma_f",   /* 6  */
-                               "rgba_gamma_f_to_rgbaf",   /* 7  */
-                               "rgbau8_to_rgba_gamma_f",  /* 8  */
-                               "rgba_gamma_f_to_rgbau8",  /* 9  */
-
-                               "rgbaf_to_ycbcraf",        /* 10 */
-                               "ycbcraf_to_rgbaf",        /* 11 */
-                               "rgbau8_to_ycbcraf",       /* 12 */
-                               "ycbcraf_to_rgbau8",       /* 13 */
-
-                               "rgbu8_to_rgbaf",          /* 14 */
-                               "rgbaf_to_rgbu8",          /* 15 */
-
-                               "yu8_to_yf",               /* 16 */
-
-                               "rgbaf_to_yaf",            /* 17 */
-                               "yaf_to_rgbaf",            /* 18 */
-                               "rgbau8_to_yaf",           /* 19 */
-                               "yaf_to_rgbau8",           /* 20 */
-
-                               NULL};
-
-  format[0] = babl_format ("RGBA u8");
-  format[1] = babl_format ("RGBA float");
-  format[2] = babl_format ("RaGaBaA float");
-  format[3] = babl_format ("R'G'B'A float");
-  format[4] = babl_format ("Y'CbCrA float");
-  format[5] = babl_format ("RGB u8");
-  format[6] = babl_format ("Y u8");
-  format[7] = babl_format ("Y float");
-  format[8] = babl_format ("YA float");
-
-  kernels_color = gegl_cl_compile_and_build (kernel_color_source, kernel_name);
+  const char *direct_kernel_name[] = {"rgbau8_to_rgbaf",         /* 0  */
+                                      "rgbaf_to_rgbau8",         /* 1  */
+
+                                      "rgbaf_to_ragabaf",        /* 2  */
+                                      "ragabaf_to_rgbaf",        /* 3  */
+                                      "rgbau8_to_ragabaf",       /* 4  */
+                                      "ragabaf_to_rgbau8",       /* 5  */
+
+                                      "rgbaf_to_rgba_gamma_f",   /* 6  */
+                                      "rgba_gamma_f_to_rgbaf",   /* 7  */
+                                      "rgbau8_to_rgba_gamma_f",  /* 8  */
+                                      "rgba_gamma_f_to_rgbau8",  /* 9  */
+
+                                      "rgbaf_to_ycbcraf",        /* 10 */
+                                      "ycbcraf_to_rgbaf",        /* 11 */
+                                      "rgbau8_to_ycbcraf",       /* 12 */
+                                      "ycbcraf_to_rgbau8",       /* 13 */
+
+                                      "rgbu8_to_rgbaf",          /* 14 */
+                                      "rgbaf_to_rgbu8",          /* 15 */
+
+                                      "yu8_to_yf",               /* 16 */
+
+                                      "rgbaf_to_yaf",            /* 17 */
+                                      "yaf_to_rgbaf",            /* 18 */
+                                      "rgbau8_to_yaf",           /* 19 */
+                                      "yaf_to_rgbau8",           /* 20 */
+
+                                      NULL};
+
+  const char *kernel_name[CL_GENERIC + 2 * CL_FORMAT_N + 1];
+  gchar      *generic_name[2 * CL_FORMAT_N];
+  GString    *source;
+  gint        i, k;
+
+  for (i = 0; i < CL_FORMAT_N; i++)
+    format[i] = babl_format (cl_format[i].name);
+
+  source = g_string_new (kernel_color_source);
+
+  for (k = 0; k < CL_GENERIC; k++)
+    kernel_name[k] = direct_kernel_name[k];
+
+  /* the generated names differ from the direct ones only for the formats
+   * which already had kernels, so give them their own namespace
+   */
+  for (i = 1; i < CL_FORMAT_N && cl_format[i].kernel; i++)
+    {
+      gchar *stem = g_strconcat ("g_", cl_format[i].kernel, NULL);
+      ClColorFormat f = cl_format[i];
+
+      f.kernel = stem;
+      append_generic_kernels (source, &f);
+
+      generic_name[2 * (i - 1)]     = g_strconcat (stem, "_to_rgbaf", NULL);
+      generic_name[2 * (i - 1) + 1] = g_strconcat ("rgbaf_to_", stem, NULL);
+      kernel_name[k++] = generic_name[2 * (i - 1)];
+      kernel_name[k++] = generic_name[2 * (i - 1) + 1];
+
+      g_free (stem);
+    }
+  kernel_name[k] = NULL;
+
+  kernels_color = gegl_cl_compile_and_build (source->str, kernel_name);
+
+  for (i = 0; i < k - CL_GENERIC; i++)
+    g_free (generic_name[i]);
+  g_string_free (source, TRUE);
 }
 
+static gint
+find_generic_format (const Babl *babl_format)
+{
+  gint i;
+
+  for (i = 0; i < CL_FORMAT_N && cl_format[i].kernel; i++)
+    if (format[i] == babl_format)
+      return i;
+
+  return -1;
+}
 
 static gint
 choose_kernel (const Babl *in_format, const Babl *out_format)
@@ -158,20 +361,7 @@ gegl_cl_color_babl (const Babl *buffer_format, size_t *bytes)
     return FALSE;
 
   if (bytes)
-    {
-      if (buffer_format == babl_format ("RGBA u8"))
-        *bytes = sizeof (cl_uchar4);
-      else if (buffer_format == babl_format ("RGB u8"))
-        *bytes = sizeof (cl_uchar3);
-      else if (buffer_format == babl_format ("Y u8"))
-        *bytes = sizeof (cl_uchar);
-      else if (buffer_format == babl_format ("Y float"))
-        *bytes = sizeof (cl_float);
-      else if (buffer_format == babl_format ("YA float"))
-        *bytes = sizeof (cl_float2);
-      else
-        *bytes = sizeof (cl_float4);
-    }
+    *bytes = babl_format_get_bytes_per_pixel (buffer_format);
 
   return TRUE;
 }
@@ -184,17 +374,45 @@ gegl_cl_color_supported (const Babl *in_format, const Babl *out_format)
 
   if (choose_kernel (in_format, out_format) >= 0)
     return GEGL_CL_COLOR_CONVERT;
-  else
-    return GEGL_CL_COLOR_NOT_SUPPORTED;
+
+  if (find_generic_format (in_format)  >= 0 &&
+      find_generic_format (out_format) >= 0)
+    return GEGL_CL_COLOR_CONVERT;
+
+  return GEGL_CL_COLOR_NOT_SUPPORTED;
 }
 
 #define CL_ERROR {g_printf("[OpenCL] Error in %s:%d@%s - %s\n", __FILE__, __LINE__, __func__, gegl_cl_errstring(errcode)); return FALSE;}
 
+static gboolean
+color_conv_kernel (gint k, cl_mem in_tex, cl_mem out_tex, const size_t size)
+{
+  int errcode;
+
+  errcode = gegl_clSetKernelArg(kernels_color->kernel[k], 0, sizeof(cl_mem), (void*)&in_tex);
+  if (errcode != CL_SUCCESS) CL_ERROR
+
+  errcode = gegl_clSetKernelArg(kernels_color->kernel[k], 1, sizeof(cl_mem), (void*)&out_tex);
+  if (errcode != CL_SUCCESS) CL_ERROR
+
+  errcode = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
+                                        kernels_color->kernel[k], 1,
+                                        NULL, &size, NULL,
+                                        0, NULL, NULL);
+  if (errcode != CL_SUCCESS) CL_ERROR
+
+  errcode = gegl_clEnqueueBarrier(gegl_cl_get_command_queue());
+  if (errcode != CL_SUCCESS) CL_ERROR
+
+  return TRUE;
+}
+
 gboolean
 gegl_cl_color_conv (cl_mem in_tex, cl_mem out_tex, const size_t size,
                     const Babl *in_format, const Babl *out_format)
 {
   int errcode;
+  gint k;
 
   if (gegl_cl_color_supported (in_format, out_format) == GEGL_CL_COLOR_NOT_SUPPORTED)
     return FALSE;
@@ -213,24 +431,37 @@ gegl_cl_color_conv (cl_mem in_tex, cl_mem out_tex, const size_t size,
       errcode = gegl_clEnqueueBarrier(gegl_cl_get_command_queue());
       if (errcode != CL_SUCCESS) CL_ERROR
     }
+  else if ((k = choose_kernel (in_format, out_format)) >= 0)
+    {
+      return color_conv_kernel (k, in_tex, out_tex, size);
+    }
   else
     {
-      gint k = choose_kernel (in_format, out_format);
-
-      errcode = gegl_clSetKernelArg(kernels_color->kernel[k], 0, sizeof(cl_mem), (void*)&in_tex);
-      if (errcode != CL_SUCCESS) CL_ERROR
-
-      errcode = gegl_clSetKernelArg(kernels_color->kernel[k], 1, sizeof(cl_mem), (void*)&out_tex);
-      if (errcode != CL_SUCCESS) CL_ERROR
-
-      errcode = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                            kernels_color->kernel[k], 1,
-                                            NULL, &size, NULL,
-                                            0, NULL, NULL);
-      if (errcode != CL_SUCCESS) CL_ERROR
-
-      errcode = gegl_clEnqueueBarrier(gegl_cl_get_command_queue());
-      if (errcode != CL_SUCCESS) CL_ERROR
+      /* two steps through RGBA float */
+      gint in_f  = find_generic_format (in_format);
+      gint out_f = find_generic_format (out_format);
+
+      if (in_f == 0)
+        return color_conv_kernel (CL_GENERIC_FROM_RGBAF (out_f), in_tex, out_tex, size);
+      else if (out_f == 0)
+        return color_conv_kernel (CL_GENERIC_TO_RGBAF (in_f), in_tex, out_tex, size);
+      else
+        {
+          gboolean ok;
+          cl_mem aux_tex = gegl_clCreateBuffer (gegl_cl_get_context (),
+                                                CL_MEM_READ_WRITE,
+                                                size * sizeof (cl_float4),
+                                                NULL, &errcode);
+          if (errcode != CL_SUCCESS) CL_ERROR
+
+          ok = color_conv_kernel (CL_GENERIC_TO_RGBAF (in_f),    in_tex,  aux_tex, size) &&
+               color_conv_kernel (CL_GENERIC_FROM_RGBAF (out_f), aux_tex, out_tex, size);
+
+          /* the release is deferred until the enqueued kernels are done */
+          gegl_clReleaseMemObject (aux_tex);
+
+          return ok;
+        }
     }
 
   return TRUE;
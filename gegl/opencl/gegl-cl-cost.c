@@ -0,0 +1,253 @@
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gprintf.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gegl.h"
+#include "gegl-debug.h"
+#include "gegl-cl-cost.h"
+
+/* number of power-of-two pixel count buckets, the last one takes
+ * everything bigger
+ */
+#define COST_BUCKETS     28
+
+/* timings needed on each path before trusting the averages */
+#define COST_MIN_SAMPLES 2
+
+/* every COST_REPROBE decisions the slower path is measured again, so the
+ * model follows changes in load or in the operation properties
+ */
+#define COST_REPROBE     64
+
+/* weight of a new sample in the running average */
+#define COST_ALPHA       0.25
+
+typedef struct
+{
+  gdouble  usecs_per_pixel [2];
+  gint     samples         [2];
+  gboolean cl_failed;
+  guint    decisions;
+} CostBucket;
+
+typedef struct
+{
+  CostBucket bucket[COST_BUCKETS];
+} CostEntry;
+
+static GHashTable  *cost_table = NULL;
+static GStaticMutex cost_mutex = G_STATIC_MUTEX_INIT;
+
+static gint
+cost_bucket (const GeglRectangle *roi)
+{
+  guint64 pixels = (guint64) roi->width * roi->height;
+  gint    bucket = 0;
+
+  while (pixels > 1 && bucket < COST_BUCKETS - 1)
+    {
+      pixels >>= 1;
+      bucket++;
+    }
+
+  return bucket;
+}
+
+/* must be called with cost_mutex held */
+static CostEntry *
+cost_entry (const gchar *op_name)
+{
+  CostEntry *entry;
+
+  if (!cost_table)
+    cost_table = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, g_free);
+
+  entry = g_hash_table_lookup (cost_table, op_name);
+  if (!entry)
+    {
+      entry = g_new0 (CostEntry, 1);
+      g_hash_table_insert (cost_table, g_strdup (op_name), entry);
+    }
+
+  return entry;
+}
+
+gegl_cl_cost_path
+gegl_cl_cost_choose (const gchar         *op_name,
+                     const GeglRectangle *roi)
+{
+  gegl_cl_cost_path path;
+  CostBucket *b;
+
+  if (!op_name)
+    return GEGL_CL_COST_CL;
+
+  g_static_mutex_lock (&cost_mutex);
+
+  b = &cost_entry (op_name)->bucket[cost_bucket (roi)];
+  b->decisions++;
+
+  if (b->cl_failed)
+    path = GEGL_CL_COST_CPU;
+  else if (b->samples[GEGL_CL_COST_CL] < COST_MIN_SAMPLES)
+    path = GEGL_CL_COST_CL;
+  else if (b->samples[GEGL_CL_COST_CPU] < COST_MIN_SAMPLES)
+    path = GEGL_CL_COST_CPU;
+  else
+    {
+      path = b->usecs_per_pixel[GEGL_CL_COST_CL] <= b->usecs_per_pixel[GEGL_CL_COST_CPU] ?
+             GEGL_CL_COST_CL : GEGL_CL_COST_CPU;
+
+      if (b->decisions % COST_REPROBE == 0)
+        path = !path;
+    }
+
+  GEGL_NOTE (GEGL_DEBUG_OPENCL, "%s %dx%d: %s (cpu %.4f us/px [%d], cl %.4f us/px [%d])",
+             op_name, roi->width, roi->height,
+             path == GEGL_CL_COST_CL ? "OpenCL" : "CPU",
+             b->usecs_per_pixel[GEGL_CL_COST_CPU], b->samples[GEGL_CL_COST_CPU],
+             b->usecs_per_pixel[GEGL_CL_COST_CL],  b->samples[GEGL_CL_COST_CL]);
+
+  g_static_mutex_unlock (&cost_mutex);
+
+  return path;
+}
+
+void
+gegl_cl_cost_record (const gchar         *op_name,
+                     const GeglRectangle *roi,
+                     gegl_cl_cost_path    path,
+                     glong                usecs)
+{
+  gdouble usecs_per_pixel;
+  CostBucket *b;
+
+  if (!op_name || roi->width <= 0 || roi->height <= 0)
+    return;
+
+  usecs_per_pixel = (gdouble) usecs / ((gdouble) roi->width * roi->height);
+
+  g_static_mutex_lock (&cost_mutex);
+
+  b = &cost_entry (op_name)->bucket[cost_bucket (roi)];
+
+  /* the first run pays for kernel compilation, don't let it count */
+  if (b->samples[path] == 0)
+    b->usecs_per_pixel[path] = usecs_per_pixel;
+  else if (b->samples[path] == 1 && usecs_per_pixel < b->usecs_per_pixel[path])
+    b->usecs_per_pixel[path] = usecs_per_pixel;
+  else
+    b->usecs_per_pixel[path] = (1.0 - COST_ALPHA) * b->usecs_per_pixel[path]
+                             + COST_ALPHA * usecs_per_pixel;
+  b->samples[path]++;
+
+  g_static_mutex_unlock (&cost_mutex);
+}
+
+void
+gegl_cl_cost_failed (const gchar         *op_name,
+                     const GeglRectangle *roi)
+{
+  if (!op_name)
+    return;
+
+  g_static_mutex_lock (&cost_mutex);
+  cost_entry (op_name)->bucket[cost_bucket (roi)].cl_failed = TRUE;
+  g_static_mutex_unlock (&cost_mutex);
+}
+
+void
+gegl_cl_cost_load (void)
+{
+  const gchar *path = g_getenv ("GEGL_CL_COST_FILE");
+  gchar  *contents;
+  gchar **lines;
+  gint    i;
+
+  if (!path || !g_file_get_contents (path, &contents, NULL, NULL))
+    return;
+
+  lines = g_strsplit (contents, "\n", -1);
+
+  g_static_mutex_lock (&cost_mutex);
+
+  for (i = 0; lines[i]; i++)
+    {
+      gchar **field = g_strsplit (lines[i], " ", -1);
+      gint    bucket;
+
+      /* op bucket cpu-us/px cpu-samples cl-us/px cl-samples cl-failed */
+      if (g_strv_length (field) == 7 && field[0][0] != '#' &&
+          (bucket = atoi (field[1])) >= 0 && bucket < COST_BUCKETS)
+        {
+          CostBucket *b = &cost_entry (field[0])->bucket[bucket];
+
+          b->usecs_per_pixel[GEGL_CL_COST_CPU] = g_ascii_strtod (field[2], NULL);
+          b->samples[GEGL_CL_COST_CPU]         = atoi (field[3]);
+          b->usecs_per_pixel[GEGL_CL_COST_CL]  = g_ascii_strtod (field[4], NULL);
+          b->samples[GEGL_CL_COST_CL]          = atoi (field[5]);
+          b->cl_failed                         = atoi (field[6]);
+        }
+
+      g_strfreev (field);
+    }
+
+  g_static_mutex_unlock (&cost_mutex);
+
+  g_strfreev (lines);
+  g_free (contents);
+}
+
+void
+gegl_cl_cost_save (void)
+{
+  const gchar   *path = g_getenv ("GEGL_CL_COST_FILE");
+  GString       *str;
+  GHashTableIter iter;
+  gpointer       key, value;
+
+  if (!path || !cost_table)
+    return;
+
+  str = g_string_new ("# op bucket cpu-us/px cpu-samples cl-us/px cl-samples cl-failed\n");
+
+  g_static_mutex_lock (&cost_mutex);
+
+  g_hash_table_iter_init (&iter, cost_table);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      CostEntry *entry = value;
+      gint i;
+
+      for (i = 0; i < COST_BUCKETS; i++)
+        {
+          CostBucket *b = &entry->bucket[i];
+          gchar cpu_cost[G_ASCII_DTOSTR_BUF_SIZE];
+          gchar cl_cost[G_ASCII_DTOSTR_BUF_SIZE];
+
+          if (!b->samples[GEGL_CL_COST_CPU] && !b->samples[GEGL_CL_COST_CL] && !b->cl_failed)
+            continue;
+
+          g_string_append_printf (str, "%s %d %s %d %s %d %d\n",
+                                  (const gchar *) key, i,
+                                  g_ascii_dtostr (cpu_cost, sizeof (cpu_cost),
+                                                  b->usecs_per_pixel[GEGL_CL_COST_CPU]),
+                                  b->samples[GEGL_CL_COST_CPU],
+                                  g_ascii_dtostr (cl_cost, sizeof (cl_cost),
+                                                  b->usecs_per_pixel[GEGL_CL_COST_CL]),
+                                  b->samples[GEGL_CL_COST_CL],
+                                  b->cl_failed);
+        }
+    }
+
+  g_static_mutex_unlock (&cost_mutex);
+
+  if (!g_file_set_contents (path, str->str, str->len, NULL))
+    g_warning ("[OpenCL] Could not save the cost model to %s", path);
+
+  g_string_free (str, TRUE);
+}
@@ -0,0 +1,33 @@
+#ifndef __GEGL_CL_COST_H__
+#define __GEGL_CL_COST_H__
+
+#include <gegl.h>
+
+/* Runtime cost model used to choose between the CPU and the OpenCL
+ * implementation of an operation.  Timings are kept per operation name and
+ * per power-of-two bucket of the processed pixel count.
+ */
+
+typedef enum
+{
+  GEGL_CL_COST_CPU = 0,
+  GEGL_CL_COST_CL  = 1
+} gegl_cl_cost_path;
+
+gegl_cl_cost_path gegl_cl_cost_choose (const gchar         *op_name,
+                                       const GeglRectangle *roi);
+
+void gegl_cl_cost_record (const gchar         *op_name,
+                          const GeglRectangle *roi,
+                          gegl_cl_cost_path    path,
+                          glong                usecs);
+
+void gegl_cl_cost_failed (const gchar         *op_name,
+                          const GeglRectangle *roi);
+
+/* the model is loaded from and saved to $GEGL_CL_COST_FILE when it is set */
+void gegl_cl_cost_load (void);
+
+void gegl_cl_cost_save (void);
+
+#endif
@@ -5,8 +5,15 @@
 #include <gmodule.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "gegl-cl-color.h"
+#include "gegl-cl-cost.h"
+
+/* the device the calling thread is enqueueing to, set by the buffer
+ * iterator for the batch it hands out; NULL means device 0
+ */
+static GStaticPrivate current_device = G_STATIC_PRIVATE_INIT;
 
 const char *gegl_cl_errstring(cl_int err) {
   static const char* strings[] =
@@ -96,7 +103,7 @@ gegl_cl_get_platform (void)
 cl_device_id
 gegl_cl_get_device (void)
 {
-  return cl_state.device;
+  return cl_state.device[gegl_cl_get_current_device ()];
 }
 
 cl_context
@@ -108,7 +115,7 @@ gegl_cl_get_context (void)
 cl_command_queue
 gegl_cl_get_command_queue (void)
 {
-  return cl_state.cq;
+  return cl_state.cq[gegl_cl_get_current_device ()];
 }
 
 cl_ulong
@@ -117,6 +124,39 @@ gegl_cl_get_local_mem_size (void)
   return cl_state.local_mem_size;
 }
 
+guint
+gegl_cl_get_n_devices (void)
+{
+  return cl_state.n_devices;
+}
+
+guint
+gegl_cl_get_current_device (void)
+{
+  return GPOINTER_TO_UINT (g_static_private_get (&current_device));
+}
+
+void
+gegl_cl_set_current_device (guint device)
+{
+  g_return_if_fail (device < cl_state.n_devices);
+  g_static_private_set (&current_device, GUINT_TO_POINTER (device), NULL);
+}
+
+cl_device_id
+gegl_cl_get_nth_device (guint device)
+{
+  g_return_val_if_fail (device < cl_state.n_devices, NULL);
+  return cl_state.device[device];
+}
+
+cl_command_queue
+gegl_cl_get_nth_command_queue (guint device)
+{
+  g_return_val_if_fail (device < cl_state.n_devices, NULL);
+  return cl_state.cq[device];
+}
+
 #ifdef G_OS_WIN32
 
 #include <windows.h>
@@ -154,6 +194,7 @@ gboolean
 gegl_cl_init (GError **error)
 {
   cl_int err;
+  cl_uint i;
 
   if (!cl_state.is_accelerated)
     {
@@ -205,6 +246,7 @@ gegl_cl_init (GError **error)
       CL_LOAD_FUNCTION (clEnqueueNDRangeKernel)
       CL_LOAD_FUNCTION (clEnqueueBarrier)
       CL_LOAD_FUNCTION (clFinish)
+      CL_LOAD_FUNCTION (clFlush)
 
       CL_LOAD_FUNCTION (clEnqueueMapBuffer)
       CL_LOAD_FUNCTION (clEnqueueMapImage)
@@ -227,18 +269,59 @@ gegl_cl_init (GError **error)
       gegl_clGetPlatformInfo (cl_state.platform, CL_PLATFORM_VERSION,    sizeof(cl_state.platform_version), cl_state.platform_version, NULL);
       gegl_clGetPlatformInfo (cl_state.platform, CL_PLATFORM_EXTENSIONS, sizeof(cl_state.platform_ext),     cl_state.platform_ext,     NULL);
 
-      err = gegl_clGetDeviceIDs (cl_state.platform, CL_DEVICE_TYPE_DEFAULT, 1, &cl_state.device, NULL);
+      err = gegl_clGetDeviceIDs (cl_state.platform, CL_DEVICE_TYPE_DEFAULT, 1, &cl_state.device[0], NULL);
       if(err != CL_SUCCESS)
         {
           g_printf("[OpenCL] Could not create device\n");
           return FALSE;
         }
 
-      gegl_clGetDeviceInfo(cl_state.device, CL_DEVICE_NAME, sizeof(cl_state.device_name), cl_state.device_name, NULL);
+      /* use every device of the same type as the default one, at most
+       * $GEGL_CL_DEVICES of them
+       */
+      {
+        cl_device_type type;
+        cl_device_id   devices[GEGL_CL_MAX_DEVICES];
+        cl_uint        n_devices = 0;
+        cl_uint        max_devices = GEGL_CL_MAX_DEVICES;
+        cl_uint        d;
+
+        if (g_getenv ("GEGL_CL_DEVICES"))
+          max_devices = CLAMP (atoi (g_getenv ("GEGL_CL_DEVICES")), 1, GEGL_CL_MAX_DEVICES);
+
+        cl_state.n_devices = 1;
+
+        gegl_clGetDeviceInfo (cl_state.device[0], CL_DEVICE_TYPE, sizeof(cl_device_type), &type, NULL);
+        if (type & ~CL_DEVICE_TYPE_DEFAULT)
+          type &= ~CL_DEVICE_TYPE_DEFAULT;
+
+        err = gegl_clGetDeviceIDs (cl_state.platform, type, GEGL_CL_MAX_DEVICES, devices, &n_devices);
+        if (err == CL_SUCCESS)
+          for (d = 0; d < MIN (n_devices, GEGL_CL_MAX_DEVICES) && cl_state.n_devices < max_devices; d++)
+            if (devices[d] != cl_state.device[0])
+              cl_state.device[cl_state.n_devices++] = devices[d];
+      }
+
+      cl_state.image_support  = CL_TRUE;
+      cl_state.max_mem_alloc  = G_MAXUINT64;
+      cl_state.local_mem_size = G_MAXUINT64;
+
+      for (i = 0; i < cl_state.n_devices; i++)
+        {
+          cl_bool  image_support;
+          cl_ulong max_mem_alloc, local_mem_size;
+
+          gegl_clGetDeviceInfo (cl_state.device[i], CL_DEVICE_NAME, sizeof(cl_state.device_name[i]), cl_state.device_name[i], NULL);
 
-      gegl_clGetDeviceInfo (cl_state.device, CL_DEVICE_IMAGE_SUPPORT,      sizeof(cl_bool),  &cl_state.image_support,    NULL);
-      gegl_clGetDeviceInfo (cl_state.device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &cl_state.max_mem_alloc,    NULL);
-      gegl_clGetDeviceInfo (cl_state.device, CL_DEVICE_LOCAL_MEM_SIZE,     sizeof(cl_ulong), &cl_state.local_mem_size,   NULL);
+          gegl_clGetDeviceInfo (cl_state.device[i], CL_DEVICE_IMAGE_SUPPORT,      sizeof(cl_bool),  &image_support,  NULL);
+          gegl_clGetDeviceInfo (cl_state.device[i], CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &max_mem_alloc,  NULL);
+          gegl_clGetDeviceInfo (cl_state.device[i], CL_DEVICE_LOCAL_MEM_SIZE,     sizeof(cl_ulong), &local_mem_size, NULL);
+
+          /* the limits have to hold on every device */
+          cl_state.image_support  = cl_state.image_support && image_support;
+          cl_state.max_mem_alloc  = MIN (cl_state.max_mem_alloc,  max_mem_alloc);
+          cl_state.local_mem_size = MIN (cl_state.local_mem_size, local_mem_size);
+        }
 
       cl_state.max_image_width  = 4096;
       cl_state.max_image_height = 4096;
@@ -246,7 +329,9 @@ gegl_cl_init (GError **error)
       g_printf("[OpenCL] Platform Name:%s\n",       cl_state.platform_name);
       g_printf("[OpenCL] Version:%s\n",             cl_state.platform_version);
       g_printf("[OpenCL] Extensions:%s\n",          cl_state.platform_ext);
-      g_printf("[OpenCL] Default Device Name:%s\n", cl_state.device_name);
+      g_printf("[OpenCL] Default Device Name:%s\n", cl_state.device_name[0]);
+      for (i = 1; i < cl_state.n_devices; i++)
+        g_printf("[OpenCL] Device %d Name:%s\n", i, cl_state.device_name[i]);
       g_printf("[OpenCL] Max Alloc: %lu bytes\n",   cl_state.max_mem_alloc);
       g_printf("[OpenCL] Local Mem: %lu bytes\n",   cl_state.local_mem_size);
 
@@ -271,21 +356,23 @@ gegl_cl_init (GError **error)
           return FALSE;
         }
 
-      cl_state.ctx = gegl_clCreateContext(0, 1, &cl_state.device, NULL, NULL, &err);
+      cl_state.ctx = gegl_clCreateContext(0, cl_state.n_devices, cl_state.device, NULL, NULL, &err);
       if(err != CL_SUCCESS)
         {
           g_printf("[OpenCL] Could not create context\n");
           return FALSE;
         }
 
-      cl_state.cq  = gegl_clCreateCommandQueue(cl_state.ctx, cl_state.device, 0, &err);
-
-      if(err != CL_SUCCESS)
+      for (i = 0; i < cl_state.n_devices; i++)
         {
-          g_printf("[OpenCL] Could not create command queue\n");
-          return FALSE;
-        }
+          cl_state.cq[i] = gegl_clCreateCommandQueue(cl_state.ctx, cl_state.device[i], 0, &err);
 
+          if(err != CL_SUCCESS)
+            {
+              g_printf("[OpenCL] Could not create command queue\n");
+              return FALSE;
+            }
+        }
     }
 
   cl_state.is_accelerated = TRUE;
@@ -294,7 +381,10 @@ gegl_cl_init (GError **error)
   cl_program_hash = g_hash_table_new (g_str_hash, g_str_equal);
 
   if (cl_state.is_accelerated)
-    gegl_cl_color_compile_kernels();
+    {
+      gegl_cl_color_compile_kernels();
+      gegl_cl_cost_load ();
+    }
 
   g_printf("[OpenCL] OK\n");
 
@@ -11,13 +11,16 @@ if (errcode != CL_SUCCESS)                                          \
             #func, __LINE__, __FILE__, gegl_cl_errstring(errcode)); \
 }
 
+#define GEGL_CL_MAX_DEVICES 8
+
 typedef struct
   {
     gboolean is_accelerated;
     cl_context ctx;
     cl_platform_id platform;
-    cl_device_id device;
-    cl_command_queue cq;
+    cl_uint n_devices;
+    cl_device_id device[GEGL_CL_MAX_DEVICES];
+    cl_command_queue cq[GEGL_CL_MAX_DEVICES];
     cl_bool image_support;
     size_t max_image_height;
     size_t max_image_width;
@@ -27,7 +30,7 @@ typedef struct
     char platform_name   [1024];
     char platform_version[1024];
     char platform_ext    [1024];
-    char device_name     [1024];
+    char device_name     [GEGL_CL_MAX_DEVICES][1024];
   }
 gegl_cl_state;
 
@@ -47,6 +50,21 @@ cl_command_queue gegl_cl_get_command_queue (void);
 
 cl_ulong gegl_cl_get_local_mem_size (void);
 
+/* All devices share the context, gegl_cl_get_device and
+ * gegl_cl_get_command_queue refer to the current one. The current
+ * device is kept per thread, so concurrent iterators don't switch
+ * each other's device.
+ */
+guint gegl_cl_get_n_devices (void);
+
+guint gegl_cl_get_current_device (void);
+
+void gegl_cl_set_current_device (guint device);
+
+cl_device_id gegl_cl_get_nth_device (guint device);
+
+cl_command_queue gegl_cl_get_nth_command_queue (guint device);
+
 typedef struct
 {
   cl_program program;
@@ -58,7 +76,7 @@ gegl_cl_run_data *gegl_cl_compile_and_build (const char *program_source,
 
 #ifdef __GEGL_CL_INIT_MAIN__
 
-gegl_cl_state cl_state = {FALSE, NULL, NULL, NULL, NULL, FALSE, 0, 0, 0, 0, "", "", "", ""};
+gegl_cl_state cl_state = {FALSE, NULL, NULL, 0, {NULL}, {NULL}, FALSE, 0, 0, 0, 0, "", "", "", {""}};
 GHashTable *cl_program_hash = NULL;
 
 t_clGetPlatformIDs  gegl_clGetPlatformIDs  = NULL;
@@ -91,6 +109,7 @@ t_clEnqueueCopyImageToBuffer gegl_clEnqueueCopyImageToBuffer = NULL;
 t_clEnqueueNDRangeKernel    gegl_clEnqueueNDRangeKernel    = NULL;
 t_clEnqueueBarrier          gegl_clEnqueueBarrier          = NULL;
 t_clFinish                  gegl_clFinish                  = NULL;
+t_clFlush                   gegl_clFlush                   = NULL;
 
 t_clEnqueueMapBuffer        gegl_clEnqueueMapBuffer        = NULL;
 t_clEnqueueMapImage         gegl_clEnqueueMapImage         = NULL;
@@ -137,6 +156,7 @@ extern t_clEnqueueCopyImageToBuffer gegl_clEnqueueCopyImageToBuffer;
 extern t_clEnqueueNDRangeKernel    gegl_clEnqueueNDRangeKernel;
 extern t_clEnqueueBarrier          gegl_clEnqueueBarrier;
 extern t_clFinish                  gegl_clFinish;
+extern t_clFlush                   gegl_clFlush;
 
 extern t_clEnqueueMapBuffer        gegl_clEnqueueMapBuffer;
 extern t_clEnqueueMapImage         gegl_clEnqueueMapImage;
@@ -0,0 +1,342 @@
+#include "config.h"
+
+#include <glib.h>
+
+#include "gegl.h"
+#include "gegl-debug.h"
+#include "gegl-instrument.h"
+#include "gegl-cl-init.h"
+#include "gegl-cl-tune.h"
+
+/* timed enqueues per candidate before the fastest one is picked, the
+ * fastest of the runs counts
+ */
+#define TUNE_TRIALS 2
+
+typedef struct
+{
+  size_t x;
+  size_t y;
+} TuneShape;
+
+/* {0, 0} leaves the choice to the implementation */
+static const TuneShape shapes[] =
+{
+  {  0, 0 },
+  {  8, 8 },
+  { 16, 8 },
+  { 16, 16 },
+  { 32, 4 },
+  { 32, 8 },
+  { 64, 1 },
+  { 64, 4 },
+  { 128, 1 },
+  { 256, 1 }
+};
+
+#define N_SHAPES G_N_ELEMENTS (shapes)
+
+typedef struct
+{
+  glong    usecs_per_pixel [N_SHAPES];
+  gint     trials          [N_SHAPES];
+  gboolean failed          [N_SHAPES]; /* the enqueue refused the shape */
+} TuneEntry;
+
+static GHashTable  *tune_table = NULL;
+static GStaticMutex tune_mutex = G_STATIC_MUTEX_INIT;
+
+typedef struct
+{
+  size_t   max_wg;
+  size_t   max_items[2]; /* work-items per dimension of a work-group */
+  cl_ulong free_local_mem;
+} KernelLimits;
+
+static KernelLimits
+kernel_limits (cl_kernel kernel)
+{
+  KernelLimits limits = { 0, { G_MAXSIZE, G_MAXSIZE }, 0 };
+  cl_ulong     used_local_mem = 0;
+  cl_uint      dims = 0;
+
+  gegl_clGetKernelWorkGroupInfo (kernel, gegl_cl_get_device (),
+                                 CL_KERNEL_WORK_GROUP_SIZE,
+                                 sizeof (size_t), &limits.max_wg, NULL);
+  gegl_clGetKernelWorkGroupInfo (kernel, gegl_cl_get_device (),
+                                 CL_KERNEL_LOCAL_MEM_SIZE,
+                                 sizeof (cl_ulong), &used_local_mem, NULL);
+
+  if (gegl_cl_get_local_mem_size () > used_local_mem)
+    limits.free_local_mem = gegl_cl_get_local_mem_size () - used_local_mem;
+
+  gegl_clGetDeviceInfo (gegl_cl_get_device (),
+                        CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS,
+                        sizeof (cl_uint), &dims, NULL);
+  if (dims >= 2)
+    {
+      size_t *sizes = g_new0 (size_t, dims);
+
+      if (gegl_clGetDeviceInfo (gegl_cl_get_device (),
+                                CL_DEVICE_MAX_WORK_ITEM_SIZES,
+                                dims * sizeof (size_t), sizes, NULL) == CL_SUCCESS)
+        {
+          limits.max_items[0] = sizes[0];
+          limits.max_items[1] = sizes[1];
+        }
+      g_free (sizes);
+    }
+
+  return limits;
+}
+
+static gboolean
+shape_usable (const TuneShape    *shape,
+              const KernelLimits *limits,
+              const size_t        global_ws[2],
+              gboolean            local,
+              gint                extra_x,
+              gint                extra_y)
+{
+  if (shape->x == 0)
+    return !local;
+
+  if (shape->x * shape->y > limits->max_wg ||
+      shape->x > limits->max_items[0] ||
+      shape->y > limits->max_items[1])
+    return FALSE;
+
+  if (local)
+    return (shape->x + extra_x) * (shape->y + extra_y) * sizeof (cl_float4)
+             <= limits->free_local_mem;
+
+  return global_ws[0] % shape->x == 0 && global_ws[1] % shape->y == 0;
+}
+
+/* must be called with tune_mutex held */
+static TuneEntry *
+tune_entry (cl_kernel kernel)
+{
+  TuneEntry *entry;
+
+  if (!tune_table)
+    tune_table = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                        NULL, g_free);
+
+  /* kernels live as long as the program cache, their address is a key */
+  entry = g_hash_table_lookup (tune_table, kernel);
+  if (!entry)
+    {
+      entry = g_new0 (TuneEntry, GEGL_CL_MAX_DEVICES);
+      g_hash_table_insert (tune_table, kernel, entry);
+    }
+
+  return &entry[gegl_cl_get_current_device ()];
+}
+
+/* the errors an enqueue gives for a work-group shape the kernel can't run
+ * with on this device
+ */
+static gboolean
+shape_error (cl_int cl_err)
+{
+  return cl_err == CL_INVALID_WORK_GROUP_SIZE ||
+         cl_err == CL_INVALID_WORK_ITEM_SIZE  ||
+         cl_err == CL_INVALID_ARG_SIZE        ||
+         cl_err == CL_OUT_OF_RESOURCES;
+}
+
+/* the next shape to time or the fastest one, -1 when none is usable, must
+ * be called with tune_mutex held
+ */
+static gint
+tune_pick (TuneEntry          *entry,
+           const KernelLimits *limits,
+           const size_t        global_ws[2],
+           gboolean            local,
+           gint                extra_x,
+           gint                extra_y,
+           gboolean           *timed)
+{
+  gint  best = -1;
+  guint s;
+
+  *timed = FALSE;
+
+  for (s = 0; s < N_SHAPES; s++)
+    {
+      if (entry->failed[s] ||
+          !shape_usable (&shapes[s], limits, global_ws, local, extra_x, extra_y))
+        continue;
+
+      if (entry->trials[s] < TUNE_TRIALS)
+        {
+          *timed = TRUE;
+          return s;
+        }
+
+      if (best < 0 || entry->usecs_per_pixel[s] < entry->usecs_per_pixel[best])
+        best = s;
+    }
+
+  return best;
+}
+
+static cl_int
+tune_enqueue_shape (cl_kernel     kernel,
+                    const size_t  global_ws[2],
+                    gboolean      local,
+                    gint          extra_x,
+                    gint          extra_y,
+                    cl_uint       tile_arg,
+                    TuneEntry    *entry,
+                    gint          best,
+                    gboolean      timed)
+{
+  cl_command_queue cq = gegl_cl_get_command_queue ();
+  size_t           local_ws[2], padded_ws[2];
+  glong            ticks = 0;
+  cl_int           cl_err;
+
+  local_ws[0] = shapes[best].x;
+  local_ws[1] = shapes[best].y;
+
+  if (local)
+    {
+      size_t tile_size = (local_ws[0] + extra_x) * (local_ws[1] + extra_y)
+                         * sizeof (cl_float4);
+
+      cl_err = gegl_clSetKernelArg (kernel, tile_arg, tile_size, NULL);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      padded_ws[0] = (global_ws[0] + local_ws[0] - 1) / local_ws[0] * local_ws[0];
+      padded_ws[1] = (global_ws[1] + local_ws[1] - 1) / local_ws[1] * local_ws[1];
+    }
+  else
+    {
+      padded_ws[0] = global_ws[0];
+      padded_ws[1] = global_ws[1];
+    }
+
+  if (timed)
+    {
+      gegl_clFinish (cq);
+      ticks = gegl_ticks ();
+    }
+
+  cl_err = gegl_clEnqueueNDRangeKernel (cq, kernel, 2,
+                                        NULL, padded_ws,
+                                        local_ws[0] ? local_ws : NULL,
+                                        0, NULL, NULL);
+  if (cl_err != CL_SUCCESS) return cl_err;
+
+  if (timed)
+    {
+      glong usecs_per_pixel;
+
+      gegl_clFinish (cq);
+      /* scaled, the per pixel time of small kernels is below a microsecond */
+      usecs_per_pixel = (gegl_ticks () - ticks) * 1024 /
+                        (glong) MAX (global_ws[0] * global_ws[1], 1);
+
+      g_static_mutex_lock (&tune_mutex);
+
+      if (entry->trials[best] == 0 || usecs_per_pixel < entry->usecs_per_pixel[best])
+        entry->usecs_per_pixel[best] = usecs_per_pixel;
+      entry->trials[best]++;
+
+      GEGL_NOTE (GEGL_DEBUG_OPENCL, "kernel %p on device %u: local size %ux%u, %ld",
+                 kernel, gegl_cl_get_current_device (),
+                 (guint) local_ws[0], (guint) local_ws[1], usecs_per_pixel);
+
+      g_static_mutex_unlock (&tune_mutex);
+    }
+
+  return CL_SUCCESS;
+}
+
+static cl_int
+tune_enqueue (cl_kernel     kernel,
+              const size_t  global_ws[2],
+              gboolean      local,
+              gint          extra_x,
+              gint          extra_y,
+              cl_uint       tile_arg)
+{
+  KernelLimits limits = kernel_limits (kernel);
+  TuneEntry   *entry;
+  cl_int       cl_err;
+
+  g_static_mutex_lock (&tune_mutex);
+  entry = tune_entry (kernel);
+  g_static_mutex_unlock (&tune_mutex);
+
+  /* a shape the device refuses is not tried again, the next one is */
+  while (TRUE)
+    {
+      gboolean timed;
+      gint     best;
+
+      g_static_mutex_lock (&tune_mutex);
+      best = tune_pick (entry, &limits, global_ws, local, extra_x, extra_y,
+                        &timed);
+      g_static_mutex_unlock (&tune_mutex);
+
+      if (best < 0)
+        return CL_INVALID_WORK_GROUP_SIZE;
+
+      cl_err = tune_enqueue_shape (kernel, global_ws, local, extra_x, extra_y,
+                                   tile_arg, entry, best, timed);
+
+      if (cl_err == CL_SUCCESS || shapes[best].x == 0 || !shape_error (cl_err))
+        return cl_err;
+
+      g_static_mutex_lock (&tune_mutex);
+      entry->failed[best] = TRUE;
+      g_static_mutex_unlock (&tune_mutex);
+
+      GEGL_NOTE (GEGL_DEBUG_OPENCL, "kernel %p on device %u: local size %ux%u "
+                 "refused (%d)", kernel, gegl_cl_get_current_device (),
+                 (guint) shapes[best].x, (guint) shapes[best].y, cl_err);
+    }
+}
+
+cl_int
+gegl_cl_tune_enqueue (cl_kernel     kernel,
+                      const size_t  global_ws[2])
+{
+  return tune_enqueue (kernel, global_ws, FALSE, 0, 0, 0);
+}
+
+cl_int
+gegl_cl_tune_enqueue_local (cl_kernel     kernel,
+                            const size_t  global_ws[2],
+                            gint          extra_x,
+                            gint          extra_y,
+                            cl_uint       tile_arg)
+{
+  return tune_enqueue (kernel, global_ws, TRUE, extra_x, extra_y, tile_arg);
+}
+
+gboolean
+gegl_cl_tune_local_fits (cl_kernel kernel,
+                         gint      extra_x,
+                         gint      extra_y)
+{
+  KernelLimits limits = kernel_limits (kernel);
+  size_t       global_ws[2] = { 1, 1 };
+  TuneEntry   *entry;
+  gboolean     fits = FALSE;
+  guint        s;
+
+  g_static_mutex_lock (&tune_mutex);
+
+  entry = tune_entry (kernel);
+  for (s = 0; s < N_SHAPES && !fits; s++)
+    fits = !entry->failed[s] &&
+           shape_usable (&shapes[s], &limits, global_ws, TRUE, extra_x, extra_y);
+
+  g_static_mutex_unlock (&tune_mutex);
+
+  return fits;
+}
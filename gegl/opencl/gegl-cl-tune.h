@@ -0,0 +1,58 @@
+#ifndef __GEGL_CL_TUNE_H__
+#define __GEGL_CL_TUNE_H__
+
+#include "gegl-cl-types.h"
+
+/* Local work size selection for 2D kernels.  The first enqueues of a kernel
+ * on a device are timed with each candidate work-group shape, after that
+ * the fastest shape is used.  A shape the enqueue refuses is not tried
+ * again.  The choice is kept per kernel and device, next to the compiled
+ * programs in cl_program_hash.
+ */
+
+/* for kernels that work with any local size dividing the global size */
+cl_int gegl_cl_tune_enqueue (cl_kernel     kernel,
+                             const size_t  global_ws[2]);
+
+/* For kernels staging their input in __local memory.  The tile holds the
+ * work-group area plus extra_x columns and extra_y rows of float4, it is
+ * passed as the __local argument tile_arg.  The global size is rounded up
+ * to the local size, so these kernels have to check their bounds.
+ */
+cl_int gegl_cl_tune_enqueue_local (cl_kernel     kernel,
+                                   const size_t  global_ws[2],
+                                   gint          extra_x,
+                                   gint          extra_y,
+                                   cl_uint       tile_arg);
+
+/* whether some work-group shape leaves room for the tile */
+gboolean gegl_cl_tune_local_fits (cl_kernel kernel,
+                                  gint      extra_x,
+                                  gint      extra_y);
+
+/* Kernel source for the tiled variants, fills the __local tile from the
+ * input starting at (x, y) and waits for the work-group.  Reads outside the
+ * input are clamped, they only feed work-items past the output bounds.
+ */
+#define GEGL_CL_TILE_SOURCE                                                     \
+"void gegl_cl_tile_load (global const float4 *in,                           \n" \
+"                        int                  in_width,                     \n" \
+"                        int                  in_height,                    \n" \
+"                        local float4        *tile,                         \n" \
+"                        int                  tile_width,                   \n" \
+"                        int                  tile_height,                  \n" \
+"                        int                  x,                            \n" \
+"                        int                  y)                            \n" \
+"{                                                                          \n" \
+"  int i, j;                                                                \n" \
+"                                                                           \n" \
+"  for (j = get_local_id (1); j < tile_height; j += get_local_size (1))     \n" \
+"    for (i = get_local_id (0); i < tile_width; i += get_local_size (0))    \n" \
+"      tile[j * tile_width + i] =                                           \n" \
+"        in[clamp (y + j, 0, in_height - 1) * in_width +                    \n" \
+"           clamp (x + i, 0, in_width  - 1)];                               \n" \
+"                                                                           \n" \
+"  barrier (CLK_LOCAL_MEM_FENCE);                                           \n" \
+"}                                                                          \n"
+
+#endif
@@ -135,3 +135,94 @@ get_invalidated_by_change (GeglOperation        *operation,
 
   return retval;
 }
+
+gboolean
+gegl_operation_area_filter_process_strips (GeglOperation           *operation,
+                                           GeglBuffer              *input,
+                                           GeglBuffer              *output,
+                                           const GeglRectangle     *result,
+                                           gint                     strip_height,
+                                           GeglAreaFilterStripFunc  func,
+                                           gpointer                 user_data)
+{
+  GeglOperationAreaFilter *area = GEGL_OPERATION_AREA_FILTER (operation);
+  const Babl              *in_format;
+  const Babl              *out_format;
+  GeglRectangle            src_rect;
+  GeglRectangle            dst_rect;
+  gint                     halo;
+  gint                     src_bpp, src_rowstride;
+  gint                     dst_bpp;
+  guchar                  *src_buf;
+  guchar                  *dst_buf;
+  gint                     fetched;  /* rows of src_buf holding valid data */
+
+  if (result->width <= 0 || result->height <= 0)
+    return TRUE;
+
+  in_format  = gegl_operation_get_format (operation, "input");
+  out_format = gegl_operation_get_format (operation, "output");
+  src_bpp    = babl_format_get_bytes_per_pixel (in_format);
+  dst_bpp    = babl_format_get_bytes_per_pixel (out_format);
+  halo       = area->top + area->bottom;
+
+  if (strip_height <= 0)
+    {
+      gint tile_height;
+
+      /* the rows moved from one strip to the next should not outnumber
+       * the rows fetched
+       */
+      g_object_get (output, "tile-height", &tile_height, NULL);
+      strip_height = MAX (tile_height, halo);
+    }
+  strip_height = MIN (strip_height, result->height);
+
+  src_rect.x      = result->x - area->left;
+  src_rect.width  = result->width + area->left + area->right;
+  src_rowstride   = src_rect.width * src_bpp;
+
+  src_buf = g_malloc (src_rowstride * (strip_height + halo));
+  dst_buf = g_malloc (result->width * dst_bpp * strip_height);
+
+  dst_rect = *result;
+  fetched  = 0;
+
+  for (dst_rect.y = result->y;
+       dst_rect.y < result->y + result->height;
+       dst_rect.y += strip_height)
+    {
+      GeglRectangle fetch;
+      gint          keep;
+
+      dst_rect.height = MIN (strip_height, result->y + result->height - dst_rect.y);
+      src_rect.y      = dst_rect.y - area->top;
+      src_rect.height = dst_rect.height + halo;
+
+      /* the halo at the bottom of the previous strip is the top of this one */
+      keep = MIN (fetched - strip_height, src_rect.height);
+      if (keep > 0)
+        memmove (src_buf, src_buf + strip_height * src_rowstride,
+                 keep * src_rowstride);
+      else
+        keep = 0;
+
+      fetch        = src_rect;
+      fetch.y     += keep;
+      fetch.height = src_rect.height - keep;
+      gegl_buffer_get (input, 1.0, &fetch, in_format,
+                       src_buf + keep * src_rowstride, GEGL_AUTO_ROWSTRIDE);
+      fetched = src_rect.height;
+
+      func (operation, (gfloat *) src_buf, &src_rect,
+            (gfloat *) dst_buf, &dst_rect, user_data);
+
+      gegl_buffer_set (output, &dst_rect, out_format, dst_buf,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (src_buf);
+  g_free (dst_buf);
+
+  return TRUE;
+}
@@ -55,6 +55,31 @@ struct _GeglOperationAreaFilterClass
 
 GType gegl_operation_area_filter_get_type (void) G_GNUC_CONST;
 
+/* Called by gegl_operation_area_filter_process_strips for each strip of the
+ * result, src holds src_rect, dst_rect extended by the area of the filter,
+ * in the format of the input pad, dst is to be filled with dst_rect in the
+ * format of the output pad.  Both are packed, without padding between rows.
+ */
+typedef void (*GeglAreaFilterStripFunc) (GeglOperation       *operation,
+                                         const gfloat        *src,
+                                         const GeglRectangle *src_rect,
+                                         gfloat              *dst,
+                                         const GeglRectangle *dst_rect,
+                                         gpointer             user_data);
+
+/* Computes result strip_height rows at a time (a strip_height of 0 picks one
+ * from the tile height of output), keeping only the rows a strip and its
+ * halo need in memory.  The halo rows shared by consecutive strips are moved
+ * instead of being fetched again.
+ */
+gboolean gegl_operation_area_filter_process_strips (GeglOperation           *operation,
+                                                    GeglBuffer              *input,
+                                                    GeglBuffer              *output,
+                                                    const GeglRectangle     *result,
+                                                    gint                     strip_height,
+                                                    GeglAreaFilterStripFunc  func,
+                                                    gpointer                 user_data);
+
 G_END_DECLS
 
 #endif
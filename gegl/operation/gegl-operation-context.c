@@ -121,6 +121,10 @@ typedef struct Property
 {
   gchar *name;
   GValue value;
+  gint   consumers; /* the number of input pads left to take the value of
+                       an output pad, see gegl_operation_context_consumed */
+  gboolean owned;   /* the value is a buffer of the evaluation that nothing
+                       outside of this context refers to any longer */
 } Property;
 
 static Property *
@@ -208,6 +212,7 @@ gegl_operation_context_add_value (GeglOperationContext *self,
     {
       /* XXX: check that the existing one was of the right type */
       g_value_reset (&property->value);
+      property->owned = FALSE;
       return &property->value;
     }
 
@@ -219,6 +224,90 @@ gegl_operation_context_add_value (GeglOperationContext *self,
   return &property->value;
 }
 
+/* sets the number of input pads in the evaluation connected to an output
+ * pad, before the value of the pad is computed
+ */
+void
+gegl_operation_context_set_consumers (GeglOperationContext *self,
+                                      const gchar          *padname,
+                                      gint                  consumers)
+{
+  GParamSpec *pspec;
+  Property   *property;
+  GSList     *found;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (G_OBJECT (self->operation)), padname);
+  g_return_if_fail (pspec != NULL);
+
+  gegl_operation_context_add_value (self, padname, G_PARAM_SPEC_VALUE_TYPE (pspec));
+  found = g_slist_find_custom (self->property, padname, lookup_property);
+  property = found->data;
+  property->consumers = consumers;
+}
+
+/* called when an input pad has taken the value of an output pad, the value
+ * is dropped when it was the last one to, freeing the buffer as soon as
+ * nothing in the evaluation needs it any longer.  Returns TRUE when the
+ * buffer was owned by this context, it then passes to the last consumer.
+ * An earlier consumer may pass the buffer on, as it is or as a sub-buffer
+ * sharing its tiles, so a buffer taken by more than one consumer is never
+ * passed on as owned.
+ */
+gboolean
+gegl_operation_context_consumed (GeglOperationContext *self,
+                                 const gchar          *padname)
+{
+  Property *property;
+  GSList   *found;
+  gboolean  owned;
+
+  found = g_slist_find_custom (self->property, padname, lookup_property);
+  if (!found)
+    return FALSE;
+
+  property = found->data;
+  if (--property->consumers != 0)
+    {
+      property->owned = FALSE;
+      return FALSE;
+    }
+
+  owned = property->owned;
+  self->property = g_slist_remove (self->property, property);
+  property_destroy (property);
+
+  return owned;
+}
+
+/* marks the buffer in @padname as one that nothing outside of the context
+ * refers to, see gegl_operation_context_owns
+ */
+void
+gegl_operation_context_set_owned (GeglOperationContext *self,
+                                  const gchar          *padname,
+                                  gboolean              owned)
+{
+  GSList *found;
+
+  found = g_slist_find_custom (self->property, padname, lookup_property);
+  if (found)
+    ((Property *) found->data)->owned = owned;
+}
+
+/* whether the context may write to the buffer in @padname: it was made
+ * for the evaluation, and the context has it from the last consumer of the
+ * output it came from
+ */
+gboolean
+gegl_operation_context_owns (GeglOperationContext *self,
+                             const gchar          *padname)
+{
+  GSList *found;
+
+  found = g_slist_find_custom (self->property, padname, lookup_property);
+  return found && ((Property *) found->data)->owned;
+}
+
 GeglOperationContext *gegl_operation_context_new (void)
 {
   GeglOperationContext *self = g_slice_new0 (GeglOperationContext);
@@ -234,6 +323,7 @@ void gegl_operation_context_destroy (GeglOperationContext *self)
       self->property = g_slist_remove (self->property, property);
       property_destroy (property);
     }
+  g_free (self->checksum);
   g_slice_free (GeglOperationContext, self);
 }
 
@@ -270,6 +360,27 @@ gegl_operation_context_take_object (GeglOperationContext *context,
       gegl_operation_context_set_property (context, padname, &value);
 
       g_value_unset (&value);
+
+      /* an owned input passed on as it is, or processed in place, stays
+       * owned, the input is dropped once the output is computed
+       */
+      if (data)
+        {
+          GSList *iter;
+
+          for (iter = context->property; iter; iter = g_slist_next (iter))
+            {
+              Property *property = iter->data;
+
+              if (property->owned &&
+                  G_VALUE_HOLDS_OBJECT (&property->value) &&
+                  g_value_get_object (&property->value) == data)
+                {
+                  gegl_operation_context_set_owned (context, padname, TRUE);
+                  break;
+                }
+            }
+        }
     }
   else
     {
@@ -393,6 +504,11 @@ gegl_operation_context_get_target (GeglOperationContext *context,
 
   gegl_operation_context_take_object (context, padname, G_OBJECT (output));
 
+  /* a buffer of its own, unlike the cache */
+  if (output != emptybuf () &&
+      output != GEGL_BUFFER (operation->node->cache))
+    gegl_operation_context_set_owned (context, padname, TRUE);
+
   return output;
 }
 
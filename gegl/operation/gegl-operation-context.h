@@ -47,14 +47,11 @@ struct _GeglOperationContext
   gboolean       cached;       /* true if the cache can be used directly, and
                                   recomputation of inputs is unneccesary) */
 
-  gint           refs;         /* set to number of nodes that depends on it
-                                  before evaluation begins, each time data is
-                                  fetched from the op the reference count is
-                                  dropped, when it drops to zero, the op is
-                                  asked to clean it's pads, FIXME: should be
-                                  incorporated into the refcount of
-                                  GeglOperationContext?
-                                */
+  GeglNode      *duplicate_of; /* a node of the evaluation computing the same
+                                  output, see gegl-merge-visitor.c */
+  gint           duplicates;   /* the nodes that are a duplicate_of this one */
+
+  gchar         *checksum;     /* of the output, see gegl-disk-cache.c */
 };
 
 GeglBuffer     *gegl_operation_context_get_target      (GeglOperationContext *self,
@@ -82,6 +79,16 @@ void            gegl_operation_context_get_property    (GeglOperationContext *se
 
 void            gegl_operation_context_remove_property (GeglOperationContext *self,
                                                         const gchar          *name);
+void            gegl_operation_context_set_consumers   (GeglOperationContext *self,
+                                                        const gchar          *padname,
+                                                        gint                  consumers);
+gboolean        gegl_operation_context_consumed        (GeglOperationContext *self,
+                                                        const gchar          *padname);
+void            gegl_operation_context_set_owned       (GeglOperationContext *self,
+                                                        const gchar          *padname,
+                                                        gboolean              owned);
+gboolean        gegl_operation_context_owns            (GeglOperationContext *self,
+                                                        const gchar          *padname);
 GeglRectangle * gegl_operation_context_get_need_rect   (GeglOperationContext *self);
 void            gegl_operation_context_set_need_rect   (GeglOperationContext *self,
                                                         const GeglRectangle  *rect);
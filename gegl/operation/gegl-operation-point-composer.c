@@ -29,6 +29,9 @@
 #include "graph/gegl-pad.h"
 #include <string.h>
 
+#include "opencl/gegl-cl-cost.h"
+#include "gegl-instrument.h"
+
 static gboolean gegl_operation_point_composer_process
                               (GeglOperation       *operation,
                                GeglBuffer          *input,
@@ -74,9 +77,10 @@ gegl_operation_point_composer_init (GeglOperationPointComposer *self)
 
 }
 
-gboolean gegl_can_do_inplace_processing (GeglOperation       *operation,
-                                         GeglBuffer          *input,
-                                         const GeglRectangle *result);
+gboolean gegl_can_do_inplace_processing (GeglOperation        *operation,
+                                         GeglOperationContext *context,
+                                         GeglBuffer           *input,
+                                         const GeglRectangle  *result);
 
 /* we replicate the process function from GeglOperationComposer to be
  * able to bail out earlier for some common processing time pitfalls
@@ -102,7 +106,7 @@ gegl_operation_composer_process2 (GeglOperation        *operation,
   input = gegl_operation_context_get_source (context, "input");
   aux   = gegl_operation_context_get_source (context, "aux");
 
-  if (gegl_can_do_inplace_processing (operation, input, result))
+  if (gegl_can_do_inplace_processing (operation, context, input, result))
     {
       output = g_object_ref (input);
       gegl_operation_context_take_object (context, "output", G_OBJECT (output));
@@ -170,7 +174,6 @@ gegl_operation_point_composer_cl_process (GeglOperation       *operation,
 
         while (gegl_buffer_cl_iterator_next (i, &err))
           {
-            if (err) return FALSE;
             for (j=0; j < i->n; j++)
               {
                 cl_err = point_composer_class->cl_process(operation, i->tex[read][j], i->tex[foo][j], i->tex[0][j],
@@ -179,6 +182,7 @@ gegl_operation_point_composer_cl_process (GeglOperation       *operation,
                   {
                     g_warning("[OpenCL] Error in %s [GeglOperationPointComposer] Kernel\n",
                               GEGL_OPERATION_CLASS (operation)->name);
+                    gegl_buffer_cl_iterator_stop (i);
                     return FALSE;
                   }
               }
@@ -188,7 +192,6 @@ gegl_operation_point_composer_cl_process (GeglOperation       *operation,
       {
         while (gegl_buffer_cl_iterator_next (i, &err))
           {
-            if (err) return FALSE;
             for (j=0; j < i->n; j++)
               {
                 cl_err = point_composer_class->cl_process(operation, i->tex[read][j], NULL, i->tex[0][j],
@@ -197,13 +200,16 @@ gegl_operation_point_composer_cl_process (GeglOperation       *operation,
                   {
                     g_warning("[OpenCL] Error in %s [GeglOperationPointComposer] Kernel\n",
                               GEGL_OPERATION_CLASS (operation)->name);
+                    gegl_buffer_cl_iterator_stop (i);
                     return FALSE;
                   }
               }
           }
       }
+
+    /* the iterator is already freed when it failed */
+    return !err;
   }
-  return TRUE;
 }
 
 static gboolean
@@ -220,12 +226,22 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
 
   if ((result->width > 0) && (result->height > 0))
     {
-      if (cl_state.is_accelerated && point_composer_class->cl_process)
+      const gchar *name = GEGL_OPERATION_GET_CLASS (operation)->name;
+      gboolean     timed = cl_state.is_accelerated && point_composer_class->cl_process;
+      glong        ticks;
+
+      if (timed && gegl_cl_cost_choose (name, result) == GEGL_CL_COST_CL)
         {
+          ticks = gegl_ticks ();
           if (gegl_operation_point_composer_cl_process (operation, input, aux, output, result))
-            return TRUE;
+            {
+              gegl_cl_cost_record (name, result, GEGL_CL_COST_CL, gegl_ticks () - ticks);
+              return TRUE;
+            }
+          gegl_cl_cost_failed (name, result);
         }
 
+      ticks = gegl_ticks ();
       {
         GeglBufferIterator *i = gegl_buffer_iterator_new (output, result, out_format, GEGL_BUFFER_WRITE);
         gint read = /*output == input ? 0 :*/ gegl_buffer_iterator_add (i, input,  result, in_format, GEGL_BUFFER_READ);
@@ -250,6 +266,8 @@ gegl_operation_point_composer_process (GeglOperation       *operation,
               }
           }
       }
+      if (timed)
+        gegl_cl_cost_record (name, result, GEGL_CL_COST_CPU, gegl_ticks () - ticks);
       return TRUE;
     }
   return TRUE;
@@ -33,6 +33,8 @@
 #include "gegl-tile-storage.h"
 
 #include "opencl/gegl-cl.h"
+#include "opencl/gegl-cl-cost.h"
+#include "gegl-instrument.h"
 
 static gboolean gegl_operation_point_filter_process
                               (GeglOperation       *operation,
@@ -109,7 +111,6 @@ gegl_operation_point_filter_cl_process (GeglOperation       *operation,
                   gint read = gegl_buffer_cl_iterator_add (i, input, result, in_format,  GEGL_CL_BUFFER_READ);
     while (gegl_buffer_cl_iterator_next (i, &err))
       {
-        if (err) return FALSE;
         for (j=0; j < i->n; j++)
           {
             cl_err = point_filter_class->cl_process(operation, i->tex[read][j], i->tex[0][j],
@@ -118,12 +119,15 @@ gegl_operation_point_filter_cl_process (GeglOperation       *operation,
               {
                 g_warning("[OpenCL] Error in %s [GeglOperationPointFilter] Kernel\n",
                           GEGL_OPERATION_CLASS (operation)->name);
+                gegl_buffer_cl_iterator_stop (i);
                 return FALSE;
               }
           }
       }
+
+    /* the iterator is already freed when it failed */
+    return !err;
   }
-  return TRUE;
 }
 
 static gboolean
@@ -140,12 +144,22 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
 
   if ((result->width > 0) && (result->height > 0))
     {
-      if (cl_state.is_accelerated && point_filter_class->cl_process)
+      const gchar *name = GEGL_OPERATION_GET_CLASS (operation)->name;
+      gboolean     timed = cl_state.is_accelerated && point_filter_class->cl_process;
+      glong        ticks;
+
+      if (timed && gegl_cl_cost_choose (name, result) == GEGL_CL_COST_CL)
         {
+          ticks = gegl_ticks ();
           if (gegl_operation_point_filter_cl_process (operation, input, output, result))
-            return TRUE;
+            {
+              gegl_cl_cost_record (name, result, GEGL_CL_COST_CL, gegl_ticks () - ticks);
+              return TRUE;
+            }
+          gegl_cl_cost_failed (name, result);
         }
 
+      ticks = gegl_ticks ();
       {
         GeglBufferIterator *i = gegl_buffer_iterator_new (output, result, out_format, GEGL_BUFFER_WRITE);
         gint read = /*output == input ? 0 :*/ gegl_buffer_iterator_add (i, input,  result, in_format, GEGL_BUFFER_READ);
@@ -155,22 +169,30 @@ gegl_operation_point_filter_process (GeglOperation       *operation,
           while (gegl_buffer_iterator_next (i))
             point_filter_class->process (operation, i->data[read], i->data[0], i->length, &i->roi[0]);
       }
+      if (timed)
+        gegl_cl_cost_record (name, result, GEGL_CL_COST_CPU, gegl_ticks () - ticks);
     }
   return TRUE;
 }
 
-gboolean gegl_can_do_inplace_processing (GeglOperation       *operation,
-                                         GeglBuffer          *input,
-                                         const GeglRectangle *result);
+gboolean gegl_can_do_inplace_processing (GeglOperation        *operation,
+                                         GeglOperationContext *context,
+                                         GeglBuffer           *input,
+                                         const GeglRectangle  *result);
 
-gboolean gegl_can_do_inplace_processing (GeglOperation       *operation,
-                                         GeglBuffer          *input,
-                                         const GeglRectangle *result)
+gboolean gegl_can_do_inplace_processing (GeglOperation        *operation,
+                                         GeglOperationContext *context,
+                                         GeglBuffer           *input,
+                                         const GeglRectangle  *result)
 {
   if (!input ||
       GEGL_IS_CACHE (input))
     return FALSE;
-  if (gegl_object_get_has_forked (input))
+
+  /* the buffer is ours to write to when the context took it as the last
+   * consumer of an output that owned it, see gegl_operation_context_owns
+   */
+  if (!gegl_operation_context_owns (context, "input"))
     return FALSE;
 
   if (input->format == gegl_operation_get_format (operation, "output") &&
@@ -192,7 +214,7 @@ static gboolean gegl_operation_point_filter_op_process
 
   input = gegl_operation_context_get_source (context, "input");
 
-  if (gegl_can_do_inplace_processing (operation, input, roi))
+  if (gegl_can_do_inplace_processing (operation, context, input, roi))
     {
       output = g_object_ref (input);
       gegl_operation_context_take_object (context, "output", G_OBJECT (output));
@@ -94,6 +94,7 @@ dispatch (GObject *object,
   gint good      = 0;
   gint reference = 0;
   gint simd      = 0;
+  gint avx       = 0;
   gint i;
   gint choice;
 
@@ -121,6 +122,7 @@ dispatch (GObject *object,
         {
           if (g_str_equal (string, "fast"))      fast = i;
           if (g_str_equal (string, "simd"))      simd = i;
+          else if (g_str_equal (string, "avx"))  avx = i;
           else if (g_str_equal (string, "good")) good = i;
           else if (g_str_equal (string, "reference"))
             reference = i;
@@ -131,6 +133,7 @@ dispatch (GObject *object,
 
   choice = reference;
   if (gegl_config()->quality <= 1.0  && simd) choice = simd;
+  if (gegl_config()->quality <= 1.0  && avx)  choice = avx;
   if (gegl_config()->quality <= 0.75 && good) choice = good;
   if (gegl_config()->quality <= 0.25 && fast) choice = fast;
 
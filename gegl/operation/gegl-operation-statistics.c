@@ -0,0 +1,418 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+#include <glib-object.h>
+
+#include "gegl.h"
+#include "gegl-types-internal.h"
+#include "gegl-debug.h"
+#include "gegl-utils.h"
+#include "gegl-operation-statistics.h"
+#include "graph/gegl-node.h"
+#include "buffer/gegl-buffer.h"
+#include "gegl-openmp.h"
+
+/* the statistics computed for a node, freed with it or when it is
+ * invalidated
+ */
+typedef struct
+{
+  GSList *list;
+  guint   generation; /* bumped by every invalidation */
+} StatisticsCache;
+
+static GStaticMutex cache_mutex = G_STATIC_MUTEX_INIT;
+
+
+static void
+statistics_free (GeglStatistics *stats)
+{
+  g_free (stats->histogram);
+  g_slice_free (GeglStatistics, stats);
+}
+
+void
+gegl_statistics_free (GeglStatistics *stats)
+{
+  g_return_if_fail (stats != NULL);
+
+  statistics_free (stats);
+}
+
+static GeglStatistics *
+statistics_copy (const GeglStatistics *stats)
+{
+  GeglStatistics *copy = g_slice_dup (GeglStatistics, stats);
+
+  if (stats->histogram)
+    copy->histogram = g_memdup (stats->histogram,
+                                sizeof (glong) * stats->n_bins * stats->n_components);
+
+  return copy;
+}
+
+static void
+statistics_cache_free (gpointer data)
+{
+  StatisticsCache *cache = data;
+
+  g_slist_foreach (cache->list, (GFunc) statistics_free, NULL);
+  g_slist_free (cache->list);
+  g_slice_free (StatisticsCache, cache);
+}
+
+static GQuark
+statistics_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (!quark)
+    quark = g_quark_from_static_string ("gegl-operation-statistics");
+
+  return quark;
+}
+
+/* an invalidation of a node means its input or its properties changed, the
+ * rectangle is in the coordinates of its output which need not be those of
+ * the input, so all the statistics of the node are dropped
+ */
+static void
+statistics_node_invalidated (GeglNode            *node,
+                             const GeglRectangle *rect,
+                             gpointer             data)
+{
+  StatisticsCache *cache;
+
+  g_static_mutex_lock (&cache_mutex);
+
+  cache = g_object_get_qdata (G_OBJECT (node), statistics_quark ());
+  if (cache)
+    cache->generation++;
+  if (cache && cache->list)
+    {
+      GEGL_NOTE (GEGL_DEBUG_CACHE, "statistics of %s dropped",
+                 gegl_node_get_debug_name (node));
+
+      g_slist_foreach (cache->list, (GFunc) statistics_free, NULL);
+      g_slist_free (cache->list);
+      cache->list = NULL;
+    }
+
+  g_static_mutex_unlock (&cache_mutex);
+}
+
+static StatisticsCache *
+statistics_cache_get (GeglNode *node)
+{
+  StatisticsCache *cache = g_object_get_qdata (G_OBJECT (node),
+                                               statistics_quark ());
+
+  if (!cache)
+    {
+      cache = g_slice_new0 (StatisticsCache);
+      g_signal_connect (node, "invalidated",
+                        G_CALLBACK (statistics_node_invalidated), NULL);
+      g_object_set_qdata_full (G_OBJECT (node), statistics_quark (), cache,
+                               statistics_cache_free);
+    }
+
+  return cache;
+}
+
+/* reads rect a strip of tile rows at a time, calls func for every strip */
+typedef void (*StatisticsStripFunc) (GeglStatistics *stats,
+                                     const gfloat   *strip,
+                                     gint            rows);
+
+static void
+statistics_scan (GeglStatistics      *stats,
+                 GeglBuffer          *input,
+                 StatisticsStripFunc  func)
+{
+  const GeglRectangle *rect = &stats->rect;
+  gint                 tile_height;
+  gfloat              *strip;
+  gint                 y;
+
+  g_object_get (input, "tile-height", &tile_height, NULL);
+  strip = g_new (gfloat, rect->width * tile_height * stats->n_components);
+
+  for (y = 0; y < rect->height;)
+    {
+      GeglRectangle strip_rect = { rect->x, rect->y + y, rect->width, 0 };
+      gint          rows;
+
+      /* strips end on tile boundaries */
+      rows = tile_height - (((rect->y + y) % tile_height) + tile_height) % tile_height;
+      strip_rect.height = MIN (rows, rect->height - y);
+
+      gegl_buffer_get (input, 1.0, &strip_rect, stats->format, strip,
+                       GEGL_AUTO_ROWSTRIDE);
+      func (stats, strip, strip_rect.height);
+
+      y += strip_rect.height;
+    }
+
+  g_free (strip);
+}
+
+/* the sums of every row are computed in parallel and added to the totals
+ * in the order of the rows, values that are not finite are skipped
+ */
+static void
+statistics_moments (GeglStatistics *stats,
+                    const gfloat   *strip,
+                    gint            rows)
+{
+  gint     n      = stats->n_components;
+  gint     width  = stats->rect.width;
+  gdouble *sums   = g_new (gdouble, rows * n * 5);
+  gint     row, c;
+
+  _OMP (omp parallel for private(c) schedule(static))
+  for (row = 0; row < rows; row++)
+    {
+      const gfloat *src     = strip + row * width * n;
+      gdouble      *sum     = sums + row * n * 5;
+      gdouble      *log_sum = sum + n;
+      gdouble      *min     = sum + n * 2;
+      gdouble      *max     = sum + n * 3;
+      gdouble      *valid   = sum + n * 4;
+      gint          x;
+
+      for (c = 0; c < n; c++)
+        {
+          sum[c] = log_sum[c] = valid[c] = 0.0;
+          min[c] = G_MAXDOUBLE;
+          max[c] = -G_MAXDOUBLE;
+        }
+
+      for (x = 0; x < width; x++)
+        for (c = 0; c < n; c++)
+          {
+            gfloat value = src[x * n + c];
+
+            if (!isfinite (value))
+              continue;
+
+            valid[c]   += 1.0;
+            sum[c]     += value;
+            log_sum[c] += log (GEGL_STATISTICS_LOG_DELTA + MAX (value, 0.0f));
+            min[c]      = MIN (min[c], value);
+            max[c]      = MAX (max[c], value);
+          }
+    }
+
+  for (row = 0; row < rows; row++)
+    {
+      const gdouble *sum = sums + row * n * 5;
+
+      for (c = 0; c < n; c++)
+        {
+          stats->valid[c]    += sum[n * 4 + c];
+          stats->mean[c]     += sum[c];
+          stats->log_mean[c] += sum[n + c];
+          stats->min[c]       = MIN (stats->min[c], sum[n * 2 + c]);
+          stats->max[c]       = MAX (stats->max[c], sum[n * 3 + c]);
+        }
+    }
+
+  g_free (sums);
+}
+
+static void
+statistics_histogram (GeglStatistics *stats,
+                      const gfloat   *strip,
+                      gint            rows)
+{
+  gint    n      = stats->n_components;
+  gint    width  = stats->rect.width;
+  gint    n_bins = stats->n_bins;
+  gdouble scale[GEGL_STATISTICS_MAX_COMPONENTS];
+  gint    c;
+
+  for (c = 0; c < n; c++)
+    scale[c] = stats->max[c] > stats->min[c] ?
+                 n_bins / (stats->max[c] - stats->min[c]) : 0.0;
+
+  /* counts are added the same whatever the order */
+  _OMP (omp parallel private(c))
+  {
+    glong *histogram = g_new0 (glong, n_bins * n);
+    gint   row;
+
+    _OMP (omp for schedule(static))
+    for (row = 0; row < rows; row++)
+      {
+        const gfloat *src = strip + row * width * n;
+        gint          x;
+
+        for (x = 0; x < width; x++)
+          for (c = 0; c < n; c++)
+            {
+              gfloat value = src[x * n + c];
+              gint   bin;
+
+              if (!isfinite (value))
+                continue;
+
+              bin = (value - stats->min[c]) * scale[c];
+              histogram[c * n_bins + CLAMP (bin, 0, n_bins - 1)]++;
+            }
+      }
+
+    _OMP (omp critical)
+    for (c = 0; c < n_bins * n; c++)
+      stats->histogram[c] += histogram[c];
+
+    g_free (histogram);
+  }
+}
+
+static GeglStatistics *
+statistics_compute (GeglBuffer          *input,
+                    const GeglRectangle *rect,
+                    const Babl          *format,
+                    gint                 n_bins)
+{
+  GeglStatistics *stats = g_slice_new0 (GeglStatistics);
+  gint            c;
+
+  stats->rect         = *rect;
+  stats->format       = format;
+  stats->n_components = babl_format_get_n_components (format);
+  stats->count        = (glong) rect->width * rect->height;
+  stats->n_bins       = MAX (n_bins, 0);
+
+  for (c = 0; c < stats->n_components; c++)
+    {
+      stats->min[c] = G_MAXDOUBLE;
+      stats->max[c] = -G_MAXDOUBLE;
+    }
+
+  statistics_scan (stats, input, statistics_moments);
+
+  for (c = 0; c < stats->n_components; c++)
+    {
+      if (stats->valid[c])
+        {
+          stats->mean[c]     /= stats->valid[c];
+          stats->log_mean[c] /= stats->valid[c];
+        }
+      else
+        {
+          stats->min[c] = stats->max[c] = 0.0;
+        }
+    }
+
+  if (stats->n_bins)
+    {
+      stats->histogram = g_new0 (glong, stats->n_bins * stats->n_components);
+      statistics_scan (stats, input, statistics_histogram);
+    }
+
+  return stats;
+}
+
+static GeglStatistics *
+statistics_lookup (StatisticsCache     *cache,
+                   const GeglRectangle *rect,
+                   const Babl          *format,
+                   gint                 n_bins)
+{
+  GSList *iter;
+
+  for (iter = cache->list; iter; iter = iter->next)
+    {
+      GeglStatistics *cached = iter->data;
+
+      if (cached->format == format && cached->n_bins == n_bins &&
+          gegl_rectangle_equal (&cached->rect, rect))
+        return cached;
+    }
+
+  return NULL;
+}
+
+GeglStatistics *
+gegl_operation_get_statistics (GeglOperation       *operation,
+                               GeglBuffer          *input,
+                               const GeglRectangle *rect,
+                               const Babl          *format,
+                               gint                 n_bins)
+{
+  StatisticsCache *cache;
+  GeglStatistics  *stats;
+  GeglStatistics  *computed;
+  guint            generation;
+
+  g_return_val_if_fail (GEGL_IS_OPERATION (operation), NULL);
+  g_return_val_if_fail (GEGL_IS_NODE (operation->node), NULL);
+  g_return_val_if_fail (GEGL_IS_BUFFER (input), NULL);
+  g_return_val_if_fail (rect && rect->width > 0 && rect->height > 0, NULL);
+  g_return_val_if_fail (babl_format_get_n_components (format) <=
+                        GEGL_STATISTICS_MAX_COMPONENTS, NULL);
+
+  n_bins = MAX (n_bins, 0);
+
+  g_static_mutex_lock (&cache_mutex);
+
+  cache = statistics_cache_get (operation->node);
+  stats = statistics_lookup (cache, rect, format, n_bins);
+  if (stats)
+    {
+      GEGL_NOTE (GEGL_DEBUG_CACHE, "statistics of %s (%i,%i %i×%i) reused",
+                 gegl_node_get_debug_name (operation->node),
+                 rect->x, rect->y, rect->width, rect->height);
+
+      stats = statistics_copy (stats);
+      g_static_mutex_unlock (&cache_mutex);
+
+      return stats;
+    }
+  generation = cache->generation;
+
+  g_static_mutex_unlock (&cache_mutex);
+
+  /* the scan runs unlocked, other nodes and other rectangles are not held
+   * up by it
+   */
+  computed = statistics_compute (input, rect, format, n_bins);
+  stats    = statistics_copy (computed);
+
+  g_static_mutex_lock (&cache_mutex);
+
+  /* not kept when the node was invalidated meanwhile, or when another
+   * thread got there first
+   */
+  if (cache->generation == generation &&
+      !statistics_lookup (cache, rect, format, n_bins))
+    {
+      cache->list = g_slist_prepend (cache->list, computed);
+      computed    = NULL;
+    }
+
+  g_static_mutex_unlock (&cache_mutex);
+
+  if (computed)
+    statistics_free (computed);
+
+  return stats;
+}
@@ -0,0 +1,82 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Statistics of a whole rectangle of an input, for operations that need a
+ * global reduction (extrema, averages, a histogram) before they can compute
+ * any part of their output.  The results are kept with the node of the
+ * operation until the node is invalidated, so an operation rendered in
+ * chunks scans its input once instead of once per chunk.
+ */
+
+#ifndef __GEGL_OPERATION_STATISTICS_H__
+#define __GEGL_OPERATION_STATISTICS_H__
+
+#include "gegl-operation.h"
+
+G_BEGIN_DECLS
+
+#define GEGL_STATISTICS_MAX_COMPONENTS 4
+
+/* log_mean is the mean of log (GEGL_STATISTICS_LOG_DELTA + MAX (value, 0)),
+ * the offset keeps black pixels from dominating it
+ */
+#define GEGL_STATISTICS_LOG_DELTA 2.3e-5
+
+typedef struct _GeglStatistics GeglStatistics;
+struct _GeglStatistics
+{
+  GeglRectangle  rect;          /* area summarised */
+  const Babl    *format;        /* float format the pixels were read in */
+  gint           n_components;
+  glong          count;         /* number of pixels */
+  glong          valid[GEGL_STATISTICS_MAX_COMPONENTS];
+                                /* finite values of a component, the others
+                                 * are left out of the statistics
+                                 */
+
+  gdouble        min[GEGL_STATISTICS_MAX_COMPONENTS];
+  gdouble        max[GEGL_STATISTICS_MAX_COMPONENTS];
+  gdouble        mean[GEGL_STATISTICS_MAX_COMPONENTS];
+  gdouble        log_mean[GEGL_STATISTICS_MAX_COMPONENTS];
+
+  gint           n_bins;        /* 0 when no histogram was asked for */
+  glong         *histogram;     /* n_bins counts per component, the bins of a
+                                 * component split [min, max] evenly
+                                 */
+};
+
+/* Returns the statistics of rect of input, read in format, which must have
+ * float components.  A histogram of n_bins bins per component is computed
+ * when n_bins is positive.  The input is read a strip of tile rows at a
+ * time and the sums are added in a fixed order, so the results do not
+ * depend on the number of threads.
+ *
+ * The statistics are kept with the node of operation until the node is
+ * invalidated, later calls with the same arguments copy them without
+ * reading input again.  The returned copy is freed with
+ * gegl_statistics_free.
+ */
+GeglStatistics * gegl_operation_get_statistics (GeglOperation       *operation,
+                                                GeglBuffer          *input,
+                                                const GeglRectangle *rect,
+                                                const Babl          *format,
+                                                gint                 n_bins);
+
+void             gegl_statistics_free          (GeglStatistics      *stats);
+
+G_END_DECLS
+
+#endif
@@ -66,14 +66,12 @@ gegl_debug_rect_visitor_visit_node (GeglVisitor *self,
     "%s\n"
     "\thave: %ix%i %i,%i\n"
     "\tneed: %ix%i %i,%i\n"
-    "\tresult: %ix%i %i,%i\n"
-    "\trefs: %i",
+    "\tresult: %ix%i %i,%i",
     gegl_node_get_debug_name (node),
     node->have_rect.width, node->have_rect.height,
     node->have_rect.x, node->have_rect.y,
     context->need_rect.width, context->need_rect.height,
     context->need_rect.x, context->need_rect.y,
     context->result_rect.width, context->result_rect.height,
-    context->result_rect.x, context->result_rect.y,
-    context->refs);
+    context->result_rect.x, context->result_rect.y);
 }
@@ -0,0 +1,415 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gegl.h"
+#include "gegl-debug.h"
+#include "gegl-types-internal.h"
+#include "gegl-config.h"
+#include "gegl-disk-cache.h"
+#include "gegl-value-contents.h"
+#include "graph/gegl-node.h"
+#include "graph/gegl-pad.h"
+#include "operation/gegl-operation.h"
+#include "operation/gegl-operation-context.h"
+#include "operation/gegl-operation-sink.h"
+
+static gint hits    = 0;
+static gint misses  = 0;
+static gint stored  = 0;
+static gint evicted = 0;
+
+static GStaticMutex evict_mutex = G_STATIC_MUTEX_INIT;
+
+/* the size of the files in total_dir as of its last scan plus the size of
+ * the files stored since, -1 when it needs a scan.  Files stored by other
+ * processes are only counted by the next scan.
+ */
+static gint64  total     = -1;
+static gchar  *total_dir = NULL;
+
+/* adds a property value to a checksum, FALSE for values that don't
+ * describe the same thing in another process, like buffers
+ */
+static gboolean
+gegl_disk_cache_add_value (GChecksum    *checksum,
+                           const GValue *value)
+{
+  gchar *contents = gegl_value_contents (value);
+
+  if (!contents)
+    return FALSE;
+
+  /* files read by the operation, like the path of a png-load, are taken
+   * to be the same while their size and time are
+   */
+  if (G_VALUE_HOLDS_STRING (value) && g_value_get_string (value))
+    {
+      const gchar *string = g_value_get_string (value);
+      struct stat  st;
+
+      if (g_stat (string, &st) == 0 && S_ISREG (st.st_mode))
+        {
+          g_free (contents);
+          contents = g_strdup_printf ("%s %" G_GINT64_FORMAT " %" G_GINT64_FORMAT,
+                                      string, (gint64) st.st_size,
+                                      (gint64) st.st_mtime);
+        }
+    }
+
+  g_checksum_update (checksum, (guchar *) contents, -1);
+  g_free (contents);
+
+  return TRUE;
+}
+
+/* the checksum of the output of node, of its operation, the values of its
+ * properties and the checksums of the outputs connected to its inputs.
+ * "" for outputs that can't be told apart across processes, and for those
+ * depending on them.  Kept in the context of node for the evaluation.
+ */
+static const gchar *
+gegl_disk_cache_checksum (GeglNode *node,
+                          gpointer  context_id)
+{
+  GeglOperationContext *context = gegl_node_get_context (node, context_id);
+  GeglOperation        *operation = node->operation;
+  GChecksum            *checksum;
+  GParamSpec          **pspecs;
+  GSList               *pads;
+  guint                 n_pspecs;
+  guint                 i;
+  gboolean              known = TRUE;
+
+  if (!context)
+    return "";
+  if (context->checksum)
+    return context->checksum;
+
+  if (!operation || GEGL_IS_OPERATION_SINK (operation))
+    {
+      context->checksum = g_strdup ("");
+      return context->checksum;
+    }
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA1);
+  g_checksum_update (checksum, (guchar *) G_OBJECT_TYPE_NAME (operation), -1);
+
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (operation), &n_pspecs);
+  for (i = 0; i < n_pspecs && known; i++)
+    {
+      GValue value = { 0, };
+
+      /* pads are checksummed by what is connected to them */
+      if (!(pspecs[i]->flags & G_PARAM_READABLE) ||
+          gegl_node_get_pad (node, pspecs[i]->name))
+        continue;
+
+      g_value_init (&value, pspecs[i]->value_type);
+      g_object_get_property (G_OBJECT (operation), pspecs[i]->name, &value);
+      g_checksum_update (checksum, (guchar *) pspecs[i]->name, -1);
+      known = gegl_disk_cache_add_value (checksum, &value);
+      g_value_unset (&value);
+    }
+  g_free (pspecs);
+
+  for (pads = node->input_pads; pads && known; pads = g_slist_next (pads))
+    {
+      GeglPad *source_pad = gegl_pad_get_connected_to (pads->data);
+
+      g_checksum_update (checksum, (guchar *) gegl_pad_get_name (pads->data), -1);
+      if (source_pad)
+        {
+          const gchar *source = gegl_disk_cache_checksum (gegl_pad_get_node (source_pad),
+                                                          context_id);
+
+          known = *source != '\0';
+          g_checksum_update (checksum, (guchar *) source, -1);
+          g_checksum_update (checksum, (guchar *) gegl_pad_get_name (source_pad), -1);
+        }
+    }
+
+  context->checksum = g_strdup (known ? g_checksum_get_string (checksum) : "");
+  g_checksum_free (checksum);
+
+  return context->checksum;
+}
+
+/* the file the output of node computed in this evaluation is kept in, NULL
+ * when it isn't kept
+ */
+static gchar *
+gegl_disk_cache_path (GeglNode *node,
+                      gpointer  context_id)
+{
+  GeglOperationContext *context = gegl_node_get_context (node, context_id);
+  const GeglRectangle  *result  = &context->result_rect;
+  const gchar          *dir     = gegl_config ()->disk_cache;
+  const gchar          *output;
+  const Babl           *format;
+  gchar                *key;
+  gchar                *name;
+  gchar                *path;
+  gint                  major, minor, micro;
+
+  if (!dir || !node->operation || node->is_graph ||
+      GEGL_OPERATION_GET_CLASS (node->operation)->no_cache ||
+      !gegl_node_get_pad (node, "output"))
+    return NULL;
+
+  output = gegl_disk_cache_checksum (node, context_id);
+  if (*output == '\0')
+    return NULL;
+
+  /* everything else the pixels computed depend on */
+  format = gegl_operation_get_format (node->operation, "output");
+  gegl_get_version (&major, &minor, &micro);
+  key = g_strdup_printf ("%s %d,%d %dx%d %s %d.%d.%d %f %f",
+                         output,
+                         result->x, result->y, result->width, result->height,
+                         format ? babl_get_name (format) : "",
+                         major, minor, micro,
+                         gegl_config ()->quality,
+                         gegl_config ()->babl_tolerance);
+
+  name = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+  path = g_strconcat (dir, G_DIR_SEPARATOR_S, name, ".gegl", NULL);
+  g_free (name);
+  g_free (key);
+
+  return path;
+}
+
+typedef struct
+{
+  gchar  *path;
+  gint64  size;
+  gint64  time;
+} CacheFile;
+
+static gint
+cache_file_compare (gconstpointer a,
+                    gconstpointer b)
+{
+  const CacheFile *file_a = a;
+  const CacheFile *file_b = b;
+
+  return file_a->time < file_b->time ? -1 : file_a->time > file_b->time;
+}
+
+/* removes the least recently used files of dir until it fits in limit,
+ * hits touch the files they load.  Returns the size of the files left, -1
+ * when dir can't be read.  Must be called with evict_mutex held.
+ */
+static gint64
+gegl_disk_cache_evict (const gchar *dir,
+                       gint64       limit)
+{
+  gint64       left  = 0;
+  GSList      *files = NULL;
+  GSList      *iter;
+  const gchar *name;
+  GDir        *gdir;
+
+  gdir = g_dir_open (dir, 0, NULL);
+  if (!gdir)
+    return -1;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      CacheFile   *file;
+      struct stat  st;
+      gchar       *path;
+
+      if (!g_str_has_suffix (name, ".gegl"))
+        continue;
+
+      path = g_build_filename (dir, name, NULL);
+      if (g_stat (path, &st) != 0)
+        {
+          g_free (path);
+          continue;
+        }
+
+      file       = g_slice_new (CacheFile);
+      file->path = path;
+      file->size = st.st_size;
+      file->time = st.st_mtime;
+      files      = g_slist_prepend (files, file);
+      left      += file->size;
+    }
+  g_dir_close (gdir);
+
+  files = g_slist_sort (files, cache_file_compare);
+  for (iter = files; iter; iter = g_slist_next (iter))
+    {
+      CacheFile *file = iter->data;
+
+      if (left > limit && g_unlink (file->path) == 0)
+        {
+          GEGL_NOTE (GEGL_DEBUG_DISK_CACHE, "evicted %s", file->path);
+          left -= file->size;
+          g_atomic_int_inc (&evicted);
+        }
+
+      g_free (file->path);
+      g_slice_free (CacheFile, file);
+    }
+  g_slist_free (files);
+
+  return left;
+}
+
+/* counts size more bytes stored in the directory, it is only scanned for
+ * files to evict once the running total grows beyond disk-cache-size
+ */
+static void
+gegl_disk_cache_grow (gint64 size)
+{
+  const gchar *dir   = gegl_config ()->disk_cache;
+  gint64       limit = (gint64) gegl_config ()->disk_cache_size * 1024 * 1024;
+
+  g_static_mutex_lock (&evict_mutex);
+
+  if (!total_dir || strcmp (total_dir, dir))
+    {
+      g_free (total_dir);
+      total_dir = g_strdup (dir);
+      total     = -1;
+    }
+
+  if (total >= 0)
+    total += size;
+
+  if (total < 0 || total > limit)
+    total = gegl_disk_cache_evict (dir, limit);
+
+  g_static_mutex_unlock (&evict_mutex);
+}
+
+/* sets the output of node from the file it was kept in by an earlier
+ * evaluation, FALSE when there is none and node is to be computed
+ */
+gboolean
+gegl_disk_cache_load (GeglNode *node,
+                      gpointer  context_id)
+{
+  GeglOperationContext *context = gegl_node_get_context (node, context_id);
+  const GeglRectangle  *result  = &context->result_rect;
+  GeglBuffer           *loaded  = NULL;
+  GeglBuffer           *output;
+  gchar                *path;
+
+  path = gegl_disk_cache_path (node, context_id);
+  if (!path)
+    return FALSE;
+
+  if (g_file_test (path, G_FILE_TEST_IS_REGULAR))
+    loaded = gegl_buffer_load (path);
+
+  if (!loaded)
+    {
+      GEGL_NOTE (GEGL_DEBUG_DISK_CACHE, "miss for \"%s\": %s",
+                 gegl_node_get_debug_name (node), path);
+      g_atomic_int_inc (&misses);
+      g_free (path);
+      return FALSE;
+    }
+
+  output = gegl_operation_context_get_target (context, "output");
+  gegl_buffer_copy (loaded, result, output, result);
+  if (output == GEGL_BUFFER (node->cache))
+    gegl_cache_computed (node->cache, result);
+  g_object_unref (loaded);
+
+  /* most recently used */
+  g_utime (path, NULL);
+
+  GEGL_NOTE (GEGL_DEBUG_DISK_CACHE, "hit for \"%s\": %s",
+             gegl_node_get_debug_name (node), path);
+  g_atomic_int_inc (&hits);
+  g_free (path);
+
+  return TRUE;
+}
+
+/* keeps the output node computed in its file, for later evaluations */
+void
+gegl_disk_cache_store (GeglNode *node,
+                       gpointer  context_id)
+{
+  GeglOperationContext *context = gegl_node_get_context (node, context_id);
+  GeglBuffer           *output;
+  struct stat           st;
+  gint64                size = 0;
+  gchar                *path;
+  gchar                *temp;
+
+  path = gegl_disk_cache_path (node, context_id);
+  if (!path)
+    return;
+
+  output = GEGL_BUFFER (gegl_operation_context_get_object (context, "output"));
+  if (!output || g_mkdir_with_parents (gegl_config ()->disk_cache, 0755) != 0)
+    {
+      g_free (path);
+      return;
+    }
+
+  /* written under another name first, other processes only ever load
+   * complete files
+   */
+  temp = g_strdup_printf ("%s-%i-%p.tmp", path, getpid (), g_thread_self ());
+  gegl_buffer_save (output, temp, &context->result_rect);
+
+  /* a file replaced by the rename no longer counts */
+  if (g_stat (path, &st) == 0)
+    size -= st.st_size;
+
+  if (g_stat (temp, &st) == 0 && g_rename (temp, path) == 0)
+    {
+      GEGL_NOTE (GEGL_DEBUG_DISK_CACHE, "stored \"%s\": %s",
+                 gegl_node_get_debug_name (node), path);
+      g_atomic_int_inc (&stored);
+
+      gegl_disk_cache_grow (size + st.st_size);
+    }
+  else
+    {
+      g_unlink (temp);
+    }
+  g_free (temp);
+  g_free (path);
+}
+
+void
+gegl_disk_cache_stats (void)
+{
+  if (!gegl_config ()->disk_cache)
+    return;
+
+  GEGL_NOTE (GEGL_DEBUG_DISK_CACHE,
+             "disk cache %s: %i hits, %i misses, %i stored, %i evicted",
+             gegl_config ()->disk_cache, hits, misses, stored, evicted);
+}
@@ -0,0 +1,41 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_DISK_CACHE_H__
+#define __GEGL_DISK_CACHE_H__
+
+G_BEGIN_DECLS
+
+/* With the disk-cache config property set to a directory, the outputs of
+ * the operations that keep a GeglCache are also saved there as .gegl files,
+ * named by a checksum of everything the pixels computed depend on: the
+ * operation, its properties, the checksums of its inputs and the
+ * rectangle computed.  Later evaluations, in this process or others, load
+ * them instead of computing them again.  The least recently used files are
+ * removed when the directory grows beyond disk-cache-size, the directory is
+ * only scanned when the size of the files stored since the last scan takes
+ * it over the limit.
+ */
+
+gboolean gegl_disk_cache_load  (GeglNode *node,
+                                gpointer  context_id);
+void     gegl_disk_cache_store (GeglNode *node,
+                                gpointer  context_id);
+void     gegl_disk_cache_stats (void);
+
+G_END_DECLS
+
+#endif /* __GEGL_DISK_CACHE_H__ */
@@ -23,11 +23,14 @@
 
 #include "gegl.h"
 #include "gegl-types-internal.h"
+#include "gegl-config.h"
+#include "gegl-debug.h"
 #include "gegl-eval-mgr.h"
 #include "gegl-eval-visitor.h"
 #include "gegl-debug-rect-visitor.h"
 #include "gegl-need-visitor.h"
 #include "gegl-have-visitor.h"
+#include "gegl-merge-visitor.h"
 #include "gegl-instrument.h"
 #include "graph/gegl-node.h"
 #include "gegl-prepare-visitor.h"
@@ -41,6 +44,7 @@
 static void gegl_eval_mgr_class_init (GeglEvalMgrClass *klass);
 static void gegl_eval_mgr_init (GeglEvalMgr *self);
 static void gegl_eval_mgr_finalize (GObject *self_object);
+static void gegl_eval_mgr_free_plan (GeglEvalMgr *self);
 
 G_DEFINE_TYPE (GeglEvalMgr, gegl_eval_mgr, G_TYPE_OBJECT)
 
@@ -92,11 +96,42 @@ gegl_eval_mgr_finalize (GObject *self_object)
   g_object_unref (self->eval_visitor);
   g_object_unref (self->need_visitor);
   g_object_unref (self->finish_visitor);
+  gegl_eval_mgr_free_plan (self);
   g_free (self->pad_name);
 
   G_OBJECT_CLASS (gegl_eval_mgr_parent_class)->finalize (self_object);
 }
 
+/* the visitables a visitor visited, in the order it visited them */
+static GSList *
+gegl_eval_mgr_plan_list (GeglVisitor *visitor)
+{
+  return g_slist_reverse (g_slist_copy (gegl_visitor_get_visits_list (visitor)));
+}
+
+static void
+gegl_eval_mgr_make_plan (GeglEvalMgr *self)
+{
+  self->nodes      = gegl_eval_mgr_plan_list (self->finish_visitor);
+  self->need_nodes = gegl_eval_mgr_plan_list (self->need_visitor);
+  self->pads       = gegl_eval_mgr_plan_list (self->eval_visitor);
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS, "planned evaluation of \"%s\": %d nodes, %d pads",
+             gegl_node_get_debug_name (self->node),
+             g_slist_length (self->nodes), g_slist_length (self->pads));
+}
+
+static void
+gegl_eval_mgr_free_plan (GeglEvalMgr *self)
+{
+  g_slist_free (self->nodes);
+  g_slist_free (self->need_nodes);
+  g_slist_free (self->pads);
+  self->nodes      = NULL;
+  self->need_nodes = NULL;
+  self->pads       = NULL;
+}
+
 static gboolean
 gegl_eval_mgr_change_notification (GObject             *gobject,
                                    const GeglRectangle *rect,
@@ -121,6 +156,9 @@ gegl_eval_mgr_change_notification (GObject             *gobject,
       mgr->state = NEED_REDO_PREPARE_AND_HAVE_RECT_TRAVERSAL;
     }
 
+  /* connections might have changed */
+  gegl_eval_mgr_free_plan (mgr);
+
   return FALSE;
 }
 
@@ -133,6 +171,10 @@ gegl_eval_mgr_apply (GeglEvalMgr *self)
   GeglPad     *pad;
   glong        time       = gegl_ticks ();
   gpointer     context_id = self;
+  GSList      *nodes      = NULL;
+  GSList      *need_nodes = NULL;
+  GSList      *pads       = NULL;
+  gboolean     planned;
 
   g_assert (GEGL_IS_EVAL_MGR (self));
 
@@ -150,6 +192,22 @@ gegl_eval_mgr_apply (GeglEvalMgr *self)
 
   g_object_ref (root);
 
+  /* the plan is dropped whenever the state goes back to redoing the
+   * prepare and have_rect traversals.  We hold on to it ourselves while
+   * evaluating, changes made meanwhile drop the plan of the mgr only.
+   */
+  planned = self->nodes != NULL &&
+            self->state == NEED_CONTEXT_SETUP_TRAVERSAL;
+  if (planned)
+    {
+      nodes      = self->nodes;
+      need_nodes = self->need_nodes;
+      pads       = self->pads;
+      self->nodes      = NULL;
+      self->need_nodes = NULL;
+      self->pads       = NULL;
+    }
+
   /* do the necessary set-up work (all using depth first traversal) */
   switch (self->state)
     {
@@ -167,10 +225,28 @@ gegl_eval_mgr_apply (GeglEvalMgr *self)
       case NEED_CONTEXT_SETUP_TRAVERSAL:
 
         gegl_visitor_reset (self->prepare_visitor);
-        gegl_visitor_dfs_traverse (self->prepare_visitor, GEGL_VISITABLE (root));
+        if (planned)
+          gegl_visitor_list_traverse (self->prepare_visitor, nodes);
+        else
+          gegl_visitor_dfs_traverse (self->prepare_visitor, GEGL_VISITABLE (root));
         self->state = NEED_CONTEXT_SETUP_TRAVERSAL;
      }
 
+  /* let nodes computing the same output as another one take its output,
+   * before the need traversal counts the consumers of the outputs
+   */
+  if (gegl_config ()->merge_duplicates)
+    {
+      GeglVisitor *merge_visitor;
+
+      merge_visitor = g_object_new (GEGL_TYPE_MERGE_VISITOR, "id", context_id, NULL);
+      if (planned)
+        gegl_visitor_list_traverse (merge_visitor, nodes);
+      else
+        gegl_visitor_dfs_traverse (merge_visitor, GEGL_VISITABLE (root));
+      g_object_unref (merge_visitor);
+    }
+
   /* set up the root node */
   if (self->roi.width == -1 &&
       self->roi.height == -1)
@@ -188,7 +264,10 @@ gegl_eval_mgr_apply (GeglEvalMgr *self)
    * hamper other useful API that depends on the need_rect to be
    * in the nodes?
    */
-  gegl_visitor_bfs_traverse (self->need_visitor, GEGL_VISITABLE (root));
+  if (planned)
+    gegl_visitor_list_traverse (self->need_visitor, need_nodes);
+  else
+    gegl_visitor_bfs_traverse (self->need_visitor, GEGL_VISITABLE (root));
 
 #if 0
   if (g_getenv ("GEGL_DEBUG_RECTS") != NULL)
@@ -204,7 +283,11 @@ gegl_eval_mgr_apply (GeglEvalMgr *self)
 
   /* now let's do the real work */
   gegl_visitor_reset (self->eval_visitor);
-  if (pad)
+  if (planned)
+    {
+      gegl_visitor_list_traverse (self->eval_visitor, pads);
+    }
+  else if (pad)
     {
       gegl_visitor_dfs_traverse (self->eval_visitor, GEGL_VISITABLE (pad));
     }
@@ -233,7 +316,33 @@ gegl_eval_mgr_apply (GeglEvalMgr *self)
 
   /* do the clean up */
   gegl_visitor_reset (self->finish_visitor);
-  gegl_visitor_dfs_traverse (self->finish_visitor, GEGL_VISITABLE (root));
+  if (planned)
+    gegl_visitor_list_traverse (self->finish_visitor, nodes);
+  else
+    gegl_visitor_dfs_traverse (self->finish_visitor, GEGL_VISITABLE (root));
+
+  /* keep the orders of the traversals for the next evaluations, unless the
+   * graph changed while evaluating it
+   */
+  if (self->state == NEED_CONTEXT_SETUP_TRAVERSAL)
+    {
+      if (!planned)
+        {
+          gegl_eval_mgr_make_plan (self);
+        }
+      else
+        {
+          self->nodes      = nodes;
+          self->need_nodes = need_nodes;
+          self->pads       = pads;
+        }
+    }
+  else
+    {
+      g_slist_free (nodes);
+      g_slist_free (need_nodes);
+      g_slist_free (pads);
+    }
 
   g_object_unref (root);
   time = gegl_ticks () - time;
@@ -70,6 +70,15 @@ struct _GeglEvalMgr
   GeglVisitor *have_visitor;
   GeglVisitor *finish_visitor;
 
+  /* the plan of the evaluation: the orders the traversals of the graph
+   * visited the nodes and pads in, kept while the graph does not change so
+   * that the next evaluations visit the same lists instead of traversing
+   * the graph again (the prepare and finish visitors visit the nodes, the
+   * need visitor the need_nodes and the eval visitor the pads)
+   */
+  GSList      *nodes;
+  GSList      *need_nodes;
+  GSList      *pads;
 };
 
 struct _GeglEvalMgrClass
@@ -25,6 +25,8 @@
 #include "gegl-debug.h"
 #include "gegl-types-internal.h"
 #include "gegl-eval-visitor.h"
+#include "gegl-disk-cache.h"
+#include "gegl-point-fusion.h"
 #include "graph/gegl-node.h"
 #include "operation/gegl-operation.h"
 #include "operation/gegl-operation-context.h"
@@ -33,6 +35,7 @@
 #include "gegl-instrument.h"
 #include "operation/gegl-operation-sink.h"
 #include "buffer/gegl-region.h"
+#include "gegl-utils.h"
 
 
 static void gegl_eval_visitor_class_init (GeglEvalVisitorClass *klass);
@@ -57,6 +60,43 @@ gegl_eval_visitor_init (GeglEvalVisitor *self)
 }
 
 
+/* gives a duplicate the output of the node it duplicates, when that covers
+ * all the duplicate computes, see gegl-merge-visitor.c.  The duplicate is
+ * counted as a consumer of that output, and is done with it either way.
+ */
+static gboolean
+gegl_eval_visitor_take_original (GeglOperationContext *context,
+                                 gpointer              context_id)
+{
+  GeglOperationContext *original = gegl_node_get_context (context->duplicate_of,
+                                                          context_id);
+  GValue               *value    = gegl_operation_context_get_value (original,
+                                                                     "output");
+  gboolean              taken    = FALSE;
+
+  if (value && g_value_get_object (value) && !original->cached &&
+      gegl_rectangle_contains (&original->result_rect, &context->result_rect))
+    {
+      gegl_operation_context_set_object (context, "output",
+                                         g_value_get_object (value));
+      taken = TRUE;
+    }
+
+  if (gegl_operation_context_consumed (original, "output"))
+    {
+      /* the last consumer of the original, its buffer is the duplicate's */
+      if (taken)
+        gegl_operation_context_set_owned (context, "output", TRUE);
+    }
+  else if (taken)
+    {
+      /* shared with the consumers of the duplicate from now on */
+      gegl_operation_context_set_owned (original, "output", FALSE);
+    }
+
+  return taken;
+}
+
 /* this is the visitor that does the real computations for GEGL */
 static void
 gegl_eval_visitor_visit_pad (GeglVisitor *self,
@@ -79,6 +119,19 @@ gegl_eval_visitor_visit_pad (GeglVisitor *self,
                                              gegl_pad_get_name (pad),
                                              G_OBJECT (node->cache));
         }
+      else if (context->duplicate_of &&
+               gegl_eval_visitor_take_original (context, context_id))
+        {
+          GEGL_NOTE (GEGL_DEBUG_PROCESS, "Using the output of %p for pad '%s' on \"%s\"", context->duplicate_of, gegl_pad_get_name (pad), gegl_node_get_debug_name (node));
+        }
+      else if (gegl_point_fusion_is_fused (node, context_id))
+        {
+          /* computed along with the node consuming it, which needs the
+           * inputs of this one then
+           */
+          GEGL_NOTE (GEGL_DEBUG_PROCESS, "Fusing pad '%s' on \"%s\" into its consumer", gegl_pad_get_name (pad), gegl_node_get_debug_name (node));
+          return;
+        }
       else
         {
           if ((context->result_rect.width == 0 || context->result_rect.height == 0))
@@ -94,27 +147,33 @@ gegl_eval_visitor_visit_pad (GeglVisitor *self,
               GEGL_NOTE (GEGL_DEBUG_PROCESS, "For \"%s\" processing pad '%s' result_rect = %d, %d %d×%d",
                          gegl_pad_get_name (pad), gegl_node_get_debug_name (node),
                          context->result_rect.x, context->result_rect.y, context->result_rect.width, context->result_rect.height);
-              gegl_operation_process (operation, context, gegl_pad_get_name (pad),
-                                      &context->result_rect);
+              if (!gegl_disk_cache_load (node, context_id))
+                {
+                  if (!gegl_point_fusion_process (node, context_id))
+                    gegl_operation_process (operation, context, gegl_pad_get_name (pad),
+                                            &context->result_rect);
+                  gegl_disk_cache_store (node, context_id);
+                }
               time      = gegl_ticks () - time;
 
               gegl_instrument ("process", gegl_node_get_operation (node), time);
             }
+        }
 
-          if (gegl_pad_get_num_connections (pad) > 1)
+      /* with its only output computed the node is done with its inputs,
+       * dropping them frees buffers no other consumer holds on to, and
+       * leaves buffers with one consumer left to process them in place
+       */
+      if (node->output_pads->next == NULL)
+        {
+          GSList *pads;
+
+          for (pads = node->input_pads; pads; pads = g_slist_next (pads))
             {
-              /* Mark buffers that have been consumed by different parts of the
-               * graph so that in-place processing can be avoided on them.
-               */
-              GValue *value;
-              GeglBuffer *buffer;
-              value = gegl_operation_context_get_value (context, gegl_pad_get_name (pad));
-              if (value)
-                {
-                  buffer = g_value_get_object (value);
-                  if (buffer)
-                    gegl_object_set_has_forked (buffer);
-                }
+              const gchar *name = gegl_pad_get_name (pads->data);
+
+              if (gegl_operation_context_get_value (context, name))
+                gegl_operation_context_remove_property (context, name);
             }
         }
     }
@@ -132,6 +191,10 @@ gegl_eval_visitor_visit_pad (GeglVisitor *self,
           GeglNode        *source_node    = gegl_pad_get_node (source_pad);
           GeglOperationContext *source_context = gegl_node_get_context (source_node, context_id);
 
+          /* the output of a node fused into this one is never set */
+          if (gegl_point_fusion_is_fused (source_node, context_id))
+            return;
+
           g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (prop_spec));
 
           gegl_operation_context_get_property (source_context,
@@ -148,16 +211,22 @@ gegl_eval_visitor_visit_pad (GeglVisitor *self,
           gegl_operation_context_set_property (context,
                                           gegl_pad_get_name (pad),
                                           &value);
-          /* reference counting for this source dropped to zero, freeing up */
-          if (-- gegl_node_get_context (
-                     gegl_pad_get_node (source_pad), context_id)->refs == 0 &&
-              g_value_get_object (&value))
-            {
-              gegl_operation_context_remove_property (
-                 gegl_node_get_context (
-                    gegl_pad_get_node (source_pad), context_id),
-                    gegl_pad_get_name (source_pad));
-            }
+          /* a node with several outputs keeps its inputs until the end of
+           * the evaluation, no other consumer may write to them
+           */
+          if (node->output_pads && node->output_pads->next)
+            gegl_operation_context_set_owned (source_context,
+                                              gegl_pad_get_name (source_pad),
+                                              FALSE);
+
+          /* the source drops its output after its last consumer took it,
+           * which then owns the buffer when the source did
+           */
+          if (gegl_operation_context_consumed (source_context,
+                                               gegl_pad_get_name (source_pad)))
+            gegl_operation_context_set_owned (context,
+                                              gegl_pad_get_name (pad),
+                                              TRUE);
 
           g_value_unset (&value);
 
@@ -0,0 +1,179 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <string.h>
+
+#include "gegl.h"
+#include "gegl-debug.h"
+#include "gegl-types-internal.h"
+#include "gegl-merge-visitor.h"
+#include "gegl-value-contents.h"
+#include "operation/gegl-operation.h"
+#include "operation/gegl-operation-context.h"
+#include "operation/gegl-operation-sink.h"
+#include "graph/gegl-node.h"
+#include "graph/gegl-pad.h"
+#include "graph/gegl-visitable.h"
+
+
+static void gegl_merge_visitor_class_init (GeglMergeVisitorClass *klass);
+static void gegl_merge_visitor_finalize   (GObject               *object);
+static void gegl_merge_visitor_visit_node (GeglVisitor           *self,
+                                           GeglNode              *node);
+
+
+G_DEFINE_TYPE (GeglMergeVisitor, gegl_merge_visitor, GEGL_TYPE_VISITOR)
+
+
+static void
+gegl_merge_visitor_class_init (GeglMergeVisitorClass *klass)
+{
+  GObjectClass     *gobject_class = G_OBJECT_CLASS (klass);
+  GeglVisitorClass *visitor_class = GEGL_VISITOR_CLASS (klass);
+
+  gobject_class->finalize   = gegl_merge_visitor_finalize;
+  visitor_class->visit_node = gegl_merge_visitor_visit_node;
+}
+
+static void
+gegl_merge_visitor_init (GeglMergeVisitor *self)
+{
+  self->outputs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+static void
+gegl_merge_visitor_finalize (GObject *object)
+{
+  GeglMergeVisitor *self = GEGL_MERGE_VISITOR (object);
+
+  g_hash_table_destroy (self->outputs);
+
+  G_OBJECT_CLASS (gegl_merge_visitor_parent_class)->finalize (object);
+}
+
+/* a string equal for the nodes computing the same output: the type of the
+ * operation, the contents of its properties and the nodes connected to its
+ * inputs, with duplicates replaced by the node they duplicate.  NULL for
+ * nodes never merged.
+ */
+static gchar *
+gegl_merge_visitor_key (GeglVisitor *self,
+                        GeglNode    *node)
+{
+  GeglOperation  *operation = node->operation;
+  GParamSpec    **pspecs;
+  GString        *key;
+  GSList         *pads;
+  guint           n_pspecs;
+  guint           i;
+
+  /* sinks are run for what they do, not for an output */
+  if (!operation || node->is_graph ||
+      GEGL_IS_OPERATION_SINK (operation) ||
+      !node->output_pads || node->output_pads->next ||
+      strcmp (gegl_pad_get_name (node->output_pads->data), "output"))
+    return NULL;
+
+  key    = g_string_new (G_OBJECT_TYPE_NAME (operation));
+  pspecs = g_object_class_list_properties (G_OBJECT_GET_CLASS (operation), &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      GValue  value = { 0, };
+      gchar  *contents;
+
+      /* pads are compared by what is connected to them */
+      if (!(pspecs[i]->flags & G_PARAM_READABLE) ||
+          gegl_node_get_pad (node, pspecs[i]->name))
+        continue;
+
+      g_value_init (&value, pspecs[i]->value_type);
+      g_object_get_property (G_OBJECT (operation), pspecs[i]->name, &value);
+
+      /* other objects, like the buffer of a buffer-source, by identity */
+      contents = gegl_value_contents (&value);
+      if (!contents)
+        contents = g_strdup_value_contents (&value);
+
+      g_string_append_printf (key, " %s=%s", pspecs[i]->name, contents);
+      g_free (contents);
+      g_value_unset (&value);
+    }
+  g_free (pspecs);
+
+  for (pads = node->input_pads; pads; pads = g_slist_next (pads))
+    {
+      GeglPad *source_pad = gegl_pad_get_connected_to (pads->data);
+
+      g_string_append_printf (key, " %s<-", gegl_pad_get_name (pads->data));
+      if (source_pad)
+        {
+          GeglNode             *source_node    = gegl_pad_get_node (source_pad);
+          GeglOperationContext *source_context = gegl_node_get_context (source_node,
+                                                                        self->context_id);
+
+          if (source_context && source_context->duplicate_of)
+            source_node = source_context->duplicate_of;
+
+          g_string_append_printf (key, "%p.%s", source_node,
+                                  gegl_pad_get_name (source_pad));
+        }
+    }
+
+  return g_string_free (key, FALSE);
+}
+
+/* points the context of a node computing the same output as a node visited
+ * before to that node, its inputs are visited first so identical subgraphs
+ * are merged from their sources up
+ */
+static void
+gegl_merge_visitor_visit_node (GeglVisitor *self,
+                               GeglNode    *node)
+{
+  GeglMergeVisitor     *merge   = GEGL_MERGE_VISITOR (self);
+  GeglOperationContext *context = gegl_node_get_context (node, self->context_id);
+  GeglNode             *original;
+  gchar                *key;
+
+  GEGL_VISITOR_CLASS (gegl_merge_visitor_parent_class)->visit_node (self, node);
+
+  context->duplicate_of = NULL;
+  context->duplicates   = 0;
+
+  key = gegl_merge_visitor_key (self, node);
+  if (!key)
+    return;
+
+  original = g_hash_table_lookup (merge->outputs, key);
+  if (original)
+    {
+      /* both are of the same operation, which the debug name has */
+      GEGL_NOTE (GEGL_DEBUG_MERGE, "merging \"%s\" into %p: %s",
+                 gegl_node_get_debug_name (node), original, key);
+
+      context->duplicate_of = original;
+      gegl_node_get_context (original, self->context_id)->duplicates++;
+      g_free (key);
+    }
+  else
+    {
+      g_hash_table_insert (merge->outputs, key, node);
+    }
+}
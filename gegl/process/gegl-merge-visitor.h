@@ -0,0 +1,53 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_MERGE_VISITOR_H__
+#define __GEGL_MERGE_VISITOR_H__
+
+#include "graph/gegl-visitor.h"
+
+G_BEGIN_DECLS
+
+
+#define GEGL_TYPE_MERGE_VISITOR            (gegl_merge_visitor_get_type ())
+#define GEGL_MERGE_VISITOR(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GEGL_TYPE_MERGE_VISITOR, GeglMergeVisitor))
+#define GEGL_MERGE_VISITOR_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  GEGL_TYPE_MERGE_VISITOR, GeglMergeVisitorClass))
+#define GEGL_IS_MERGE_VISITOR(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GEGL_TYPE_MERGE_VISITOR))
+#define GEGL_IS_MERGE_VISITOR_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  GEGL_TYPE_MERGE_VISITOR))
+#define GEGL_MERGE_VISITOR_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  GEGL_TYPE_MERGE_VISITOR, GeglMergeVisitorClass))
+
+
+typedef struct _GeglMergeVisitorClass GeglMergeVisitorClass;
+
+struct _GeglMergeVisitor
+{
+  GeglVisitor  parent_instance;
+
+  GHashTable  *outputs; /* the first node visited for every key */
+};
+
+struct _GeglMergeVisitorClass
+{
+  GeglVisitorClass  parent_class;
+};
+
+
+GType   gegl_merge_visitor_get_type (void) G_GNUC_CONST;
+
+
+G_END_DECLS
+
+#endif /* __GEGL_MERGE_VISITOR_H__ */
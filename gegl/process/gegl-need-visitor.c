@@ -27,6 +27,7 @@
 #include "gegl-need-visitor.h"
 #include "operation/gegl-operation.h"
 #include "operation/gegl-operation-context.h"
+#include "graph/gegl-connection.h"
 #include "graph/gegl-node.h"
 #include "graph/gegl-pad.h"
 #include "graph/gegl-visitable.h"
@@ -54,7 +55,7 @@ gegl_need_visitor_init (GeglNeedVisitor *self)
 {
 }
 
-/* sets the context's result_rect and refs */
+/* sets the context's result_rect and the consumers of its output pads */
 static void
 gegl_need_visitor_visit_node (GeglVisitor *self,
                               GeglNode    *node)
@@ -78,5 +79,36 @@ gegl_need_visitor_visit_node (GeglVisitor *self,
              context->need_rect.x, context->need_rect.y, context->need_rect.width, context->need_rect.height,
              context->result_rect.x, context->result_rect.y, context->result_rect.width, context->result_rect.height);
 
-  context->refs = gegl_node_get_num_sinks (node);
+  /* count the input pads in this evaluation taking the output of every
+   * output pad, the consumers of nodes the evaluation doesn't reach have
+   * no context
+   */
+  {
+    GSList *pads;
+
+    for (pads = node->output_pads; pads; pads = g_slist_next (pads))
+      {
+        GeglPad *pad       = pads->data;
+        gint     consumers = 0;
+        GSList  *connections;
+
+        for (connections = gegl_pad_get_connections (pad);
+             connections;
+             connections = g_slist_next (connections))
+          {
+            GeglNode *sink = gegl_connection_get_sink_node (connections->data);
+
+            if (gegl_node_get_context (sink, self->context_id))
+              consumers++;
+          }
+
+        /* duplicates of this node take its output in place of their own */
+        if (!strcmp (gegl_pad_get_name (pad), "output"))
+          consumers += context->duplicates;
+
+        gegl_operation_context_set_consumers (context,
+                                              gegl_pad_get_name (pad),
+                                              consumers);
+      }
+  }
 }
@@ -0,0 +1,383 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+#include <string.h>
+
+#include "gegl.h"
+#include "gegl-debug.h"
+#include "gegl-types-internal.h"
+#include "gegl-point-fusion.h"
+#include "graph/gegl-connection.h"
+#include "graph/gegl-node.h"
+#include "graph/gegl-pad.h"
+#include "operation/gegl-operation.h"
+#include "operation/gegl-operation-context.h"
+#include "operation/gegl-operation-point-composer.h"
+#include "operation/gegl-operation-point-filter.h"
+#include "opencl/gegl-cl.h"
+#include "gegl-utils.h"
+
+/* the number of pixels the operations of a chain compute at a time, small
+ * enough for the scratch buffers passing them on to stay in the caches
+ */
+#define GEGL_POINT_FUSION_BLOCK 1024
+
+gboolean gegl_can_do_inplace_processing (GeglOperation        *operation,
+                                         GeglOperationContext *context,
+                                         GeglBuffer           *input,
+                                         const GeglRectangle  *result);
+
+typedef struct
+{
+  GeglNode      *node;
+  GeglOperation *operation;
+  gboolean       composer;
+  GeglBuffer    *aux;
+  const Babl    *aux_format;
+  gint           aux_index; /* in the iterator, -1 when read by itself */
+  const Babl    *fish;      /* from the output of the operation before,
+                               when its format differs from our input */
+} FusedOperation;
+
+/* point operations doing their processing through the process of the
+ * point filter or point composer class, on the cpu
+ */
+static gboolean
+gegl_point_fusion_fusable (GeglNode *node)
+{
+  GeglOperation      *operation = node->operation;
+  GeglOperationClass *base;
+
+  if (GEGL_IS_OPERATION_POINT_FILTER (operation))
+    {
+      GeglOperationPointFilterClass *klass = GEGL_OPERATION_POINT_FILTER_GET_CLASS (operation);
+
+      if (!klass->process ||
+          (klass->cl_process && gegl_cl_is_accelerated ()))
+        return FALSE;
+
+      base = g_type_class_peek (GEGL_TYPE_OPERATION_POINT_FILTER);
+    }
+  else if (GEGL_IS_OPERATION_POINT_COMPOSER (operation))
+    {
+      GeglOperationPointComposerClass *klass = GEGL_OPERATION_POINT_COMPOSER_GET_CLASS (operation);
+
+      if (!klass->process ||
+          (klass->cl_process && gegl_cl_is_accelerated ()))
+        return FALSE;
+
+      base = g_type_class_peek (GEGL_TYPE_OPERATION_POINT_COMPOSER);
+    }
+  else
+    {
+      return FALSE;
+    }
+
+  return GEGL_OPERATION_GET_CLASS (operation)->process == base->process;
+}
+
+/* the node the output of node is computed along with, NULL when it is
+ * computed by itself
+ */
+static GeglNode *
+gegl_point_fusion_get_consumer (GeglNode *node,
+                                gpointer  context_id)
+{
+  GeglOperationContext *context;
+  GeglOperationContext *consumer_context;
+  GeglConnection       *connection;
+  GeglNode             *consumer;
+  GeglPad              *pad;
+
+  /* outputs that would be cached are computed for the cache */
+  if (!gegl_point_fusion_fusable (node) ||
+      !(node->dont_cache || GEGL_OPERATION_GET_CLASS (node->operation)->no_cache))
+    return NULL;
+
+  pad = gegl_node_get_pad (node, "output");
+  if (!pad || gegl_pad_get_num_connections (pad) != 1)
+    return NULL;
+
+  connection = gegl_pad_get_connections (pad)->data;
+  consumer   = gegl_connection_get_sink_node (connection);
+  if (strcmp (gegl_pad_get_name (gegl_connection_get_sink_pad (connection)), "input") ||
+      !gegl_point_fusion_fusable (consumer))
+    return NULL;
+
+  context          = gegl_node_get_context (node, context_id);
+  consumer_context = gegl_node_get_context (consumer, context_id);
+  if (!context || !consumer_context ||
+      context->cached || consumer_context->cached)
+    return NULL;
+
+  /* the duplicates of node take the output it keeps, and a duplicate
+   * takes the output of its original instead of computing one, either way
+   * there has to be a buffer
+   */
+  if (context->duplicates ||
+      context->duplicate_of ||
+      consumer_context->duplicate_of)
+    return NULL;
+
+  /* every pixel the consumer computes must be one node computes */
+  if (consumer_context->result_rect.width <= 0 ||
+      consumer_context->result_rect.height <= 0 ||
+      !gegl_rectangle_contains (&context->result_rect,
+                                &consumer_context->result_rect))
+    return NULL;
+
+  return consumer;
+}
+
+/* whether the output of node is computed by gegl_point_fusion_process on
+ * the node consuming it, the evaluation leaves it without a buffer
+ */
+gboolean
+gegl_point_fusion_is_fused (GeglNode *node,
+                            gpointer  context_id)
+{
+  return gegl_point_fusion_get_consumer (node, context_id) != NULL;
+}
+
+/* computes the output of node along with the outputs fused into it,
+ * returns FALSE when there are none and node is to be processed by itself
+ */
+gboolean
+gegl_point_fusion_process (GeglNode *node,
+                           gpointer  context_id)
+{
+  GeglOperationContext *context = gegl_node_get_context (node, context_id);
+  const GeglRectangle  *result  = &context->result_rect;
+  GeglOperationContext *head_context;
+  GeglBufferIterator   *i;
+  FusedOperation       *ops;
+  GeglNode             *head;
+  GeglBuffer           *input;
+  GeglBuffer           *output;
+  const Babl           *format;
+  guchar               *scratch[4] = { NULL, };
+  glong                 capacity   = 0;
+  gint                  bpp        = 0;
+  gint                  n_ops      = 1;
+  gint                  n_iterators;
+  gint                  read;
+  gint                  k;
+
+  if (!gegl_point_fusion_fusable (node))
+    return FALSE;
+
+  for (head = node; ; n_ops++)
+    {
+      GeglNode *producer = gegl_node_get_producer (head, "input", NULL);
+
+      if (!producer ||
+          gegl_point_fusion_get_consumer (producer, context_id) != head)
+        break;
+      head = producer;
+    }
+
+  if (n_ops == 1)
+    return FALSE;
+
+  ops = g_new0 (FusedOperation, n_ops);
+  for (k = n_ops - 1; k >= 0; k--)
+    {
+      ops[k].node      = k == n_ops - 1 ? node
+                                        : gegl_node_get_producer (ops[k + 1].node, "input", NULL);
+      ops[k].operation = ops[k].node->operation;
+      ops[k].composer  = GEGL_IS_OPERATION_POINT_COMPOSER (ops[k].operation);
+      ops[k].aux_index = -1;
+    }
+
+  head_context = gegl_node_get_context (head, context_id);
+  input = gegl_operation_context_get_source (head_context, "input");
+  if (!input)
+    input = gegl_buffer_new (NULL, NULL);
+
+  if (gegl_can_do_inplace_processing (node->operation, head_context, input, result))
+    {
+      output = g_object_ref (input);
+      gegl_operation_context_take_object (context, "output", G_OBJECT (output));
+      /* the input is in the context of the head of the chain */
+      gegl_operation_context_set_owned (context, "output", TRUE);
+    }
+  else
+    {
+      output = gegl_operation_context_get_target (context, "output");
+    }
+
+  i    = gegl_buffer_iterator_new (output, result,
+                                   gegl_operation_get_format (node->operation, "output"),
+                                   GEGL_BUFFER_WRITE);
+  read = gegl_buffer_iterator_add (i, input, result,
+                                   gegl_operation_get_format (head->operation, "input"),
+                                   GEGL_BUFFER_READ);
+  n_iterators = 2;
+
+  /* the formats passed from one operation to the next, and the aux
+   * inputs of the composers, read along with the input while there is
+   * room in the iterator
+   */
+  format = gegl_operation_get_format (head->operation, "input");
+  for (k = 0; k < n_ops; k++)
+    {
+      GeglOperation *operation = ops[k].operation;
+      const Babl    *in_format = gegl_operation_get_format (operation, "input");
+
+      if (format != in_format)
+        ops[k].fish = babl_fish (format, in_format);
+      format = gegl_operation_get_format (operation, "output");
+
+      bpp = MAX (bpp, babl_format_get_bytes_per_pixel (in_format));
+      bpp = MAX (bpp, babl_format_get_bytes_per_pixel (format));
+
+      if (ops[k].composer)
+        {
+          ops[k].aux        = gegl_operation_context_get_source (
+                                gegl_node_get_context (ops[k].node, context_id),
+                                "aux");
+          ops[k].aux_format = gegl_operation_get_format (operation, "aux");
+
+          if (ops[k].aux)
+            {
+              bpp = MAX (bpp, babl_format_get_bytes_per_pixel (ops[k].aux_format));
+
+              if (n_iterators < GEGL_BUFFER_MAX_ITERATORS)
+                {
+                  ops[k].aux_index = gegl_buffer_iterator_add (i, ops[k].aux, result,
+                                                               ops[k].aux_format,
+                                                               GEGL_BUFFER_READ);
+                  n_iterators++;
+                }
+            }
+        }
+    }
+
+  while (gegl_buffer_iterator_next (i))
+    {
+      const GeglRectangle *roi  = &i->roi[0];
+      gint                 rows = MAX (1, GEGL_POINT_FUSION_BLOCK / roi->width);
+      gint                 y;
+
+      if ((glong) rows * roi->width > capacity)
+        {
+          capacity = (glong) rows * roi->width;
+          for (k = 0; k < G_N_ELEMENTS (scratch); k++)
+            scratch[k] = g_realloc (scratch[k], capacity * bpp);
+        }
+
+      for (y = 0; y < roi->height; y += rows)
+        {
+          GeglRectangle block  = { roi->x, roi->y + y,
+                                   roi->width, MIN (rows, roi->height - y) };
+          glong         offset = (glong) y * roi->width;
+          glong         n      = (glong) block.width * block.height;
+          guchar       *in;
+
+          in = (guchar *) i->data[read] +
+               offset * babl_format_get_bytes_per_pixel (
+                          gegl_operation_get_format (head->operation, "input"));
+
+          for (k = 0; k < n_ops; k++)
+            {
+              FusedOperation *op = &ops[k];
+              guchar         *out;
+
+              /* the last one writes to the output, the others to one of
+               * two scratch buffers taking turns
+               */
+              if (k == n_ops - 1)
+                out = (guchar *) i->data[0] +
+                      offset * babl_format_get_bytes_per_pixel (
+                                 gegl_operation_get_format (op->operation, "output"));
+              else
+                out = scratch[k % 2];
+
+              if (op->fish)
+                {
+                  babl_process (op->fish, in, scratch[2], n);
+                  in = scratch[2];
+                }
+
+              if (op->composer)
+                {
+                  guchar *aux = NULL;
+
+                  if (op->aux_index >= 0)
+                    {
+                      aux = (guchar *) i->data[op->aux_index] +
+                            offset * babl_format_get_bytes_per_pixel (op->aux_format);
+                    }
+                  else if (op->aux)
+                    {
+                      gegl_buffer_get (op->aux, 1.0, &block, op->aux_format,
+                                       scratch[3], GEGL_AUTO_ROWSTRIDE);
+                      aux = scratch[3];
+                    }
+
+                  GEGL_OPERATION_POINT_COMPOSER_GET_CLASS (op->operation)->process (
+                    op->operation, in, aux, out, n, &block);
+                }
+              else
+                {
+                  GEGL_OPERATION_POINT_FILTER_GET_CLASS (op->operation)->process (
+                    op->operation, in, out, n, &block);
+                }
+
+              in = out;
+            }
+        }
+    }
+
+  if (output == GEGL_BUFFER (node->cache))
+    gegl_cache_computed (node->cache, result);
+
+  GEGL_NOTE (GEGL_DEBUG_PROCESS, "computed %d point operations up to \"%s\" in one pass",
+             n_ops, gegl_node_get_debug_name (node));
+
+  /* the operations before node are done with their inputs, node itself
+   * is left to the evaluation
+   */
+  for (k = 0; k < n_ops; k++)
+    {
+      if (ops[k].aux)
+        g_object_unref (ops[k].aux);
+
+      if (k < n_ops - 1)
+        {
+          GeglOperationContext *op_context = gegl_node_get_context (ops[k].node, context_id);
+          GSList               *pads;
+
+          for (pads = ops[k].node->input_pads; pads; pads = g_slist_next (pads))
+            {
+              const gchar *name = gegl_pad_get_name (pads->data);
+
+              if (gegl_operation_context_get_value (op_context, name))
+                gegl_operation_context_remove_property (op_context, name);
+            }
+        }
+    }
+
+  for (k = 0; k < G_N_ELEMENTS (scratch); k++)
+    g_free (scratch[k]);
+  g_free (ops);
+  g_object_unref (input);
+
+  return TRUE;
+}
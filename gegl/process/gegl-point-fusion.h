@@ -0,0 +1,35 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_POINT_FUSION_H__
+#define __GEGL_POINT_FUSION_H__
+
+G_BEGIN_DECLS
+
+/* Chains of point filters and point composers, each one the only consumer
+ * of the one before it, are computed in one pass over the tiles of the
+ * last one's output, passing the pixels from one operation to the next in
+ * small scratch buffers instead of buffers holding all of them.
+ */
+
+gboolean gegl_point_fusion_is_fused (GeglNode *node,
+                                     gpointer  context_id);
+gboolean gegl_point_fusion_process  (GeglNode *node,
+                                     gpointer  context_id);
+
+G_END_DECLS
+
+#endif /* __GEGL_POINT_FUSION_H__ */
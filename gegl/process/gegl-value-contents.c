@@ -0,0 +1,115 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "gegl.h"
+#include "gegl-types-internal.h"
+#include "gegl-value-contents.h"
+
+gchar *
+gegl_value_contents (const GValue *value)
+{
+  switch (G_TYPE_FUNDAMENTAL (G_VALUE_TYPE (value)))
+    {
+      case G_TYPE_FLOAT:
+      case G_TYPE_DOUBLE:
+        {
+          /* exactly, g_strdup_value_contents rounds */
+          gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+          return g_strdup (g_ascii_dtostr (buf, sizeof (buf),
+                                           G_VALUE_HOLDS_DOUBLE (value) ?
+                                           g_value_get_double (value) :
+                                           g_value_get_float (value)));
+        }
+
+      case G_TYPE_STRING:
+        {
+          const gchar *string = g_value_get_string (value);
+
+          return g_strdup (string ? string : "NULL");
+        }
+
+      case G_TYPE_CHAR:
+      case G_TYPE_UCHAR:
+      case G_TYPE_BOOLEAN:
+      case G_TYPE_INT:
+      case G_TYPE_UINT:
+      case G_TYPE_LONG:
+      case G_TYPE_ULONG:
+      case G_TYPE_INT64:
+      case G_TYPE_UINT64:
+      case G_TYPE_ENUM:
+      case G_TYPE_FLAGS:
+        return g_strdup_value_contents (value);
+
+      case G_TYPE_OBJECT:
+        {
+          GObject *object = g_value_get_object (value);
+
+          if (!object)
+            return g_strdup ("NULL");
+
+          if (GEGL_IS_COLOR (object))
+            {
+              GString *string = g_string_new (NULL);
+              gdouble  rgba[4];
+              gint     i;
+
+              gegl_color_get_rgba (GEGL_COLOR (object),
+                                   &rgba[0], &rgba[1], &rgba[2], &rgba[3]);
+              for (i = 0; i < 4; i++)
+                {
+                  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+                  g_string_append_printf (string, i ? " %s" : "%s",
+                                          g_ascii_dtostr (buf, sizeof (buf), rgba[i]));
+                }
+              return g_string_free (string, FALSE);
+            }
+          else if (GEGL_IS_PATH (object))
+            {
+              return gegl_path_to_string (GEGL_PATH (object));
+            }
+          else if (GEGL_IS_CURVE (object))
+            {
+              GString *string = g_string_new (NULL);
+              guint    i;
+
+              for (i = 0; i < gegl_curve_num_points (GEGL_CURVE (object)); i++)
+                {
+                  gchar   x[G_ASCII_DTOSTR_BUF_SIZE];
+                  gchar   y[G_ASCII_DTOSTR_BUF_SIZE];
+                  gdouble point[2];
+
+                  gegl_curve_get_point (GEGL_CURVE (object), i,
+                                        &point[0], &point[1]);
+                  g_string_append_printf (string, "%s,%s ",
+                                          g_ascii_dtostr (x, sizeof (x), point[0]),
+                                          g_ascii_dtostr (y, sizeof (y), point[1]));
+                }
+              return g_string_free (string, FALSE);
+            }
+          return NULL;
+        }
+
+      default:
+        return NULL;
+    }
+}
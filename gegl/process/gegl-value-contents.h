@@ -0,0 +1,33 @@
+/* This file is part of GEGL
+ *
+ * GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GEGL_VALUE_CONTENTS_H__
+#define __GEGL_VALUE_CONTENTS_H__
+
+G_BEGIN_DECLS
+
+/* A string equal for the values of properties that make an operation
+ * compute the same thing, used to find duplicate nodes and to name the
+ * files of the disk cache.  Numbers are written exactly, colors, paths and
+ * curves by what they hold rather than by their address.  NULL for values
+ * that can only be told apart by identity, like buffers.
+ */
+
+gchar * gegl_value_contents (const GValue *value);
+
+G_END_DECLS
+
+#endif /* __GEGL_VALUE_CONTENTS_H__ */
@@ -27,6 +27,7 @@
 #include <glib/gi18n-lib.h>
 
 #include <math.h>
+#include <string.h>
 #include <gegl.h>
 #include <gegl-plugin.h>
 #include <gegl-utils.h>
@@ -37,6 +38,11 @@
 #include "affine.h"
 #include "module.h"
 
+#include "opencl/gegl-cl.h"
+#include "buffer/gegl-buffer-cl-iterator.h"
+
+#include "gegl-openmp.h"
+
 enum
 {
   PROP_ORIGIN_X = 1,
@@ -84,17 +90,26 @@ static GeglNode    * gegl_affine_detect                    (GeglOperation
                                                             gint                  y);
 
 static gboolean      gegl_affine_matrix3_allow_fast_translate      (GeglMatrix3 *matrix);
-static gboolean      gegl_affine_matrix3_allow_fast_reflect_x      (GeglMatrix3 *matrix);
-static gboolean      gegl_affine_matrix3_allow_fast_reflect_y      (GeglMatrix3 *matrix);
+static gboolean      gegl_affine_matrix3_allow_fast_orthogonal     (GeglMatrix3 *matrix);
 
-static void          gegl_affine_fast_reflect_x            (GeglBuffer           *dest,
+static void          gegl_affine_fast_orthogonal           (GeglBuffer           *dest,
                                                             GeglBuffer           *src,
-                                                            const GeglRectangle  *dest_rect,
-                                                            const GeglRectangle  *src_rect);
-static void          gegl_affine_fast_reflect_y            (GeglBuffer           *dest,
+                                                            GeglMatrix3          *matrix);
+
+typedef struct _ScaleFilter ScaleFilter;
+
+static gboolean      gegl_affine_allow_fast_scale          (OpAffine             *affine,
+                                                            GeglMatrix3          *matrix,
+                                                            ScaleFilter          *filter);
+static void          gegl_affine_scale_context_rect        (const ScaleFilter    *filter,
+                                                            GeglRectangle        *context_rect);
+static void          gegl_affine_get_context_rect          (OpAffine             *affine,
+                                                            GeglMatrix3          *matrix,
+                                                            GeglRectangle        *context_rect);
+static void          gegl_affine_fast_scale                (GeglBuffer           *dest,
                                                             GeglBuffer           *src,
-                                                            const GeglRectangle  *dest_rect,
-                                                            const GeglRectangle  *src_rect);
+                                                            GeglMatrix3          *matrix,
+                                                            const ScaleFilter    *filter);
 
 
 /* ************************* */
@@ -450,12 +465,6 @@ gegl_affine_get_bounding_box (GeglOperation *op)
   gint           i;
 
   GeglRectangle  context_rect;
-  GeglSampler   *sampler;
-
-  sampler = gegl_buffer_sampler_new (NULL, babl_format("RaGaBaA float"),
-      gegl_sampler_type_from_string (affine->filter));
-  context_rect = *gegl_sampler_get_context_rect (sampler);
-  g_object_unref (sampler);
 
   if (gegl_operation_source_get_bounding_box (op, "input"))
     in_rect = *gegl_operation_source_get_bounding_box (op, "input");
@@ -468,6 +477,8 @@ gegl_affine_get_bounding_box (GeglOperation *op)
       return in_rect;
     }
 
+  gegl_affine_get_context_rect (affine, &matrix, &context_rect);
+
   in_rect.x      += context_rect.x;
   in_rect.y      += context_rect.y;
   in_rect.width  += context_rect.width;
@@ -534,17 +545,13 @@ gegl_affine_get_required_for_output (GeglOperation       *op,
   GeglRectangle  requested_rect,
                  need_rect;
   GeglRectangle  context_rect;
-  GeglSampler   *sampler;
   gdouble        need_points [8];
   gint           i;
 
   requested_rect = *region;
-  sampler = gegl_buffer_sampler_new (NULL, babl_format("RaGaBaA float"),
-      gegl_sampler_type_from_string (affine->filter));
-  context_rect = *gegl_sampler_get_context_rect (sampler);
-  g_object_unref (sampler);
 
   gegl_affine_create_composite_matrix (affine, &inverse);
+  gegl_affine_get_context_rect (affine, &inverse, &context_rect);
   gegl_matrix3_invert (&inverse);
 
   if (gegl_affine_is_intermediate_node (affine) ||
@@ -586,16 +593,10 @@ gegl_affine_get_invalidated_by_change (GeglOperation       *op,
   GeglMatrix3        matrix;
   GeglRectangle      affected_rect;
   GeglRectangle      context_rect;
-  GeglSampler       *sampler;
   gdouble            affected_points [8];
   gint               i;
   GeglRectangle      region = *input_region;
 
-  sampler = gegl_buffer_sampler_new (NULL, babl_format("RaGaBaA float"),
-      gegl_sampler_type_from_string (affine->filter));
-  context_rect = *gegl_sampler_get_context_rect (sampler);
-  g_object_unref (sampler);
-
   gegl_affine_create_matrix (affine, &matrix);
 
   if (affine->origin_x || affine->origin_y)
@@ -615,6 +616,8 @@ gegl_affine_get_invalidated_by_change (GeglOperation       *op,
       return region;
     }
 
+  gegl_affine_get_context_rect (affine, &matrix, &context_rect);
+
   region.x      += context_rect.x;
   region.y      += context_rect.y;
   region.width  += context_rect.width;
@@ -649,15 +652,13 @@ affine_generic (GeglBuffer  *dest,
 {
   GeglBufferIterator *i;
   const GeglRectangle *dest_extent;
-  gint                  x, y;
+  gint                  y;
   gfloat * restrict     dest_buf,
                        *dest_ptr;
   GeglMatrix3           inverse;
   GeglMatrix2           inverse_jacobian;
   gdouble               u_start,
-                        v_start,
-                        u_float,
-                        v_float;
+                        v_start;
 
   Babl                 *format;
 
@@ -696,24 +697,410 @@ affine_generic (GeglBuffer  *dest,
       if (inverse.coeff [0][0] < 0.)  u_start -= .001;
       if (inverse.coeff [1][1] < 0.)  v_start -= .001;
 
+      /* a row of the destination is a span of samples along the first
+       * column of the inverse
+       */
       for (dest_ptr = dest_buf, y = roi->height; y--;)
         {
-           u_float = u_start;
-           v_float = v_start;
-
-           for (x = roi->width; x--;)
-             {
-               gegl_sampler_get (sampler, u_float, v_float, &inverse_jacobian, dest_ptr);
-               dest_ptr+=4;
-               u_float += inverse.coeff [0][0];
-               v_float += inverse.coeff [1][0];
-             }
+           gegl_sampler_get_span (sampler, u_start, v_start,
+                                  inverse.coeff [0][0], inverse.coeff [1][0],
+                                  &inverse_jacobian, roi->width, dest_ptr);
+           dest_ptr += roi->width * 4;
            u_start += inverse.coeff [0][1];
            v_start += inverse.coeff [1][1];
         }
     }
 }
 
+/* The OpenCL kernels mirror the nearest, linear and cubic samplers, the
+ * source region of each chunk is fetched with gegl_buffer_get so the abyss
+ * is the same as the one the CPU samplers see. Coordinates are passed
+ * relative to the fetched region to keep float precision.
+ */
+
+#define AFFINE_KERNEL_SOURCE                                                       \
+"int trunc_index (float rel, int origin)                                       \n" \
+"{                                                                             \n" \
+"  /* (gint) cast of the absolute coordinate, as in the CPU samplers */       \n" \
+"  float f = floor (rel);                                                      \n" \
+"  int   i = (int) f;                                                          \n" \
+"  if (i + origin < 0 && rel != f)                                             \n" \
+"    i += 1;                                                                   \n" \
+"  return i;                                                                   \n" \
+"}                                                                             \n" \
+"                                                                              \n" \
+"float cubic_kernel (float x, float b, float c)                                \n" \
+"{                                                                             \n" \
+"  float ax = fabs (x);                                                        \n" \
+"  float x2 = ax * ax;                                                         \n" \
+"  float x3 = x2 * ax;                                                         \n" \
+"                                                                              \n" \
+"  if (ax > 2.0f)                                                              \n" \
+"    return 0.0f;                                                              \n" \
+"  if (ax < 1.0f)                                                              \n" \
+"    return ((12.0f - 9.0f * b - 6.0f * c) * x3 +                              \n" \
+"            (-18.0f + 12.0f * b + 6.0f * c) * x2 +                            \n" \
+"            (6.0f - 2.0f * b)) / 6.0f;                                        \n" \
+"  return ((-b - 6.0f * c) * x3 +                                              \n" \
+"          (6.0f * b + 30.0f * c) * x2 +                                       \n" \
+"          (-12.0f * b - 48.0f * c) * ax +                                     \n" \
+"          (8.0f * b + 24.0f * c)) / 6.0f;                                     \n" \
+"}                                                                             \n" \
+"                                                                              \n" \
+"__kernel void affine_nearest (SOURCE           src,                           \n" \
+"                              int2             src_size,                      \n" \
+"                              int2             origin,                        \n" \
+"                              __global float4 *out,                           \n" \
+"                              float2           start,                         \n" \
+"                              float4           inverse)                       \n" \
+"{                                                                             \n" \
+"  int   gx = get_global_id (0);                                               \n" \
+"  int   gy = get_global_id (1);                                               \n" \
+"  float u  = start.x + gx * inverse.s0 + gy * inverse.s1;                     \n" \
+"  float v  = start.y + gx * inverse.s2 + gy * inverse.s3;                     \n" \
+"                                                                              \n" \
+"  out[gy * get_global_size (0) + gx] =                                        \n" \
+"    fetch (src, src_size, trunc_index (u, origin.x),                          \n" \
+"                          trunc_index (v, origin.y));                         \n" \
+"}                                                                             \n" \
+"                                                                              \n" \
+"__kernel void affine_linear (SOURCE           src,                            \n" \
+"                             int2             src_size,                       \n" \
+"                             int2             origin,                         \n" \
+"                             __global float4 *out,                            \n" \
+"                             float2           start,                          \n" \
+"                             float4           inverse)                        \n" \
+"{                                                                             \n" \
+"  int   gx = get_global_id (0);                                               \n" \
+"  int   gy = get_global_id (1);                                               \n" \
+"  float u  = start.x + gx * inverse.s0 + gy * inverse.s1;                     \n" \
+"  float v  = start.y + gx * inverse.s2 + gy * inverse.s3;                     \n" \
+"  int   ix = (int) floor (u);                                                 \n" \
+"  int   iy = (int) floor (v);                                                 \n" \
+"  float x  = u - ix;                                                          \n" \
+"  float y  = v - iy;                                                          \n" \
+"                                                                              \n" \
+"  float4 top = mix (fetch (src, src_size, ix,     iy),                        \n" \
+"                    fetch (src, src_size, ix + 1, iy), x);                    \n" \
+"  float4 bot = mix (fetch (src, src_size, ix,     iy + 1),                    \n" \
+"                    fetch (src, src_size, ix + 1, iy + 1), x);                \n" \
+"                                                                              \n" \
+"  out[gy * get_global_size (0) + gx] = mix (top, bot, y);                     \n" \
+"}                                                                             \n" \
+"                                                                              \n" \
+"__kernel void affine_cubic (SOURCE           src,                             \n" \
+"                            int2             src_size,                        \n" \
+"                            int2             origin,                          \n" \
+"                            __global float4 *out,                             \n" \
+"                            float2           start,                           \n" \
+"                            float4           inverse,                         \n" \
+"                            float2           bc)                              \n" \
+"{                                                                             \n" \
+"  int    gx = get_global_id (0);                                              \n" \
+"  int    gy = get_global_id (1);                                              \n" \
+"  float  u  = start.x + gx * inverse.s0 + gy * inverse.s1;                    \n" \
+"  float  v  = start.y + gx * inverse.s2 + gy * inverse.s3;                    \n" \
+"  int    ix = trunc_index (u, origin.x);                                      \n" \
+"  int    iy = trunc_index (v, origin.y);                                      \n" \
+"  float4 sum = (float4)(0.0f);                                                \n" \
+"  int    i, j;                                                                \n" \
+"                                                                              \n" \
+"  for (j = -1; j <= 2; j++)                                                   \n" \
+"    {                                                                         \n" \
+"      float wy = cubic_kernel (v - (iy + j), bc.x, bc.y);                     \n" \
+"                                                                              \n" \
+"      for (i = -1; i <= 2; i++)                                               \n" \
+"        sum += wy * cubic_kernel (u - (ix + i), bc.x, bc.y) *                 \n" \
+"               fetch (src, src_size, ix + i, iy + j);                         \n" \
+"    }                                                                         \n" \
+"                                                                              \n" \
+"  out[gy * get_global_size (0) + gx] = sum;                                   \n" \
+"}                                                                             \n"
+
+static const char *kernel_source_image =
+"#define SOURCE __read_only image2d_t                                          \n"
+"                                                                              \n"
+"const sampler_t source_sampler = CLK_NORMALIZED_COORDS_FALSE |                \n"
+"                                 CLK_ADDRESS_CLAMP           |                \n"
+"                                 CLK_FILTER_NEAREST;                          \n"
+"                                                                              \n"
+"float4 fetch (SOURCE src, int2 size, int x, int y)                            \n"
+"{                                                                             \n"
+"  return read_imagef (src, source_sampler, (int2)(x, y));                     \n"
+"}                                                                             \n"
+"                                                                              \n"
+AFFINE_KERNEL_SOURCE;
+
+static const char *kernel_source_buffer =
+"#define SOURCE __global const float4 *                                        \n"
+"                                                                              \n"
+"float4 fetch (SOURCE src, int2 size, int x, int y)                            \n"
+"{                                                                             \n"
+"  if (x < 0 || y < 0 || x >= size.x || y >= size.y)                           \n"
+"    return (float4)(0.0f);                                                    \n"
+"  return src[y * size.x + x];                                                 \n"
+"}                                                                             \n"
+"                                                                              \n"
+AFFINE_KERNEL_SOURCE;
+
+static gegl_cl_run_data *cl_data_image  = NULL;
+static gegl_cl_run_data *cl_data_buffer = NULL;
+
+/* the part of the source the chunk @roi samples from, and the sampling
+ * position of its first pixel
+ */
+static void
+cl_affine_source_rect (GeglMatrix3         *inverse,
+                       const GeglRectangle *roi,
+                       GeglSampler         *sampler,
+                       gdouble             *u_start,
+                       gdouble             *v_start,
+                       GeglRectangle       *src_rect)
+{
+  const GeglRectangle *context_rect = gegl_sampler_get_context_rect (sampler);
+  gdouble              points[8];
+  gint                 k;
+
+  *u_start = inverse->coeff[0][0] * roi->x + inverse->coeff[0][1] * roi->y + inverse->coeff[0][2];
+  *v_start = inverse->coeff[1][0] * roi->x + inverse->coeff[1][1] * roi->y + inverse->coeff[1][2];
+
+  /* same rounding correction as affine_generic */
+  if (inverse->coeff [0][0] < 0.)  *u_start -= .001;
+  if (inverse->coeff [1][1] < 0.)  *v_start -= .001;
+
+  /* sampling positions of the corner pixels of the chunk */
+  for (k = 0; k < 4; k++)
+    {
+      gint dx = (k & 1) ? roi->width  - 1 : 0;
+      gint dy = (k & 2) ? roi->height - 1 : 0;
+
+      points[k * 2]     = *u_start + dx * inverse->coeff[0][0] + dy * inverse->coeff[0][1];
+      points[k * 2 + 1] = *v_start + dx * inverse->coeff[1][0] + dy * inverse->coeff[1][1];
+    }
+  gegl_affine_bounding_box (points, 4, src_rect);
+
+  /* one extra pixel on each side for the (gint) rounding of negative
+   * coordinates
+   */
+  src_rect->x      += context_rect->x - 1;
+  src_rect->y      += context_rect->y - 1;
+  src_rect->width  += context_rect->width  + 2;
+  src_rect->height += context_rect->height + 2;
+}
+
+static gboolean
+cl_affine_use_image (const GeglRectangle *src_rect)
+{
+  return cl_state.image_support &&
+         src_rect->width  <= cl_state.max_image_width &&
+         src_rect->height <= cl_state.max_image_height;
+}
+
+/* whether the source of a chunk of @roi's size fits on the device, either
+ * as an image or as a buffer
+ */
+static gboolean
+cl_affine_source_fits (GeglMatrix3         *inverse,
+                       const GeglRectangle *roi,
+                       GeglSampler         *sampler)
+{
+  GeglRectangle src_rect;
+  gdouble       u_start, v_start;
+
+  cl_affine_source_rect (inverse, roi, sampler, &u_start, &v_start, &src_rect);
+
+  /* the rounding of the bounding box depends on where the chunk is */
+  src_rect.width  += 1;
+  src_rect.height += 1;
+
+  return cl_affine_use_image (&src_rect) ||
+         (cl_ulong) src_rect.width * src_rect.height * 4 * sizeof (gfloat) <= cl_state.max_mem_alloc;
+}
+
+static cl_int
+cl_affine (GeglBuffer          *src,
+           cl_mem               out_tex,
+           const GeglRectangle *roi,
+           GeglMatrix3         *inverse,
+           GeglSamplerType      sampler_type,
+           GeglSampler         *sampler)
+{
+  const Babl       *format = babl_format ("RaGaBaA float");
+  gegl_cl_run_data *cl_data;
+  cl_kernel         kernel;
+  cl_int            cl_err = 0;
+  cl_mem            src_tex;
+  GeglRectangle     src_rect;
+  gfloat           *src_buf;
+  gdouble           u_start, v_start;
+  cl_int2           src_size, origin;
+  cl_float2         start;
+  cl_float4         coeff;
+  size_t            global_ws[2];
+  gboolean          use_image;
+
+  cl_affine_source_rect (inverse, roi, sampler, &u_start, &v_start, &src_rect);
+
+  use_image = cl_affine_use_image (&src_rect);
+
+  /* cl_process checked that the chunks fit */
+  if (!use_image &&
+      (cl_ulong) src_rect.width * src_rect.height * 4 * sizeof (gfloat) > cl_state.max_mem_alloc)
+    return CL_INVALID_BUFFER_SIZE;
+
+  if (use_image)
+    {
+      if (!cl_data_image)
+        {
+          const char *kernel_name[] = {"affine_nearest", "affine_linear", "affine_cubic", NULL};
+          cl_data_image = gegl_cl_compile_and_build (kernel_source_image, kernel_name);
+        }
+      cl_data = cl_data_image;
+    }
+  else
+    {
+      if (!cl_data_buffer)
+        {
+          const char *kernel_name[] = {"affine_nearest", "affine_linear", "affine_cubic", NULL};
+          cl_data_buffer = gegl_cl_compile_and_build (kernel_source_buffer, kernel_name);
+        }
+      cl_data = cl_data_buffer;
+    }
+
+  if (!cl_data) return 1;
+
+  src_buf = g_new (gfloat, src_rect.width * src_rect.height * 4);
+  gegl_buffer_get (src, 1.0, &src_rect, format, src_buf, GEGL_AUTO_ROWSTRIDE);
+
+  if (use_image)
+    {
+      cl_image_format image_format = {CL_RGBA, CL_FLOAT};
+
+      src_tex = gegl_clCreateImage2D (gegl_cl_get_context (),
+                                      CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                      &image_format,
+                                      src_rect.width, src_rect.height, 0,
+                                      src_buf, &cl_err);
+    }
+  else
+    {
+      src_tex = gegl_clCreateBuffer (gegl_cl_get_context (),
+                                     CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                                     src_rect.width * src_rect.height * 4 * sizeof (gfloat),
+                                     src_buf, &cl_err);
+    }
+
+  g_free (src_buf);
+  if (cl_err != CL_SUCCESS) return cl_err;
+
+  src_size.s[0] = src_rect.width;
+  src_size.s[1] = src_rect.height;
+  origin.s[0]   = src_rect.x;
+  origin.s[1]   = src_rect.y;
+  start.s[0]    = u_start - src_rect.x;
+  start.s[1]    = v_start - src_rect.y;
+  coeff.s[0]    = inverse->coeff[0][0];
+  coeff.s[1]    = inverse->coeff[0][1];
+  coeff.s[2]    = inverse->coeff[1][0];
+  coeff.s[3]    = inverse->coeff[1][1];
+
+  switch (sampler_type)
+    {
+      case GEGL_SAMPLER_LINEAR: kernel = cl_data->kernel[1]; break;
+      case GEGL_SAMPLER_CUBIC:  kernel = cl_data->kernel[2]; break;
+      default:                  kernel = cl_data->kernel[0]; break;
+    }
+
+  cl_err |= gegl_clSetKernelArg(kernel, 0, sizeof(cl_mem),    (void*)&src_tex);
+  cl_err |= gegl_clSetKernelArg(kernel, 1, sizeof(cl_int2),   (void*)&src_size);
+  cl_err |= gegl_clSetKernelArg(kernel, 2, sizeof(cl_int2),   (void*)&origin);
+  cl_err |= gegl_clSetKernelArg(kernel, 3, sizeof(cl_mem),    (void*)&out_tex);
+  cl_err |= gegl_clSetKernelArg(kernel, 4, sizeof(cl_float2), (void*)&start);
+  cl_err |= gegl_clSetKernelArg(kernel, 5, sizeof(cl_float4), (void*)&coeff);
+
+  if (sampler_type == GEGL_SAMPLER_CUBIC)
+    {
+      gdouble   b, c;
+      cl_float2 bc;
+
+      g_object_get (sampler, "b", &b, "c", &c, NULL);
+      bc.s[0] = b;
+      bc.s[1] = c;
+      cl_err |= gegl_clSetKernelArg(kernel, 6, sizeof(cl_float2), (void*)&bc);
+    }
+
+  if (cl_err != CL_SUCCESS)
+    {
+      gegl_clReleaseMemObject (src_tex);
+      return cl_err;
+    }
+
+  global_ws[0] = roi->width;
+  global_ws[1] = roi->height;
+
+  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
+                                        kernel, 2,
+                                        NULL, global_ws, NULL,
+                                        0, NULL, NULL);
+
+  /* the kernel keeps its own reference until it has run */
+  gegl_clReleaseMemObject (src_tex);
+
+  return cl_err;
+}
+
+static gboolean
+cl_process (GeglBuffer          *dest,
+            GeglBuffer          *src,
+            const GeglRectangle *result,
+            GeglMatrix3         *matrix,
+            GeglSamplerType      sampler_type,
+            GeglSampler         *sampler)
+{
+  const Babl *format = babl_format ("RaGaBaA float");
+  GeglMatrix3 inverse;
+  GeglRectangle chunk;
+  gint err;
+  gint j;
+  cl_int cl_err;
+
+  GeglBufferClIterator *i;
+
+  gegl_matrix3_copy_into (&inverse, matrix);
+  gegl_matrix3_invert (&inverse);
+
+  /* the iterator hands out chunks of at most the maximum image size, the
+   * source of the largest one has to fit on the device
+   */
+  chunk.x      = result->x;
+  chunk.y      = result->y;
+  chunk.width  = MIN (result->width,  cl_state.max_image_width);
+  chunk.height = MIN (result->height, cl_state.max_image_height);
+
+  if (!cl_affine_source_fits (&inverse, &chunk, sampler))
+    return FALSE;
+
+  i = gegl_buffer_cl_iterator_new (dest, result, format, GEGL_CL_BUFFER_WRITE);
+
+  while (gegl_buffer_cl_iterator_next (i, &err))
+    {
+      for (j=0; j < i->n; j++)
+        {
+          cl_err = cl_affine (src, i->tex[0][j], &i->roi[0][j],
+                              &inverse, sampler_type, sampler);
+          if (cl_err != CL_SUCCESS)
+            {
+              g_warning("[OpenCL] Error in affine: %s\n", gegl_cl_errstring(cl_err));
+              gegl_buffer_cl_iterator_stop (i);
+              return FALSE;
+            }
+        }
+    }
+
+  /* the iterator is already freed when it failed */
+  return !err;
+}
+
 static gboolean
 gegl_affine_matrix3_allow_fast_translate (GeglMatrix3 *matrix)
 {
@@ -723,109 +1110,552 @@ gegl_affine_matrix3_allow_fast_translate (GeglMatrix3 *matrix)
   return gegl_matrix3_is_translate (matrix);
 }
 
+/* Matrices that only swap and mirror the axes and translate by whole
+ * pixels: the reflections, the rotations by multiples of 90 degrees and
+ * the transpositions. They move every pixel onto another one, the output
+ * is a copy of the input pixels in another order.
+ */
 static gboolean
-gegl_affine_matrix3_allow_fast_reflect_x (GeglMatrix3 *matrix)
+gegl_affine_matrix3_allow_fast_orthogonal (GeglMatrix3 *matrix)
 {
-  GeglMatrix3 copy;
+  gint i, j;
 
-  if (! GEGL_FLOAT_EQUAL (matrix->coeff[1][1], -1.0))
+  if (! GEGL_FLOAT_IS_ZERO (matrix->coeff[2][0]) ||
+      ! GEGL_FLOAT_IS_ZERO (matrix->coeff[2][1]) ||
+      ! GEGL_FLOAT_EQUAL (matrix->coeff[2][2], 1.0))
     return FALSE;
-  gegl_matrix3_copy_into (&copy, matrix);
-  copy.coeff[1][1] = 1.;
-  return gegl_affine_matrix3_allow_fast_translate (&copy);
+
+  for (i = 0; i < 2; i++)
+    {
+      if (! GEGL_FLOAT_EQUAL (matrix->coeff[i][2],
+                              floor (matrix->coeff[i][2] + 0.5)))
+        return FALSE;
+
+      for (j = 0; j < 2; j++)
+        if (! GEGL_FLOAT_IS_ZERO (matrix->coeff[i][j]) &&
+            ! GEGL_FLOAT_EQUAL (fabs (matrix->coeff[i][j]), 1.0))
+          return FALSE;
+    }
+
+  /* one axis of the input for every axis of the output */
+  return (GEGL_FLOAT_IS_ZERO (matrix->coeff[0][1]) &&
+          GEGL_FLOAT_IS_ZERO (matrix->coeff[1][0]) &&
+          ! GEGL_FLOAT_IS_ZERO (matrix->coeff[0][0]) &&
+          ! GEGL_FLOAT_IS_ZERO (matrix->coeff[1][1])) ||
+         (GEGL_FLOAT_IS_ZERO (matrix->coeff[0][0]) &&
+          GEGL_FLOAT_IS_ZERO (matrix->coeff[1][1]) &&
+          ! GEGL_FLOAT_IS_ZERO (matrix->coeff[0][1]) &&
+          ! GEGL_FLOAT_IS_ZERO (matrix->coeff[1][0]));
 }
 
-static gboolean
-gegl_affine_matrix3_allow_fast_reflect_y (GeglMatrix3 *matrix)
+/* Output pixel x,y is input pixel (inverse.coeff[0][0] * x +
+ * inverse.coeff[0][1] * y + inverse.coeff[0][2], ...), as the samplers
+ * would read it at that position. The output is written a tile at a time
+ * through an iterator, the input pixels of a tile are read with a single
+ * gegl_buffer_get in the format of the input and copied without converting
+ * or interpolating them.
+ */
+static void
+gegl_affine_fast_orthogonal (GeglBuffer  *dest,
+                             GeglBuffer  *src,
+                             GeglMatrix3 *matrix)
+{
+  const Babl         *format   = gegl_buffer_get_format (src);
+  const gint          px_size  = babl_format_get_bytes_per_pixel (format);
+  GeglBufferIterator *iter;
+  GeglMatrix3         inverse;
+  gint                m[2][3];
+  guchar             *buf      = NULL;
+  gint                buf_size = 0;
+  gint                i, j;
+
+  gegl_matrix3_copy_into (&inverse, matrix);
+  gegl_matrix3_invert (&inverse);
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 3; j++)
+      m[i][j] = floor (inverse.coeff[i][j] + 0.5);
+
+  iter = gegl_buffer_iterator_new (dest, gegl_buffer_get_extent (dest),
+                                   format, GEGL_BUFFER_WRITE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi = &iter->roi[0];
+      guchar              *dest_ptr = iter->data[0];
+      GeglRectangle        src_rect;
+      gint                 x0, y0, x1, y1;
+      gint                 step_x, step_y;
+      const guchar        *src_row;
+      gint                 x, y;
+
+      /* the input pixels of two opposite corners of the tile */
+      x0 = m[0][0] * roi->x + m[0][1] * roi->y + m[0][2];
+      y0 = m[1][0] * roi->x + m[1][1] * roi->y + m[1][2];
+      x1 = m[0][0] * (roi->x + roi->width - 1) +
+           m[0][1] * (roi->y + roi->height - 1) + m[0][2];
+      y1 = m[1][0] * (roi->x + roi->width - 1) +
+           m[1][1] * (roi->y + roi->height - 1) + m[1][2];
+
+      src_rect.x      = MIN (x0, x1);
+      src_rect.y      = MIN (y0, y1);
+      src_rect.width  = ABS (x1 - x0) + 1;
+      src_rect.height = ABS (y1 - y0) + 1;
+
+      if (src_rect.width * src_rect.height * px_size > buf_size)
+        {
+          buf_size = src_rect.width * src_rect.height * px_size;
+          g_free (buf);
+          buf = g_malloc (buf_size);
+        }
+
+      gegl_buffer_get (src, 1.0, &src_rect, format, buf, GEGL_AUTO_ROWSTRIDE);
+
+      /* how far apart in buf the input pixels of neighbouring output
+       * pixels are
+       */
+      step_x  = (m[0][0] + m[1][0] * src_rect.width) * px_size;
+      step_y  = (m[0][1] + m[1][1] * src_rect.width) * px_size;
+      src_row = buf + ((y0 - src_rect.y) * src_rect.width +
+                       (x0 - src_rect.x)) * px_size;
+
+      for (y = 0; y < roi->height; y++, src_row += step_y)
+        {
+          const guchar *src_ptr = src_row;
+
+          for (x = 0; x < roi->width; x++, src_ptr += step_x)
+            {
+              memcpy (dest_ptr, src_ptr, px_size);
+              dest_ptr += px_size;
+            }
+        }
+    }
+
+  g_free (buf);
+}
+
+/* The separable scaling path, for matrices that only scale and translate.
+ * Every output pixel is a weighted sum of the source pixels around its
+ * center, with weights that depend on its column and its row only, so
+ * they are computed once for every column and row of the output and the
+ * image is filtered in two passes, along the rows and then along the
+ * columns. When downscaling, the filter is stretched by the inverse of the
+ * scale to cover all the source pixels of an output pixel, which
+ * antialiases like an area filter instead of point sampling the source.
+ * Reductions by two or more filter the level of the mipmap pyramid of the
+ * source the samplers would read, whose pixels average blocks of the
+ * source, so that the filters are never stretched by two or more.
+ */
+
+typedef enum
+{
+  SCALE_FILTER_LINEAR,
+  SCALE_FILTER_CUBIC,
+  SCALE_FILTER_LANCZOS
+} ScaleFilterType;
+
+struct _ScaleFilter
 {
-  GeglMatrix3 copy;
+  ScaleFilterType type;
+  gdouble         support;  /* radius of the filter at scale 1 */
+  gdouble         b, c;     /* parameters of the cubic filters */
+  gdouble         scale_x;  /* the scale of the matrix */
+  gdouble         scale_y;
+  gint            level;    /* level of the pyramid of the input read */
+};
 
-  if (! GEGL_FLOAT_EQUAL (matrix->coeff[0][0], -1.0))
+/* reductions by two or more read the level of the pyramid of the input
+ * the samplers would, which the filters reduce less than twice more
+ */
+static gint
+scale_filter_level (const ScaleFilter *filter)
+{
+  gdouble      footprint = 1.0 / MAX (filter->scale_x, filter->scale_y);
+  GeglMatrix2  scale     = { { { footprint, 0.0 }, { 0.0, footprint } } };
+  GeglSampler *sampler;
+  gint         level;
+
+  sampler = gegl_buffer_sampler_new (NULL, babl_format("RaGaBaA float"),
+                                     GEGL_SAMPLER_LINEAR);
+  level = gegl_sampler_get_level (sampler, &scale);
+  g_object_unref (sampler);
+
+  return level;
+}
+
+static gboolean
+gegl_affine_allow_fast_scale (OpAffine    *affine,
+                              GeglMatrix3 *matrix,
+                              ScaleFilter *filter)
+{
+  if (! GEGL_FLOAT_IS_ZERO (matrix->coeff[0][1]) ||
+      ! GEGL_FLOAT_IS_ZERO (matrix->coeff[1][0]) ||
+      matrix->coeff[0][0] <= GEGL_FLOAT_EPSILON ||
+      matrix->coeff[1][1] <= GEGL_FLOAT_EPSILON ||
+      ! GEGL_FLOAT_IS_ZERO (matrix->coeff[2][0]) ||
+      ! GEGL_FLOAT_IS_ZERO (matrix->coeff[2][1]) ||
+      ! GEGL_FLOAT_EQUAL (matrix->coeff[2][2], 1.0))
     return FALSE;
-  gegl_matrix3_copy_into (&copy, matrix);
-  copy.coeff[0][0] = 1.;
-  return gegl_affine_matrix3_allow_fast_translate (&copy);
+
+  filter->scale_x = matrix->coeff[0][0];
+  filter->scale_y = matrix->coeff[1][1];
+
+  if (! strcmp (affine->filter, "linear"))
+    {
+      filter->type    = SCALE_FILTER_LINEAR;
+      filter->support = 1.0;
+    }
+  else if (! strcmp (affine->filter, "cubic"))
+    {
+      /* the B-spline of the cubic sampler */
+      filter->type    = SCALE_FILTER_CUBIC;
+      filter->support = 2.0;
+      filter->b       = 1.0;
+      filter->c       = 0.0;
+    }
+  else if (! strcmp (affine->filter, "lanczos"))
+    {
+      filter->type    = SCALE_FILTER_LANCZOS;
+      filter->support = affine->lanczos_width;
+    }
+  else if (! strcmp (affine->filter, "lohalo") &&
+           filter->scale_x <= 1.0 && filter->scale_y <= 1.0)
+    {
+      /* lohalo downsamples with the Robidoux cubic, it enlarges with
+       * interpolators no separable filter reproduces
+       */
+      filter->type    = SCALE_FILTER_CUBIC;
+      filter->support = 2.0;
+      filter->b       = 0.37821575509399867;
+      filter->c       = 0.31089212245300067;
+    }
+  else
+    {
+      return FALSE;
+    }
+
+  filter->level = scale_filter_level (filter);
+
+  return TRUE;
 }
 
+/* the source pixels, around a source pixel, that contribute to the output
+ * pixels it maps to
+ */
 static void
-gegl_affine_fast_reflect_x (GeglBuffer              *dest,
-                            GeglBuffer              *src,
-                            const GeglRectangle     *dest_rect,
-                            const GeglRectangle     *src_rect)
+gegl_affine_scale_context_rect (const ScaleFilter *filter,
+                                GeglRectangle     *context_rect)
 {
-  const Babl              *format = gegl_buffer_get_format (src);
-  const gint               px_size = babl_format_get_bytes_per_pixel (format),
-                           rowstride = src_rect->width * px_size;
-  gint                     i;
-  guchar                  *buf = (guchar *) g_malloc (src_rect->height * rowstride);
+  gint factor   = 1 << filter->level;
+  gint radius_x = ceil (filter->support / MIN (filter->scale_x, 1.0));
+  gint radius_y = ceil (filter->support / MIN (filter->scale_y, 1.0));
+
+  /* and the blocks the pixels of the level average */
+  if (factor > 1)
+    {
+      radius_x += factor;
+      radius_y += factor;
+    }
+
+  context_rect->x      = -radius_x;
+  context_rect->y      = -radius_y;
+  context_rect->width  = radius_x * 2 + 1;
+  context_rect->height = radius_y * 2 + 1;
+}
 
-  gegl_buffer_get (src, 1.0, src_rect, format, buf, GEGL_AUTO_ROWSTRIDE);
+/* the input pixels around an input pixel that the output pixels it maps to
+ * depend on
+ */
+static void
+gegl_affine_get_context_rect (OpAffine      *affine,
+                              GeglMatrix3   *matrix,
+                              GeglRectangle *context_rect)
+{
+  ScaleFilter  filter;
+  GeglSampler *sampler;
+  GeglMatrix3  inverse;
+  GeglMatrix2  inverse_jacobian;
+  gint         factor;
 
-  for (i = 0; i < src_rect->height / 2; i++)
+  if (gegl_affine_allow_fast_scale (affine, matrix, &filter))
     {
-      gint      dest_offset = (src_rect->height - i - 1) * rowstride,
-                src_offset = i * rowstride,
-                j;
+      gegl_affine_scale_context_rect (&filter, context_rect);
+      return;
+    }
+
+  gegl_matrix3_copy_into (&inverse, matrix);
+  gegl_matrix3_invert (&inverse);
+  inverse_jacobian.coeff[0][0] = inverse.coeff[0][0];
+  inverse_jacobian.coeff[0][1] = inverse.coeff[0][1];
+  inverse_jacobian.coeff[1][0] = inverse.coeff[1][0];
+  inverse_jacobian.coeff[1][1] = inverse.coeff[1][1];
 
-      for (j = 0; j < rowstride; j++)
+  sampler = gegl_buffer_sampler_new (NULL, babl_format("RaGaBaA float"),
+      gegl_sampler_type_from_string (affine->filter));
+  *context_rect = *gegl_sampler_get_context_rect (sampler);
+  factor = 1 << gegl_sampler_get_level (sampler, &inverse_jacobian);
+  g_object_unref (sampler);
+
+  /* a sampler reading a level of the pyramid reaches factor times further,
+   * and every pixel it reads averages a block of factor×factor pixels
+   */
+  if (factor > 1)
+    {
+      context_rect->x      = (context_rect->x - 1) * factor;
+      context_rect->y      = (context_rect->y - 1) * factor;
+      context_rect->width  = (context_rect->width + 2) * factor;
+      context_rect->height = (context_rect->height + 2) * factor;
+    }
+}
+
+static inline gdouble
+scale_filter_sinc (gdouble x)
+{
+  if (fabs (x) < 1e-6)
+    return 1.0;
+
+  return sin (G_PI * x) / (G_PI * x);
+}
+
+static gdouble
+scale_filter_weight (const ScaleFilter *filter,
+                     gdouble            x)
+{
+  gdouble ax = fabs (x);
+
+  if (ax >= filter->support)
+    return 0.0;
+
+  switch (filter->type)
+    {
+      case SCALE_FILTER_LINEAR:
+        return 1.0 - ax;
+
+      case SCALE_FILTER_CUBIC:
         {
-          const guchar      tmp = buf[src_offset];
+          gdouble b = filter->b, c = filter->c;
+
+          if (ax < 1.0)
+            return ((12 - 9 * b - 6 * c) * ax * ax * ax +
+                    (-18 + 12 * b + 6 * c) * ax * ax +
+                    (6 - 2 * b)) / 6.0;
+          else
+            return ((-b - 6 * c) * ax * ax * ax +
+                    (6 * b + 30 * c) * ax * ax +
+                    (-12 * b - 48 * c) * ax +
+                    (8 * b + 24 * c)) / 6.0;
+        }
+
+      case SCALE_FILTER_LANCZOS:
+        return scale_filter_sinc (x) * scale_filter_sinc (x / filter->support);
+    }
+
+  return 0.0;
+}
 
-          buf[src_offset] = buf[dest_offset];
-          buf[dest_offset] = tmp;
+/* the source pixels and weights of n output pixels along one axis */
+typedef struct
+{
+  gint   *start;     /* first source pixel of every output pixel */
+  gint   *n_taps;    /* number of source pixels of every output pixel */
+  gfloat *weights;   /* max_taps weights for every output pixel */
+  gint    max_taps;
+} ScaleTable;
+
+/* output pixel first + i is at inverse_scale * (first + i) + inverse_offset
+ * in the source
+ */
+static void
+scale_table_init (ScaleTable        *table,
+                  const ScaleFilter *filter,
+                  gdouble            scale,
+                  gdouble            inverse_scale,
+                  gdouble            inverse_offset,
+                  gint               first,
+                  gint               n)
+{
+  gdouble stretch = MIN (scale, 1.0);
+  gdouble radius  = filter->support / stretch;
+  gint    i;
+
+  table->max_taps = floor (radius * 2) + 2;
+  table->start    = g_new (gint, n);
+  table->n_taps   = g_new (gint, n);
+  table->weights  = g_new0 (gfloat, n * table->max_taps);
 
-          dest_offset++;
-          src_offset++;
+  for (i = 0; i < n; i++)
+    {
+      gdouble center  = inverse_scale * (first + i) + inverse_offset;
+      gint    start   = ceil (center - radius);
+      gint    end     = floor (center + radius);
+      gfloat *weights = table->weights + i * table->max_taps;
+      gdouble sum     = 0.0;
+      gint    j;
+
+      /* taps on the edge of the support have no weight */
+      if (scale_filter_weight (filter, (start - center) * stretch) == 0.0)
+        start++;
+      if (end >= start &&
+          scale_filter_weight (filter, (end - center) * stretch) == 0.0)
+        end--;
+      if (end < start)
+        end = start = floor (center + 0.5);
+
+      table->start[i]  = start;
+      table->n_taps[i] = MIN (end - start + 1, table->max_taps);
+
+      for (j = 0; j < table->n_taps[i]; j++)
+        {
+          weights[j] = scale_filter_weight (filter,
+                                            (start + j - center) * stretch);
+          sum += weights[j];
         }
+
+      if (sum != 0.0)
+        for (j = 0; j < table->n_taps[i]; j++)
+          weights[j] /= sum;
+      else
+        weights[0] = 1.0;
     }
+}
 
-  gegl_buffer_set (dest, dest_rect, format, buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (buf);
+static void
+scale_table_free (ScaleTable *table)
+{
+  g_free (table->start);
+  g_free (table->n_taps);
+  g_free (table->weights);
 }
 
 static void
-gegl_affine_fast_reflect_y (GeglBuffer              *dest,
-                            GeglBuffer              *src,
-                            const GeglRectangle     *dest_rect,
-                            const GeglRectangle     *src_rect)
+gegl_affine_fast_scale (GeglBuffer        *dest,
+                        GeglBuffer        *src,
+                        GeglMatrix3       *matrix,
+                        const ScaleFilter *filter)
 {
-  const Babl              *format = gegl_buffer_get_format (src);
-  const gint               px_size = babl_format_get_bytes_per_pixel (format),
-                           rowstride = src_rect->width * px_size;
-  gint                     i;
-  guchar                  *buf = (guchar *) g_malloc (src_rect->height * rowstride);
+  const Babl          *format = babl_format ("RaGaBaA float");
+  const GeglRectangle *roi    = gegl_buffer_get_extent (dest);
+  const gint           factor = 1 << filter->level;
+  GeglMatrix3          inverse;
+  ScaleTable           columns, rows;
+  GeglRectangle        strip_rect;
+  gint                 src_x, src_width;
+  gint                 src_y, src_end;
+  gint                 strip_height;
+  gint                 first_row;
+  gfloat              *strip, *filtered, *out;
+
+  if (roi->width <= 0 || roi->height <= 0)
+    return;
 
-  gegl_buffer_get (src, 1.0, src_rect, format, buf, GEGL_AUTO_ROWSTRIDE);
+  /* the matrix from the level read, pixel x of the level is at
+   * x * factor + (factor - 1) / 2 in the input
+   */
+  gegl_matrix3_copy_into (&inverse, matrix);
+  inverse.coeff[0][2] += inverse.coeff[0][0] * (factor - 1) / 2.0;
+  inverse.coeff[1][2] += inverse.coeff[1][1] * (factor - 1) / 2.0;
+  inverse.coeff[0][0] *= factor;
+  inverse.coeff[1][1] *= factor;
+  gegl_matrix3_invert (&inverse);
 
-  for (i = 0; i < src_rect->height; i++)
+  scale_table_init (&columns, filter, filter->scale_x * factor,
+                    inverse.coeff[0][0], inverse.coeff[0][2],
+                    roi->x, roi->width);
+  scale_table_init (&rows, filter, filter->scale_y * factor,
+                    inverse.coeff[1][1], inverse.coeff[1][2],
+                    roi->y, roi->height);
+
+  /* the centers increase with the output pixels, so do the taps */
+  src_x     = columns.start[0];
+  src_width = columns.start[roi->width - 1] +
+              columns.n_taps[roi->width - 1] - src_x;
+  src_y     = rows.start[0];
+  src_end   = rows.start[roi->height - 1] + rows.n_taps[roi->height - 1];
+
+  /* the source is read in strips of rows, filtered along the rows, and
+   * added to the output rows whose filter cover them
+   */
+  g_object_get (src, "tile-height", &strip_height, NULL);
+  strip    = g_new (gfloat, src_width * strip_height * 4);
+  filtered = g_new (gfloat, roi->width * strip_height * 4);
+  out      = g_new0 (gfloat, roi->width * roi->height * 4);
+
+  first_row = 0;
+  for (strip_rect.y = src_y; strip_rect.y < src_end;
+       strip_rect.y += strip_rect.height)
     {
-      gint      src_offset = i * rowstride,
-                dest_offset = src_offset + rowstride,
-                j;
+      gint strip_end;
+      gint row, y;
 
-      for (j = 0; j < src_rect->width / 2; j++)
-        {
-          gint k;
+      strip_rect.x      = src_x;
+      strip_rect.width  = src_width;
+      strip_rect.height = MIN (strip_height, src_end - strip_rect.y);
+      strip_end         = strip_rect.y + strip_rect.height;
+
+      gegl_buffer_get (src, 1.0 / factor, &strip_rect, format, strip,
+                       GEGL_AUTO_ROWSTRIDE);
 
-          dest_offset -= px_size;
+      _OMP (omp parallel for schedule(static))
+      for (row = 0; row < strip_rect.height; row++)
+        {
+          const gfloat *src_row = strip + row * src_width * 4;
+          gfloat       *dst     = filtered + row * roi->width * 4;
+          gint          x;
 
-          for (k = 0; k < px_size; k++)
+          for (x = 0; x < roi->width; x++, dst += 4)
             {
-              const guchar      tmp = buf[src_offset];
+              const gfloat *weights = columns.weights + x * columns.max_taps;
+              const gfloat *pixel   = src_row +
+                                      (columns.start[x] - src_x) * 4;
+              gfloat        sum[4]  = { 0.0, 0.0, 0.0, 0.0 };
+              gint          i, c;
+
+              for (i = 0; i < columns.n_taps[x]; i++, pixel += 4)
+                for (c = 0; c < 4; c++)
+                  sum[c] += weights[i] * pixel[c];
+
+              for (c = 0; c < 4; c++)
+                dst[c] = sum[c];
+            }
+        }
 
-              buf[src_offset] = buf[dest_offset];
-              buf[dest_offset] = tmp;
+      /* output rows are done once the strips went past their taps */
+      while (first_row < roi->height &&
+             rows.start[first_row] + rows.n_taps[first_row] <= strip_rect.y)
+        first_row++;
 
-              dest_offset++;
-              src_offset++;
-            }
+      /* every output row is added to by a single thread, its taps in
+       * order, the result does not depend on the number of threads
+       */
+      _OMP (omp parallel for schedule(dynamic))
+      for (y = first_row; y < roi->height; y++)
+        {
+          gint    from = MAX (rows.start[y], strip_rect.y);
+          gint    to   = MIN (rows.start[y] + rows.n_taps[y], strip_end);
+          gfloat *dst  = out + y * roi->width * 4;
+          gint    r;
 
-          dest_offset -= px_size;
+          for (r = from; r < to; r++)
+            {
+              const gfloat  weight  = rows.weights[y * rows.max_taps +
+                                                   r - rows.start[y]];
+              const gfloat *src_row = filtered +
+                                      (r - strip_rect.y) * roi->width * 4;
+              gint          i;
+
+              for (i = 0; i < roi->width * 4; i++)
+                dst[i] += weight * src_row[i];
+            }
         }
     }
 
-  gegl_buffer_set (dest, dest_rect, format, buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (buf);
+  gegl_buffer_set (dest, roi, format, out, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (strip);
+  g_free (filtered);
+  g_free (out);
+  scale_table_free (&columns);
+  scale_table_free (&rows);
 }
 
 static gboolean
@@ -837,6 +1667,7 @@ gegl_affine_process (GeglOperation        *operation,
   GeglBuffer          *input;
   GeglBuffer          *output;
   GeglMatrix3          matrix;
+  ScaleFilter          scale_filter;
   OpAffine            *affine = (OpAffine *) operation;
 
   gegl_affine_create_composite_matrix (affine, &matrix);
@@ -870,20 +1701,13 @@ gegl_affine_process (GeglOperation        *operation,
                                                     of source) */
                          NULL);
 
-      if (gegl_object_get_has_forked (input))
-        gegl_object_set_has_forked (output);
-
       gegl_operation_context_take_object (context, "output", G_OBJECT (output));
 
       if (input != NULL)
         g_object_unref (input);
     }
-  else if (gegl_affine_matrix3_allow_fast_reflect_x (&matrix))
+  else if (gegl_affine_matrix3_allow_fast_orthogonal (&matrix))
     {
-      GeglRectangle      src_rect;
-      GeglSampler       *sampler;
-      GeglRectangle      context_rect;
-
       input  = gegl_operation_context_get_source (context, "input");
       if (!input)
         {
@@ -893,28 +1717,12 @@ gegl_affine_process (GeglOperation        *operation,
 
       output = gegl_operation_context_get_target (context, "output");
 
-      src_rect = gegl_operation_get_required_for_output (operation, "output", result);
-      src_rect.y += 1;
+      gegl_affine_fast_orthogonal (output, input, &matrix);
 
-      sampler = gegl_buffer_sampler_new (input, babl_format("RaGaBaA float"),
-          gegl_sampler_type_from_string (affine->filter));
-      context_rect = *gegl_sampler_get_context_rect (sampler);
-
-      src_rect.width -= context_rect.width;
-      src_rect.height -= context_rect.height;
-
-      gegl_affine_fast_reflect_x (output, input, result, &src_rect);
-      g_object_unref (sampler);
-
-      if (input != NULL)
-        g_object_unref (input);
+      g_object_unref (input);
     }
-  else if (gegl_affine_matrix3_allow_fast_reflect_y (&matrix))
+  else if (gegl_affine_allow_fast_scale (affine, &matrix, &scale_filter))
     {
-      GeglRectangle      src_rect;
-      GeglSampler       *sampler;
-      GeglRectangle      context_rect;
-
       input  = gegl_operation_context_get_source (context, "input");
       if (!input)
         {
@@ -924,33 +1732,28 @@ gegl_affine_process (GeglOperation        *operation,
 
       output = gegl_operation_context_get_target (context, "output");
 
-      src_rect = gegl_operation_get_required_for_output (operation, "output", result);
-      src_rect.x += 1;
+      gegl_affine_fast_scale (output, input, &matrix, &scale_filter);
 
-      sampler = gegl_buffer_sampler_new (input, babl_format("RaGaBaA float"),
-          gegl_sampler_type_from_string (affine->filter));
-      context_rect = *gegl_sampler_get_context_rect (sampler);
-
-      src_rect.width -= context_rect.width;
-      src_rect.height -= context_rect.height;
-
-      gegl_affine_fast_reflect_y (output, input, result, &src_rect);
-      g_object_unref (sampler);
-
-      if (input != NULL)
-        g_object_unref (input);
+      g_object_unref (input);
     }
   else
     {
       /* for all other cases, do a proper resampling */
-      GeglSampler *sampler;
+      GeglSampler    *sampler;
+      GeglSamplerType sampler_type = gegl_sampler_type_from_string (affine->filter);
 
       input  = gegl_operation_context_get_source (context, "input");
       output = gegl_operation_context_get_target (context, "output");
 
       sampler = gegl_buffer_sampler_new (input, babl_format("RaGaBaA float"),
-          gegl_sampler_type_from_string (affine->filter));
-      affine_generic (output, input, &matrix, sampler);
+          sampler_type);
+
+      if (! (cl_state.is_accelerated &&
+             (sampler_type == GEGL_SAMPLER_NEAREST ||
+              sampler_type == GEGL_SAMPLER_LINEAR  ||
+              sampler_type == GEGL_SAMPLER_CUBIC) &&
+             cl_process (output, input, result, &matrix, sampler_type, sampler)))
+        affine_generic (output, input, &matrix, sampler);
       g_object_unref (sampler);
 
       if (input != NULL)
@@ -38,12 +38,20 @@ gegl_chant_double (edge_preservation, _("Edge preservation"), 0.0, 70.0, 8.0,
 #include <math.h>
 
 static void
-bilateral_filter (GeglBuffer          *src,
+bilateral_filter (GeglOperation       *operation,
+                  const gfloat        *src_buf,
                   const GeglRectangle *src_rect,
-                  GeglBuffer          *dst,
+                  gfloat              *dst_buf,
                   const GeglRectangle *dst_rect,
-                  gdouble              radius,
-                  gdouble              preserve);
+                  gpointer             user_data);
+
+static void
+bilateral_filter_fast (GeglBuffer          *src,
+                       const GeglRectangle *src_rect,
+                       GeglBuffer          *dst,
+                       const GeglRectangle *dst_rect,
+                       gdouble              radius,
+                       gdouble              preserve);
 
 #include <stdio.h>
 
@@ -107,6 +115,67 @@ static const char* kernel_source =
 "        }                                                             \n"
 "    }                                                                 \n"
 "    out[gidx + gidy * dst_width] = accumulated / count;               \n"
+"}                                                                     \n"
+
+/* variant staging the neighbourhood in __local memory */
+GEGL_CL_TILE_SOURCE
+"kernel void bilateral_filter_tiled(global float4 *in,                 \n"
+"                                   global float4 *out,                \n"
+"                                   const  float radius,               \n"
+"                                   const  float preserve,             \n"
+"                                   const  int   dst_width,            \n"
+"                                   const  int   dst_height,           \n"
+"                                   local  float4 *tile)               \n"
+"{                                                                     \n"
+"    int gidx        = get_global_id(0);                               \n"
+"    int gidy        = get_global_id(1);                               \n"
+"    int n_radius    = ceil(radius);                                   \n"
+"    int src_width   = dst_width  + n_radius * 2;                      \n"
+"    int src_height  = dst_height + n_radius * 2;                      \n"
+"    int tile_width  = get_local_size(0) + n_radius * 2;               \n"
+"    int tile_height = get_local_size(1) + n_radius * 2;               \n"
+"    int lx          = get_local_id(0) + n_radius;                     \n"
+"    int ly          = get_local_id(1) + n_radius;                     \n"
+"                                                                      \n"
+"    int u, v;                                                         \n"
+"    float4 center_pix;                                                \n"
+"    float4 accumulated = 0.0f;                                        \n"
+"    float4 tempf       = 0.0f;                                        \n"
+"    float  count       = 0.0f;                                        \n"
+"    float  diff_map, gaussian_weight, weight;                         \n"
+"                                                                      \n"
+"    gegl_cl_tile_load (in, src_width, src_height,                     \n"
+"                       tile, tile_width, tile_height,                 \n"
+"                       get_group_id(0) * get_local_size(0),           \n"
+"                       get_group_id(1) * get_local_size(1));          \n"
+"                                                                      \n"
+"    if (gidx >= dst_width || gidy >= dst_height)                      \n"
+"        return;                                                       \n"
+"                                                                      \n"
+"    center_pix = tile[ly * tile_width + lx];                          \n"
+"                                                                      \n"
+"    for (v = -n_radius;v <= n_radius; ++v)                            \n"
+"    {                                                                 \n"
+"        for (u = -n_radius;u <= n_radius; ++u)                        \n"
+"        {                                                             \n"
+"            tempf = tile[(ly + v) * tile_width + lx + u];             \n"
+"                                                                      \n"
+"            diff_map = exp (                                          \n"
+"                - (   POW2(center_pix.x - tempf.x)                    \n"
+"                    + POW2(center_pix.y - tempf.y)                    \n"
+"                    + POW2(center_pix.z - tempf.z))                   \n"
+"                * preserve);                                          \n"
+"                                                                      \n"
+"            gaussian_weight =                                         \n"
+"                exp( - 0.5f * (POW2(u) + POW2(v)) / radius);          \n"
+"                                                                      \n"
+"            weight = diff_map * gaussian_weight;                      \n"
+"                                                                      \n"
+"            accumulated += tempf * weight;                            \n"
+"            count += weight;                                          \n"
+"        }                                                             \n"
+"    }                                                                 \n"
+"    out[gidx + gidy * dst_width] = accumulated / count;               \n"
 "}                                                                     \n";
 
 static gegl_cl_run_data *cl_data = NULL;
@@ -121,10 +190,11 @@ cl_bilateral_filter (cl_mem                in_tex,
 {
   cl_int cl_err = 0;
   size_t global_ws[2];
+  gint   n_radius;
 
   if (!cl_data)
   {
-    const char *kernel_name[] = {"bilateral_filter", NULL};
+    const char *kernel_name[] = {"bilateral_filter", "bilateral_filter_tiled", NULL};
     cl_data = gegl_cl_compile_and_build (kernel_source, kernel_name);
   }
 
@@ -133,16 +203,29 @@ cl_bilateral_filter (cl_mem                in_tex,
   global_ws[0] = roi->width;
   global_ws[1] = roi->height;
 
+  n_radius = ceil (radius);
+
+  if (gegl_cl_tune_local_fits (cl_data->kernel[1], 2 * n_radius, 2 * n_radius))
+    {
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 0, sizeof(cl_mem),   (void*)&in_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 1, sizeof(cl_mem),   (void*)&out_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 2, sizeof(cl_float), (void*)&radius);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 3, sizeof(cl_float), (void*)&preserve);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 4, sizeof(cl_int),   (void*)&roi->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 5, sizeof(cl_int),   (void*)&roi->height);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      return gegl_cl_tune_enqueue_local (cl_data->kernel[1], global_ws,
+                                         2 * n_radius, 2 * n_radius, 6);
+    }
+
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 0, sizeof(cl_mem),   (void*)&in_tex);
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 1, sizeof(cl_mem),   (void*)&out_tex);
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 2, sizeof(cl_float), (void*)&radius);
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 3, sizeof(cl_float), (void*)&preserve);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                       cl_data->kernel[0], 2,
-                                       NULL, global_ws, NULL,
-                                       0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[0], global_ws);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   return cl_err;
@@ -167,7 +250,6 @@ cl_process (GeglOperation       *operation,
                 gint read = gegl_buffer_cl_iterator_add_2 (i, input, result, in_format, GEGL_CL_BUFFER_READ, op_area->left, op_area->right, op_area->top, op_area->bottom);
   while (gegl_buffer_cl_iterator_next (i, &err))
   {
-    if (err) return FALSE;
     for (j=0; j < i->n; j++)
     {
       cl_err = cl_bilateral_filter(i->tex[read][j], i->tex[0][j], i->size[0][j], &i->roi[0][j], ceil(o->blur_radius), o->edge_preservation);
@@ -175,11 +257,14 @@ cl_process (GeglOperation       *operation,
       {
         g_warning("[OpenCL] Error in gegl:bilateral-filter\n",
           GEGL_OPERATION_CLASS (operation)->name);
+        gegl_buffer_cl_iterator_stop (i);
         return FALSE;
       }
     }
   }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 static gboolean
@@ -189,49 +274,84 @@ process (GeglOperation       *operation,
          const GeglRectangle *result)
 {
   GeglChantO   *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglRectangle compute;
 
   if (o->blur_radius >= 1.0 && cl_state.is_accelerated)
     if (cl_process (operation, input, output, result))
       return TRUE;
 
+  if (o->blur_radius < 1.0)
+    {
+      output = g_object_ref (input);
+    }
+  else
+    {
+      return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                        0, bilateral_filter, NULL);
+    }
+
+  return  TRUE;
+}
+
+/* destination rows handled per grid, bounds the memory used */
+#define GRID_STRIP     128
+/* the smallest spatial cell of the grid, in pixels */
+#define GRID_MIN_CELL  2.0
+/* the most luminance cells of a grid, HDR input with a range of many
+ * sigma_r gets coarser cells instead of an unbounded grid
+ */
+#define GRID_MAX_DEPTH 64
+
+static gboolean
+process_fast (GeglOperation       *operation,
+              GeglBuffer          *input,
+              GeglBuffer          *output,
+              const GeglRectangle *result)
+{
+  GeglChantO   *o = GEGL_CHANT_PROPERTIES (operation);
+  GeglRectangle compute;
+
   compute = gegl_operation_get_required_for_output (operation, "input",result);
 
   if (o->blur_radius < 1.0)
     {
-      output = g_object_ref (input);
+      gegl_buffer_copy (input, result, output, result);
+    }
+  else if (sqrt (o->blur_radius) < GRID_MIN_CELL)
+    {
+      /* the grid would be about as large as the image, the exact filter
+       * is cheap at these radii
+       */
+      return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                        0, bilateral_filter, NULL);
     }
   else
     {
-      bilateral_filter (input, &compute, output, result, o->blur_radius, o->edge_preservation);
+      bilateral_filter_fast (input, &compute, output, result, o->blur_radius, o->edge_preservation);
     }
 
   return  TRUE;
 }
 
 static void
-bilateral_filter (GeglBuffer          *src,
+bilateral_filter (GeglOperation       *operation,
+                  const gfloat        *src_buf,
                   const GeglRectangle *src_rect,
-                  GeglBuffer          *dst,
+                  gfloat              *dst_buf,
                   const GeglRectangle *dst_rect,
-                  gdouble              radius,
-                  gdouble              preserve)
+                  gpointer             user_data)
 {
+  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
+  gdouble radius = o->blur_radius;
+  gdouble preserve = o->edge_preservation;
   gfloat *gauss;
   gint x,y;
   gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
   gint width = (gint) radius * 2 + 1;
   gint iradius = radius;
   gint src_width = src_rect->width;
   gint src_height = src_rect->height;
 
   gauss = g_newa (gfloat, width * width);
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
 
   offset = 0;
 
@@ -246,7 +366,7 @@ bilateral_filter (GeglBuffer          *src,
     for (x=0; x<dst_rect->width; x++)
       {
         gint u,v;
-        gfloat *center_pix = src_buf + ((x+iradius)+((y+iradius) * src_width)) * 4;
+        const gfloat *center_pix = src_buf + ((x+iradius)+((y+iradius) * src_width)) * 4;
         gfloat  accumulated[4]={0,0,0,0};
         gfloat  count=0.0;
 
@@ -261,7 +381,7 @@ bilateral_filter (GeglBuffer          *src,
                 {
                   gint c;
 
-                  gfloat *src_pix = src_buf + (i + j * src_width) * 4;
+                  const gfloat *src_pix = src_buf + (i + j * src_width) * 4;
 
                   gfloat diff_map   = exp (- (POW2(center_pix[0] - src_pix[0])+
                                               POW2(center_pix[1] - src_pix[1])+
@@ -286,10 +406,212 @@ bilateral_filter (GeglBuffer          *src,
           dst_buf[offset*4+u] = accumulated[u]/count;
         offset++;
       }
-  gegl_buffer_set (dst, dst_rect, babl_format ("RGBA float"), dst_buf,
-                   GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
+}
+
+
+/* Approximation of the filter above with a bilateral grid (Paris and
+ * Durand): the pixels are splatted into a coarse 3D grid over x, y and
+ * luminance, the grid is blurred and sliced back with trilinear
+ * interpolation.  The cost per pixel does not depend on the radius.  The
+ * color difference of the exact filter is replaced by the luminance
+ * difference, scaled so both agree on grey pixels.
+ */
+
+typedef struct
+{
+  gfloat *cells;  /* premultiplied by the weight: r, g, b, a, weight */
+  gint    width;
+  gint    height;
+  gint    depth;
+} BilateralGrid;
+
+#define GRID_CELL(grid, x, y, z) \
+  ((grid)->cells + ((((z) * (grid)->height + (y)) * (grid)->width + (x)) * 5))
+
+static inline gfloat
+grid_luminance (const gfloat *pix)
+{
+  return 0.2126 * pix[0] + 0.7152 * pix[1] + 0.0722 * pix[2];
+}
+
+/* [1 4 6 4 1] / 16 has a variance of one cell */
+static void
+grid_blur (BilateralGrid *grid,
+           gint           stride,
+           gint           length,
+           gint           lines,
+           gint           line_stride)
+{
+  gfloat *tmp = g_new (gfloat, length * 5);
+  gint    line;
+
+  for (line = 0; line < lines; line++)
+    {
+      gfloat *base = grid->cells + line * line_stride * 5;
+      gint    i, c;
+
+      for (i = 0; i < length; i++)
+        for (c = 0; c < 5; c++)
+          {
+            gfloat sum = 6.0 * base[i * stride * 5 + c];
+
+            if (i > 0)          sum += 4.0 * base[(i - 1) * stride * 5 + c];
+            if (i > 1)          sum +=       base[(i - 2) * stride * 5 + c];
+            if (i < length - 1) sum += 4.0 * base[(i + 1) * stride * 5 + c];
+            if (i < length - 2) sum +=       base[(i + 2) * stride * 5 + c];
+
+            tmp[i * 5 + c] = sum / 16.0;
+          }
+
+      for (i = 0; i < length; i++)
+        for (c = 0; c < 5; c++)
+          base[i * stride * 5 + c] = tmp[i * 5 + c];
+    }
+
+  g_free (tmp);
+}
+
+static void
+bilateral_filter_fast (GeglBuffer          *src,
+                       const GeglRectangle *src_rect,
+                       GeglBuffer          *dst,
+                       const GeglRectangle *dst_rect,
+                       gdouble              radius,
+                       gdouble              preserve)
+{
+  gint    iradius  = radius;
+  /* the spatial weight is exp (-0.5 * d^2 / radius) */
+  gfloat  sigma_s  = MAX (sqrt (radius), GRID_MIN_CELL);
+  /* the range weight is exp (-preserve * (dr^2 + dg^2 + db^2)), that is
+   * exp (-3 * preserve * dy^2) on grey pixels
+   */
+  gfloat  sigma_r  = preserve > 0.0 ? 1.0 / sqrt (6.0 * preserve) : G_MAXFLOAT;
+  gint    strip_y;
+
+  for (strip_y = 0; strip_y < dst_rect->height; strip_y += GRID_STRIP)
+    {
+      GeglRectangle  strip_dst, strip_src;
+      BilateralGrid  grid;
+      gfloat        *src_buf, *dst_buf;
+      gfloat         lum_min = G_MAXFLOAT, lum_max = -G_MAXFLOAT;
+      gfloat         lum_scale;
+      gint           n_pixels, x, y, i;
+
+      strip_dst.x      = dst_rect->x;
+      strip_dst.y      = dst_rect->y + strip_y;
+      strip_dst.width  = dst_rect->width;
+      strip_dst.height = MIN (GRID_STRIP, dst_rect->height - strip_y);
+
+      strip_src.x      = src_rect->x;
+      strip_src.y      = strip_dst.y - iradius;
+      strip_src.width  = src_rect->width;
+      strip_src.height = strip_dst.height + 2 * iradius;
+
+      n_pixels = strip_src.width * strip_src.height;
+      src_buf  = g_new (gfloat, n_pixels * 4);
+      dst_buf  = g_new (gfloat, strip_dst.width * strip_dst.height * 4);
+
+      gegl_buffer_get (src, 1.0, &strip_src, babl_format ("RGBA float"),
+                       src_buf, GEGL_AUTO_ROWSTRIDE);
+
+      for (i = 0; i < n_pixels; i++)
+        {
+          gfloat lum = grid_luminance (src_buf + i * 4);
+
+          lum_min = MIN (lum_min, lum);
+          lum_max = MAX (lum_max, lum);
+        }
+
+      lum_scale = (sigma_r < G_MAXFLOAT && lum_max > lum_min) ? 1.0 / sigma_r : 0.0;
+      if ((lum_max - lum_min) * lum_scale > GRID_MAX_DEPTH)
+        lum_scale = GRID_MAX_DEPTH / (lum_max - lum_min);
+
+      /* two cells of margin on each side for the blur */
+      grid.width  = ceil (strip_src.width  / sigma_s) + 5;
+      grid.height = ceil (strip_src.height / sigma_s) + 5;
+      grid.depth  = ceil ((lum_max - lum_min) * lum_scale) + 5;
+      grid.cells  = g_new0 (gfloat, grid.width * grid.height * grid.depth * 5);
+
+      /* splat */
+      for (y = 0; y < strip_src.height; y++)
+        for (x = 0; x < strip_src.width; x++)
+          {
+            gfloat *pix = src_buf + (y * strip_src.width + x) * 4;
+            gfloat  gx  = x / sigma_s + 2.0;
+            gfloat  gy  = y / sigma_s + 2.0;
+            gfloat  gz  = (grid_luminance (pix) - lum_min) * lum_scale + 2.0;
+            gint    ix  = gx, iy = gy, iz = gz;
+            gfloat  fx  = gx - ix, fy = gy - iy, fz = gz - iz;
+            gint    corner;
+
+            for (corner = 0; corner < 8; corner++)
+              {
+                gint    dx = corner & 1, dy = (corner >> 1) & 1, dz = corner >> 2;
+                gfloat  w  = (dx ? fx : 1.0 - fx) *
+                             (dy ? fy : 1.0 - fy) *
+                             (dz ? fz : 1.0 - fz);
+                gfloat *cell = GRID_CELL (&grid, ix + dx, iy + dy, iz + dz);
+
+                cell[0] += pix[0] * w;
+                cell[1] += pix[1] * w;
+                cell[2] += pix[2] * w;
+                cell[3] += pix[3] * w;
+                cell[4] += w;
+              }
+          }
+
+      /* blur along x, y and z */
+      grid_blur (&grid, 1, grid.width, grid.height * grid.depth, grid.width);
+      for (i = 0; i < grid.depth; i++)
+        {
+          BilateralGrid plane = grid;
+
+          plane.cells = GRID_CELL (&grid, 0, 0, i);
+          grid_blur (&plane, grid.width, grid.height, grid.width, 1);
+        }
+      if (lum_scale > 0.0)
+        grid_blur (&grid, grid.width * grid.height, grid.depth,
+                   grid.width * grid.height, 1);
+
+      /* slice */
+      for (y = 0; y < strip_dst.height; y++)
+        for (x = 0; x < strip_dst.width; x++)
+          {
+            gint    sx  = x + strip_dst.x - strip_src.x;
+            gint    sy  = y + iradius;
+            gfloat *pix = src_buf + (sy * strip_src.width + sx) * 4;
+            gfloat *out = dst_buf + (y * strip_dst.width + x) * 4;
+            gfloat  gx  = sx / sigma_s + 2.0;
+            gfloat  gy  = sy / sigma_s + 2.0;
+            gfloat  gz  = (grid_luminance (pix) - lum_min) * lum_scale + 2.0;
+            gint    ix  = gx, iy = gy, iz = gz;
+            gfloat  fx  = gx - ix, fy = gy - iy, fz = gz - iz;
+            gfloat  acc[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+            gint    corner, c;
+
+            for (corner = 0; corner < 8; corner++)
+              {
+                gint    dx = corner & 1, dy = (corner >> 1) & 1, dz = corner >> 2;
+                gfloat  w  = (dx ? fx : 1.0 - fx) *
+                             (dy ? fy : 1.0 - fy) *
+                             (dz ? fz : 1.0 - fz);
+                gfloat *cell = GRID_CELL (&grid, ix + dx, iy + dy, iz + dz);
+
+                for (c = 0; c < 5; c++)
+                  acc[c] += cell[c] * w;
+              }
+
+            for (c = 0; c < 4; c++)
+              out[c] = acc[4] > 0.0 ? acc[c] / acc[4] : pix[c];
+          }
+
+      gegl_buffer_set (dst, &strip_dst, babl_format ("RGBA float"), dst_buf,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      g_free (grid.cells);
+      g_free (src_buf);
+      g_free (dst_buf);
+    }
 }
 
 
@@ -305,6 +627,9 @@ gegl_chant_class_init (GeglChantClass *klass)
   filter_class->process   = process;
   operation_class->prepare = prepare;
 
+  gegl_operation_class_add_processor (operation_class,
+                                      G_CALLBACK (process_fast), "fast");
+
   operation_class->name        = "gegl:bilateral-filter";
   operation_class->opencl_support = TRUE;
   operation_class->categories  = "misc";
@@ -33,176 +33,45 @@ gegl_chant_double (radius, _("Radius"), 0.0, 200.0, 4.0,
 #include <stdio.h>
 #include <math.h>
 
-#ifdef USE_DEAD_CODE
-static inline float
-get_mean_component (gfloat *buf,
-                    gint    buf_width,
-                    gint    buf_height,
-                    gint    x0,
-                    gint    y0,
-                    gint    width,
-                    gint    height,
-                    gint    component)
-{
-  gint    x, y;
-  gdouble acc=0;
-  gint    count=0;
-
-  gint offset = (y0 * buf_width + x0) * 4 + component;
-
-  for (y=y0; y<y0+height; y++)
-    {
-    for (x=x0; x<x0+width; x++)
-      {
-        if (x>=0 && x<buf_width &&
-            y>=0 && y<buf_height)
-          {
-            acc += buf [offset];
-            count++;
-          }
-        offset+=4;
-      }
-      offset+= (buf_width * 4) - 4 * width;
-    }
-   if (count)
-     return acc/count;
-   return 0.0;
-}
-#endif
-
-static inline void
-get_mean_components (gfloat *buf,
-                     gint    buf_width,
-                     gint    buf_height,
-                     gint    x0,
-                     gint    y0,
-                     gint    width,
-                     gint    height,
-                     gfloat *components)
-{
-  gint    y;
-  gdouble acc[4]={0,0,0,0};
-  gint    count[4]={0,0,0,0};
-
-  gint offset = (y0 * buf_width + x0) * 4;
-
-  for (y=y0; y<y0+height; y++)
-    {
-    gint x;
-    for (x=x0; x<x0+width; x++)
-      {
-        if (x>=0 && x<buf_width &&
-            y>=0 && y<buf_height)
-          {
-            gint c;
-            for (c=0;c<4;c++)
-              {
-                acc[c] += buf [offset+c];
-                count[c]++;
-              }
-          }
-        offset+=4;
-      }
-      offset+= (buf_width * 4) - 4 * width;
-    }
-    {
-      gint c;
-      for (c=0;c<4;c++)
-        {
-         if (count[c])
-           components[c] = acc[c]/count[c];
-         else
-           components[c] = 0.0;
-        }
-    }
-}
+#include "summed-area.h"
 
-/* expects src and dst buf to have the same extent */
+/* dst_rect is src_rect shrunk by the radius on every side, each output
+ * pixel is the mean of the (1 + 2 * radius)^2 box starting at the same
+ * offset in src_rect
+ */
 static void
-hor_blur (GeglBuffer          *src,
+box_blur (GeglBuffer          *src,
           const GeglRectangle *src_rect,
           GeglBuffer          *dst,
           const GeglRectangle *dst_rect,
           gint                 radius)
 {
+  SummedArea *area;
   gint u,v;
   gint offset;
-  gfloat *src_buf;
   gfloat *dst_buf;
 
-  /* src == dst for hor blur */
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RaGaBaA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
+  area    = summed_area_new (src, src_rect, babl_format ("RaGaBaA float"), FALSE);
+  dst_buf = g_new (gfloat, dst_rect->width * dst_rect->height * 4);
 
   offset = 0;
   for (v=0; v<dst_rect->height; v++)
     for (u=0; u<dst_rect->width; u++)
       {
-        gint i;
-        gfloat components[4];
-
-        get_mean_components (src_buf,
-                             src_rect->width,
-                             src_rect->height,
-                             u - radius,
-                             v,
-                             1 + radius*2,
-                             1,
-                             components);
-
-        for (i=0; i<4; i++)
-          dst_buf [offset++] = components[i];
-      }
-
-  gegl_buffer_set (dst, dst_rect, babl_format ("RaGaBaA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
-}
-
-
-/* expects dst buf to be radius smaller than src buf */
-static void
-ver_blur (GeglBuffer          *src,
-          const GeglRectangle *src_rect,
-          GeglBuffer          *dst,
-          const GeglRectangle *dst_rect,
-          gint                 radius)
-{
-  gint u,v;
-  gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
+        gdouble sum[4];
+        gint    count;
+        gint    c;
 
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RaGaBaA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
-  offset=0;
-  for (v=0; v<dst_rect->height; v++)
-    for (u=0; u<dst_rect->width; u++)
-      {
-        gfloat components[4];
-        gint c;
-
-        get_mean_components (src_buf,
-                             src_rect->width,
-                             src_rect->height,
-                             u + radius,  /* 1x radius is the offset between the bufs */
-                             v - radius + radius, /* 1x radius is the offset between the bufs */
-                             1,
-                             1 + radius * 2,
-                             components);
+        count = summed_area_get (area, u, v, 1 + radius * 2, 1 + radius * 2,
+                                 sum, NULL);
 
         for (c=0; c<4; c++)
-          dst_buf [offset++] = components[c];
+          dst_buf [offset++] = count ? sum[c] / count : 0.0;
       }
 
   gegl_buffer_set (dst, dst_rect, babl_format ("RaGaBaA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
   g_free (dst_buf);
+  summed_area_free (area);
 }
 
 static void prepare (GeglOperation *operation)
@@ -265,6 +134,61 @@ static const char* kernel_source =
 "   }                                                                                               \n"
 "                                                                                                   \n"
 "  out[out_index] = mean / (2 * radius + 1);                                                        \n"
+"}                                                                                                  \n"
+
+/* variants staging the neighbourhood in __local memory, dimension 0 is x */
+GEGL_CL_TILE_SOURCE
+"__kernel void kernel_blur_hor_tiled (__global const float4     *in,                                \n"
+"                                     __global       float4     *aux,                               \n"
+"                                     int width, int height, int radius,                            \n"
+"                                     __local        float4     *tile)                              \n"
+"{                                                                                                  \n"
+"  const int x          = get_global_id (0);                                                        \n"
+"  const int y          = get_global_id (1);                                                        \n"
+"  const int tile_width = get_local_size (0) + 2 * radius;                                          \n"
+"  const int tile_index = get_local_id (1) * tile_width + get_local_id (0);                         \n"
+"  int i;                                                                                           \n"
+"  float4 mean;                                                                                     \n"
+"                                                                                                   \n"
+"  gegl_cl_tile_load (in, width + 2 * radius, height, tile, tile_width, get_local_size (1),          \n"
+"                     get_group_id (0) * get_local_size (0), get_group_id (1) * get_local_size (1));\n"
+"                                                                                                   \n"
+"  if (x >= width || y >= height)                                                                   \n"
+"    return;                                                                                        \n"
+"                                                                                                   \n"
+"  mean = (float4)(0.0f);                                                                           \n"
+"                                                                                                   \n"
+"  for (i = 0; i <= 2 * radius; i++)                                                                \n"
+"    mean += tile[tile_index + i];                                                                  \n"
+"                                                                                                   \n"
+"  aux[y * width + x] = mean / (2 * radius + 1);                                                    \n"
+"}                                                                                                  \n"
+
+"__kernel void kernel_blur_ver_tiled (__global const float4     *aux,                               \n"
+"                                     __global       float4     *out,                               \n"
+"                                     int width, int height, int radius,                            \n"
+"                                     __local        float4     *tile)                              \n"
+"{                                                                                                  \n"
+"  const int x          = get_global_id (0);                                                        \n"
+"  const int y          = get_global_id (1);                                                        \n"
+"  const int tile_width = get_local_size (0);                                                       \n"
+"  const int tile_index = get_local_id (1) * tile_width + get_local_id (0);                         \n"
+"  int i;                                                                                           \n"
+"  float4 mean;                                                                                     \n"
+"                                                                                                   \n"
+"  gegl_cl_tile_load (aux, width, height + 2 * radius, tile, tile_width,                            \n"
+"                     get_local_size (1) + 2 * radius,                                              \n"
+"                     get_group_id (0) * get_local_size (0), get_group_id (1) * get_local_size (1));\n"
+"                                                                                                   \n"
+"  if (x >= width || y >= height)                                                                   \n"
+"    return;                                                                                        \n"
+"                                                                                                   \n"
+"  mean = (float4)(0.0f);                                                                           \n"
+"                                                                                                   \n"
+"  for (i = 0; i <= 2 * radius; i++)                                                                \n"
+"    mean += tile[tile_index + i * tile_width];                                                     \n"
+"                                                                                                   \n"
+"  out[y * width + x] = mean / (2 * radius + 1);                                                    \n"
 "}                                                                                                  \n";
 
 static gegl_cl_run_data *cl_data = NULL;
@@ -279,15 +203,52 @@ cl_box_blur (cl_mem                in_tex,
 {
   cl_int cl_err = 0;
   size_t global_ws_hor[2], global_ws_ver[2];
+  gboolean tiled;
 
   if (!cl_data)
     {
-      const char *kernel_name[] = {"kernel_blur_hor", "kernel_blur_ver", NULL};
+      const char *kernel_name[] = {"kernel_blur_hor", "kernel_blur_ver",
+                                   "kernel_blur_hor_tiled", "kernel_blur_ver_tiled", NULL};
       cl_data = gegl_cl_compile_and_build (kernel_source, kernel_name);
     }
 
   if (!cl_data) return 1;
 
+  tiled = gegl_cl_tune_local_fits (cl_data->kernel[2], 2 * radius, 0) &&
+          gegl_cl_tune_local_fits (cl_data->kernel[3], 0, 2 * radius);
+
+  if (tiled)
+    {
+      gint aux_height = roi->height + 2 * radius;
+
+      global_ws_hor[0] = roi->width;
+      global_ws_hor[1] = aux_height;
+
+      global_ws_ver[0] = roi->width;
+      global_ws_ver[1] = roi->height;
+
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 0, sizeof(cl_mem),   (void*)&in_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 1, sizeof(cl_mem),   (void*)&aux_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 2, sizeof(cl_int),   (void*)&roi->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 3, sizeof(cl_int),   (void*)&aux_height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 4, sizeof(cl_int),   (void*)&radius);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      cl_err = gegl_cl_tune_enqueue_local (cl_data->kernel[2], global_ws_hor, 2 * radius, 0, 5);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      gegl_clEnqueueBarrier (gegl_cl_get_command_queue ());
+
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 0, sizeof(cl_mem),   (void*)&aux_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 1, sizeof(cl_mem),   (void*)&out_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 2, sizeof(cl_int),   (void*)&roi->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 3, sizeof(cl_int),   (void*)&roi->height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 4, sizeof(cl_int),   (void*)&radius);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      return gegl_cl_tune_enqueue_local (cl_data->kernel[3], global_ws_ver, 0, 2 * radius, 5);
+    }
+
   global_ws_hor[0] = roi->height + 2 * radius;
   global_ws_hor[1] = roi->width;
 
@@ -300,10 +261,7 @@ cl_box_blur (cl_mem                in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 3, sizeof(cl_int),   (void*)&radius);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                        cl_data->kernel[0], 2,
-                                        NULL, global_ws_hor, NULL,
-                                        0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[0], global_ws_hor);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   gegl_clEnqueueBarrier (gegl_cl_get_command_queue ());
@@ -314,10 +272,7 @@ cl_box_blur (cl_mem                in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 3, sizeof(cl_int),   (void*)&radius);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                        cl_data->kernel[1], 2,
-                                        NULL, global_ws_ver, NULL,
-                                        0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[1], global_ws_ver);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   return cl_err;
@@ -343,18 +298,20 @@ cl_process (GeglOperation       *operation,
                 gint aux  = gegl_buffer_cl_iterator_add_2 (i, NULL, result, in_format,  GEGL_CL_BUFFER_AUX, 0, 0, op_area->top, op_area->bottom);
   while (gegl_buffer_cl_iterator_next (i, &err))
     {
-      if (err) return FALSE;
       for (j=0; j < i->n; j++)
         {
           cl_err = cl_box_blur(i->tex[read][j], i->tex[aux][j], i->tex[0][j], i->size[0][j], &i->roi[0][j], ceil (o->radius));
           if (cl_err != CL_SUCCESS)
             {
               g_warning("[OpenCL] Error in box-blur: %s\n", gegl_cl_errstring(cl_err));
+              gegl_buffer_cl_iterator_stop (i);
               return FALSE;
             }
         }
     }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 static gboolean
@@ -365,7 +322,6 @@ process (GeglOperation       *operation,
 {
   GeglRectangle rect;
   GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglBuffer *temp;
   GeglOperationAreaFilter *op_area;
   op_area = GEGL_OPERATION_AREA_FILTER (operation);
 
@@ -380,13 +336,8 @@ process (GeglOperation       *operation,
   rect.width+=op_area->left + op_area->right;
   rect.height+=op_area->top + op_area->bottom;
 
-  temp  = gegl_buffer_new (&rect,
-                           babl_format ("RaGaBaA float"));
-
-  hor_blur (input, &rect, temp, &rect, o->radius);
-  ver_blur (temp, &rect, output, result, o->radius);
+  box_blur (input, &rect, output, result, o->radius);
 
-  g_object_unref (temp);
   return  TRUE;
 }
 
@@ -44,42 +44,44 @@ gegl_chant_double (rgamma, _("Radial Gamma"), 0.0, 8.0, 2.0,
 #include <math.h>
 #include <stdlib.h>
 #include "envelopes.h"
+#include "parallel-reduce.h"
 
 #define RGAMMA 2.0
 
-static void c2g (GeglBuffer          *src,
+static void c2g (GeglOperation       *operation,
+                 const gfloat        *src_buf,
                  const GeglRectangle *src_rect,
-                 GeglBuffer          *dst,
+                 gfloat              *dst_buf,
                  const GeglRectangle *dst_rect,
-                 gint                 radius,
-                 gint                 samples,
-                 gint                 iterations,
-                 gdouble              rgamma)
+                 gpointer             user_data)
 {
+  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
+  gint    radius = o->radius;
+  gint    samples = o->samples;
+  gint    iterations = o->iterations;
+  gdouble rgamma = RGAMMA /*o->rgamma*/;
   gint x,y;
-  gint    dst_offset=0;
-  gfloat *src_buf;
-  gfloat *dst_buf;
   gint    inw = src_rect->width;
-  gint    outw = dst_rect->width;
   gint    inh = src_rect->height;
+  gint   outw = dst_rect->width;
 
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 2);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
+  /* the spray of a pixel only depends on its position, rows can be
+   * computed in parallel
+   */
+  _OMP (omp parallel for private(x) schedule(static))
   for (y=radius; y<dst_rect->height+radius; y++)
     {
       gint src_offset = (inw*y+radius)*4;
+      gint dst_offset = (outw*(y-radius))*2;
       for (x=radius; x<outw+radius; x++)
         {
-          gfloat *pixel= src_buf + src_offset;
+          const gfloat *pixel= src_buf + src_offset;
           gfloat  min[4];
           gfloat  max[4];
 
           compute_envelopes (src_buf,
                              inw, inh,
+                             src_rect->x, src_rect->y,
                              x, y,
                              radius, samples,
                              iterations,
@@ -122,9 +124,6 @@ static void c2g (GeglBuffer          *src,
           }
         }
     }
-  gegl_buffer_set (dst, dst_rect, babl_format ("YA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
 }
 
 static void prepare (GeglOperation *operation)
@@ -416,7 +415,6 @@ cl_process (GeglOperation       *operation,
                                                            op_area->left, op_area->right, op_area->top, op_area->bottom);
   while (gegl_buffer_cl_iterator_next (i, &err))
   {
-    if (err) return FALSE;
     for (j=0; j < i->n; j++)
     {
       cl_err = cl_c2g(i->tex[read][j], i->tex[0][j],i->size[0][j], &i->roi[read][j],&i->roi[0][j],
@@ -424,11 +422,14 @@ cl_process (GeglOperation       *operation,
       if (cl_err != CL_SUCCESS)
       {
         g_warning("[OpenCL] Error in gegl:c2g Kernel");
+        gegl_buffer_cl_iterator_stop (i);
         return FALSE;
       }
     }
   }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 static gboolean
@@ -438,20 +439,13 @@ process (GeglOperation       *operation,
          const GeglRectangle *result)
 {
   GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglRectangle compute;
-  compute = gegl_operation_get_required_for_output (operation, "input",result);
 
   if (o->radius < 500 && cl_state.is_accelerated)
     if(cl_process(operation, input, output, result))
       return TRUE;
 
-  c2g (input, &compute, output, result,
-       o->radius,
-       o->samples,
-       o->iterations,
-       /*o->rgamma*/RGAMMA);
-
-  return  TRUE;
+  return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                    0, c2g, NULL);
 }
 
 
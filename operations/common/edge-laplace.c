@@ -420,10 +420,7 @@ cl_edge_laplace (cl_mem                in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 1, sizeof(cl_mem),   (void*)&aux_tex);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                       cl_data->kernel[0], 2,
-                                       NULL, global_ws, NULL,
-                                       0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[0], global_ws);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   cl_err = gegl_clEnqueueBarrier(gegl_cl_get_command_queue());
@@ -433,10 +430,7 @@ cl_edge_laplace (cl_mem                in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 1, sizeof(cl_mem),   (void*)&out_tex);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                       cl_data->kernel[1], 2,
-                                       NULL, global_ws, NULL,
-                                       0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[1], global_ws);
   if (cl_err != CL_SUCCESS) return cl_err;
   return cl_err;
 }
@@ -461,18 +455,20 @@ cl_process (GeglOperation       *operation,
   gint aux  = gegl_buffer_cl_iterator_add_2 (i, NULL, result, in_format,  GEGL_CL_BUFFER_AUX, op_area->left, op_area->right, op_area->top, op_area->bottom);
   while (gegl_buffer_cl_iterator_next (i, &err))
   {
-    if (err) return FALSE;
     for (j=0; j < i->n; j++)
     {
       cl_err = cl_edge_laplace(i->tex[read][j], i->tex[aux][j], i->tex[0][j], &i->roi[read][j], &i->roi[0][j], LAPLACE_RADIUS);
       if (cl_err != CL_SUCCESS)
       {
         g_warning("[OpenCL] Error in gegl:edge-laplace: %s\n", gegl_cl_errstring(cl_err));
+        gegl_buffer_cl_iterator_stop (i);
         return FALSE;
       }
     }
   }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 static gboolean
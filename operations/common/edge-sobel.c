@@ -46,15 +46,12 @@ gegl_chant_boolean (keep_signal,  _("Keep Signal"),  TRUE,
 #define SOBEL_RADIUS 1
 
 static void
-edge_sobel (GeglBuffer          *src,
+edge_sobel (GeglOperation       *operation,
+            const gfloat        *src_buf,
             const GeglRectangle *src_rect,
-            GeglBuffer          *dst,
+            gfloat              *dst_buf,
             const GeglRectangle *dst_rect,
-            gboolean            horizontal,
-            gboolean            vertical,
-            gboolean            keep_signal);
-
-
+            gpointer             user_data);
 
 static void prepare (GeglOperation *operation)
 {
@@ -132,6 +129,83 @@ static const char* kernel_source =
 "    gradient.w = pix_mm.w;                                            \n"
 "                                                                      \n"
 "    out[gidx + gidy * dst_width] = gradient;                          \n"
+"}                                                                     \n"
+
+/* variant staging the neighbourhood in __local memory */
+GEGL_CL_TILE_SOURCE
+"kernel void kernel_edgesobel_tiled(global float4 *in,                 \n"
+"                                   global float4 *out,                \n"
+"                                   const int horizontal,              \n"
+"                                   const int vertical,                \n"
+"                                   const int keep_signal,             \n"
+"                                   const int dst_width,               \n"
+"                                   const int dst_height,              \n"
+"                                   local float4 *tile)                \n"
+"{                                                                     \n"
+"    int gidx = get_global_id(0);                                      \n"
+"    int gidy = get_global_id(1);                                      \n"
+"                                                                      \n"
+"    float4 hor_grad = 0.0f;                                           \n"
+"    float4 ver_grad = 0.0f;                                           \n"
+"    float4 gradient = 0.0f;                                           \n"
+"                                                                      \n"
+"    int tile_width = get_local_size(0) + SOBEL_RADIUS * 2;            \n"
+"    int tid = get_local_id(0) + SOBEL_RADIUS                          \n"
+"            + (get_local_id(1) + SOBEL_RADIUS) * tile_width;          \n"
+"                                                                      \n"
+"    gegl_cl_tile_load (in,                                            \n"
+"                       dst_width  + SOBEL_RADIUS * 2,                 \n"
+"                       dst_height + SOBEL_RADIUS * 2,                 \n"
+"                       tile, tile_width,                              \n"
+"                       get_local_size(1) + SOBEL_RADIUS * 2,          \n"
+"                       get_group_id(0) * get_local_size(0),           \n"
+"                       get_group_id(1) * get_local_size(1));          \n"
+"                                                                      \n"
+"    if (gidx >= dst_width || gidy >= dst_height)                      \n"
+"        return;                                                       \n"
+"                                                                      \n"
+"    float4 pix_fl = tile[tid - 1 - tile_width];                       \n"
+"    float4 pix_fm = tile[tid     - tile_width];                       \n"
+"    float4 pix_fr = tile[tid + 1 - tile_width];                       \n"
+"    float4 pix_ml = tile[tid - 1             ];                       \n"
+"    float4 pix_mm = tile[tid                 ];                       \n"
+"    float4 pix_mr = tile[tid + 1             ];                       \n"
+"    float4 pix_bl = tile[tid - 1 + tile_width];                       \n"
+"    float4 pix_bm = tile[tid     + tile_width];                       \n"
+"    float4 pix_br = tile[tid + 1 + tile_width];                       \n"
+"                                                                      \n"
+"    if (horizontal)                                                   \n"
+"    {                                                                 \n"
+"        hor_grad +=                                                   \n"
+"            - 1.0f * pix_fl + 1.0f * pix_fr                           \n"
+"            - 2.0f * pix_ml + 2.0f * pix_mr                           \n"
+"            - 1.0f * pix_bl + 1.0f * pix_br;                          \n"
+"    }                                                                 \n"
+"    if (vertical)                                                     \n"
+"    {                                                                 \n"
+"        ver_grad +=                                                   \n"
+"            - 1.0f * pix_fl - 2.0f * pix_fm                           \n"
+"            - 1.0f * pix_fr + 1.0f * pix_bl                           \n"
+"            + 2.0f * pix_bm + 1.0f * pix_br;                          \n"
+"    }                                                                 \n"
+"                                                                      \n"
+"    if (horizontal && vertical)                                       \n"
+"    {                                                                 \n"
+"        gradient = sqrt(                                              \n"
+"            hor_grad * hor_grad +                                     \n"
+"            ver_grad * ver_grad) / 1.41f;                             \n"
+"    }                                                                 \n"
+"    else                                                              \n"
+"    {                                                                 \n"
+"        if (keep_signal)                                              \n"
+"            gradient = hor_grad + ver_grad;                           \n"
+"        else                                                          \n"
+"            gradient = fabs(hor_grad + ver_grad);                     \n"
+"    }                                                                 \n"
+"                                                                      \n"
+"    gradient.w = pix_mm.w;                                            \n"
+"                                                                      \n"
+"    out[gidx + gidy * dst_width] = gradient;                          \n"
 "}                                                                     \n";
 
 static gegl_cl_run_data *cl_data = NULL;
@@ -148,7 +222,7 @@ cl_edge_sobel (cl_mem              in_tex,
   cl_int cl_err = 0;
   if (!cl_data)
   {
-    const char *kernel_name[] = {"kernel_edgesobel", NULL};
+    const char *kernel_name[] = {"kernel_edgesobel", "kernel_edgesobel_tiled", NULL};
     cl_data = gegl_cl_compile_and_build(kernel_source, kernel_name);
   }
   if (!cl_data)  return 0;
@@ -158,6 +232,20 @@ cl_edge_sobel (cl_mem              in_tex,
   cl_int n_keep_signal = keep_signal;
   const size_t gbl_size[2] = {roi->width,roi->height};
 
+  if (gegl_cl_tune_local_fits (cl_data->kernel[1], 2, 2))
+    {
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 0, sizeof(cl_mem), (void*)&in_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 1, sizeof(cl_mem), (void*)&out_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 2, sizeof(cl_int), (void*)&n_horizontal);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 3, sizeof(cl_int), (void*)&n_vertical);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 4, sizeof(cl_int), (void*)&n_keep_signal);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 5, sizeof(cl_int), (void*)&roi->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 6, sizeof(cl_int), (void*)&roi->height);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      return gegl_cl_tune_enqueue_local (cl_data->kernel[1], gbl_size, 2, 2, 7);
+    }
+
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 0, sizeof(cl_mem), (void*)&in_tex);
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 1, sizeof(cl_mem), (void*)&out_tex);
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 2, sizeof(cl_int), (void*)&n_horizontal);
@@ -165,10 +253,7 @@ cl_edge_sobel (cl_mem              in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 4, sizeof(cl_int), (void*)&n_keep_signal);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue(),
-                                       cl_data->kernel[0], 2,
-                                       NULL, gbl_size, NULL,
-                                       0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[0], gbl_size);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   return cl_err;
@@ -193,18 +278,20 @@ cl_process (GeglOperation       *operation,
                 gint read = gegl_buffer_cl_iterator_add_2 (i, input, result, in_format, GEGL_CL_BUFFER_READ,op_area->left, op_area->right, op_area->top, op_area->bottom);
   while (gegl_buffer_cl_iterator_next (i, &err))
   {
-    if (err) return FALSE;
     for (j=0; j < i->n; j++)
     {
       cl_err = cl_edge_sobel(i->tex[read][j], i->tex[0][j], i->size[0][j],&i->roi[0][j], o->horizontal, o->vertical, o->keep_signal);
       if (cl_err != CL_SUCCESS)
       {
         g_warning("[OpenCL] Error in gegl:edge-sobel\n");
+        gegl_buffer_cl_iterator_stop (i);
         return FALSE;
       }
     }
   }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 static gboolean
@@ -213,17 +300,12 @@ process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result)
 {
-  GeglChantO   *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglRectangle compute;
-
-  compute = gegl_operation_get_required_for_output (operation, "input",result);
-
   if (cl_state.is_accelerated)
     if(cl_process(operation, input, output, result))
       return TRUE;
 
-  edge_sobel (input, &compute, output, result, o->horizontal, o->vertical, o->keep_signal);
-  return  TRUE;
+  return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                    0, edge_sobel, NULL);
 }
 
 inline static gfloat
@@ -233,27 +315,22 @@ RMS(gfloat a, gfloat b)
 }
 
 static void
-edge_sobel (GeglBuffer          *src,
+edge_sobel (GeglOperation       *operation,
+            const gfloat        *src_buf,
             const GeglRectangle *src_rect,
-            GeglBuffer          *dst,
+            gfloat              *dst_buf,
             const GeglRectangle *dst_rect,
-            gboolean            horizontal,
-            gboolean            vertical,
-            gboolean            keep_signal)
+            gpointer             user_data)
 {
-
-  gint x,y;
-  gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
+  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
+  gboolean    horizontal  = o->horizontal;
+  gboolean    vertical    = o->vertical;
+  gboolean    keep_signal = o->keep_signal;
+  gint        x,y;
+  gint        offset;
 
   gint src_width = src_rect->width;
 
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
   offset = 0;
 
   for (y=0; y<dst_rect->height; y++)
@@ -264,14 +341,14 @@ edge_sobel (GeglBuffer          *src,
         gfloat ver_grad[3] = {0.0f, 0.0f, 0.0f};
         gfloat gradient[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 
-        gfloat *center_pix = src_buf + ((x+SOBEL_RADIUS)+((y+SOBEL_RADIUS) * src_width)) * 4;
+        const gfloat *center_pix = src_buf + ((x+SOBEL_RADIUS)+((y+SOBEL_RADIUS) * src_width)) * 4;
 
         gint c;
 
         if (horizontal)
           {
             gint i=x+SOBEL_RADIUS, j=y+SOBEL_RADIUS;
-            gfloat *src_pix = src_buf + (i + j * src_width) * 4;
+            const gfloat *src_pix = src_buf + (i + j * src_width) * 4;
 
             for (c=0;c<3;c++)
                 hor_grad[c] +=
@@ -283,7 +360,7 @@ edge_sobel (GeglBuffer          *src,
         if (vertical)
           {
             gint i=x+SOBEL_RADIUS, j=y+SOBEL_RADIUS;
-            gfloat *src_pix = src_buf + (i + j * src_width) * 4;
+            const gfloat *src_pix = src_buf + (i + j * src_width) * 4;
 
             for (c=0;c<3;c++)
                 ver_grad[c] +=
@@ -319,11 +396,6 @@ edge_sobel (GeglBuffer          *src,
 
         offset++;
       }
-
-  gegl_buffer_set (dst, dst_rect, babl_format ("RGBA float"), dst_buf,
-                   GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
 }
 
 
@@ -17,12 +17,28 @@
 #define ANGLE_PRIME  95273 /* the lookuptables are sized as primes to ensure */
 #define RADIUS_PRIME 29537 /* as good as possible variation when using both */
 
-static gfloat   lut_cos[ANGLE_PRIME];
-static gfloat   lut_sin[ANGLE_PRIME];
-static gfloat   radiuses[RADIUS_PRIME];
+#define SAMPLE_BLOCK 16    /* sample positions computed at a time, the tables
+                            * repeat their first SAMPLE_BLOCK entries at the
+                            * end so a block never wraps around
+                            */
+
+#define RADIUS_SEED  1     /* the radiuses are the same on every run */
+
+static gfloat   lut_cos[ANGLE_PRIME + SAMPLE_BLOCK];
+static gfloat   lut_sin[ANGLE_PRIME + SAMPLE_BLOCK];
+static gfloat   radiuses[RADIUS_PRIME + SAMPLE_BLOCK];
 static gdouble  luts_computed = 0.0;
-static gint     angle_no=0;
-static gint     radius_no=0;
+static GStaticMutex luts_mutex = G_STATIC_MUTEX_INIT;
+
+/* position of a pixel in the sequence of sample positions, the spray of a
+ * pixel depends on its position in the image only, not on the order in
+ * which tiles or pixels are processed
+ */
+typedef struct
+{
+  gint angle_no;
+  gint radius_no;
+} SprayState;
 
 static void compute_luts(gdouble rgamma)
 {
@@ -33,8 +49,14 @@ static void compute_luts(gdouble rgamma)
 
   if (luts_computed==rgamma)
     return;
-  luts_computed = rgamma;
-  rand = g_rand_new();
+
+  g_static_mutex_lock (&luts_mutex);
+  if (luts_computed==rgamma)
+    {
+      g_static_mutex_unlock (&luts_mutex);
+      return;
+    }
+  rand = g_rand_new_with_seed (RADIUS_SEED);
 
   for (i=0;i<ANGLE_PRIME;i++)
     {
@@ -46,20 +68,47 @@ static void compute_luts(gdouble rgamma)
     {
       radiuses[i] = pow(g_rand_double_range (rand, 0.0, 1.0), rgamma);
     }
+  for (i=0;i<SAMPLE_BLOCK;i++)
+    {
+      lut_cos[ANGLE_PRIME + i]   = lut_cos[i];
+      lut_sin[ANGLE_PRIME + i]   = lut_sin[i];
+      radiuses[RADIUS_PRIME + i] = radiuses[i];
+    }
 
   g_rand_free(rand);
+  luts_computed = rgamma;
+  g_static_mutex_unlock (&luts_mutex);
+}
+
+/* a counter based generator, hashes the image coordinates of a pixel into
+ * its starting position in the tables
+ */
+static inline void
+spray_init (SprayState *spray,
+            gint        x,
+            gint        y)
+{
+  guint32 h = (guint32) x * 0x9e3779b1u ^ (guint32) y * 0x85ebca77u;
+
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
 
+  spray->angle_no  = h % ANGLE_PRIME;
+  spray->radius_no = (h / ANGLE_PRIME) % RADIUS_PRIME;
 }
 
 static inline void
-sample (gfloat *buf,
-        gint    width,
-        gint    height,
-        gint    x,
-        gint    y,
-        gfloat *dst)
+sample (const gfloat *buf,
+        gint          width,
+        gint          height,
+        gint          x,
+        gint          y,
+        gfloat       *dst)
 {
-  gfloat *pixel = (buf + ((width * y) + x) * 4);
+  const gfloat *pixel = (buf + ((width * y) + x) * 4);
   gint c;
 
   for (c=0;c<4;c++)
@@ -69,21 +118,24 @@ sample (gfloat *buf,
 }
 
 static inline void
-sample_min_max (gfloat *buf,
-                gint    width,
-                gint    height,
-                gint    x,
-                gint    y,
-                gint    radius,
-                gint    samples,
-                gfloat *min,
-                gfloat *max)
+sample_min_max (const gfloat *buf,
+                gint          width,
+                gint          height,
+                gint          x,
+                gint          y,
+                gint          radius,
+                gint          samples,
+                SprayState   *spray,
+                gfloat       *min,
+                gfloat       *max)
 {
   gfloat best_min[3];
   gfloat best_max[3];
-  gfloat *center_pix = (buf + (width * y + x) * 4);
+  const gfloat *center_pix = (buf + (width * y + x) * 4);
+  gint   found = 0;
+  gint   tries = 0;
 
-  gint i, c;
+  gint c;
 
   for (c=0;c<3;c++)
     {
@@ -91,52 +143,62 @@ sample_min_max (gfloat *buf,
       best_max[c]=center_pix[c];
     }
 
-  for (i=0; i<samples; i++)
+  /* sample positions outside the valid image area and fully transparent
+   * pixels are skipped, and another sample taken instead; this should
+   * potentially work better than mirroring or extending the image.  Give
+   * up on pixels with nothing to sample around them.
+   */
+  while (found < samples && tries < samples * 64)
     {
-      gint u, v;
-      gint angle;
-      gfloat rmag;
-retry:                      /* if we've sampled outside the valid image
-                               area, we grab another sample instead, this
-                               should potentially work better than mirroring
-                               or extending the image
-                             */
-      angle = angle_no++;
-      rmag = radiuses[radius_no++] * radius;
-
-      if (angle_no>=ANGLE_PRIME)
-        angle_no=0;
-      if (radius_no>=RADIUS_PRIME)
-        radius_no=0;
-
-      u = x + rmag * lut_cos[angle];
-      v = y + rmag * lut_sin[angle];
-
-      if (u>=width ||
-          u<0 ||
-          v>=height ||
-          v<0)
-        goto retry;
+      const gfloat *cos_block = lut_cos + spray->angle_no;
+      const gfloat *sin_block = lut_sin + spray->angle_no;
+      const gfloat *rad_block = radiuses + spray->radius_no;
+      gint          offsets[SAMPLE_BLOCK];
+      gint          k;
 
-      {
-        gfloat *pixel = (buf + ((width * v) + u) * 4);
-
-        if (pixel[3]>0.0) /* ignore fully transparent pixels */
-          {
-            for (c=0;c<3;c++)
-              {
-                if (pixel[c]<best_min[c])
-                  best_min[c]=pixel[c];
-
-                if (pixel[c]>best_max[c])
-                  best_max[c]=pixel[c];
-              }
-          }
-        else
-          {
-            goto retry;
-          }
-      }
+      /* positions for a whole block of samples at once, this loop is
+       * vectorized; offsets outside the image are marked with -1
+       */
+      for (k = 0; k < SAMPLE_BLOCK; k++)
+        {
+          gfloat rmag = rad_block[k] * radius;
+          /* displacements are rounded down on their own, rounding x + dx
+           * would make the sample depend on where x is relative to buf;
+           * offset by radius they are positive and truncation rounds down
+           */
+          gint   u    = x + (gint) (rmag * cos_block[k] + radius) - radius;
+          gint   v    = y + (gint) (rmag * sin_block[k] + radius) - radius;
+
+          offsets[k] = (u >= 0 && u < width && v >= 0 && v < height) ?
+                       (width * v + u) * 4 : -1;
+        }
+
+      spray->angle_no  += SAMPLE_BLOCK;
+      spray->radius_no += SAMPLE_BLOCK;
+      if (spray->angle_no >= ANGLE_PRIME)
+        spray->angle_no -= ANGLE_PRIME;
+      if (spray->radius_no >= RADIUS_PRIME)
+        spray->radius_no -= RADIUS_PRIME;
+
+      for (k = 0; k < SAMPLE_BLOCK && found < samples; k++)
+        {
+          const gfloat *pixel;
+
+          tries++;
+          if (offsets[k] < 0)
+            continue;
+
+          pixel = buf + offsets[k];
+          if (pixel[3]<=0.0) /* ignore fully transparent pixels */
+            continue;
+
+          for (c=0;c<3;c++)
+            {
+              best_min[c] = MIN (best_min[c], pixel[c]);
+              best_max[c] = MAX (best_max[c], pixel[c]);
+            }
+          found++;
+        }
     }
   for (c=0;c<3;c++)
     {
@@ -145,34 +207,39 @@ retry:                      /* if we've sampled outside the valid image
     }
 }
 
-static inline void compute_envelopes (gfloat  *buf,
-                                      gint     width,
-                                      gint     height,
-                                      gint     x,
-                                      gint     y,
-                                      gint     radius,
-                                      gint     samples,
-                                      gint     iterations,
-                                      gboolean same_spray,
-                                      gdouble  rgamma,
-                                      gfloat  *min_envelope,
-                                      gfloat  *max_envelope)
+/* buf_x, buf_y is the position of buf in the image, x and y are relative
+ * to buf
+ */
+static inline void compute_envelopes (const gfloat *buf,
+                                      gint          width,
+                                      gint          height,
+                                      gint          buf_x,
+                                      gint          buf_y,
+                                      gint          x,
+                                      gint          y,
+                                      gint          radius,
+                                      gint          samples,
+                                      gint          iterations,
+                                      gboolean      same_spray,
+                                      gdouble       rgamma,
+                                      gfloat       *min_envelope,
+                                      gfloat       *max_envelope)
 {
   gint    i;
   gint    c;
   gfloat  range_sum[4]               = {0,0,0,0};
   gfloat  relative_brightness_sum[4] = {0,0,0,0};
-  gfloat *pixel = buf + (width*y+x)*4;
+  const gfloat *pixel = buf + (width*y+x)*4;
+  SprayState    spray;
 
   /* compute lookuptables for the gamma, currently not used/exposed
    * as a tweakable property */
   compute_luts(rgamma);
 
   if (same_spray)
-    {
-      angle_no = 0;
-      radius_no = 0;
-    }
+    spray_init (&spray, 0, 0);
+  else
+    spray_init (&spray, buf_x + x, buf_y + y);
 
   for (i=0;i<iterations;i++)
     {
@@ -183,6 +250,7 @@ static inline void compute_envelopes (gfloat  *buf,
                       height,
                       x, y,
                       radius, samples,
+                      &spray,
                       min, max);
 
       for (c=0;c<3;c++)
@@ -52,6 +52,7 @@ gegl_chant_double (noise, _("Noise"),
 #include "gegl-chant.h"
 #include "gegl-debug.h"
 #include <stdlib.h>
+#include "parallel-reduce.h"
 
 static const gchar *OUTPUT_FORMAT   = "RGB float";
 static const gint   MINIMUM_PYRAMID = 32;
@@ -110,6 +111,8 @@ fattal02_set_array (gfloat *array,
                     gfloat  value)
 {
   guint i;
+
+  _OMP (omp parallel for schedule(static))
   for (i = 0; i < size; ++i)
     array[i] = value;
 }
@@ -121,6 +124,8 @@ fattal02_add_array (gfloat       *accum,
                     const gfloat *input)
 {
   guint i;
+
+  _OMP (omp parallel for schedule(static))
   for (i = 0; i < size; ++i)
     accum[i] += input[i];
 }
@@ -156,13 +161,19 @@ fattal02_restrict (const gfloat        *input,
 
   const gfloat filterSize = 0.5;
 
-  gfloat sx, sy;
   guint   x,  y;
 
-  for (y = 0, sy = dy / 2 - 0.5; y < outRows; ++y, sy += dy)
+  /* the sample positions are computed from x and y rather than accumulated,
+   * so rows can be computed in any order
+   */
+  _OMP (omp parallel for private(x) schedule(static))
+  for (y = 0; y < outRows; ++y)
     {
-      for (x = 0, sx = dx / 2 - 0.5; x < outCols; ++x, sx += dx )
+      const gfloat sy = dy / 2 - 0.5 + y * dy;
+
+      for (x = 0; x < outCols; ++x)
         {
+          const gfloat sx = dx / 2 - 0.5 + x * dx;
           gfloat pixVal = 0;
           gfloat w      = 0;
           gint   ix, iy;
@@ -203,13 +214,16 @@ fattal02_prolongate (const gfloat        *input,
 
   const float filterSize = 1;
 
-  gfloat sx, sy;
   guint   x,  y;
 
-  for (y = 0, sy = -dy / 2; y < outRows; ++y, sy += dy)
+  _OMP (omp parallel for private(x) schedule(static))
+  for (y = 0; y < outRows; ++y)
     {
-      for (x = 0, sx = -dx / 2; x < outCols; ++x, sx += dx )
+      const gfloat sy = -dy / 2 + y * dy;
+
+      for (x = 0; x < outCols; ++x)
         {
+          const gfloat sx = -dx / 2 + x * dx;
           gfloat pixVal = 0;
           gfloat weight = 0;
           gfloat ix, iy;
@@ -231,9 +245,10 @@ fattal02_prolongate (const gfloat        *input,
                 }
             }
 
-          g_return_if_fail (weight != 0);
+          /* no returning from within a parallel loop */
+          g_warn_if_fail (weight != 0);
 
-          output [x + y * outCols] = pixVal / weight;
+          output [x + y * outCols] = weight != 0 ? pixVal / weight : 0;
         }
     }
 }
@@ -286,6 +301,7 @@ fattal02_calculate_defect (gfloat              *D,
         sy = extent_f->height;
   guint x, y;
 
+  _OMP (omp parallel for private(x) schedule(static))
   for (y = 0; y < sy; ++y)
     {
       for (x = 0; x < sx; ++x)
@@ -481,6 +497,7 @@ asolve (gulong n,
 {
   guint i;
 
+  _OMP (omp parallel for schedule(static))
   for (i = 0; i < n; ++i)
     x[i] = -4 * b[i];
 }
@@ -496,6 +513,7 @@ atimes (guint  rows,
 
 #define IDX(R,C) ((R) * cols + (C))
 
+  _OMP (omp parallel for private(c) schedule(static))
   for (r = 1; r < rows - 1; ++r)
     {
       for (c = 1; c < cols - 1; ++c)
@@ -554,10 +572,7 @@ snrm (gulong n,
 
   if (itol <= 3)
     {
-      gfloat ans = 0.0;
-      for (i = 0; i < n; ++i)
-          ans += sx[i] * sx[i];
-      return sqrtf (ans);
+      return sqrtf (parallel_reduce_dot (n, sx, sx));
     }
   else
     {
@@ -603,6 +618,7 @@ linbcg (guint   rows,
 
   *iter=0;
   atimes (rows, cols, x, r, 0);
+  _OMP (omp parallel for schedule(static))
   for (j = 0; j < n; ++j)
     {
        r[j] = b[j] - r[j];
@@ -641,13 +657,11 @@ linbcg (guint   rows,
 
       zm1nrm = znrm;
       asolve (n, rr, zz, 1);
-      for (bknum = 0.0, j = 0; j < n; ++j)
-        {
-          bknum += z[j] * rr[j];
-        }
+      bknum = parallel_reduce_dot (n, z, rr);
 
       if (*iter == 1)
         {
+          _OMP (omp parallel for schedule(static))
           for (j = 0; j < n; ++j)
             {
                p[j] =  z[j];
@@ -658,6 +672,7 @@ linbcg (guint   rows,
         {
           bk = bknum / bkden;
 
+          _OMP (omp parallel for schedule(static))
           for (j = 0; j < n; ++j)
             {
                p[j] = bk *  p[j] +  z[j];
@@ -668,14 +683,12 @@ linbcg (guint   rows,
       bkden = bknum;
       atimes (rows, cols, p, z, 0);
 
-      for (akden = 0.0, j = 0; j < n; ++j)
-        {
-          akden += z[j] * pp[j];
-        }
+      akden = parallel_reduce_dot (n, z, pp);
 
       ak = bknum / akden;
       atimes (rows, cols, pp, zz, 1);
 
+      _OMP (omp parallel for schedule(static))
       for (j = 0; j < n; ++j)
         {
            x[j] += ak *  p[j];
@@ -43,6 +43,7 @@ gegl_chant_string (filter, _("Filter"), "auto",
 #include "gegl-chant.h"
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #define RADIUS_SCALE   4
 
@@ -87,60 +88,39 @@ iir_young_find_constants (gfloat   sigma,
   *B = 1 - ( (b[1]+b[2]+b[3])/b[0] );
 }
 
-static inline void
-iir_young_blur_1D (gfloat  * buf,
-                   gint      offset,
-                   gint      delta_offset,
-                   gdouble   B,
-                   gdouble * b,
-                   gfloat  * w,
-                   gint      w_len)
+/* number of rows or columns filtered together, the samples of a batch are
+ * next to each other in memory so the loops over them get vectorised
+ */
+#define IIR_BATCH 8
+
+/* runs the forward and backward filters over len lines of IIR_BATCH RGBA
+ * pixels.  The three lines before and after the signal must be zero, they
+ * stand for the samples outside of it.  Samples are stored as floats and
+ * filtered in double precision like the per column version did, which keeps
+ * the results of large radii unchanged.
+ */
+static void
+iir_young_blur_batch (gfloat  *lines,
+                      gint     len,
+                      gdouble  B,
+                      gdouble *b)
 {
-  gint wcount, i;
-  gdouble tmp;
+  const gint    step = IIR_BATCH * 4;
+  const gdouble b0 = b[0], b1 = b[1], b2 = b[2], b3 = b[3];
+  gfloat       *p;
+  gint          i, k;
 
   /* forward filter */
-  wcount = 0;
-
-  while (wcount < w_len)
-    {
-      tmp = 0;
-
-      for (i=1; i<4; i++)
-        {
-          if (wcount-i >= 0)
-            tmp += b[i]*w[wcount-i];
-        }
-
-      tmp /= b[0];
-      tmp += B*buf[offset];
-      w[wcount] = tmp;
-
-      wcount++;
-      offset += delta_offset;
-    }
+  for (i = 0, p = lines; i < len; i++, p += step)
+    for (k = 0; k < step; k++)
+      p[k] = (b1 * p[k - step] + b2 * p[k - 2 * step] + b3 * p[k - 3 * step]) / b0 +
+             B * p[k];
 
   /* backward filter */
-  wcount = w_len - 1;
-  offset -= delta_offset;
-
-  while (wcount >= 0)
-    {
-      tmp = 0;
-
-      for (i=1; i<4; i++)
-        {
-          if (wcount+i < w_len)
-            tmp += b[i]*buf[offset+delta_offset*i];
-        }
-
-      tmp /= b[0];
-      tmp += B*w[wcount];
-      buf[offset] = tmp;
-
-      offset -= delta_offset;
-      wcount--;
-    }
+  for (i = len - 1, p = lines + (len - 1) * step; i >= 0; i--, p -= step)
+    for (k = 0; k < step; k++)
+      p[k] = (b1 * p[k + step] + b2 * p[k + 2 * step] + b3 * p[k + 3 * step]) / b0 +
+             B * p[k];
 }
 
 /* expects src and dst buf to have the same height and no y-offset */
@@ -152,37 +132,41 @@ iir_young_hor_blur (GeglBuffer          *src,
                     gdouble              B,
                     gdouble             *b)
 {
-  gint v;
-  gint c;
-  gint w_len;
+  const gint step = IIR_BATCH * 4;
+  gint u, v, r;
+  gint len;
   gfloat *buf;
-  gfloat *w;
+  gfloat *lines;
 
-  buf = g_new0 (gfloat, src_rect->height * src_rect->width * 4);
-  w   = g_new0 (gfloat, src_rect->width);
+  len   = src_rect->width;
+  buf   = g_new (gfloat, src_rect->height * src_rect->width * 4);
+  lines = g_new0 (gfloat, (len + 6) * step);
 
   gegl_buffer_get (src, 1.0, src_rect, babl_format ("RaGaBaA float"),
                    buf, GEGL_AUTO_ROWSTRIDE);
 
-  w_len = src_rect->width;
-  for (v=0; v<src_rect->height; v++)
+  /* rows are filtered IIR_BATCH at a time from a transposed copy */
+  for (v=0; v<src_rect->height; v+=IIR_BATCH)
     {
-      for (c = 0; c < 4; c++)
-        {
-          iir_young_blur_1D (buf,
-                             v*src_rect->width*4+c,
-                             4,
-                             B,
-                             b,
-                             w,
-                             w_len);
-        }
+      gint n = MIN (IIR_BATCH, src_rect->height - v);
+
+      for (r = 0; r < n; r++)
+        for (u = 0; u < len; u++)
+          memcpy (lines + (u + 3) * step + r * 4,
+                  buf + ((v + r) * len + u) * 4, 4 * sizeof (gfloat));
+
+      iir_young_blur_batch (lines + 3 * step, len, B, b);
+
+      for (r = 0; r < n; r++)
+        for (u = 0; u < len; u++)
+          memcpy (buf + ((v + r) * len + u) * 4,
+                  lines + (u + 3) * step + r * 4, 4 * sizeof (gfloat));
     }
 
   gegl_buffer_set (dst, src_rect, babl_format ("RaGaBaA float"),
                    buf, GEGL_AUTO_ROWSTRIDE);
   g_free (buf);
-  g_free (w);
+  g_free (lines);
 }
 
 /* expects src and dst buf to have the same width and no x-offset */
@@ -194,37 +178,39 @@ iir_young_ver_blur (GeglBuffer          *src,
                     gdouble              B,
                     gdouble             *b)
 {
-  gint u;
-  gint c;
-  gint w_len;
+  const gint step = IIR_BATCH * 4;
+  gint u, v;
+  gint len;
   gfloat *buf;
-  gfloat *w;
+  gfloat *lines;
 
-  buf = g_new0 (gfloat, src_rect->height * src_rect->width * 4);
-  w   = g_new0 (gfloat, src_rect->height);
+  len   = src_rect->height;
+  buf   = g_new (gfloat, src_rect->height * src_rect->width * 4);
+  lines = g_new0 (gfloat, (len + 6) * step);
 
   gegl_buffer_get (src, 1.0, src_rect, babl_format ("RaGaBaA float"),
                    buf, GEGL_AUTO_ROWSTRIDE);
 
-  w_len = src_rect->height;
-  for (u=0; u<dst_rect->width; u++)
+  /* IIR_BATCH neighbouring columns at a time, copied a row at a time */
+  for (u=0; u<dst_rect->width; u+=IIR_BATCH)
     {
-      for (c = 0; c < 4; c++)
-        {
-          iir_young_blur_1D (buf,
-                             u*4 + c,
-                             src_rect->width*4,
-                             B,
-                             b,
-                             w,
-                             w_len);
-        }
+      gint n = MIN (IIR_BATCH, dst_rect->width - u);
+
+      for (v = 0; v < len; v++)
+        memcpy (lines + (v + 3) * step,
+                buf + (v * src_rect->width + u) * 4, n * 4 * sizeof (gfloat));
+
+      iir_young_blur_batch (lines + 3 * step, len, B, b);
+
+      for (v = 0; v < len; v++)
+        memcpy (buf + (v * src_rect->width + u) * 4,
+                lines + (v + 3) * step, n * 4 * sizeof (gfloat));
     }
 
   gegl_buffer_set (dst, src_rect,
                    babl_format ("RaGaBaA float"), buf, GEGL_AUTO_ROWSTRIDE);
   g_free (buf);
-  g_free (w);
+  g_free (lines);
 }
 
 
@@ -469,6 +455,88 @@ static const char* kernel_source =
 "                                                                  \n"
 "    dst_buf[gid] = fir_get_mean_component_1D_CL(                  \n"
 "        src_buf, src_offset, 1, cmatrix, matrix_length);          \n"
+"}                                                                 \n"
+
+/* variants staging the neighbourhood in __local memory */
+GEGL_CL_TILE_SOURCE
+"float4 fir_get_mean_component_1D_tiled(local const float4 *tile, \n"
+"                                       int offset,                \n"
+"                                       const int delta_offset,    \n"
+"                                       constant float *cmatrix,   \n"
+"                                       const int matrix_length)   \n"
+"{                                                                 \n"
+"    float4 acc = 0.0f;                                            \n"
+"    int i;                                                        \n"
+"                                                                  \n"
+"    for(i=0; i<matrix_length; i++)                                \n"
+"      {                                                           \n"
+"        acc    += tile[offset] * cmatrix[i];                      \n"
+"        offset += delta_offset;                                   \n"
+"      }                                                           \n"
+"    return acc;                                                   \n"
+"}                                                                 \n"
+"                                                                  \n"
+"__kernel void fir_ver_blur_tiled(const global float4 *src_buf,    \n"
+"                                 const int src_width,             \n"
+"                                 const int src_height,            \n"
+"                                 global float4 *dst_buf,          \n"
+"                                 const int dst_width,             \n"
+"                                 const int dst_height,            \n"
+"                                 constant float *cmatrix,         \n"
+"                                 const int matrix_length,         \n"
+"                                 const int yoff,                  \n"
+"                                 local float4 *tile)              \n"
+"{                                                                 \n"
+"    int gidx = get_global_id(0);                                  \n"
+"    int gidy = get_global_id(1);                                  \n"
+"    int tile_width = get_local_size(0);                           \n"
+"    int radius = matrix_length / 2;                               \n"
+"                                                                  \n"
+"    gegl_cl_tile_load (src_buf, src_width, src_height,            \n"
+"                       tile, tile_width,                          \n"
+"                       get_local_size(1) + matrix_length - 1,     \n"
+"                       get_group_id(0) * get_local_size(0),       \n"
+"                       get_group_id(1) * get_local_size(1)        \n"
+"                       + yoff - radius);                          \n"
+"                                                                  \n"
+"    if (gidx >= dst_width || gidy >= dst_height)                  \n"
+"      return;                                                     \n"
+"                                                                  \n"
+"    dst_buf[gidx + gidy * dst_width] =                            \n"
+"      fir_get_mean_component_1D_tiled(                            \n"
+"        tile, get_local_id(1) * tile_width + get_local_id(0),     \n"
+"        tile_width, cmatrix, matrix_length);                      \n"
+"}                                                                 \n"
+"                                                                  \n"
+"__kernel void fir_hor_blur_tiled(const global float4 *src_buf,    \n"
+"                                 const int src_width,             \n"
+"                                 const int src_height,            \n"
+"                                 global float4 *dst_buf,          \n"
+"                                 const int dst_width,             \n"
+"                                 const int dst_height,            \n"
+"                                 constant float *cmatrix,         \n"
+"                                 const int matrix_length,         \n"
+"                                 const int xoff,                  \n"
+"                                 local float4 *tile)              \n"
+"{                                                                 \n"
+"    int gidx = get_global_id(0);                                  \n"
+"    int gidy = get_global_id(1);                                  \n"
+"    int tile_width = get_local_size(0) + matrix_length - 1;       \n"
+"    int radius = matrix_length / 2;                               \n"
+"                                                                  \n"
+"    gegl_cl_tile_load (src_buf, src_width, src_height,            \n"
+"                       tile, tile_width, get_local_size(1),       \n"
+"                       get_group_id(0) * get_local_size(0)        \n"
+"                       + xoff - radius,                           \n"
+"                       get_group_id(1) * get_local_size(1));      \n"
+"                                                                  \n"
+"    if (gidx >= dst_width || gidy >= dst_height)                  \n"
+"      return;                                                     \n"
+"                                                                  \n"
+"    dst_buf[gidx + gidy * dst_width] =                            \n"
+"      fir_get_mean_component_1D_tiled(                            \n"
+"        tile, get_local_id(1) * tile_width + get_local_id(0),     \n"
+"        1, cmatrix, matrix_length);                               \n"
 "}                                                                 \n";
 
 static gegl_cl_run_data *cl_data = NULL;
@@ -496,7 +564,8 @@ cl_gaussian_blur (cl_mem                in_tex,
 
   if (!cl_data)
   {
-      const char *kernel_name[] = {"fir_ver_blur_CL", "fir_hor_blur_CL", NULL};
+      const char *kernel_name[] = {"fir_ver_blur_CL", "fir_hor_blur_CL",
+                                   "fir_ver_blur_tiled", "fir_hor_blur_tiled", NULL};
       cl_data = gegl_cl_compile_and_build (kernel_source, kernel_name);
   }
 
@@ -522,6 +591,52 @@ cl_gaussian_blur (cl_mem                in_tex,
                                      NULL, NULL, NULL);
   if (cl_err != CL_SUCCESS) return cl_err;
 
+  if (gegl_cl_tune_local_fits (cl_data->kernel[3], matrix_length_x - 1, 0) &&
+      gegl_cl_tune_local_fits (cl_data->kernel[2], 0, matrix_length_y - 1))
+    {
+      global_ws[0] = aux_rect->width;
+      global_ws[1] = aux_rect->height;
+
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 0, sizeof(cl_mem), (void*)&in_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 1, sizeof(cl_int), (void*)&src_rect->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 2, sizeof(cl_int), (void*)&src_rect->height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 3, sizeof(cl_mem), (void*)&aux_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 4, sizeof(cl_int), (void*)&aux_rect->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 5, sizeof(cl_int), (void*)&aux_rect->height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 6, sizeof(cl_mem), (void*)&cl_matrix_x);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 7, sizeof(cl_int), (void*)&matrix_length_x);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[3], 8, sizeof(cl_int), (void*)&xoff);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      cl_err = gegl_cl_tune_enqueue_local (cl_data->kernel[3], global_ws,
+                                           matrix_length_x - 1, 0, 9);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      global_ws[0] = roi->width;
+      global_ws[1] = roi->height;
+
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 0, sizeof(cl_mem), (void*)&aux_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 1, sizeof(cl_int), (void*)&aux_rect->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 2, sizeof(cl_int), (void*)&aux_rect->height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 3, sizeof(cl_mem), (void*)&out_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 4, sizeof(cl_int), (void*)&roi->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 5, sizeof(cl_int), (void*)&roi->height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 6, sizeof(cl_mem), (void*)&cl_matrix_y);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 7, sizeof(cl_int), (void*)&matrix_length_y);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[2], 8, sizeof(cl_int), (void*)&yoff);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      cl_err = gegl_cl_tune_enqueue_local (cl_data->kernel[2], global_ws,
+                                           0, matrix_length_y - 1, 9);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      gegl_clFinish(gegl_cl_get_command_queue ());
+
+      gegl_clReleaseMemObject(cl_matrix_x);
+      gegl_clReleaseMemObject(cl_matrix_y);
+      return cl_err;
+    }
+
   global_ws[0] = aux_rect->width;
   global_ws[1] = aux_rect->height;
 
@@ -533,10 +648,7 @@ cl_gaussian_blur (cl_mem                in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 5, sizeof(cl_int), (void*)&xoff);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                       cl_data->kernel[1], 2,
-                                       NULL, global_ws, NULL,
-                                       0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[1], global_ws);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   global_ws[0] = roi->width;
@@ -550,10 +662,7 @@ cl_gaussian_blur (cl_mem                in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 5, sizeof(cl_int), (void*)&yoff);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                       cl_data->kernel[0], 2,
-                                       NULL, global_ws, NULL,
-                                       0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[0], global_ws);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   gegl_clFinish(gegl_cl_get_command_queue ());
@@ -601,7 +710,6 @@ cl_process (GeglOperation       *operation,
                                              0, 0, op_area->top, op_area->bottom);
   while (gegl_buffer_cl_iterator_next (i, &err))
     {
-      if (err) return FALSE;
       for (j=0; j < i->n; j++)
         {
            cl_err = cl_gaussian_blur(i->tex[read][j],
@@ -620,9 +728,13 @@ cl_process (GeglOperation       *operation,
           if (cl_err != CL_SUCCESS)
             {
               g_warning("[OpenCL] Error in gegl:gaussian-blur");
-              return FALSE;
+              gegl_buffer_cl_iterator_stop (i);
+              err = TRUE;
+              break;
             }
         }
+      if (err)
+        break;
     }
 
   g_free (fmatrix_x);
@@ -630,7 +742,9 @@ cl_process (GeglOperation       *operation,
 
   g_free (cmatrix_x);
   g_free (cmatrix_y);
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 static gboolean
@@ -47,12 +47,7 @@ gegl_chant_double (detail, _("Detail"),
 #include "gegl-chant.h"
 #include <stdio.h>
 #include <stdlib.h>
-
-#ifdef HAVE_OPENMP
-#define _OMP(x) _Pragma(#x)
-#else
-#define _OMP(x) /* OMP disabled: "#x" */
-#endif
+#include "parallel-reduce.h"
 
 /* Common return codes for operators */
 #define PFSTMO_OK 1             /* Successful */
@@ -252,7 +247,7 @@ mantiuk06_matrix_upsample (const gint          outCols,
                                          * best.
                                          */
 
-  _OMP (omp parallel for schedule(static))
+  _OMP (omp parallel for private(x) schedule(static))
   for (y = 0; y < outRows; y++)
     {
       const gfloat sy  = y * dy;
@@ -307,7 +302,7 @@ mantiuk06_matrix_downsample (const gint          inCols,
    */
 
   const gfloat normalize = 1.0f/(dx*dy);
-  _OMP (omp parallel for schedule(static))
+  _OMP (omp parallel for private(x, i, j) schedule(static))
   for (y = 0; y < outRows; y++)
     {
       const gint   iy1 = (  y   * inRows) / outRows;
@@ -433,20 +428,15 @@ mantiuk06_matrix_free (gfloat *m)
   g_free (m);
 }
 
-/* multiply vector by vector (each vector should have one dimension equal to 1) */
+/* multiply vector by vector (each vector should have one dimension equal to 1),
+ * the result does not depend on the number of threads
+ */
 static inline gfloat
 mantiuk06_matrix_dot_product (const guint         n,
                               const gfloat *const a,
                               const gfloat *const b)
 {
-  gfloat val = 0;
-  guint j;
-
-  _OMP (omp parallel for reduction(+:val) schedule(static))
-  for (j = 0; j < n; j++)
-    val += a[j] * b[j];
-
-  return val;
+  return parallel_reduce_dot (n, a, b);
 }
 
 /* set zeros for matrix elements */
@@ -469,7 +459,7 @@ mantiuk06_calculate_and_add_divergence (const gint          cols,
 {
   gint ky, kx;
 
-  _OMP (omp parallel for schedule(static))
+  _OMP (omp parallel for private(kx) schedule(static))
   for (ky = 0; ky < rows; ky++)
     {
       for (kx = 0; kx<cols; kx++)
@@ -715,7 +705,7 @@ mantiuk06_calculate_gradient (const gint          cols,
 {
   gint ky, kx;
 
-  _OMP (omp parallel for schedule(static))
+  _OMP (omp parallel for private(kx) schedule(static))
   for (ky = 0; ky < rows; ky++)
     {
       for (kx = 0; kx < cols; kx++)
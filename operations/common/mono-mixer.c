@@ -109,7 +109,6 @@ cl_process (GeglOperation       *operation,
   gint read = gegl_buffer_cl_iterator_add (i, input, result, in_format,  GEGL_CL_BUFFER_READ);
   while (gegl_buffer_cl_iterator_next (i, &err))
   {
-    if (err) return FALSE;
     for (j=0; j < i->n; j++)
     {
       cl_err = cl_mono_mixer(i->tex[read][j], i->tex[0][j], i->size[0][j], &i->roi[0][j], o->red ,o->green , o->blue);
@@ -117,11 +116,14 @@ cl_process (GeglOperation       *operation,
       if (cl_err != CL_SUCCESS)
       {
         g_warning("[OpenCL] Error %s in gegl:mono-mixer", gegl_cl_errstring(cl_err));
+        gegl_buffer_cl_iterator_stop (i);
         return FALSE;
       }
     }
   }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 
@@ -339,7 +339,6 @@ cl_process (GeglOperation       *operation,
 
   while (gegl_buffer_cl_iterator_next (i, &err))
   {
-    if (err) return FALSE;
     for (j=0; j < i->n; j++)
       {
         cl_err = cl_noise_reduction(i->tex[read][j],
@@ -352,11 +351,14 @@ cl_process (GeglOperation       *operation,
         if (cl_err != CL_SUCCESS)
         {
           g_warning("[OpenCL] Error in noise-reduction");
+          gegl_buffer_cl_iterator_stop (i);
           return FALSE;
         }
       }
   }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 #define INPLACE 1
@@ -0,0 +1,64 @@
+/* GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Helpers for the loops of the iterative solvers of the tone mapping
+ * operations.  Loops are split between threads with OpenMP when the
+ * compiler supports it.
+ *
+ * An OpenMP reduction adds the partial sums of the threads in whatever order
+ * they finish, which makes the result depend on the number of threads.
+ * Reductions here sum fixed blocks of PARALLEL_REDUCE_BLOCK values instead,
+ * in parallel, and then add the block sums in order.  The result is the same
+ * whatever the number of threads.
+ */
+
+#include "gegl-openmp.h"
+
+#define PARALLEL_REDUCE_BLOCK 4096
+
+/* sum of a[i] * b[i], i in [0, n) */
+static inline gdouble
+parallel_reduce_dot (glong         n,
+                     const gfloat *a,
+                     const gfloat *b)
+{
+  glong    n_blocks = (n + PARALLEL_REDUCE_BLOCK - 1) / PARALLEL_REDUCE_BLOCK;
+  gdouble  stack_sums[64];
+  gdouble *sums = n_blocks > G_N_ELEMENTS (stack_sums) ?
+                    g_new (gdouble, n_blocks) : stack_sums;
+  gdouble  total = 0.0;
+  glong    block;
+
+  _OMP (omp parallel for schedule(static))
+  for (block = 0; block < n_blocks; block++)
+    {
+      glong   start = block * PARALLEL_REDUCE_BLOCK;
+      glong   end   = MIN (start + PARALLEL_REDUCE_BLOCK, n);
+      gdouble sum   = 0.0;
+      glong   i;
+
+      for (i = start; i < end; i++)
+        sum += (gdouble) a[i] * b[i];
+
+      sums[block] = sum;
+    }
+
+  for (block = 0; block < n_blocks; block++)
+    total += sums[block];
+
+  if (sums != stack_sums)
+    g_free (sums);
+
+  return total;
+}
@@ -260,7 +260,8 @@ reinhard05_process (GeglOperation       *operation,
           channel [RGB],
           normalise;
 
-  gint    i, c;
+  gint     i, c;
+  gboolean success = TRUE;
 
   g_return_val_if_fail (operation, FALSE);
   g_return_val_if_fail (input, FALSE);
@@ -340,7 +341,6 @@ reinhard05_process (GeglOperation       *operation,
 
       while (gegl_buffer_cl_iterator_next (i, &err))
         {
-          if (err) return FALSE;
           for (j=0; j < i->n; j++)
             {
 
@@ -350,12 +350,17 @@ reinhard05_process (GeglOperation       *operation,
               if (cl_err != CL_SUCCESS)
                 {
                   g_warning("[OpenCL] Error in gegl:reinhard05: %s\n", gegl_cl_errstring(cl_err));
-                  return FALSE;
+                  success = FALSE;
+                  break;
                 }
 
               pix_map = gegl_clEnqueueMapBuffer(gegl_cl_get_command_queue(), i->tex[0][j], CL_TRUE, CL_MAP_READ, 0, i->size[0][j] * babl_format_get_bytes_per_pixel (in_format),
                                                 0, NULL, NULL, &cl_err);
-              if (CL_SUCCESS != cl_err) return cl_err;
+              if (CL_SUCCESS != cl_err)
+                {
+                  success = FALSE;
+                  break;
+                }
 
               for (k = 0; k < i->size[0][j]; ++k)
                 {
@@ -367,20 +372,29 @@ reinhard05_process (GeglOperation       *operation,
 
               cl_err = gegl_clEnqueueUnmapMemObject(gegl_cl_get_command_queue(), i->tex[0][j], pix_map,
                                                     0, NULL, NULL);
-              if (CL_SUCCESS != cl_err) return cl_err;
+              if (CL_SUCCESS != cl_err)
+                success = FALSE;
 
             }
+          if (!success)
+            {
+              gegl_buffer_cl_iterator_stop (i);
+              break;
+            }
         }
+      /* the iterator is already freed when it failed */
+      if (err)
+        success = FALSE;
       }
 
       /* Normalise the pixel values */
       reinhard05_stats_finish (&normalise);
+      if (success)
       {
       GeglBufferClIterator *i = gegl_buffer_cl_iterator_new (output, result, out_format, GEGL_CL_BUFFER_WRITE);
       gint read = gegl_buffer_cl_iterator_add (i, pix_out, result, in_format,  GEGL_CL_BUFFER_READ);
       while (gegl_buffer_cl_iterator_next (i, &err))
         {
-          if (err) return FALSE;
           for (j=0; j < i->n; j++)
             {
 
@@ -389,12 +403,20 @@ reinhard05_process (GeglOperation       *operation,
               if (cl_err != CL_SUCCESS)
                 {
                   g_warning("[OpenCL] Error in gegl:reinhard05: %s\n", gegl_cl_errstring(cl_err));
-                  return FALSE;
-
+                  success = FALSE;
+                  break;
                 }
 
             }
+          if (!success)
+            {
+              gegl_buffer_cl_iterator_stop (i);
+              break;
+            }
         }
+      /* the iterator is already freed when it failed */
+      if (err)
+        success = FALSE;
       }
 
       gegl_buffer_destroy (pix_out);
@@ -448,7 +470,7 @@ reinhard05_process (GeglOperation       *operation,
   g_free (pix);
   g_free (lum);
 
-  return TRUE;
+  return success;
 }
 
 
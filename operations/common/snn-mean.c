@@ -37,11 +37,12 @@ gegl_chant_int (pairs, _("Pairs"), 1, 2, 2,
 #include <math.h>
 
 static void
-snn_mean (GeglBuffer          *src,
-          GeglBuffer          *dst,
+snn_mean (GeglOperation       *operation,
+          const gfloat        *src_buf,
+          const GeglRectangle *src_rect,
+          gfloat              *dst_buf,
           const GeglRectangle *dst_rect,
-          gdouble              radius,
-          gint                 pairs);
+          gpointer             user_data);
 
 
 static void prepare (GeglOperation *operation)
@@ -59,7 +60,7 @@ static void prepare (GeglOperation *operation)
 #define RGB_LUMINANCE_GREEN  (0.715160)
 #define RGB_LUMINANCE_BLUE   (0.072169)
 
-static inline gfloat rgb2luminance (gfloat *pix)
+static inline gfloat rgb2luminance (const gfloat *pix)
 {
   return pix[0] * RGB_LUMINANCE_RED +
          pix[1] * RGB_LUMINANCE_GREEN +
@@ -68,8 +69,8 @@ static inline gfloat rgb2luminance (gfloat *pix)
 
 #define POW2(a)((a)*(a))
 
-static inline gfloat colordiff (gfloat *pixA,
-                                gfloat *pixB)
+static inline gfloat colordiff (const gfloat *pixA,
+                                const gfloat *pixB)
 {
   return POW2(pixA[0]-pixB[0])+
          POW2(pixA[1]-pixB[1])+
@@ -78,30 +79,26 @@ static inline gfloat colordiff (gfloat *pixA,
 
 
 static void
-snn_mean (GeglBuffer          *src,
-          GeglBuffer          *dst,
+snn_mean (GeglOperation       *operation,
+          const gfloat        *src_buf,
+          const GeglRectangle *src_rect,
+          gfloat              *dst_buf,
           const GeglRectangle *dst_rect,
-          gdouble              dradius,
-          gint                 pairs)
+          gpointer             user_data)
 {
+  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
   gint x,y;
   gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
-  gint radius = dradius;
-  gint src_width = gegl_buffer_get_width (src);
-  gint src_height = gegl_buffer_get_height (src);
-
-  src_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (src) * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, NULL, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
+  gint radius = o->radius;
+  gint pairs = o->pairs;
+  gint src_width = src_rect->width;
+  gint src_height = src_rect->height;
 
   offset = 0;
 
   for (y=0; y<dst_rect->height; y++)
     {
-      gfloat *center_pix;
+      const gfloat *center_pix;
 
       center_pix = src_buf + ((radius) + (y+radius)* src_width)*4;
 
@@ -116,7 +113,7 @@ snn_mean (GeglBuffer          *src,
           for (v=-radius;v<=0;v++)
             for (u=-radius;u<= (pairs==1?radius:0);u++)
               {
-                gfloat *selected_pix = center_pix;
+                const gfloat *selected_pix = center_pix;
                 gfloat  best_diff = 1000.0;
                 gint    i;
 
@@ -144,7 +141,7 @@ snn_mean (GeglBuffer          *src,
                         if (xs[i] >= 0 && xs[i] < src_width &&
                             ys[i] >= 0 && ys[i] < src_height)
                           {
-                            gfloat *tpix = src_buf + (xs[i]+ys[i]* src_width)*4;
+                            const gfloat *tpix = src_buf + (xs[i]+ys[i]* src_width)*4;
                             gfloat diff = colordiff (tpix, center_pix);
                             if (diff < best_diff)
                               {
@@ -174,10 +171,6 @@ snn_mean (GeglBuffer          *src,
           center_pix += 4;
         }
     }
-  gegl_buffer_set (dst, dst_rect, babl_format ("RGBA float"), dst_buf,
-                   GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
 }
 
 
@@ -299,6 +292,73 @@ static const char* kernel_source =
 "        return;                                                       \n"
 "    }                                                                 \n"
 "    return;                                                           \n"
+"}                                                                     \n"
+
+/* variant staging the neighbourhood in __local memory, for two pairs */
+GEGL_CL_TILE_SOURCE
+"__kernel void snn_mean_tiled (__global const   float4 *src_buf,       \n"
+"                                               int src_width,         \n"
+"                                               int src_height,        \n"
+"                              __global         float4 *dst_buf,       \n"
+"                                               int dst_width,         \n"
+"                                               int dst_height,        \n"
+"                                               int radius,            \n"
+"                              __local          float4 *tile)          \n"
+"{                                                                     \n"
+"    int gidx       = get_global_id(0);                                \n"
+"    int gidy       = get_global_id(1);                                \n"
+"    int x0         = get_group_id(0) * get_local_size(0);             \n"
+"    int y0         = get_group_id(1) * get_local_size(1);             \n"
+"    int tile_width = get_local_size(0) + 2 * radius;                  \n"
+"                                                                      \n"
+"    gegl_cl_tile_load (src_buf, src_width, src_height,                \n"
+"                       tile, tile_width,                              \n"
+"                       get_local_size(1) + 2 * radius, x0, y0);       \n"
+"                                                                      \n"
+"    if (gidx >= dst_width || gidy >= dst_height)                      \n"
+"        return;                                                       \n"
+"                                                                      \n"
+"    float4 center_pix =                                               \n"
+"        tile[(gidx - x0 + radius) + (gidy - y0 + radius) * tile_width];\n"
+"    float4 accumulated=0;                                             \n"
+"                                                                      \n"
+"    int count=0;                                                      \n"
+"    for(int i=-radius;i<0;i++)                                        \n"
+"    {                                                                 \n"
+"        for(int j=-radius;j<0;j++)                                    \n"
+"        {                                                             \n"
+"            float4 selected_pix = center_pix;                         \n"
+"            float  best_diff = 1000.0f;                               \n"
+"                                                                      \n"
+"            int xs[4]={                                               \n"
+"                gidx+j+radius, gidx-j+radius,                         \n"
+"                gidx-j+radius, gidx+j+radius                          \n"
+"            };                                                        \n"
+"            int ys[4]={                                               \n"
+"                gidy+i+radius, gidy-i+radius,                         \n"
+"                gidy+i+radius, gidy-i+radius};                        \n"
+"                                                                      \n"
+"            for (int k=0;k<4;k++)                                     \n"
+"            {                                                         \n"
+"                if (xs[k] >= 0 && xs[k] < src_width &&                \n"
+"                    ys[k] >= 0 && ys[k] < src_height)                 \n"
+"                {                                                     \n"
+"                    float4 tpix =                                     \n"
+"                        tile[(xs[k] - x0) + (ys[k] - y0) * tile_width];\n"
+"                    float diff=colordiff(tpix, center_pix);           \n"
+"                    if (diff < best_diff)                             \n"
+"                    {                                                 \n"
+"                        best_diff = diff;                             \n"
+"                        selected_pix = tpix;                          \n"
+"                    }                                                 \n"
+"                }                                                     \n"
+"            }                                                         \n"
+"                                                                      \n"
+"            accumulated += selected_pix;                              \n"
+"            ++count;                                                  \n"
+"        }                                                             \n"
+"    }                                                                 \n"
+"    dst_buf[gidx + gidy * dst_width] = accumulated/count;             \n"
 "}                                                                     \n";
 
 
@@ -317,7 +377,7 @@ cl_snn_mean (cl_mem                in_tex,
 
   if (!cl_data)
     {
-      const char *kernel_name[] = {"snn_mean_CL", NULL};
+      const char *kernel_name[] = {"snn_mean_CL", "snn_mean_tiled", NULL};
       cl_data = gegl_cl_compile_and_build (kernel_source, kernel_name);
     }
 
@@ -327,6 +387,22 @@ cl_snn_mean (cl_mem                in_tex,
   global_ws[0] = roi->width;
   global_ws[1] = roi->height;
 
+  if (pairs == 2 &&
+      gegl_cl_tune_local_fits (cl_data->kernel[1], 2 * radius, 2 * radius))
+    {
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 0, sizeof(cl_mem),   (void*)&in_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 1, sizeof(cl_int),   (void*)&src_rect->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 2, sizeof(cl_int),   (void*)&src_rect->height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 3, sizeof(cl_mem),   (void*)&out_tex);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 4, sizeof(cl_int),   (void*)&roi->width);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 5, sizeof(cl_int),   (void*)&roi->height);
+      cl_err |= gegl_clSetKernelArg(cl_data->kernel[1], 6, sizeof(cl_int),   (void*)&radius);
+      if (cl_err != CL_SUCCESS) return cl_err;
+
+      return gegl_cl_tune_enqueue_local (cl_data->kernel[1], global_ws,
+                                         2 * radius, 2 * radius, 7);
+    }
+
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 0, sizeof(cl_mem),   (void*)&in_tex);
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 1, sizeof(cl_int),   (void*)&src_rect->width);
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 2, sizeof(cl_int),   (void*)&src_rect->height);
@@ -335,10 +411,7 @@ cl_snn_mean (cl_mem                in_tex,
   cl_err |= gegl_clSetKernelArg(cl_data->kernel[0], 5, sizeof(cl_int),   (void*)&pairs);
   if (cl_err != CL_SUCCESS) return cl_err;
 
-  cl_err = gegl_clEnqueueNDRangeKernel(gegl_cl_get_command_queue (),
-                                        cl_data->kernel[0], 2,
-                                        NULL, global_ws, NULL,
-                                        0, NULL, NULL);
+  cl_err = gegl_cl_tune_enqueue (cl_data->kernel[0], global_ws);
   if (cl_err != CL_SUCCESS) return cl_err;
 
   return cl_err;
@@ -363,18 +436,20 @@ cl_process (GeglOperation       *operation,
                 gint read = gegl_buffer_cl_iterator_add_2 (i, input, result, in_format,  GEGL_CL_BUFFER_READ, op_area->left, op_area->right, op_area->top, op_area->bottom);
   while (gegl_buffer_cl_iterator_next (i, &err))
     {
-      if (err) return FALSE;
       for (j=0; j < i->n; j++)
         {
           cl_err = cl_snn_mean(i->tex[read][j], i->tex[0][j], &i->roi[read][j], &i->roi[0][j], ceil(o->radius), o->pairs);
           if (cl_err != CL_SUCCESS)
             {
               g_warning("[OpenCL] Error %s gegl:snn-mean", gegl_cl_errstring(cl_err));
+              gegl_buffer_cl_iterator_stop (i);
               return FALSE;
             }
         }
     }
-  return TRUE;
+
+  /* the iterator is already freed when it failed */
+  return !err;
 }
 
 static gboolean
@@ -383,30 +458,20 @@ process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result)
 {
-  GeglRectangle rect;
   GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglBuffer *temp;
-  GeglOperationAreaFilter *op_area;
-  op_area = GEGL_OPERATION_AREA_FILTER (operation);
 
   if (cl_state.is_accelerated)
     if (cl_process (operation, input, output, result))
       return TRUE;
 
-  GeglRectangle compute;
-  compute = gegl_operation_get_required_for_output(operation, "input", result);
-
   if (o->radius < 1.0)
-  {
-    output = g_object_ref (input);
-  }
-  else
-  {
-    temp = gegl_buffer_create_sub_buffer (input, &compute);
-       snn_mean (temp, output, result, o->radius, o->pairs);
-  }
-  g_object_unref (temp);
-  return  TRUE;
+    {
+      gegl_buffer_copy (input, result, output, result);
+      return TRUE;
+    }
+
+  return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                    0, snn_mean, NULL);
 }
 
 
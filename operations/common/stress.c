@@ -54,44 +54,42 @@ gegl_chant_double (rgamma, _("Radial Gamma"), 0.0, 8.0, 2.0,
 #include <math.h>
 #include <stdlib.h>
 #include "envelopes.h"
+#include "parallel-reduce.h"
 
-static void stress (GeglBuffer          *src,
+static void stress (GeglOperation       *operation,
+                    const gfloat        *src_buf,
                     const GeglRectangle *src_rect,
-                    GeglBuffer          *dst,
+                    gfloat              *dst_buf,
                     const GeglRectangle *dst_rect,
-                    gint                 radius,
-                    gint                 samples,
-                    gint                 iterations,
-                    gdouble              rgamma)
+                    gpointer             user_data)
 {
+  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
+  gint    radius = o->radius;
+  gint    samples = o->samples;
+  gint    iterations = o->iterations;
+  gdouble rgamma = RGAMMA /*o->rgamma*/;
   gint x,y;
-  gint    dst_offset=0;
-  gfloat *src_buf;
-  gfloat *dst_buf;
   gint    inw = src_rect->width;
   gint    inh = src_rect->height;
   gint   outw = dst_rect->width;
 
-  /* this use of huge linear buffers should be avoided and
-   * most probably would lead to great speed ups
+  /* the spray of a pixel only depends on its position, rows can be
+   * computed in parallel
    */
-
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
+  _OMP (omp parallel for private(x) schedule(static))
   for (y=radius; y<dst_rect->height+radius; y++)
     {
       gint src_offset = (inw*y+radius)*4;
+      gint dst_offset = (outw*(y-radius))*4;
       for (x=radius; x<outw+radius; x++)
         {
-          gfloat *center_pix= src_buf + src_offset;
+          const gfloat *center_pix= src_buf + src_offset;
           gfloat  min_envelope[4];
           gfloat  max_envelope[4];
 
           compute_envelopes (src_buf,
                              inw, inh,
+                             src_rect->x, src_rect->y,
                              x, y,
                              radius, samples,
                              iterations,
@@ -119,9 +117,6 @@ static void stress (GeglBuffer          *src,
           dst_offset+=4;
         }
     }
-  gegl_buffer_set (dst, dst_rect, babl_format ("RGBA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
 }
 
 static void prepare (GeglOperation *operation)
@@ -130,8 +125,8 @@ static void prepare (GeglOperation *operation)
   area->left = area->right = area->top = area->bottom =
       ceil (GEGL_CHANT_PROPERTIES (operation)->radius);
 
-  gegl_operation_set_format (operation, "output",
-                             babl_format ("RaGaBaA float"));
+  gegl_operation_set_format (operation, "input", babl_format ("RGBA float"));
+  gegl_operation_set_format (operation, "output", babl_format ("RGBA float"));
 }
 
 static GeglRectangle
@@ -151,17 +146,8 @@ process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result)
 {
-  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglRectangle compute;
-  compute = gegl_operation_get_required_for_output (operation, "input",result);
-
-  stress (input, &compute, output, result,
-          o->radius,
-          o->samples,
-          o->iterations,
-          RGAMMA /*o->rgamma,*/);
-
-  return  TRUE;
+  return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                    0, stress, NULL);
 }
 
 
@@ -50,35 +50,32 @@ inner_process (gdouble  min,
   return TRUE;
 }
 
+/* the extrema of the color components of the whole input, computed once
+ * for all the chunks of the output
+ */
 static void
-buffer_get_min_max (GeglBuffer *buffer,
-                    gdouble    *min,
-                    gdouble    *max)
+buffer_get_min_max (GeglOperation *operation,
+                    GeglBuffer    *buffer,
+                    gdouble       *min,
+                    gdouble       *max)
 {
-  gfloat tmin = 9000000.0;
-  gfloat tmax =-9000000.0;
+  const GeglRectangle *bound = gegl_operation_source_get_bounding_box (operation,
+                                                                       "input");
+  GeglStatistics      *stats;
+  gint                 component;
+
+  stats = gegl_operation_get_statistics (operation, buffer, bound,
+                                         babl_format ("RGBA float"), 0);
 
-  gfloat *buf = g_new0 (gfloat, 4 * gegl_buffer_get_pixel_count (buffer));
-  gint i;
-  gegl_buffer_get (buffer, 1.0, NULL, babl_format ("RGBA float"), buf, GEGL_AUTO_ROWSTRIDE);
-  for (i=0;i< gegl_buffer_get_pixel_count (buffer);i++)
+  *min = stats->min[0];
+  *max = stats->max[0];
+  for (component=1; component<3; component++)
     {
-      gint component;
-      for (component=0; component<3; component++)
-        {
-          gfloat val = buf[i*4+component];
-
-          if (val<tmin)
-            tmin=val;
-          if (val>tmax)
-            tmax=val;
-        }
+      *min = MIN (*min, stats->min[component]);
+      *max = MAX (*max, stats->max[component]);
     }
-  g_free (buf);
-  if (min)
-    *min = tmin;
-  if (max)
-    *max = tmax;
+
+  gegl_statistics_free (stats);
 }
 
 static void prepare (GeglOperation *operation)
@@ -104,7 +101,7 @@ process (GeglOperation       *operation,
 {
   gdouble  min, max;
 
-  buffer_get_min_max (input, &min, &max);
+  buffer_get_min_max (operation, input, &min, &max);
   {
     gint row;
     gfloat *buf;
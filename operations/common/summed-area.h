@@ -0,0 +1,184 @@
+/* GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Summed area tables of the RGBA components of a rectangle of a buffer,
+ * the sum (and optionally the sum of squares) of any window of that
+ * rectangle costs four lookups.  Sums are kept in double precision so
+ * they stay exact enough for the rectangles an area filter asks for.
+ *
+ * Only the given rectangle is read, a strip of tile rows at a time, or the
+ * table is built from pixels already in memory.
+ */
+
+typedef struct
+{
+  GeglRectangle  rect;    /* area covered, in buffer coordinates */
+  gint           stride;  /* doubles per row of the tables */
+  gdouble       *sum;     /* (width + 1) x (height + 1) RGBA, the first
+                           * row and column are zero
+                           */
+  gdouble       *sum_sq;  /* the same for the squares, or NULL */
+} SummedArea;
+
+static inline SummedArea *
+summed_area_alloc (const GeglRectangle *rect,
+                   gboolean             squares)
+{
+  SummedArea *area = g_new0 (SummedArea, 1);
+
+  area->rect   = *rect;
+  area->stride = (rect->width + 1) * 4;
+  area->sum    = g_new0 (gdouble, area->stride * (rect->height + 1));
+  if (squares)
+    area->sum_sq = g_new0 (gdouble, area->stride * (rect->height + 1));
+
+  return area;
+}
+
+/* accumulates row y of the rectangle, the rows above it are done */
+static inline void
+summed_area_add_row (SummedArea   *area,
+                     gint          y,
+                     const gfloat *src)
+{
+  const gdouble *up   = area->sum + y * area->stride;
+  gdouble       *row  = area->sum + (y + 1) * area->stride;
+  gdouble        acc[4] = { 0.0, 0.0, 0.0, 0.0 };
+  gint           x, c;
+
+  for (x = 0; x < area->rect.width; x++)
+    for (c = 0; c < 4; c++)
+      {
+        acc[c] += src[x * 4 + c];
+        row[(x + 1) * 4 + c] = up[(x + 1) * 4 + c] + acc[c];
+      }
+
+  if (area->sum_sq)
+    {
+      up  = area->sum_sq + y * area->stride;
+      row = area->sum_sq + (y + 1) * area->stride;
+      acc[0] = acc[1] = acc[2] = acc[3] = 0.0;
+
+      for (x = 0; x < area->rect.width; x++)
+        for (c = 0; c < 4; c++)
+          {
+            acc[c] += (gdouble) src[x * 4 + c] * src[x * 4 + c];
+            row[(x + 1) * 4 + c] = up[(x + 1) * 4 + c] + acc[c];
+          }
+    }
+}
+
+static inline SummedArea *
+summed_area_new (GeglBuffer          *buffer,
+                 const GeglRectangle *rect,
+                 const Babl          *format,
+                 gboolean             squares)
+{
+  SummedArea *area = summed_area_alloc (rect, squares);
+  gint        tile_height;
+  gfloat     *strip;
+  gint        y;
+
+  g_object_get (buffer, "tile-height", &tile_height, NULL);
+  strip = g_new (gfloat, rect->width * tile_height * 4);
+
+  for (y = 0; y < rect->height;)
+    {
+      GeglRectangle strip_rect = { rect->x, rect->y + y, rect->width, 0 };
+      gint          rows, i;
+
+      /* strips end on tile boundaries */
+      rows = tile_height - (((rect->y + y) % tile_height) + tile_height) % tile_height;
+      strip_rect.height = MIN (rows, rect->height - y);
+
+      gegl_buffer_get (buffer, 1.0, &strip_rect, format, strip, GEGL_AUTO_ROWSTRIDE);
+
+      for (i = 0; i < strip_rect.height; i++, y++)
+        summed_area_add_row (area, y, strip + i * rect->width * 4);
+    }
+
+  g_free (strip);
+
+  return area;
+}
+
+/* the table of the packed RGBA float pixels of rect held in src */
+static inline SummedArea *
+summed_area_new_for_data (const gfloat        *src,
+                          const GeglRectangle *rect,
+                          gboolean             squares)
+{
+  SummedArea *area = summed_area_alloc (rect, squares);
+  gint        y;
+
+  for (y = 0; y < rect->height; y++)
+    summed_area_add_row (area, y, src + y * rect->width * 4);
+
+  return area;
+}
+
+static inline void
+summed_area_free (SummedArea *area)
+{
+  g_free (area->sum);
+  g_free (area->sum_sq);
+  g_free (area);
+}
+
+/* sums of the pixels x in [x0, x0 + width), y in [y0, y0 + height),
+ * relative to the origin of the rectangle and clipped to it.  sum_sq may
+ * be NULL, returns the number of pixels summed.
+ */
+static inline gint
+summed_area_get (SummedArea *area,
+                 gint        x0,
+                 gint        y0,
+                 gint        width,
+                 gint        height,
+                 gdouble    *sum,
+                 gdouble    *sum_sq)
+{
+  gint x1 = MIN (x0 + width, area->rect.width);
+  gint y1 = MIN (y0 + height, area->rect.height);
+  gint a, b, c, d, i;
+
+  x0 = MAX (x0, 0);
+  y0 = MAX (y0, 0);
+
+  if (x1 <= x0 || y1 <= y0)
+    {
+      for (i = 0; i < 4; i++)
+        {
+          sum[i] = 0.0;
+          if (sum_sq)
+            sum_sq[i] = 0.0;
+        }
+      return 0;
+    }
+
+  a = y0 * area->stride + x0 * 4;
+  b = y0 * area->stride + x1 * 4;
+  c = y1 * area->stride + x0 * 4;
+  d = y1 * area->stride + x1 * 4;
+
+  for (i = 0; i < 4; i++)
+    {
+      sum[i] = area->sum[d + i] - area->sum[b + i] - area->sum[c + i] + area->sum[a + i];
+      if (sum_sq)
+        sum_sq[i] = area->sum_sq[d + i] - area->sum_sq[b + i] -
+                    area->sum_sq[c + i] + area->sum_sq[a + i];
+    }
+
+  return (x1 - x0) * (y1 - y0);
+}
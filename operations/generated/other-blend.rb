@@ -1,5 +1,7 @@
 #!/usr/bin/env ruby
 
+require File.expand_path('simd', File.dirname(__FILE__))
+
 copyright = '
 /* !!!! AUTOGENERATED FILE generated by other-blend.rb !!!!!
  *
@@ -92,7 +94,7 @@ gegl_chant_class_init (GeglChantClass *klass)
 
   point_composer_class->process = process;
   operation_class->prepare = prepare;
-'
+' + SIMD_REGISTRATION
 
 file_tail2 = '  operation_class->categories  = "compositors:porter-duff";
 }
@@ -149,8 +151,8 @@ a.each do
     }
   return TRUE;
 }
-
 "
+  file.write simd_processors(c_formula, a_formula)
   file.write file_tail1
   file.write "
   operation_class->name        = \"gegl:#{name}\";
@@ -0,0 +1,377 @@
+#!/usr/bin/env ruby
+
+# SSE and AVX versions of the compositor formulas, shared by the generators.
+#
+# The formulas are C expressions of cA, cB, aA, aB and aD.  simd_expression
+# turns one into the same expression of __m128 values with SSE intrinsics,
+# or of __m256 values with AVX ones: arithmetic, comparisons, MIN, MAX,
+# CLAMP and sqrt map to their packed instructions and a ? b : c selects
+# with the mask of a.  Both sides of a selection are computed, values of
+# the lanes not selected (divisions by zero included) are dropped.
+#
+# simd_loop computes four pixels at a time, eight with AVX: they are
+# transposed into one vector per component, so each formula is evaluated
+# once for all of them.
+#
+# The SSE loop is built when configure enables SSE and registered as the
+# "simd" processor, the AVX one when the compiler targets AVX (-mavx or a
+# -march having it) and registered as "avx", which is preferred to "simd".
+
+class SimdExpression
+  COMPARE = { '>'  => '_mm_cmpgt_ps', '<'  => '_mm_cmplt_ps',
+              '>=' => '_mm_cmpge_ps', '<=' => '_mm_cmple_ps',
+              '==' => '_mm_cmpeq_ps' }
+
+  AVX_COMPARE = { '>'  => '_CMP_GT_OQ', '<'  => '_CMP_LT_OQ',
+                  '>=' => '_CMP_GE_OQ', '<=' => '_CMP_LE_OQ',
+                  '==' => '_CMP_EQ_OQ' }
+
+  def initialize (formula, avx = false)
+    @formula = formula
+    @avx     = avx
+    @tokens  = formula.scan(/\d+\.\d*f?|\d+f?|[A-Za-z_]\w*|>=|<=|==|[-+*\/()<>?:,]/)
+    @pos     = 0
+  end
+
+  def parse
+    expression = conditional
+    fail "#{@formula}: unexpected #{peek}" if peek
+    expression
+  end
+
+  private
+
+  # the packed instruction name of the target, _mm_add_ps or _mm256_add_ps
+  def op (name)
+    "#{@avx ? '_mm256' : '_mm'}_#{name}_ps"
+  end
+
+  def peek
+    @tokens[@pos]
+  end
+
+  def take (expected = nil)
+    token = @tokens[@pos]
+    fail "#{@formula}: expected #{expected}, got #{token}" if expected && token != expected
+    @pos += 1
+    token
+  end
+
+  def conditional
+    mask = comparison
+    return mask unless peek == '?'
+    take '?'
+    yes = conditional
+    take ':'
+    no = conditional
+    return "_mm256_blendv_ps (#{no}, #{yes}, #{mask})" if @avx
+    "simd_select (#{mask}, #{yes}, #{no})"
+  end
+
+  def comparison
+    left = sum
+    while COMPARE[peek]
+      compare = take
+      if @avx
+        left = "_mm256_cmp_ps (#{left}, #{sum}, #{AVX_COMPARE[compare]})"
+      else
+        left = "#{COMPARE[compare]} (#{left}, #{sum})"
+      end
+    end
+    left
+  end
+
+  def sum
+    left = product
+    while peek == '+' || peek == '-'
+      name = take == '+' ? op('add') : op('sub')
+      left = "#{name} (#{left}, #{product})"
+    end
+    left
+  end
+
+  def product
+    left = unary
+    while peek == '*' || peek == '/'
+      name = take == '*' ? op('mul') : op('div')
+      left = "#{name} (#{left}, #{unary})"
+    end
+    left
+  end
+
+  def unary
+    return primary unless peek == '-'
+    take '-'
+    "#{op('sub')} (#{op('setzero')} (), #{unary})"
+  end
+
+  def arguments (count)
+    take '('
+    args = [conditional]
+    (count - 1).times { take ','; args << conditional }
+    take ')'
+    args
+  end
+
+  def primary
+    token = take
+    case token
+    when '('
+      expression = conditional
+      take ')'
+      expression
+    when /^\d/
+      number = token.sub(/f$/, '')
+      number += '.0' unless number.include? '.'
+      "#{op('set1')} (#{number}f)"
+    when 'MIN'
+      "#{op('min')} (%s, %s)" % arguments(2)
+    when 'MAX'
+      "#{op('max')} (%s, %s)" % arguments(2)
+    when 'CLAMP'
+      "#{op('min')} (#{op('max')} (%s, %s), %s)" % arguments(3)
+    when 'sqrt'
+      "#{op('sqrt')} (%s)" % arguments(1)
+    when /^[A-Za-z_]/
+      token
+    else
+      fail "#{@formula}: unexpected #{token}"
+    end
+  end
+end
+
+def simd_expression (formula, avx = false)
+  SimdExpression.new(formula, avx).parse
+end
+
+# Written before the simd loops, in the files of the operations and in the
+# headers of test-simd-composers.
+SIMD_HELPERS = '
+#include <xmmintrin.h>
+
+#define SIMD_BLOCK 4
+
+/* the lanes of a where mask is set, the lanes of b elsewhere */
+static inline __m128
+simd_select (__m128 mask,
+             __m128 a,
+             __m128 b)
+{
+  return _mm_or_ps (_mm_and_ps (mask, a), _mm_andnot_ps (mask, b));
+}
+'
+
+# Written before the avx loops.  A vector holds two pixels four apart, one
+# in each half, the halves are transposed as the four pixels of the SSE
+# loop are.
+AVX_HELPERS = '
+#include <immintrin.h>
+
+#define AVX_BLOCK 8
+
+/* pixel 0 in the low half, pixel 4 in the high half */
+static inline __m256
+avx_load (const gfloat *pixel)
+{
+  return _mm256_insertf128_ps (_mm256_castps128_ps256 (_mm_loadu_ps (pixel)),
+                               _mm_loadu_ps (pixel + 16), 1);
+}
+
+static inline void
+avx_store (gfloat *pixel,
+           __m256  v)
+{
+  _mm_storeu_ps (pixel, _mm256_castps256_ps128 (v));
+  _mm_storeu_ps (pixel + 16, _mm256_extractf128_ps (v, 1));
+}
+
+/* _MM_TRANSPOSE4_PS of both halves */
+static inline void
+avx_transpose (__m256 v[4])
+{
+  __m256 t0 = _mm256_unpacklo_ps (v[0], v[1]);
+  __m256 t1 = _mm256_unpackhi_ps (v[0], v[1]);
+  __m256 t2 = _mm256_unpacklo_ps (v[2], v[3]);
+  __m256 t3 = _mm256_unpackhi_ps (v[2], v[3]);
+
+  v[0] = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (1, 0, 1, 0));
+  v[1] = _mm256_shuffle_ps (t0, t2, _MM_SHUFFLE (3, 2, 3, 2));
+  v[2] = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (1, 0, 1, 0));
+  v[3] = _mm256_shuffle_ps (t1, t3, _MM_SHUFFLE (3, 2, 3, 2));
+}
+'
+
+# The loop of process_simd () or process_avx (), computing blocks of
+# SIMD_BLOCK or AVX_BLOCK pixels.  done is the number of pixels computed,
+# in, aux and out are left pointing at the first pixel left over.
+def simd_loop (c_formula, a_formula, avx = false)
+  vector  = avx ? '__m256' : '__m128'
+  block   = avx ? 'AVX_BLOCK' : 'SIMD_BLOCK'
+  uses    = lambda { |formula, name| formula =~ /\b#{name}\b/ }
+  alphas  = ['aA', 'aB'].select { |name|
+    uses.call(a_formula, name) || uses.call(c_formula, name) }
+  colours = [['cA', 'A[j]'], ['cB', 'B[j]']].select { |name, value|
+    uses.call(c_formula, name) }
+
+  alpha_lines  = alphas.map { |name|
+    "      #{name} = #{name == 'aA' ? 'A' : 'B'}[3];\n" }.join
+  colour_lines = colours.map { |name, value|
+    "          #{vector} #{name} = #{value};\n" }.join
+  colour_lines += "\n" unless colour_lines.empty?
+
+  if avx
+    load = "
+      for (j = 0; j < 4; j++)
+        {
+          A[j] = avx_load (aux + j * 4);
+          B[j] = avx_load (in + j * 4);
+        }
+
+      /* one vector per component, holding it for the eight pixels */
+      avx_transpose (A);
+      avx_transpose (B);
+"
+    store = "
+      avx_transpose (D);
+
+      for (j = 0; j < 4; j++)
+        avx_store (out + j * 4, D[j]);
+"
+  else
+    load = "
+      for (j = 0; j < 4; j++)
+        {
+          A[j] = _mm_loadu_ps (aux + j * 4);
+          B[j] = _mm_loadu_ps (in + j * 4);
+        }
+
+      /* one vector per component, holding it for the four pixels */
+      _MM_TRANSPOSE4_PS (A[0], A[1], A[2], A[3]);
+      _MM_TRANSPOSE4_PS (B[0], B[1], B[2], B[3]);
+"
+    store = "
+      _MM_TRANSPOSE4_PS (D[0], D[1], D[2], D[3]);
+
+      for (j = 0; j < 4; j++)
+        _mm_storeu_ps (out + j * 4, D[j]);
+"
+  end
+
+  "
+  for (done = 0; done + #{block} <= n_pixels; done += #{block})
+    {
+      #{vector} A[4], B[4], D[4];
+      #{vector} #{(alphas + ['aD']).join(', ')};
+      gint   j;
+#{load}
+#{alpha_lines}      aD = #{simd_expression(a_formula, avx)};
+
+      for (j = 0; j < 3; j++)
+        {
+#{colour_lines}          D[j] = #{simd_expression(c_formula, avx)};
+        }
+      D[3] = aD;
+#{store}
+      in  += #{block} * 4;
+      aux += #{block} * 4;
+      out += #{block} * 4;
+    }
+"
+end
+
+# process_simd () and process_avx () of an operation, computing the pixels
+# left over with process ().
+def simd_processors (c_formula, a_formula)
+  [['USE_SSE', 'simd', SIMD_HELPERS, 'four', false],
+   ['__AVX__', 'avx',  AVX_HELPERS,  'eight', true]].map {
+    |guard, name, helpers, count, avx|
+    pad = ' ' * name.length
+    "
+#ifdef #{guard}
+#{helpers}
+/* the same computation #{count} pixels at a time, see simd.rb */
+static gboolean
+process_#{name} (GeglOperation       *op,
+#{pad}          void                *in_buf,
+#{pad}          void                *aux_buf,
+#{pad}          void                *out_buf,
+#{pad}          glong                n_pixels,
+#{pad}          const GeglRectangle *roi)
+{
+  gfloat * GEGL_ALIGNED in = in_buf;
+  gfloat * GEGL_ALIGNED aux = aux_buf;
+  gfloat * GEGL_ALIGNED out = out_buf;
+  glong   done;
+
+  if (aux==NULL)
+    return TRUE;
+#{simd_loop(c_formula, a_formula, avx)}
+  /* the pixels left over */
+  return process (op, in, aux, out, n_pixels - done, roi);
+}
+
+#endif
+"
+  }.join
+end
+
+# Registers the processors written by simd_processors, in class_init ().
+SIMD_REGISTRATION = '#ifdef USE_SSE
+  gegl_operation_class_add_processor (operation_class,
+                                      G_CALLBACK (process_simd), "simd");
+#endif
+#ifdef __AVX__
+  gegl_operation_class_add_processor (operation_class,
+                                      G_CALLBACK (process_avx), "avx");
+#endif
+'
+
+# The helpers of both loops, for the headers of test-simd-composers, which
+# include two of them.
+SIMD_KERNEL_HELPERS = "
+#ifndef SIMD_BLOCK#{SIMD_HELPERS}#endif
+
+#if defined (__AVX__) && !defined (AVX_BLOCK)#{AVX_HELPERS}#endif
+"
+
+# The simd and avx loops of an operation as functions of their own, for
+# test-simd-composers, computing the pixels left over with
+# <name>_reference ().
+def simd_kernel_functions (name, c_formula, a_formula)
+  [['simd', false], ['avx', true]].map { |suffix, avx|
+    pad = ' ' * (name.length + suffix.length + 1)
+    function = "
+static void
+#{name}_#{suffix} (gfloat *in,
+#{pad}  gfloat *aux,
+#{pad}  gfloat *out,
+#{pad}  glong   n_pixels)
+{
+  glong done;
+#{simd_loop(c_formula, a_formula, avx)}
+  #{name}_reference (in, aux, out, n_pixels - done);
+}
+"
+    avx ? "\n#ifdef __AVX__#{function}#endif\n" : function
+  }.join
+end
+
+# The tables of kernels of test-simd-composers, the simd loops and, when
+# the compiler targets AVX, the avx loops.
+def simd_kernel_tables (table, names)
+  entries = lambda { |suffix|
+    names.map { |name|
+      "  { \"svg:#{name.gsub(/_/, '-')} #{suffix}\", #{name}_reference, #{name}_#{suffix} },\n"
+    }.join }
+  "
+static const SimdKernel #{table}[] =
+{
+#{entries.call('simd')}};
+
+#ifdef __AVX__
+static const SimdKernel #{table.sub(/_kernels$/, '_avx_kernels')}[] =
+{
+#{entries.call('avx')}};
+#endif
+"
+end
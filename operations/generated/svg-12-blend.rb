@@ -1,5 +1,7 @@
 #!/usr/bin/env ruby
 
+require File.expand_path('simd', File.dirname(__FILE__))
+
 copyright = '
 /* !!!! AUTOGENERATED FILE generated by svg12-blend.rb !!!!!
  *
@@ -111,7 +113,9 @@ process (GeglOperation       *op,
 file_tail1 = '
   return TRUE;
 }
+'
 
+file_class_head = '
 static void
 gegl_chant_class_init (GeglChantClass *klass)
 {
@@ -123,7 +127,7 @@ gegl_chant_class_init (GeglChantClass *klass)
 
   point_composer_class->process = process;
   operation_class->prepare = prepare;
-'
+' + SIMD_REGISTRATION
 
 file_tail2 = '  operation_class->categories  = "compositors:svgfilter";
 }
@@ -131,6 +135,28 @@ file_tail2 = '  operation_class->categories  = "compositors:svgfilter";
 #endif
 '
 
+# The reference, simd and avx loops of an operation as functions of their own,
+# for test-simd-composers in tests/simple
+def kernel_functions (name, loop, c_formula, a_formula)
+  pad = ' ' * name.length
+  "
+static void
+#{name}_reference (gfloat *in,
+#{pad}            gfloat *aux,
+#{pad}            gfloat *out,
+#{pad}            glong   n_pixels)
+{
+  gint i;
+#{loop}}
+" + simd_kernel_functions(name, c_formula, a_formula)
+end
+
+kernels = File.open('svg-12-blend-kernels.h', 'w')
+kernels.write copyright.sub('This file is an image processing operation for GEGL',
+                            'This file is part of the tests of GEGL')
+kernels.write "
+" + SIMD_KERNEL_HELPERS
+
 a.each do
     |item|
 
@@ -145,6 +171,9 @@ a.each do
     swapcased   = name.swapcase
     formula1    = item[1]
 
+    c_formula   = "CLAMP (#{formula1}, 0, aD)"
+    a_formula   = 'aA + aB - aA * aB'
+
     file.write copyright
     file.write file_head1
     file.write "
@@ -154,7 +183,7 @@ a.each do
 #include \"gegl-chant.h\"
 "
     file.write file_head2
-    file.write "
+    loop = "
   for (i = 0; i < n_pixels; i++)
     {
       gfloat aA, aB, aD;
@@ -178,7 +207,10 @@ a.each do
       out += 4;
     }
 "
+    file.write loop
   file.write file_tail1
+  file.write simd_processors(c_formula, a_formula)
+  file.write file_class_head
   file.write "
   operation_class->compat_name = \"gegl:#{name}\";
   operation_class->name        = \"svg:#{name}\";
@@ -187,6 +219,8 @@ a.each do
 "
   file.write file_tail2
   file.close
+
+  kernels.write kernel_functions(item[0], loop, c_formula, a_formula)
 end
 
 b.each do
@@ -205,6 +239,9 @@ b.each do
     formula1    = item[2]
     formula2    = item[3]
 
+    c_formula   = "(#{cond1}) ?\n                      CLAMP (#{formula1}, 0, aD) :\n                      CLAMP (#{formula2}, 0, aD)"
+    a_formula   = 'aA + aB - aA * aB'
+
     file.write copyright
     file.write file_head1
     file.write "
@@ -214,7 +251,7 @@ b.each do
 #include \"gegl-chant.h\"
 "
     file.write file_head2
-    file.write "
+    loop = "
   for (i = 0; i < n_pixels; i++)
     {
       gfloat aA, aB, aD;
@@ -241,7 +278,10 @@ b.each do
       out += 4;
     }
 "
+    file.write loop
   file.write file_tail1
+  file.write simd_processors(c_formula, a_formula)
+  file.write file_class_head
   file.write "
   operation_class->compat_name = \"gegl:#{name}\";
   operation_class->name        = \"svg:#{name}\";
@@ -250,6 +290,8 @@ b.each do
 "
   file.write file_tail2
   file.close
+
+  kernels.write kernel_functions(item[0], loop, c_formula, a_formula)
 end
 
 c.each do
@@ -270,6 +312,9 @@ c.each do
     formula2    = item[4]
     formula3    = item[5]
 
+    c_formula   = "(#{cond1}) ?\n                      CLAMP (#{formula1}, 0, aD) :\n                      (#{cond2}) ?\n                      CLAMP (#{formula2}, 0, aD) :\n                      CLAMP (#{formula3}, 0, aD)"
+    a_formula   = 'aA + aB - aA * aB'
+
     file.write copyright
     file.write file_head1
     file.write "
@@ -280,7 +325,7 @@ c.each do
 #include <math.h>
 "
     file.write file_head2
-    file.write "
+    loop = "
   for (i = 0; i < n_pixels; i++)
     {
       gfloat aA, aB, aD;
@@ -309,7 +354,10 @@ c.each do
       out += 4;
     }
 "
+    file.write loop
   file.write file_tail1
+  file.write simd_processors(c_formula, a_formula)
+  file.write file_class_head
   file.write "
   operation_class->name        = \"gegl:#{name}\";
   operation_class->description =
@@ -317,6 +365,8 @@ c.each do
 "
   file.write file_tail2
   file.close
+
+  kernels.write kernel_functions(item[0], loop, c_formula, a_formula)
 end
 
 d.each do
@@ -334,6 +384,9 @@ d.each do
     formula1    = item[1]
     formula2    = item[2]
 
+    c_formula   = "CLAMP (#{formula1}, 0, aD)"
+    a_formula   = formula2
+
     file.write copyright
     file.write file_head1
     file.write "
@@ -343,7 +396,7 @@ d.each do
 #include \"gegl-chant.h\"
 "
     file.write file_head2
-    file.write "
+    loop = "
   for (i = 0; i < n_pixels; i++)
     {
       gfloat aA, aB, aD;
@@ -367,7 +420,10 @@ d.each do
       out += 4;
     }
 "
+    file.write loop
   file.write file_tail1
+  file.write simd_processors(c_formula, a_formula)
+  file.write file_class_head
   file.write "
   operation_class->name        = \"svg:#{name}\";
   operation_class->compat_name = \"gegl:#{name}\";
@@ -376,4 +432,10 @@ d.each do
 "
   file.write file_tail2
   file.close
+
+  kernels.write kernel_functions(item[0], loop, c_formula, a_formula)
 end
+
+kernels.write simd_kernel_tables('svg_12_blend_kernels',
+                                 (a + b + c + d).map { |item| item[0] })
+kernels.close
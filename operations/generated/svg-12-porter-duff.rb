@@ -1,5 +1,7 @@
 #!/usr/bin/env ruby
 
+require File.expand_path('simd', File.dirname(__FILE__))
+
 copyright = '
 /* !!!! AUTOGENERATED FILE generated by svg-12-porter-duff.rb !!!!!
  *
@@ -60,6 +62,7 @@ a = [
 b = [ ['src_in',        'cA * aB',  # the bounding box of this mode is the
                         'aA * aB']]  # bounding box of the input only.
 
+
 file_head1 = '
 #include "config.h"
 #include <glib/gi18n-lib.h>
@@ -112,8 +115,7 @@ gegl_chant_class_init (GeglChantClass *klass)
 
   point_composer_class->process = process;
   operation_class->prepare = prepare;
-
-'
+' + SIMD_REGISTRATION
 
 file_tail2 = '  operation_class->categories  = "compositors:porter-duff";
 }
@@ -121,31 +123,9 @@ file_tail2 = '  operation_class->categories  = "compositors:porter-duff";
 #endif
 '
 
-a.each do
-    |item|
-
-    name     = item[0] + ''
-    name.gsub!(/_/, '-')
-    filename = name + '.c'
-
-    puts "generating #{filename}"
-    file = File.open(filename, 'w')
-
-    capitalized = name.capitalize
-    swapcased   = name.swapcase
-    c_formula   = item[1]
-    a_formula   = item[2]
-
-    file.write copyright
-    file.write file_head1
-    file.write "
-#define GEGL_CHANT_TYPE_POINT_COMPOSER
-#define GEGL_CHANT_C_FILE        \"#{filename}\"
-
-#include \"gegl-chant.h\"
-"
-    file.write file_head2
-    file.write "
+# The loop of process (), computing n_pixels pixels one at a time.
+def scalar_loop (c_formula, a_formula)
+  "
   for (i = 0; i < n_pixels; i++)
     {
       gint   j;
@@ -168,25 +148,17 @@ a.each do
       aux += 4;
       out += 4;
     }
-  return TRUE;
-}
 "
-  file.write file_tail1
-  file.write "
-  operation_class->compat_name = \"gegl:#{name}\";
-  operation_class->name        = \"svg:#{name}\";
-  operation_class->description =
-        _(\"Porter Duff operation #{name} (d = #{c_formula})\");
-"
-  file.write file_tail2
-  file.close
 end
 
+# Both loops of every operation, for test-simd-composers in tests/simple
+kernels = File.open('svg-12-porter-duff-kernels.h', 'w')
+kernels.write copyright.sub('This file is an image processing operation for GEGL',
+                            'This file is part of the tests of GEGL')
+kernels.write "
+" + SIMD_KERNEL_HELPERS
 
-
-
-
-b.each do
+(a + b).each do
     |item|
 
     name     = item[0] + ''
@@ -210,32 +182,14 @@ b.each do
 #include \"gegl-chant.h\"
 "
     file.write file_head2
-    file.write "
-  for (i = 0; i < n_pixels; i++)
-    {
-      gint   j;
-      gfloat aA, aB, aD;
-
-      aB = in[3];
-      aA = aux[3];
-      aD = #{a_formula};
-
-      for (j = 0; j < 3; j++)
-        {
-          gfloat cA, cB;
-
-          cB = in[j];
-          cA = aux[j];
-          out[j] = #{c_formula};
-        }
-      out[3] = aD;
-      in  += 4;
-      aux += 4;
-      out += 4;
-    }
-  return TRUE;
+    file.write scalar_loop(c_formula, a_formula)
+    file.write "  return TRUE;
 }
+"
+    file.write simd_processors(c_formula, a_formula)
 
+    if b.include? item
+      file.write "
 static GeglRectangle get_bounding_box (GeglOperation *self)
 {
   GeglRectangle *in_rect = gegl_operation_source_get_bounding_box (self, \"input\");
@@ -244,14 +198,35 @@ static GeglRectangle get_bounding_box (GeglOperation *self)
 
 
 "
+    end
+
   file.write file_tail1
   file.write "
   operation_class->compat_name = \"gegl:#{name}\";
   operation_class->name        = \"svg:#{name}\";
-  operation_class->get_bounding_box = get_bounding_box;
-  operation_class->description =
+"
+  if b.include? item
+    file.write "  operation_class->get_bounding_box = get_bounding_box;
+"
+  end
+  file.write "  operation_class->description =
         _(\"Porter Duff operation #{name} (d = #{c_formula})\");
 "
   file.write file_tail2
   file.close
+
+  kernels.write "
+static void
+#{item[0]}_reference (gfloat *in,
+#{' ' * item[0].length}            gfloat *aux,
+#{' ' * item[0].length}            gfloat *out,
+#{' ' * item[0].length}            glong   n_pixels)
+{
+  gint i;
+#{scalar_loop(c_formula, a_formula)}}
+" + simd_kernel_functions(item[0], c_formula, a_formula)
 end
+
+kernels.write simd_kernel_tables('svg_12_porter_duff_kernels',
+                                 (a + b).map { |item| item[0] })
+kernels.close
@@ -31,123 +31,23 @@ gegl_chant_double (radius, _("Radius"), 0.0, 200.0, 4.0,
 #define GEGL_CHANT_C_FILE       "box-min.c"
 
 #include "gegl-chant.h"
-#include <stdio.h>
 #include <math.h>
 
-static inline gfloat
-get_min_component (gfloat *buf,
-                   gint    buf_width,
-                   gint    buf_height,
-                   gint    x0,
-                   gint    y0,
-                   gint    width,
-                   gint    height,
-                   gint    component)
-{
-  gint    x, y;
-  gfloat min=1000000000.0;
-  gint    count=0;
-
-  gint offset = (y0 * buf_width + x0) * 4 + component;
-
-  for (y=y0; y<y0+height; y++)
-    {
-    for (x=x0; x<x0+width; x++)
-      {
-        if (x>=0 && x<buf_width &&
-            y>=0 && y<buf_height)
-          {
-            if (buf [offset] < min)
-              min = buf[offset];
-            count++;
-          }
-        offset+=4;
-      }
-      offset+= (buf_width * 4) - 4 * width;
-    }
-   return min;
-}
+#include "running-extremum.h"
 
 static void
-hor_min (GeglBuffer          *src,
+box_min (GeglOperation       *operation,
+         const gfloat        *src_buf,
          const GeglRectangle *src_rect,
-         GeglBuffer          *dst,
+         gfloat              *dst_buf,
          const GeglRectangle *dst_rect,
-         gint                 radius)
+         gpointer             user_data)
 {
-  gint u,v;
-  gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
-
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * dst_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
-  offset = 0;
-  for (v=0; v<dst_rect->height; v++)
-    for (u=0; u<dst_rect->width; u++)
-      {
-        gint i;
-
-        for (i=0; i<4; i++)
-          dst_buf [offset++] = get_min_component (src_buf,
-                               src_rect->width,
-                               src_rect->height,
-                               u + radius - radius,
-                               v + radius,
-                               1 + radius*2,
-                               1,
-                               i);
-      }
-
-  gegl_buffer_set (dst, dst_rect, babl_format ("RGBA float"), dst_buf,
-                   GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
-}
+  gint radius = GEGL_CHANT_PROPERTIES (operation)->radius;
 
-
-static void
-ver_min (GeglBuffer *src,
-         const GeglRectangle *src_rect,
-         GeglBuffer          *dst,
-         const GeglRectangle *dst_rect,
-         gint                 radius)
-{
-  gint u,v;
-  gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
-
-  src_buf = g_new0 (gfloat, src_rect->width * src_rect->height * 4);
-  dst_buf = g_new0 (gfloat, dst_rect->width * src_rect->height * 4);
-
-  gegl_buffer_get (src, 1.0, src_rect, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
-  offset=0;
-  for (v=0; v<dst_rect->height; v++)
-    for (u=0; u<dst_rect->width; u++)
-      {
-        gint c;
-
-        for (c=0; c<4; c++)
-          dst_buf [offset++] =
-           get_min_component (src_buf,
-                              src_rect->width,
-                              src_rect->height,
-                              u,
-                              v - radius,
-                              1,
-                              1 + radius * 2,
-                              c);
-      }
-
-  gegl_buffer_set (dst, dst_rect, babl_format ("RGBA float"), dst_buf,
-                   GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
+  running_extremum_box (src_buf, src_rect->width, src_rect->height,
+                        0, 0, 1 + radius * 2, 1 + radius * 2, FALSE,
+                        dst_buf, dst_rect->width, dst_rect->height);
 }
 
 static void prepare (GeglOperation *operation)
@@ -157,6 +57,7 @@ static void prepare (GeglOperation *operation)
   area->right =
   area->top   =
   area->bottom = GEGL_CHANT_PROPERTIES (operation)->radius;
+  gegl_operation_set_format (operation, "input", babl_format ("RGBA float"));
   gegl_operation_set_format (operation, "output", babl_format ("RGBA float"));
 }
 
@@ -166,13 +67,8 @@ process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result)
 {
-  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglRectangle input_rect = gegl_operation_get_required_for_output (operation, "input", result);
-
-  hor_min ( input, &input_rect, output, result, o->radius);
-  ver_min (output,      result, output, result, o->radius);
-
-  return  TRUE;
+  return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                    0, box_min, NULL);
 }
 
 
@@ -28,11 +28,11 @@ gegl_chant_double (radius, _("Radius"), 0.0, 70.0, 4.0,
   _("Radius of square pixel region (width and height will be radius*2+1)"))
 gegl_chant_double (percentile, _("Percentile"), 0.0, 100.0, 50,
   _("The percentile to compute, defaults to 50, which is a median filter."))
+gegl_chant_int (precision, _("Precision"), 4, 12, 12,
+  _("Luminance precision in bits, samples are ranked in 2^precision bins"))
 
 #else
 
-#define MAX_SAMPLES 20000 /* adapted to max level of radius */
-
 #define GEGL_CHANT_TYPE_AREA_FILTER
 #define GEGL_CHANT_C_FILE       "box-percentile.c"
 
@@ -40,10 +40,15 @@ gegl_chant_double (percentile, _("Percentile"), 0.0, 100.0, 50,
 #include <stdio.h>
 #include <math.h>
 
-static void median (GeglBuffer *src,
-                    GeglBuffer *dst,
-                    gint        radius,
-                    gdouble     rank);
+#include "sliding-histogram.h"
+
+static void median (GeglBuffer          *src,
+                    GeglBuffer          *dst,
+                    const GeglRectangle *compute,
+                    const GeglRectangle *result,
+                    gint                 radius,
+                    gdouble              rank,
+                    gint                 bits);
 
 
 static void prepare (GeglOperation *operation)
@@ -62,148 +67,44 @@ process (GeglOperation       *operation,
          const GeglRectangle *result)
 {
   GeglChantO   *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglBuffer   *temp_in;
   GeglRectangle compute = gegl_operation_get_required_for_output (operation, "input", result);
 
   if (o->radius < 1.0)
-    {
-      output = g_object_ref (input);
-    }
+    gegl_buffer_copy (input, result, output, result);
   else
-    {
-      temp_in = gegl_buffer_create_sub_buffer (input, &compute);
-
-      median (temp_in, output, o->radius, o->percentile / 100.0);
-      g_object_unref (temp_in);
-    }
+    median (input, output, &compute, result, o->radius,
+            o->percentile / 100.0, o->precision);
 
   return  TRUE;
 }
 
 
-typedef struct
-{
-  int       head;
-  int       next[MAX_SAMPLES];
-  float     luma[MAX_SAMPLES];
-  float    *pixel[MAX_SAMPLES];
-  int       items;
-} RankList;
-
 static void
-list_clear (RankList * p)
-{
-  p->items = 0;
-  p->next[0] = -1;
-}
-
-static inline void
-list_add (RankList *p,
-          gfloat    lumniosity,
-          gfloat   *pixel)
+median (GeglBuffer          *src,
+        GeglBuffer          *dst,
+        const GeglRectangle *compute,
+        const GeglRectangle *result,
+        gint                 radius,
+        gdouble              rank,
+        gint                 bits)
 {
-  gint location;
-
-  location = p->items;
-
-  p->items++;
-  p->luma[location] = lumniosity;
-  p->pixel[location] = pixel;
-  p->next[location] = -1;
-
-  if (p->items == 1)
-    {
-      p->head = location;
-      return;
-    }
-  if (lumniosity <= p->luma[p->head])
-    {
-      p->next[location] = p->head;
-      p->head = location;
-    }
-  else
-    {
-      gint   prev, i;
-      prev = p->head;
-      i = prev;
-      while (i >= 0 && p->luma[i] < lumniosity)
-        {
-          prev = i;
-          i = p->next[i];
-        }
-      p->next[location] = p->next[prev];
-      p->next[prev] = location;
-    }
-}
-
-static inline gfloat *
-list_percentile (RankList *p,
-                 gdouble   percentile)
-{
-  gint       i = p->head;
-  gint       pos = 0;
-  if (!p->items)
-    return NULL;
-  if (percentile >= 1.0)
-    percentile = 1.0;
-  while (pos < p->items * percentile &&
-         p->pixel[p->next[i]])
-    {
-      i = p->next[i];
-      pos++;
-    }
-  return p->pixel[i];
-}
+  gfloat *src_buf = g_new (gfloat, compute->width * compute->height * 4);
+  gfloat *dst_buf = g_new (gfloat, compute->width * compute->height * 4);
 
-static void
-median (GeglBuffer *src,
-        GeglBuffer *dst,
-        gint        radius,
-        gdouble     rank)
-{
-  RankList list={0};
-
-  gint x,y;
-  gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
-
-
-  src_buf = g_malloc0 (gegl_buffer_get_pixel_count (src) * 4 * 4);
-  dst_buf = g_malloc0 (gegl_buffer_get_pixel_count (dst) * 4 * 4);
-
-  gegl_buffer_get (src, 1.0, NULL, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
-  offset = 0;
-  for (y=0; y<gegl_buffer_get_height (dst); y++)
-    for (x=0; x<gegl_buffer_get_width (dst); x++)
-      {
-        gint u,v;
-        gfloat *median_pix;
-
-        list_clear (&list);
-
-        for (v=y-radius;v<=y+radius;v++)
-          for (u=x-radius;u<=x+radius;u++)
-            {
-              if (u >= 0 && u < gegl_buffer_get_width (dst) &&
-                  v >= 0 && v < gegl_buffer_get_height (dst))
-                {
-                  gfloat *src_pix = src_buf + (u+(v * gegl_buffer_get_width (src))) * 4;
-                  gfloat luma = (src_pix[0] * 0.212671 +
-                                 src_pix[1] * 0.715160 +
-                                 src_pix[2] * 0.072169);
-                  list_add (&list, luma, src_pix);
-                }
-            }
-
-        median_pix = list_percentile (&list, rank);
-        for (u=0; u<4;u++)
-          dst_buf[offset*4+u] = median_pix[u];
-        offset++;
-      }
-  gegl_buffer_set (dst, NULL, babl_format ("RGBA float"), dst_buf,
+  gegl_buffer_get (src, 1.0, compute, babl_format ("RGBA float"), src_buf,
                    GEGL_AUTO_ROWSTRIDE);
+
+  /* the windows of the result are within compute, the same pixels are
+   * ranked whichever chunk a result pixel is processed in
+   */
+  sliding_histogram_box (src_buf, compute->width,
+                         compute->width, compute->height,
+                         radius, rank, bits, dst_buf);
+
+  gegl_buffer_set (dst, result, babl_format ("RGBA float"),
+                   dst_buf + ((result->y - compute->y) * compute->width +
+                              result->x - compute->x) * 4,
+                   compute->width * 4 * sizeof (gfloat));
   g_free (src_buf);
   g_free (dst_buf);
 }
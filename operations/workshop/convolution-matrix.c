@@ -100,6 +100,7 @@ gegl_chant_string (border, _("Border"), "extend",
 #include "gegl-chant.h"
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 
 #define RESPONSE_RESET 1
 
@@ -127,6 +128,8 @@ prepare (GeglOperation *operation)
 
   op_area->left = op_area->right = op_area->top = op_area->bottom = HALF_WINDOW;
 
+  gegl_operation_set_format (operation, "input",
+                             babl_format ("RGBA float"));
   gegl_operation_set_format (operation, "output",
                              babl_format ("RGBA float"));
 }
@@ -201,7 +204,7 @@ normalize_o (GeglChantO  *o,
 }
 
 static void
-convolve_pixel(gfloat               *src_buf,
+convolve_pixel(const gfloat         *src_buf,
                gfloat               *dst_buf,
                const GeglRectangle  *result,
                const GeglRectangle  *extended,
@@ -307,6 +310,43 @@ convolve_pixel(gfloat               *src_buf,
 
 
 
+typedef struct
+{
+  GeglBuffer     *input;
+  GeglRectangle   boundary;
+  gdouble       **matrix;
+  gdouble         matrixsum;
+} ConvolveParams;
+
+static void
+convolve_strip (GeglOperation       *operation,
+                const gfloat        *src_buf,
+                const GeglRectangle *src_rect,
+                gfloat              *dst_buf,
+                const GeglRectangle *dst_rect,
+                gpointer             user_data)
+{
+  GeglChantO     *o      = GEGL_CHANT_PROPERTIES (operation);
+  ConvolveParams *params = user_data;
+  gint            x, y;
+
+  if (o->div != 0)
+    {
+      for (y=dst_rect->y; y < dst_rect->height + dst_rect->y; y++)
+        for (x=dst_rect->x; x < dst_rect->width + dst_rect->x; x++)
+          convolve_pixel (src_buf, dst_buf, dst_rect, src_rect,
+                          &params->boundary, params->matrix, o,
+                          params->input, x, y, params->matrixsum);
+    }
+  else
+    {
+      for (y=0; y < dst_rect->height; y++)
+        memcpy (dst_buf + y * dst_rect->width * 4,
+                src_buf + ((y + HALF_WINDOW) * src_rect->width + HALF_WINDOW) * 4,
+                dst_rect->width * 4 * sizeof (gfloat));
+    }
+}
+
 static GeglRectangle
 get_effective_area (GeglOperation *operation)
 {
@@ -324,20 +364,12 @@ process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result)
 {
-  GeglChantO              *o       = GEGL_CHANT_PROPERTIES (operation);
-  GeglOperationAreaFilter *op_area = GEGL_OPERATION_AREA_FILTER (operation);
-
-  GeglRectangle   rect;
-  GeglRectangle   boundary = get_effective_area (operation);
-  gfloat         *src_buf;
-  gfloat         *dst_buf;
+  GeglChantO     *o = GEGL_CHANT_PROPERTIES (operation);
+  ConvolveParams  params;
   gdouble       **matrix;
-
-  gchar         *type;
-  gint           x, y;
-  gdouble        matrixsum = 0.0;
-
-  type = "RGBA float";
+  gint            x, y;
+  gdouble         matrixsum = 0.0;
+  gboolean        success;
 
   matrix = g_new0 (gdouble*, MATRIX_SIZE);
 
@@ -353,39 +385,20 @@ process (GeglOperation       *operation,
     for (y=0; y < MATRIX_SIZE; y++)
       matrixsum += fabs (matrix[x][y]);
 
-  rect.x      = result->x - op_area->left;
-  rect.width  = result->width + op_area->left + op_area->right;
-  rect.y      = result->y - op_area->top;
-  rect.height = result->height + op_area->top + op_area->bottom;
+  params.input     = input;
+  params.boundary  = get_effective_area (operation);
+  params.matrix    = matrix;
+  params.matrixsum = matrixsum;
 
-  src_buf = g_new0 (gfloat, rect.width * rect.height * 4);
-  dst_buf = g_new0 (gfloat, result->width * result->height * 4);
+  /* the pixels outside of a strip and its halo are sampled from input */
+  success = gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                       0, convolve_strip, &params);
 
-  gegl_buffer_get (input, 1.0, &rect, babl_format (type),
-                   src_buf, GEGL_AUTO_ROWSTRIDE);
-
-  /*fill src_buf with wrap pixels if it is the case*/
-
-  if (o->div != 0)
-    {
-      for (y=result->y; y < result->height + result->y; y++)
-        for (x=result->x; x < result->width + result->x; x++)
-          convolve_pixel (src_buf, dst_buf, result, &rect, &boundary,
-                          matrix, o, input, x, y, matrixsum);
-
-      gegl_buffer_set (output, result, babl_format (type),
-                       dst_buf, GEGL_AUTO_ROWSTRIDE);
-    }
-  else
-    gegl_buffer_set (output, &rect, babl_format (type),
-                     src_buf, GEGL_AUTO_ROWSTRIDE);
-
-
-
-  g_free (src_buf);
-  g_free (dst_buf);
+  for (x=0; x < MATRIX_SIZE ;x++)
+    g_free (matrix[x]);
+  g_free (matrix);
 
-  return TRUE;
+  return success;
 }
 
 static GeglRectangle
@@ -27,155 +27,58 @@ gegl_chant_double (radius, _("Radius"), 0.0, 70.0, 4.0,
   _("Radius of square pixel region (width and height will be radius*2+1)"))
 gegl_chant_double (percentile, _("Percentile"), 0.0, 100.0, 50,
                    _("The percentile to compute, defaults to 50, which is a median filter."))
+gegl_chant_int (precision, _("Precision"), 4, 12, 12,
+  _("Luminance precision in bits, samples are ranked in 2^precision bins"))
 
 #else
 
-#define MAX_SAMPLES 20000 /* adapted to max level of radius */
-
 #define GEGL_CHANT_TYPE_AREA_FILTER
 #define GEGL_CHANT_C_FILE       "disc-percentile.c"
 
 #include "gegl-chant.h"
 #include <math.h>
 
-static void median (GeglBuffer *src,
-                      GeglBuffer *dst,
-                      gint        radius,
-                      gdouble     rank);
-
-#include <stdio.h>
-
-typedef struct
-{
-  int       head;
-  int       next[MAX_SAMPLES];
-  float     luma[MAX_SAMPLES];
-  float    *pixel[MAX_SAMPLES];
-  int       items;
-} RankList;
-
-static void
-list_clear (RankList * p)
-{
-  p->items = 0;
-  p->next[0] = -1;
-}
+#include "sliding-histogram.h"
 
-static inline void
-list_add (RankList *p,
-          gfloat    lumniosity,
-          gfloat   *pixel)
-{
-  gint location;
-
-  location = p->items;
-
-  p->items++;
-  p->luma[location] = lumniosity;
-  p->pixel[location] = pixel;
-  p->next[location] = -1;
-
-  if (p->items == 1)
-    {
-      p->head = location;
-      return;
-    }
-  if (lumniosity <= p->luma[p->head])
-    {
-      p->next[location] = p->head;
-      p->head = location;
-    }
-  else
-    {
-      gint   prev, i;
-      prev = p->head;
-      i = prev;
-      while (i >= 0 && p->luma[i] < lumniosity)
-        {
-          prev = i;
-          i = p->next[i];
-        }
-      p->next[location] = p->next[prev];
-      p->next[prev] = location;
-    }
-}
+static void median (GeglOperation       *operation,
+                    const gfloat        *src_buf,
+                    const GeglRectangle *src_rect,
+                    gfloat              *dst_buf,
+                    const GeglRectangle *dst_rect,
+                    gpointer             user_data);
 
-static inline gfloat *
-list_percentile (RankList *p,
-                 gdouble   percentile)
-{
-  gint       i = p->head;
-  gint       pos = 0;
-  if (!p->items)
-    return NULL;
-  if (percentile >= 1.0)
-    percentile = 1.0;
-  while (pos < p->items * percentile &&
-         p->pixel[p->next[i]])
-    {
-      i = p->next[i];
-      pos++;
-    }
-  return p->pixel[i];
-}
+#include <stdio.h>
+#include <string.h>
 
 static void
-median (GeglBuffer *src,
-        GeglBuffer *dst,
-        gint        radius,
-        gdouble     rank)
+median (GeglOperation       *operation,
+        const gfloat        *src_buf,
+        const GeglRectangle *src_rect,
+        gfloat              *dst_buf,
+        const GeglRectangle *dst_rect,
+        gpointer             user_data)
 {
-  RankList list = {0};
-
-  gint x,y;
-  gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
-
-
-  src_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (src) * 4);
-  dst_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (dst) * 4);
-
-  gegl_buffer_get (src, 1.0, NULL, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
-
-  offset = 0;
-  for (y=0; y<gegl_buffer_get_height (dst); y++)
-    for (x=0; x<gegl_buffer_get_width (dst); x++)
-      {
-        gint u,v;
-        gfloat *median_pix;
-
-        list_clear (&list);
-
-        for (v=y-radius;v<=y+radius;v++)
-          for (u=x-radius;u<=x+radius;u++)
-            {
-              gint ru, rv;
-
-              ru = (x-u)*(x-u);
-              rv = (y-v)*(y-v);
-
-              if (u >= 0 && u < gegl_buffer_get_width (dst) &&
-                  v >= 0 && v < gegl_buffer_get_height (dst) &&
-                  (ru+rv) < radius* radius
-                  )
-                {
-                  gfloat *src_pix = src_buf + (u+(v * gegl_buffer_get_width (src))) * 4;
-                  gfloat luma = (src_pix[0] * 0.212671 +
-                                 src_pix[1] * 0.715160 +
-                                 src_pix[2] * 0.072169);
-                  list_add (&list, luma, src_pix);
-                }
-            }
-
-        median_pix = list_percentile (&list, rank);
-        for (u=0; u<4;u++)
-          dst_buf[offset*4+u] = median_pix[u];
-        offset++;
-      }
-  gegl_buffer_set (dst, NULL, babl_format ("RGBA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
+  GeglChantO *o    = GEGL_CHANT_PROPERTIES (operation);
+  gint        top  = dst_rect->y - src_rect->y;
+  gint        left = dst_rect->x - src_rect->x;
+  gfloat     *rows = g_new (gfloat, src_rect->width * dst_rect->height * 4);
+  gint        y;
+
+  /* the windows of the strip are within its halo, the same pixels are
+   * ranked whichever strip a result pixel is processed in
+   */
+  sliding_histogram_disc_rows (src_buf, src_rect->width,
+                               src_rect->width, src_rect->height,
+                               top, top + dst_rect->height,
+                               o->radius, o->percentile / 100.0,
+                               o->precision, rows);
+
+  for (y = 0; y < dst_rect->height; y++)
+    memcpy (dst_buf + y * dst_rect->width * 4,
+            rows + (y * src_rect->width + left) * 4,
+            dst_rect->width * 4 * sizeof (gfloat));
+
+  g_free (rows);
 }
 
 static void prepare (GeglOperation *operation)
@@ -183,6 +86,7 @@ static void prepare (GeglOperation *operation)
   GeglOperationAreaFilter *area = GEGL_OPERATION_AREA_FILTER (operation);
   GeglChantO              *o = GEGL_CHANT_PROPERTIES (operation);
   area->left = area->right = area->top = area->bottom = ceil (o->radius);
+  gegl_operation_set_format (operation, "input", babl_format ("RGBA float"));
   gegl_operation_set_format (operation, "output", babl_format ("RGBA float"));
 }
 
@@ -192,22 +96,13 @@ process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result)
 {
-  GeglChantO   *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglBuffer   *temp_in;
-  GeglRectangle compute =
-        gegl_operation_get_required_for_output (operation, "input", result);
+  GeglChantO *o = GEGL_CHANT_PROPERTIES (operation);
 
   if (o->radius < 1.0)
-    {
-      output = g_object_ref (input);
-    }
+    gegl_buffer_copy (input, result, output, result);
   else
-    {
-      temp_in = gegl_buffer_create_sub_buffer (input, &compute);
-
-      median (temp_in, output, o->radius, o->percentile / 100.0);
-      g_object_unref (temp_in);
-    }
+    return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                      0, median, NULL);
 
   return  TRUE;
 }
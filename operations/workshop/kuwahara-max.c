@@ -33,55 +33,7 @@ gegl_chant_double (radius, _("Radius"), 0.0, 50.0, 4.0,
 #include "gegl-chant.h"
 #include <math.h>
 
-static inline void
-compute_rectangle (gfloat *buf,
-                   gint    buf_width,
-                   gint    buf_height,
-                   gint    x0,
-                   gint    y0,
-                   gint    width,
-                   gint    height,
-                   gint    component,
-                   gfloat *pmin,
-                   gfloat *pmax,
-                   gfloat *pmean,
-                   gfloat *pvariance)
-{
-  gint    x, y;
-  gfloat  max   = -1000000000.0;
-  gfloat  min   =  1000000000.0;
-  gfloat  mean  =  0.0;
-  glong   count =  0;
-
-  gint offset = (y0 * buf_width + x0) * 4 + component;
-
-  for (y=y0; y<y0+height; y++)
-    {
-    for (x=x0; x<x0+width; x++)
-      {
-        if (x>=0 && x<buf_width &&
-            y>=0 && y<buf_height)
-          {
-            if (buf [offset] > max)
-              max = buf[offset];
-            if (buf [offset] < min)
-              min = buf[offset];
-            mean += buf[offset];
-            count++;
-          }
-        offset+=4;
-      }
-      offset+= (buf_width * 4) - 4 * width;
-    }
-  if (pmin)
-    *pmin = min;
-  if (pmax)
-    *pmax = max;
-  if (pmean && count)
-    *pmean = mean/count;
-  if (pvariance)
-    *pvariance = max-min;
-}
+#include "running-extremum.h"
 
 static void
 kuwahara (GeglBuffer *src,
@@ -90,99 +42,59 @@ kuwahara (GeglBuffer *src,
 {
   gint u,v;
   gint offset;
+  gint src_width  = gegl_buffer_get_width (src);
+  gint src_height = gegl_buffer_get_height (src);
+  gint dst_width  = gegl_buffer_get_width (dst);
+  gint dst_height = gegl_buffer_get_height (dst);
+  gint size       = 1 + radius;
+  gint width      = dst_width + size;
   gfloat *src_buf;
   gfloat *dst_buf;
+  gfloat *min_buf;
+  gfloat *max_buf;
 
   src_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (src) * 4);
   dst_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (dst) * 4);
+  min_buf = g_new (gfloat, width * (dst_height + size) * 4);
+  max_buf = g_new (gfloat, width * (dst_height + size) * 4);
 
   gegl_buffer_get (src, 1.0, NULL, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
 
+  /* extrema of every size x size rectangle with its top left corner in
+   * [-size, dst_width) x [-size, dst_height), the quadrants of (u, v) start
+   * at u - size or u and v - size or v
+   */
+  running_extremum_box (src_buf, src_width, src_height, -size, -size, size, size,
+                        FALSE, min_buf, width, dst_height + size);
+  running_extremum_box (src_buf, src_width, src_height, -size, -size, size, size,
+                        TRUE, max_buf, width, dst_height + size);
+
   offset = 0;
-  for (v=0; v<gegl_buffer_get_height (dst); v++)
-    for (u=0; u<gegl_buffer_get_width (dst); u++)
+  for (v=0; v<dst_height; v++)
+    for (u=0; u<dst_width; u++)
       {
+        gint quadrant[4] = { (v * width + u) * 4,
+                             (v * width + u + size) * 4,
+                             ((v + size) * width + u) * 4,
+                             ((v + size) * width + u + size) * 4 };
         gint component;
 
         for (component=0; component<3; component++)
           {
             gfloat value=0.0;
             gfloat best=1000000.0;
+            gint   q;
 
-            gfloat max = 0.0;
-            gfloat variance = 0.0;
-
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u - radius - 1,
-                               v - radius - 1,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               &max, /* max */
-                               NULL,
-                               &variance);
-            if (variance<best)
-              {
-                value = max;
-                best = variance;
-              }
-
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u,
-                               v - radius - 1,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               &max, /* max */
-                               NULL,
-                               &variance);
-            if (variance<best)
-              {
-                value = max;
-                best = variance;
-              }
-
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u - radius - 1,
-                               v,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               &max, /* max */
-                               NULL,
-                               &variance);
-            if (variance<best)
-              {
-                value = max;
-                best = variance;
-              }
-
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u,
-                               v,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               &max, /* max */
-                               NULL,
-                               &variance);
-
-            if (variance<best)
+            for (q=0; q<4; q++)
               {
-                value = max;
-                best = variance;
+                gfloat variance = max_buf[quadrant[q] + component] -
+                                  min_buf[quadrant[q] + component];
+
+                if (variance<best)
+                  {
+                    value = max_buf[quadrant[q] + component];
+                    best = variance;
+                  }
               }
             dst_buf [offset++] = value;
           }
@@ -193,6 +105,8 @@ kuwahara (GeglBuffer *src,
   gegl_buffer_set (dst, NULL, babl_format ("RGBA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
   g_free (src_buf);
   g_free (dst_buf);
+  g_free (min_buf);
+  g_free (max_buf);
 }
 
 static void prepare (GeglOperation *operation)
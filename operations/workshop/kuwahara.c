@@ -33,76 +33,70 @@ gegl_chant_double (radius, _("Radius"), 0.0, 50.0, 10.0,
 #include "gegl-chant.h"
 #include <math.h>
 
-static inline void
-compute_rectangle (gfloat *buf,
-                   gint    buf_width,
-                   gint    buf_height,
-                   gint    x0,
-                   gint    y0,
-                   gint    width,
-                   gint    height,
-                   gint    component,
-                   gfloat *pmin,
-                   gfloat *pmax,
-                   gfloat *pmean,
-                   gfloat *pvariance)
-{
-  gint    x, y;
-  gfloat  max   = -1000000000.0;
-  gfloat  min   =  1000000000.0;
-  gfloat  mean  =  0.0;
-  glong   count =  0;
-
-  gint offset = (y0 * buf_width + x0) * 4 + component;
-
-  for (y=y0; y<y0+height; y++)
-    {
-    for (x=x0; x<x0+width; x++)
-      {
-        if (x>=0 && x<buf_width &&
-            y>=0 && y<buf_height)
-          {
-            if (buf [offset] > max)
-              max = buf[offset];
-            if (buf [offset] < min)
-              min = buf[offset];
-            mean += buf[offset];
-            count++;
-          }
-        offset+=4;
-      }
-      offset+= (buf_width * 4) - 4 * width;
-    }
-  if (pmin)
-    *pmin = min;
-  if (pmax)
-    *pmax = max;
-  if (pmean && count)
-    *pmean = mean/count;
-  if (pvariance)
-    *pvariance = max-min;
-}
+#include "../common/summed-area.h"
+#include "running-extremum.h"
 
+/* the quadrants of a pixel are the size x size squares having it as a
+ * corner, the one with the smallest spread between the extrema of a
+ * component gives the mean of that component
+ */
 static void
-kuwahara (GeglBuffer *src,
-          GeglBuffer *dst,
-          gint        radius)
+kuwahara (GeglOperation       *operation,
+          const gfloat        *src_buf,
+          const GeglRectangle *src_rect,
+          gfloat              *dst_buf,
+          const GeglRectangle *dst_rect,
+          gpointer             user_data)
 {
-  gint u,v;
-  gint offset;
-  gfloat *src_buf;
-  gfloat *dst_buf;
-
-  src_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (src) * 4);
-  dst_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (dst) * 4);
-
-  gegl_buffer_get (src, 1.0, NULL, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
+  gint        radius = GEGL_CHANT_PROPERTIES (operation)->radius;
+  gint        left   = dst_rect->x - src_rect->x;
+  gint        top    = dst_rect->y - src_rect->y;
+  gint        size   = 1 + radius;
+  gint        width  = dst_rect->width + radius;
+  gint        height = dst_rect->height + radius;
+  gint        u, v;
+  gint        offset;
+  SummedArea *area;
+  gfloat     *min_buf;
+  gfloat     *spread;
+  gint        i;
+
+  /* the variance of the quadrants is the spread between the extrema of
+   * every size x size square with its top left corner in
+   * [left - radius, left + dst_width) x [top - radius, top + dst_height),
+   * the minima are dropped before the table is built
+   */
+  min_buf = g_new (gfloat, width * height * 4);
+  spread  = g_new (gfloat, width * height * 4);
+  running_extremum_box (src_buf, src_rect->width, src_rect->height,
+                        left - radius, top - radius, size, size,
+                        FALSE, min_buf, width, height);
+  running_extremum_box (src_buf, src_rect->width, src_rect->height,
+                        left - radius, top - radius, size, size,
+                        TRUE, spread, width, height);
+  for (i = 0; i < width * height * 4; i++)
+    spread[i] -= min_buf[i];
+  g_free (min_buf);
+
+  /* and their means come from a summed area table of the strip */
+  area = summed_area_new_for_data (src_buf, src_rect, FALSE);
 
   offset = 0;
-  for (v=0; v<gegl_buffer_get_height (dst); v++)
-    for (u=0; u<gegl_buffer_get_width (dst); u++)
+  for (v=0; v<dst_rect->height; v++)
+    for (u=0; u<dst_rect->width; u++)
       {
-        gint component;
+        gint    qx[4] = { u, u + radius, u, u + radius };
+        gint    qy[4] = { v, v, v + radius, v + radius };
+        gdouble sums[4][4];
+        gint    counts[4];
+        gint    component;
+        gint    q;
+
+        for (q=0; q<4; q++)
+          counts[q] = summed_area_get (area,
+                                       left - radius + qx[q],
+                                       top - radius + qy[q],
+                                       size, size, sums[q], NULL);
 
         for (component=0; component<3; component++)
           {
@@ -110,89 +104,29 @@ kuwahara (GeglBuffer *src,
             gfloat best=1000000.0;
 
             gfloat mean = 0.0;
-            gfloat variance = 0.0;
-
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u - radius - 1,
-                               v - radius - 1,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               NULL, /* max */
-                               &mean,
-                               &variance);
-            if (variance<best)
-              {
-                best = variance;
-                value = mean;
-              }
 
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u,
-                               v - radius - 1,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               NULL, /* max */
-                               &mean,
-                               &variance);
-            if (variance<best)
+            for (q=0; q<4; q++)
               {
-                best = variance;
-                value = mean;
-              }
+                gfloat variance = spread[(qy[q] * width + qx[q]) * 4 + component];
 
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u - radius - 1,
-                               v,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               NULL, /* max */
-                               &mean,
-                               &variance);
-            if (variance<best)
-              {
-                best = variance;
-                value = mean;
-              }
+                /* an empty quadrant keeps the previous mean */
+                if (counts[q])
+                  mean = sums[q][component] / counts[q];
 
-            compute_rectangle (src_buf,
-                               gegl_buffer_get_width (src),
-                               gegl_buffer_get_height (src),
-                               u,
-                               v,
-                               1 + radius,
-                               1 + radius,
-                               component,
-                               NULL, /* min */
-                               NULL, /* max */
-                               &mean,
-                               &variance);
-
-            if (variance<best)
-              {
-                best = variance;
-                value = mean;
+                if (variance<best)
+                  {
+                    best = variance;
+                    value = mean;
+                  }
               }
             dst_buf [offset++] = value;
           }
-          dst_buf [offset] = src_buf[offset];
-          offset++;
+          dst_buf [offset++] =
+            src_buf[((v + top) * src_rect->width + u + left) * 4 + 3];
       }
 
-  gegl_buffer_set (dst, NULL, babl_format ("RGBA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
-  g_free (src_buf);
-  g_free (dst_buf);
+  summed_area_free (area);
+  g_free (spread);
 }
 
 static void prepare (GeglOperation *operation)
@@ -201,6 +135,7 @@ static void prepare (GeglOperation *operation)
 
   area->left = area->right = area->top = area->bottom =
       ceil (GEGL_CHANT_PROPERTIES (operation)->radius);
+  gegl_operation_set_format (operation, "input", babl_format ("RGBA float"));
   gegl_operation_set_format (operation, "output", babl_format ("RGBA float"));
 }
 
@@ -210,16 +145,8 @@ process (GeglOperation       *operation,
          GeglBuffer          *output,
          const GeglRectangle *result)
 {
-  GeglChantO   *o = GEGL_CHANT_PROPERTIES (operation);
-  GeglBuffer   *temp_in;
-  GeglRectangle compute = gegl_operation_get_required_for_output (operation, "input", result);
-
-  temp_in = gegl_buffer_create_sub_buffer (input, &compute);
-
-  kuwahara (temp_in, output, o->radius);
-  g_object_unref (temp_in);
-
-  return  TRUE;
+  return gegl_operation_area_filter_process_strips (operation, input, output, result,
+                                                    0, kuwahara, NULL);
 }
 
 
@@ -0,0 +1,136 @@
+/* GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Running minimum and maximum over windows of a fixed size (van Herk,
+ * Gil and Werman).  The line is cut in blocks as long as the window, every
+ * window covers the end of one block and the start of the next, so its
+ * extremum is the extremum of a suffix and a prefix computed once per
+ * block.  That is three comparisons per value whatever the size of the
+ * window.
+ *
+ * Values outside the source count as RUNNING_EXTREMUM_EMPTY_MAX or
+ * RUNNING_EXTREMUM_EMPTY_MIN, the values the filters start searching
+ * from, so a window entirely outside the source returns them.
+ */
+
+#include <string.h>
+
+#define RUNNING_EXTREMUM_EMPTY_MAX (-1000000000.0)
+#define RUNNING_EXTREMUM_EMPTY_MIN   1000000000.0
+
+#define RUNNING_EXTREMUM(maximum, a, b) ((maximum) ? MAX ((a), (b)) : MIN ((a), (b)))
+
+/* dst[i] is the extremum of line[i] ... line[i + size - 1] for i in
+ * [0, n), per component of RGBA pixels.  line holds n + size - 1 pixels,
+ * prefix and suffix are work space of the same size.
+ */
+static inline void
+running_extremum_line (const gfloat *line,
+                       gint          n,
+                       gint          size,
+                       gboolean      maximum,
+                       gfloat       *prefix,
+                       gfloat       *suffix,
+                       gfloat       *dst)
+{
+  gint length = (n + size - 1) * 4;
+  gint start, i;
+
+  for (start = 0; start < length; start += size * 4)
+    {
+      gint end = MIN (start + size * 4, length);
+
+      for (i = start; i < start + 4; i++)
+        prefix[i] = line[i];
+      for (; i < end; i++)
+        prefix[i] = RUNNING_EXTREMUM (maximum, prefix[i - 4], line[i]);
+
+      for (i = end - 1; i >= end - 4; i--)
+        suffix[i] = line[i];
+      for (; i >= start; i--)
+        suffix[i] = RUNNING_EXTREMUM (maximum, suffix[i + 4], line[i]);
+    }
+
+  for (i = 0; i < n * 4; i++)
+    dst[i] = RUNNING_EXTREMUM (maximum, suffix[i], prefix[i + (size - 1) * 4]);
+}
+
+/* dst[x, y] is the extremum of the src pixels u, v with u in
+ * [x0 + x, x0 + x + size_x) and v in [y0 + y, y0 + y + size_y), computed
+ * for a dst_width x dst_height destination with a horizontal and a
+ * vertical pass.
+ */
+static inline void
+running_extremum_box (const gfloat *src,
+                      gint          src_width,
+                      gint          src_height,
+                      gint          x0,
+                      gint          y0,
+                      gint          size_x,
+                      gint          size_y,
+                      gboolean      maximum,
+                      gfloat       *dst,
+                      gint          dst_width,
+                      gint          dst_height)
+{
+  gfloat  empty  = maximum ? RUNNING_EXTREMUM_EMPTY_MAX : RUNNING_EXTREMUM_EMPTY_MIN;
+  gint    length = MAX (dst_width + size_x, dst_height + size_y) * 4;
+  gfloat *line   = g_new (gfloat, length);
+  gfloat *prefix = g_new (gfloat, length);
+  gfloat *suffix = g_new (gfloat, length);
+  gfloat *column = g_new (gfloat, dst_height * 4);
+  gfloat *rows   = g_new (gfloat, dst_width * src_height * 4);
+  gint    x, y, j;
+
+  for (y = 0; y < src_height; y++)
+    {
+      for (j = 0; j < dst_width + size_x - 1; j++)
+        {
+          gint u = x0 + j;
+
+          if (u >= 0 && u < src_width)
+            memcpy (line + j * 4, src + (y * src_width + u) * 4, 4 * sizeof (gfloat));
+          else
+            line[j * 4 + 0] = line[j * 4 + 1] = line[j * 4 + 2] = line[j * 4 + 3] = empty;
+        }
+
+      running_extremum_line (line, dst_width, size_x, maximum, prefix, suffix,
+                             rows + y * dst_width * 4);
+    }
+
+  for (x = 0; x < dst_width; x++)
+    {
+      for (j = 0; j < dst_height + size_y - 1; j++)
+        {
+          gint v = y0 + j;
+
+          if (v >= 0 && v < src_height)
+            memcpy (line + j * 4, rows + (v * dst_width + x) * 4, 4 * sizeof (gfloat));
+          else
+            line[j * 4 + 0] = line[j * 4 + 1] = line[j * 4 + 2] = line[j * 4 + 3] = empty;
+        }
+
+      running_extremum_line (line, dst_height, size_y, maximum, prefix, suffix,
+                             column);
+
+      for (y = 0; y < dst_height; y++)
+        memcpy (dst + (y * dst_width + x) * 4, column + y * 4, 4 * sizeof (gfloat));
+    }
+
+  g_free (line);
+  g_free (prefix);
+  g_free (suffix);
+  g_free (column);
+  g_free (rows);
+}
@@ -0,0 +1,505 @@
+/* GEGL is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * GEGL is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Luminance histograms shared by the percentile filters.
+ *
+ * Samples are ranked by luminance, which is binned with a precision of
+ * 2^bits bins.  The bins come from a fixed mapping of the luminance, the
+ * same for every chunk of an image, so the filters don't show seams where
+ * the chunks meet.  A bin keeps the number of samples and the index of one
+ * of them, the color returned for a percentile is that sample of the bin
+ * holding the rank, a color found in the source.  Bins are split in coarse
+ * groups so a rank is found scanning the coarse counts and then a single
+ * group of fine bins.
+ *
+ * sliding_histogram_box () uses one histogram per column and only updates
+ * the fine bins of the coarse group a rank lands in (Perreault and Hébert,
+ * "Median Filtering in Constant Time"), its cost per pixel does not depend
+ * on the radius.  sliding_histogram_disc () moves the window along the row
+ * adding and removing the pixels on the edges of the disc (Huang), which
+ * costs O(radius) per pixel.
+ */
+
+#include <string.h>
+#include <math.h>
+
+#define SLIDING_HISTOGRAM_BITS     12  /* default precision, 4096 bins */
+#define SLIDING_HISTOGRAM_MIN_BITS 4
+#define SLIDING_HISTOGRAM_MAX_BITS 12  /* bins are per column in the box */
+#define SLIDING_HISTOGRAM_STRIPE   128 /* output columns processed at a time */
+
+#define SLIDING_HISTOGRAM_LUMA(pix) ((pix)[0] * 0.212671 + \
+                                     (pix)[1] * 0.715160 + \
+                                     (pix)[2] * 0.072169)
+
+typedef struct
+{
+  gint  n_bins;
+  gint  shift;    /* fine bins per coarse bin is 1 << shift */
+  gint  n_coarse;
+  gint *coarse;
+  gint *count;
+  gint *sample;   /* index of a sample in each bin, -1 once it was removed */
+  gint *expiry;   /* when that sample leaves the window */
+  gint  total;
+} SlidingHistogram;
+
+static inline SlidingHistogram *
+sliding_histogram_new (gint bits)
+{
+  SlidingHistogram *h = g_new0 (SlidingHistogram, 1);
+
+  bits = CLAMP (bits, SLIDING_HISTOGRAM_MIN_BITS, SLIDING_HISTOGRAM_MAX_BITS);
+
+  h->n_bins   = 1 << bits;
+  h->shift    = bits / 2;
+  h->n_coarse = h->n_bins >> h->shift;
+  h->coarse   = g_new0 (gint, h->n_coarse);
+  h->count    = g_new0 (gint, h->n_bins);
+  h->sample   = g_new (gint, h->n_bins);
+  h->expiry   = g_new (gint, h->n_bins);
+
+  return h;
+}
+
+static inline void
+sliding_histogram_free (SlidingHistogram *h)
+{
+  g_free (h->coarse);
+  g_free (h->count);
+  g_free (h->sample);
+  g_free (h->expiry);
+  g_free (h);
+}
+
+static inline void
+sliding_histogram_clear (SlidingHistogram *h)
+{
+  memset (h->coarse, 0, h->n_coarse * sizeof (gint));
+  memset (h->count, 0, h->n_bins * sizeof (gint));
+  h->total = 0;
+}
+
+/* adds the sample at index, the bin keeps the sample staying in the window
+ * the longest so it seldom has to be looked for again
+ */
+static inline void
+sliding_histogram_add (SlidingHistogram *h,
+                       gint              bin,
+                       gint              index,
+                       gint              expiry)
+{
+  h->coarse[bin >> h->shift]++;
+  h->total++;
+
+  if (h->count[bin]++ == 0 ||
+      h->sample[bin] < 0 ||
+      expiry > h->expiry[bin])
+    {
+      h->sample[bin] = index;
+      h->expiry[bin] = expiry;
+    }
+}
+
+static inline void
+sliding_histogram_remove (SlidingHistogram *h,
+                          gint              bin,
+                          gint              index)
+{
+  h->coarse[bin >> h->shift]--;
+  h->total--;
+
+  if (--h->count[bin] == 0 || h->sample[bin] == index)
+    h->sample[bin] = -1;
+}
+
+/* the sorted position of the sample returned for a percentile among n
+ * samples, matching the element the rank lists used to pick
+ */
+static inline gint
+sliding_histogram_rank (gint    n,
+                        gdouble percentile)
+{
+  gint rank;
+
+  if (percentile >= 1.0)
+    percentile = 1.0;
+  rank = ceil (n * percentile);
+
+  return CLAMP (rank, 0, n - 1);
+}
+
+/* the fine bin holding the sample of the given rank */
+static inline gint
+sliding_histogram_find (SlidingHistogram *h,
+                        gint              rank)
+{
+  gint seen = 0;
+  gint bin;
+  gint c;
+
+  for (c = 0; c < h->n_coarse - 1 && seen + h->coarse[c] <= rank; c++)
+    seen += h->coarse[c];
+
+  for (bin = c << h->shift;
+       bin < h->n_bins - 1 && seen + h->count[bin] <= rank;
+       bin++)
+    seen += h->count[bin];
+
+  return bin;
+}
+
+static inline void
+sliding_histogram_copy (const gfloat *src,
+                        gint          index,
+                        gfloat       *dst)
+{
+  memcpy (dst, src + index * 4, 4 * sizeof (gfloat));
+}
+
+/* the bin of a luminance, l / (1 + |l|) orders all of the luminances in
+ * (-1, 1) without knowing their range, a quarter of the bins is spent on
+ * [0, 1]
+ */
+static inline gint
+sliding_histogram_bin (gdouble luma,
+                       gint    n_bins)
+{
+  gdouble t = fabs (luma) <= G_MAXFLOAT ? luma / (1.0 + fabs (luma)) :
+              luma > 0.0                ? 1.0 : -1.0;
+  gdouble f = (t + 1.0) * 0.5 * n_bins;
+
+  if (!(f > 0.0))
+    return 0;
+  else if (f >= n_bins)
+    return n_bins - 1;
+
+  return f;
+}
+
+/* bins the luminance of a width x height RGBA float region with a row
+ * stride of src_stride pixels, bins is width x height
+ */
+static inline void
+sliding_histogram_quantise (const gfloat *src,
+                            gint          src_stride,
+                            gint          width,
+                            gint          height,
+                            gint          n_bins,
+                            guint16      *bins)
+{
+  gint x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      bins[y * width + x] =
+        sliding_histogram_bin (SLIDING_HISTOGRAM_LUMA (src + (y * src_stride + x) * 4),
+                               n_bins);
+}
+
+/* dst[x, y] gets the percentile of the pixels u in [x - radius, x + radius]
+ * and v in [y - radius, y + radius] of a width x height source, the window
+ * is clipped to the source.
+ */
+static inline void
+sliding_histogram_box (const gfloat *src,
+                       gint          src_stride,
+                       gint          width,
+                       gint          height,
+                       gint          radius,
+                       gdouble       percentile,
+                       gint          bits,
+                       gfloat       *dst)
+{
+  SlidingHistogram *kernel = sliding_histogram_new (bits);
+  gint      n_bins   = kernel->n_bins;
+  gint      n_coarse = kernel->n_coarse;
+  gint      shift    = kernel->shift;
+  gint      seg_len  = 1 << shift;
+  gint      max_cols = MIN (width, SLIDING_HISTOGRAM_STRIPE + 2 * radius);
+  guint16  *bins     = g_new (guint16, width * height);
+  guint16  *col_coarse = g_new (guint16, max_cols * n_coarse);
+  guint16  *col_count  = g_new (guint16, max_cols * n_bins);
+  gint     *col_last   = g_new (gint, max_cols * n_bins);
+  gint     *seg_x      = g_new (gint, n_coarse);
+  gint      x0;
+
+  sliding_histogram_quantise (src, src_stride, width, height, n_bins, bins);
+
+  for (x0 = 0; x0 < width; x0 += SLIDING_HISTOGRAM_STRIPE)
+    {
+      gint x1    = MIN (x0 + SLIDING_HISTOGRAM_STRIPE, width);
+      gint first = MAX (0, x0 - radius);
+      gint last  = MIN (width, x1 + radius);
+      gint y;
+
+      memset (col_coarse, 0, (last - first) * n_coarse * sizeof (guint16));
+      memset (col_count, 0, (last - first) * n_bins * sizeof (guint16));
+
+      for (y = 0; y < height; y++)
+        {
+          gint rows = MIN (height - 1, y + radius) - MAX (0, y - radius) + 1;
+          gint u, v, x, c;
+
+          /* slide the column histograms down to rows [y - radius, y + radius],
+           * the rows of a column leave in the order they came so the last
+           * row added to a bin is in it as long as the bin isn't empty
+           */
+          for (v = (y == 0 ? 0 : y + radius); v <= y + radius && v < height; v++)
+            for (u = first; u < last; u++)
+              {
+                gint bin = bins[v * width + u];
+
+                col_coarse[(u - first) * n_coarse + (bin >> shift)]++;
+                col_count[(u - first) * n_bins + bin]++;
+                col_last[(u - first) * n_bins + bin] = v;
+              }
+
+          v = y - radius - 1;
+          if (v >= 0)
+            for (u = first; u < last; u++)
+              {
+                gint bin = bins[v * width + u];
+
+                col_coarse[(u - first) * n_coarse + (bin >> shift)]--;
+                col_count[(u - first) * n_bins + bin]--;
+              }
+
+          /* the kernel starts with the columns around x0, none of its fine
+           * bins are valid yet
+           */
+          memset (kernel->coarse, 0, n_coarse * sizeof (gint));
+          for (u = MAX (0, x0 - radius); u <= MIN (width - 1, x0 + radius); u++)
+            for (c = 0; c < n_coarse; c++)
+              kernel->coarse[c] += col_coarse[(u - first) * n_coarse + c];
+          for (c = 0; c < n_coarse; c++)
+            seg_x[c] = -1;
+
+          for (x = x0; x < x1; x++)
+            {
+              gint lo = MAX (0, x - radius);
+              gint hi = MIN (width - 1, x + radius);
+              gint rank, seen, bin, s;
+
+              if (x > x0)
+                {
+                  if (x + radius < width)
+                    for (c = 0; c < n_coarse; c++)
+                      kernel->coarse[c] += col_coarse[(x + radius - first) * n_coarse + c];
+                  if (x - radius - 1 >= 0)
+                    for (c = 0; c < n_coarse; c++)
+                      kernel->coarse[c] -= col_coarse[(x - radius - 1 - first) * n_coarse + c];
+                }
+
+              rank = sliding_histogram_rank ((hi - lo + 1) * rows, percentile);
+
+              for (s = 0, seen = 0;
+                   s < n_coarse - 1 && seen + kernel->coarse[s] <= rank;
+                   s++)
+                seen += kernel->coarse[s];
+
+              /* bring the fine bins of this coarse bin up to date, either by
+               * moving them from the window they were last valid for or by
+               * summing them again.  Columns are added left to right, the
+               * sample of a bin is in the rightmost column holding it and
+               * stays in the window while the bin isn't empty.
+               */
+              if (seg_x[s] != x)
+                {
+                  gint  seg    = s << shift;
+                  gint  plo    = MAX (0, seg_x[s] - radius);
+                  gint  phi    = MIN (width - 1, seg_x[s] + radius);
+                  gint *count  = kernel->count;
+                  gint *sample = kernel->sample;
+                  gint  b;
+
+                  if (seg_x[s] < 0 || plo > hi ||
+                      (lo - plo) + (hi - phi) > hi - lo + 1)
+                    {
+                      memset (count + seg, 0, seg_len * sizeof (gint));
+                      plo = lo;
+                      phi = lo - 1;
+                    }
+
+                  for (u = plo; u < lo; u++)
+                    {
+                      const guint16 *ccount = col_count + (u - first) * n_bins;
+
+                      for (b = seg; b < seg + seg_len; b++)
+                        count[b] -= ccount[b];
+                    }
+
+                  for (u = phi + 1; u <= hi; u++)
+                    {
+                      const guint16 *ccount = col_count + (u - first) * n_bins;
+                      const gint    *clast  = col_last + (u - first) * n_bins;
+
+                      for (b = seg; b < seg + seg_len; b++)
+                        if (ccount[b])
+                          {
+                            count[b] += ccount[b];
+                            sample[b] = clast[b] * src_stride + u;
+                          }
+                    }
+
+                  seg_x[s] = x;
+                }
+
+              for (bin = s << shift;
+                   bin < n_bins - 1 && seen + kernel->count[bin] <= rank;
+                   bin++)
+                seen += kernel->count[bin];
+
+              sliding_histogram_copy (src, kernel->sample[bin],
+                                      dst + (y * width + x) * 4);
+            }
+        }
+    }
+
+  g_free (bins);
+  g_free (col_coarse);
+  g_free (col_count);
+  g_free (col_last);
+  g_free (seg_x);
+  sliding_histogram_free (kernel);
+}
+
+/* dst[x, y - first_row] gets the percentile of the pixels u, v of a
+ * width x height source with (x - u)^2 + (y - v)^2 < radius^2, for the rows
+ * y in [first_row, last_row)
+ */
+static inline void
+sliding_histogram_disc_rows (const gfloat *src,
+                             gint          src_stride,
+                             gint          width,
+                             gint          height,
+                             gint          first_row,
+                             gint          last_row,
+                             gint          radius,
+                             gdouble       percentile,
+                             gint          bits,
+                             gfloat       *dst)
+{
+  SlidingHistogram *h    = sliding_histogram_new (bits);
+  guint16          *bins = g_new (guint16, width * height);
+  gint             *half = g_new (gint, 2 * radius + 1);
+  gint              x, y, dv;
+
+  sliding_histogram_quantise (src, src_stride, width, height, h->n_bins, bins);
+
+  /* half width of each row of the disc, -1 for rows outside it */
+  for (dv = -radius; dv <= radius; dv++)
+    {
+      gint k = -1;
+
+      while ((k + 1) * (k + 1) + dv * dv < radius * radius)
+        k++;
+      half[dv + radius] = k;
+    }
+
+  /* a pixel of a row with half width k leaves the disc at x = u + k + 1 */
+#define DISC_ADD(u, v, k) sliding_histogram_add (h, bins[(v) * width + (u)], \
+                                                 (v) * src_stride + (u),     \
+                                                 (u) + (k) + 1)
+#define DISC_REMOVE(u, v) sliding_histogram_remove (h, bins[(v) * width + (u)], \
+                                                    (v) * src_stride + (u))
+
+  for (y = first_row; y < last_row; y++)
+    {
+      sliding_histogram_clear (h);
+
+      for (dv = -radius; dv <= radius; dv++)
+        {
+          gint v = y + dv;
+          gint k = half[dv + radius];
+          gint u;
+
+          if (v < 0 || v >= height || k < 0)
+            continue;
+
+          for (u = 0; u <= k && u < width; u++)
+            DISC_ADD (u, v, k);
+        }
+
+      for (x = 0; x < width; x++)
+        {
+          gint bin;
+
+          if (x > 0)
+            for (dv = -radius; dv <= radius; dv++)
+              {
+                gint v = y + dv;
+                gint k = half[dv + radius];
+
+                if (v < 0 || v >= height || k < 0)
+                  continue;
+
+                if (x - 1 - k >= 0)
+                  DISC_REMOVE (x - 1 - k, v);
+                if (x + k < width)
+                  DISC_ADD (x + k, v, k);
+              }
+
+          bin = sliding_histogram_find (h, sliding_histogram_rank (h->total,
+                                                                   percentile));
+
+          /* the sample of the bin left the disc, look for the one staying
+           * the longest among those still in it
+           */
+          if (h->sample[bin] < 0)
+            for (dv = -radius; dv <= radius; dv++)
+              {
+                gint v = y + dv;
+                gint k = half[dv + radius];
+                gint u;
+
+                if (v < 0 || v >= height || k < 0)
+                  continue;
+
+                for (u = MAX (0, x - k); u <= MIN (width - 1, x + k); u++)
+                  if (bins[v * width + u] == bin &&
+                      (h->sample[bin] < 0 || u + k + 1 > h->expiry[bin]))
+                    {
+                      h->sample[bin] = v * src_stride + u;
+                      h->expiry[bin] = u + k + 1;
+                    }
+              }
+
+          sliding_histogram_copy (src, h->sample[bin],
+                                  dst + ((y - first_row) * width + x) * 4);
+        }
+    }
+
+#undef DISC_ADD
+#undef DISC_REMOVE
+
+  g_free (bins);
+  g_free (half);
+  sliding_histogram_free (h);
+}
+
+/* sliding_histogram_disc_rows () of all of the rows */
+static inline void
+sliding_histogram_disc (const gfloat *src,
+                        gint          src_stride,
+                        gint          width,
+                        gint          height,
+                        gint          radius,
+                        gdouble       percentile,
+                        gint          bits,
+                        gfloat       *dst)
+{
+  sliding_histogram_disc_rows (src, src_stride, width, height, 0, height,
+                               radius, percentile, bits, dst);
+}
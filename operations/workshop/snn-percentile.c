@@ -30,27 +30,18 @@ gegl_chant_int (pairs, _("Pairs"), 1, 2, 2,
   _("Number of pairs, higher number preserves more acute features"))
 gegl_chant_double (percentile, _("Percentile"), 0.0, 100.0, 50.0,
   _("The percentile to return, the default value 50 is equal to the median."))
+gegl_chant_int (precision, _("Precision"), 4, 12, 12,
+  _("Luminance precision in bits, samples are ranked in 2^precision bins"))
 
 #else
 
-#define MAX_SAMPLES 20000 /* adapted to percentile level of radius */
-
 #define GEGL_CHANT_TYPE_AREA_FILTER
 #define GEGL_CHANT_C_FILE       "snn-percentile.c"
 
 #include "gegl-chant.h"
 #include <math.h>
 
-#define RGB_LUMINANCE_RED    (0.212671)
-#define RGB_LUMINANCE_GREEN  (0.715160)
-#define RGB_LUMINANCE_BLUE   (0.072169)
-
-static inline gfloat rgb2luminance (gfloat *pix)
-{
-  return pix[0] * RGB_LUMINANCE_RED +
-         pix[1] * RGB_LUMINANCE_GREEN +
-         pix[2] * RGB_LUMINANCE_BLUE;
-}
+#include "sliding-histogram.h"
 
 #define POW2(a)((a)*(a))
 
@@ -62,98 +53,35 @@ static inline gfloat colordiff (gfloat *pixA,
          POW2(pixA[2]-pixB[2]);
 }
 
-typedef struct
-{
-  int       head;
-  int       next[MAX_SAMPLES];
-  float     luma[MAX_SAMPLES];
-  float    *pixel[MAX_SAMPLES];
-  int       items;
-} RankList;
-
-static void
-list_clear (RankList * p)
-{
-  p->items = 0;
-  p->next[0] = -1;
-}
-
-static inline void
-list_add (RankList *p,
-          gfloat    lumniosity,
-          gfloat   *pixel)
-{
-  gint location;
-
-  location = p->items;
-
-  p->items++;
-  p->luma[location] = lumniosity;
-  p->pixel[location] = pixel;
-  p->next[location] = -1;
-
-  if (p->items == 1)
-    {
-      p->head = location;
-      return;
-    }
-  if (lumniosity <= p->luma[p->head])
-    {
-      p->next[location] = p->head;
-      p->head = location;
-    }
-  else
-    {
-      gint   prev, i;
-      prev = p->head;
-      i = prev;
-      while (i >= 0 && p->luma[i] < lumniosity)
-        {
-          prev = i;
-          i = p->next[i];
-        }
-      p->next[location] = p->next[prev];
-      p->next[prev] = location;
-    }
-}
-
-static inline gfloat *
-list_percentile (RankList *p,
-                 gdouble   percentile)
-{
-  gint       i = p->head;
-  gint       pos = 0;
-  if (!p->items)
-    return NULL;
-  if (percentile >= 1.0)
-    percentile = 1.0;
-  while (pos < p->items * percentile &&
-         p->pixel[p->next[i]])
-    {
-      i = p->next[i];
-      pos++;
-    }
-  return p->pixel[i];
-}
-
 static void
 snn_percentile (GeglBuffer *src,
                 GeglBuffer *dst,
                 gdouble     radius,
                 gdouble     percentile,
-                gint        pairs)
+                gint        pairs,
+                gint        bits)
 {
   gint    x, y;
   gint    offset;
+  gint    src_width  = gegl_buffer_get_width (src);
+  gint    src_height = gegl_buffer_get_height (src);
   gfloat *src_buf;
   gfloat *dst_buf;
-  RankList list = {0};
+  guint16 *bins;
+  gint    *added;
+  gint     n_added;
+  SlidingHistogram *hist = sliding_histogram_new (bits);
 
   src_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (src) * 4);
   dst_buf = g_new0 (gfloat, gegl_buffer_get_pixel_count (dst) * 4);
+  bins    = g_new (guint16, src_width * src_height);
+  added   = g_new (gint, ((gint) radius + 1) * (2 * (gint) radius + 1));
 
   gegl_buffer_get (src, 1.0, NULL, babl_format ("RGBA float"), src_buf, GEGL_AUTO_ROWSTRIDE);
 
+  sliding_histogram_quantise (src_buf, src_width, src_width, src_height,
+                              hist->n_bins, bins);
+
   offset = 0;
   percentile/= 100.0;
 
@@ -163,7 +91,7 @@ snn_percentile (GeglBuffer *src,
         gint u,v;
         gfloat *center_pix = src_buf + offset * 4;
 
-        list_clear (&list);
+        n_added = 0;
 
         /* iterate through the upper left quater of pixels */
         for (v=-radius;v<=0;v++)
@@ -186,10 +114,10 @@ snn_percentile (GeglBuffer *src,
                   /* check which member of the symmetric quadruple to use */
                   for (i=0;i<pairs*2;i++)
                     {
-                      if (xs[i] >= 0 && xs[i] < gegl_buffer_get_width (src) &&
-                          ys[i] >= 0 && ys[i] < gegl_buffer_get_height (src))
+                      if (xs[i] >= 0 && xs[i] < src_width &&
+                          ys[i] >= 0 && ys[i] < src_height)
                         {
-                          gfloat *tpix = src_buf + (xs[i]+ys[i]*gegl_buffer_get_width (src))*4;
+                          gfloat *tpix = src_buf + (xs[i]+ys[i]*src_width)*4;
                           gfloat diff = colordiff (tpix, center_pix);
                           if (diff < best_diff)
                             {
@@ -200,21 +128,34 @@ snn_percentile (GeglBuffer *src,
                     }
                 }
 
-              list_add (&list, rgb2luminance(selected_pix), selected_pix);
+              added[n_added] = (selected_pix - src_buf) / 4;
+              sliding_histogram_add (hist, bins[added[n_added]],
+                                     added[n_added], 0);
+              n_added++;
 
               if (u==0 && v==0)
                 break; /* to avoid doubly processing when using only 1 pair */
             }
-        {
-          gfloat *result = list_percentile (&list, percentile);
-          for (u=0; u<4; u++)
-            dst_buf[offset*4+u] = result[u];
-        }
+
+        /* the samples change with every pixel, the histogram only replaces
+         * the sorting and is emptied again sample by sample
+         */
+        sliding_histogram_copy (src_buf,
+                                hist->sample[sliding_histogram_find (hist,
+                                  sliding_histogram_rank (hist->total, percentile))],
+                                dst_buf + offset * 4);
+
+        while (n_added--)
+          sliding_histogram_remove (hist, bins[added[n_added]],
+                                    added[n_added]);
         offset++;
       }
   gegl_buffer_set (dst, NULL, babl_format ("RGBA float"), dst_buf, GEGL_AUTO_ROWSTRIDE);
   g_free (src_buf);
   g_free (dst_buf);
+  g_free (bins);
+  g_free (added);
+  sliding_histogram_free (hist);
 }
 
 static void prepare (GeglOperation *operation)
@@ -244,7 +185,8 @@ process (GeglOperation       *operation,
   else
     {
       temp_in = gegl_buffer_create_sub_buffer (input, &compute);
-      snn_percentile (temp_in, output, o->radius, o->percentile, o->pairs);
+      snn_percentile (temp_in, output, o->radius, o->percentile, o->pairs,
+                      o->precision);
       g_object_unref (temp_in);
     }
 
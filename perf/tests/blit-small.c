@@ -0,0 +1,66 @@
+#include "test-common.h"
+
+/* many blits of a small rectangle from a chain of point operations, where
+ * the time spent per call setting up the evaluation outweighs the time
+ * spent processing pixels.  Changing a property before every blit makes
+ * every call set up the evaluation of the graph from scratch.
+ */
+
+#define ITERATIONS 2000
+#define SIZE       16
+
+static void
+blit_small (GeglBuffer *buffer,
+            gboolean    changing)
+{
+  GeglRectangle roi = {100, 100, SIZE, SIZE};
+  GeglNode     *gegl, *contrast, *node;
+  gfloat       *buf = g_new (gfloat, SIZE * SIZE * 4);
+  gint          i;
+
+  gegl = gegl_graph (node = gegl_node ("gegl:invert", NULL,
+                            gegl_node ("gegl:threshold", "value", 0.8, NULL,
+                            gegl_node ("gegl:levels", "out-low", 0.1, NULL,
+                 contrast = gegl_node ("gegl:brightness-contrast", "contrast", 0.2, NULL,
+                            gegl_node ("gegl:buffer-source", "buffer", buffer, NULL))))));
+
+  /* a first blit for the set up that is done once */
+  gegl_node_blit (node, 1.0, &roi, babl_format ("RGBA float"), buf,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  test_start ();
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      if (changing)
+        gegl_node_set (contrast, "contrast", 0.2 + (i % 2) * 0.1, NULL);
+
+      roi.x = 100 + (i % 64) * SIZE;
+      gegl_node_blit (node, 1.0, &roi, babl_format ("RGBA float"), buf,
+                      GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+    }
+  test_end (changing ? "blit-small-changing" : "blit-small",
+            SIZE * SIZE * 16 * ITERATIONS);
+
+  g_object_unref (gegl);
+  g_free (buf);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *buffer;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (1024, 1024, babl_format ("RGBA float"));
+
+  blit_small (buffer, FALSE);
+  blit_small (buffer, TRUE);
+
+  g_object_unref (buffer);
+  gegl_exit ();
+
+  return 0;
+}
@@ -0,0 +1,80 @@
+#include <sys/resource.h>
+#include "test-common.h"
+
+/* a deep chain of blurs and point operations rendered in one piece, with
+ * the caches of the nodes turned off the memory held at the peak of the
+ * evaluation is the intermediate buffers it keeps alive at once
+ */
+
+#define DEPTH 12
+#define SIZE  1024
+
+static glong
+max_rss (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+
+  return usage.ru_maxrss; /* kilobytes */
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle roi = {0, 0, SIZE, SIZE};
+  GeglBuffer   *buffer;
+  GeglNode     *gegl, *node;
+  gfloat       *buf;
+  glong         rss;
+  gint          i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (SIZE, SIZE, babl_format ("RGBA float"));
+  buf    = g_new (gfloat, SIZE * SIZE * 4);
+
+  gegl = gegl_node_new ();
+  g_object_set (gegl, "dont-cache", TRUE, NULL);
+  node = gegl_node_new_child (gegl,
+                              "operation", "gegl:buffer-source",
+                              "buffer",    buffer,
+                              NULL);
+
+  for (i = 0; i < DEPTH; i++)
+    {
+      GeglNode *blur, *contrast;
+
+      blur     = gegl_node_new_child (gegl,
+                                      "operation", "gegl:gaussian-blur",
+                                      "std-dev-x", 1.0,
+                                      "std-dev-y", 1.0,
+                                      NULL);
+      contrast = gegl_node_new_child (gegl,
+                                      "operation", "gegl:brightness-contrast",
+                                      "contrast",  1.1,
+                                      NULL);
+      gegl_node_link_many (node, blur, contrast, NULL);
+      node = contrast;
+    }
+
+  rss = max_rss ();
+
+  test_start ();
+  gegl_node_blit (node, 1.0, &roi, babl_format ("RGBA float"), buf,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+  test_end ("deep-chain", SIZE * SIZE * 16 * DEPTH);
+
+  /* the growth of the peak memory use over the set up of the test */
+  g_print ("@ deep-chain-peak-memory: %.2f megabytes\n",
+           (max_rss () - rss) / 1024.0);
+
+  g_object_unref (gegl);
+  g_object_unref (buffer);
+  g_free (buf);
+  gegl_exit ();
+
+  return 0;
+}
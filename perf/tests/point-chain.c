@@ -0,0 +1,62 @@
+#include "test-common.h"
+
+/* a chain of point operations ending in a composer, with the caches of
+ * the nodes turned off the chain is computed in one pass over the tiles
+ * of the output
+ */
+
+#define SIZE 1024
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle roi = {0, 0, SIZE, SIZE};
+  GeglBuffer   *buffer;
+  GeglNode     *gegl, *source, *levels, *contrast, *invert, *opacity, *over;
+  gfloat       *buf;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  buffer = test_buffer (SIZE, SIZE, babl_format ("RGBA float"));
+  buf    = g_new (gfloat, SIZE * SIZE * 4);
+
+  gegl     = gegl_node_new ();
+  g_object_set (gegl, "dont-cache", TRUE, NULL);
+  source   = gegl_node_new_child (gegl,
+                                  "operation", "gegl:buffer-source",
+                                  "buffer",    buffer,
+                                  NULL);
+  levels   = gegl_node_new_child (gegl,
+                                  "operation", "gegl:levels",
+                                  "out-low",   0.1,
+                                  NULL);
+  contrast = gegl_node_new_child (gegl,
+                                  "operation", "gegl:brightness-contrast",
+                                  "contrast",  1.2,
+                                  NULL);
+  invert   = gegl_node_new_child (gegl,
+                                  "operation", "gegl:invert",
+                                  NULL);
+  opacity  = gegl_node_new_child (gegl,
+                                  "operation", "gegl:opacity",
+                                  "value",     0.8,
+                                  NULL);
+  over     = gegl_node_new_child (gegl,
+                                  "operation", "gegl:over",
+                                  NULL);
+  gegl_node_link_many (source, levels, contrast, invert, opacity, over, NULL);
+
+  test_start ();
+  gegl_node_blit (over, 1.0, &roi, babl_format ("RGBA float"), buf,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+  test_end ("point-chain", SIZE * SIZE * 16 * 5);
+
+  g_object_unref (gegl);
+  g_object_unref (buffer);
+  g_free (buf);
+  gegl_exit ();
+
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <math.h>
+#include <string.h>
+#include "test-common.h"
+
+/* the gradient domain tone mappers, whose run time is spent in their
+ * solvers, at a few image sizes
+ */
+
+static GeglBuffer *
+hdr_buffer (gint size)
+{
+  GeglRectangle bound = {0, 0, size, size};
+  GeglBuffer   *buffer;
+  gfloat       *buf;
+  gint          i;
+
+  /* noise over a few orders of magnitude of luminance */
+  buf = g_malloc (size * size * 16);
+  for (i = 0; i < size * size; i++)
+    {
+      gint    x = i % size, y = i / size;
+      gdouble scale = pow (10.0, 4.0 * (x + y) / (2.0 * size) - 2.0);
+      gint    c;
+
+      for (c = 0; c < 3; c++)
+        buf[i * 4 + c] = scale * g_random_double_range (0.5, 1.5);
+      buf[i * 4 + 3] = 1.0;
+    }
+  buffer = gegl_buffer_new (&bound, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), buf, 0);
+  g_free (buf);
+
+  return buffer;
+}
+
+static void
+tonemap (GeglBuffer  *buffer,
+         const gchar *operation,
+         gint         size)
+{
+  GeglBuffer *buffer2;
+  GeglNode   *gegl, *sink;
+  gchar      *id;
+
+  gegl = gegl_graph (sink = gegl_node ("gegl:buffer-sink", "buffer", &buffer2, NULL,
+                            gegl_node (operation, NULL,
+                            gegl_node ("gegl:buffer-source", "buffer", buffer, NULL))));
+
+  id = g_strdup_printf ("%s-%d", operation + strlen ("gegl:"), size);
+  test_start ();
+  gegl_node_process (sink);
+  test_end (id, gegl_buffer_get_pixel_count (buffer) * 16);
+  g_free (id);
+
+  g_object_unref (buffer2);
+  g_object_unref (gegl);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint sizes[] = {256, 512, 1024};
+  gint i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      GeglBuffer *buffer = hdr_buffer (sizes[i]);
+
+      tonemap (buffer, "gegl:mantiuk06", sizes[i]);
+      tonemap (buffer, "gegl:fattal02", sizes[i]);
+
+      g_object_unref (buffer);
+    }
+
+  gegl_exit ();
+
+  return 0;
+}
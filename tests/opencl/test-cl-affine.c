@@ -0,0 +1,144 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Renders gegl:rotate and gegl:scale with the OpenCL kernels and with the
+ * CPU samplers and compares the results, including the abyss around the
+ * source.
+ */
+
+#include <string.h>
+#include <math.h>
+#include <babl/babl.h>
+
+#include "gegl.h"
+#include "gegl-types.h"
+#include "gegl-utils.h"
+#include "gegl-cl.h"
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define SKIP    77
+
+#define WIDTH  300
+#define HEIGHT 200
+
+#define TOLERANCE 1e-3
+
+static const gchar *filters[] = { "nearest", "linear", "cubic", NULL };
+
+static void
+render (GeglBuffer    *buffer,
+        const gchar   *operation,
+        const gchar   *filter,
+        GeglRectangle *roi,
+        gfloat        *result)
+{
+  GeglNode *graph, *src, *transform;
+
+  graph     = gegl_node_new ();
+  src       = gegl_node_new_child (graph,
+                                   "operation", "gegl:buffer-source",
+                                   "buffer", buffer,
+                                   NULL);
+
+  if (!strcmp (operation, "gegl:rotate"))
+    transform = gegl_node_new_child (graph,
+                                     "operation", operation,
+                                     "degrees", 33.0,
+                                     "origin-x", WIDTH / 2.0,
+                                     "origin-y", HEIGHT / 2.0,
+                                     "filter", filter,
+                                     NULL);
+  else
+    transform = gegl_node_new_child (graph,
+                                     "operation", operation,
+                                     "x", 1.37,
+                                     "y", -0.71,
+                                     "filter", filter,
+                                     NULL);
+
+  gegl_node_link (src, transform);
+
+  gegl_node_blit (transform, 1.0, roi, babl_format ("RaGaBaA float"),
+                  result, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (graph);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint          retval = SUCCESS;
+  GeglRectangle extent = {0, 0, WIDTH, HEIGHT};
+  GeglRectangle roi    = {-50, -50, WIDTH + 100, HEIGHT + 100};
+  gint          n      = roi.width * roi.height * 4;
+  gfloat       *source = g_new (gfloat, WIDTH * HEIGHT * 4);
+  gfloat       *cpu    = g_new (gfloat, n);
+  gfloat       *cl     = g_new (gfloat, n);
+  const gchar  *operations[] = { "gegl:rotate", "gegl:scale", NULL };
+  GeglBuffer   *buffer;
+  GRand        *rand;
+  gint          i, o, f;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  if (!gegl_cl_is_accelerated ())
+    {
+      g_printerr ("OpenCL is not available, skipping\n");
+      gegl_exit ();
+      return SKIP;
+    }
+
+  rand = g_rand_new_with_seed (29);
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    source[i] = g_rand_double (rand);
+  g_rand_free (rand);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, &extent, babl_format ("RGBA float"), source, GEGL_AUTO_ROWSTRIDE);
+
+  for (o = 0; operations[o]; o++)
+    for (f = 0; filters[f]; f++)
+      {
+        render (buffer, operations[o], filters[f], &roi, cl);
+
+        cl_state.is_accelerated = FALSE;
+        render (buffer, operations[o], filters[f], &roi, cpu);
+        cl_state.is_accelerated = TRUE;
+
+        for (i = 0; i < n; i++)
+          if (fabsf (cl[i] - cpu[i]) > TOLERANCE)
+            {
+              g_printerr ("%s %s: pixel (%d, %d) component %d: CPU %f OpenCL %f\n",
+                          operations[o], filters[f],
+                          roi.x + (i / 4) % roi.width, roi.y + (i / 4) / roi.width,
+                          i % 4, cpu[i], cl[i]);
+              retval = FAILURE;
+              break;
+            }
+      }
+
+  g_object_unref (buffer);
+  g_free (source);
+  g_free (cpu);
+  g_free (cl);
+
+  gegl_exit ();
+
+  return retval;
+}
@@ -0,0 +1,201 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks the OpenCL color conversions against babl, every format is
+ * converted to and from "RGBA float" and the results are compared in
+ * "RGBA float" with a tolerance of about one u8 step.
+ */
+
+#include <string.h>
+#include <math.h>
+#include <babl/babl.h>
+
+#include "gegl.h"
+#include "gegl-types.h"
+#include "gegl-utils.h"
+#include "gegl-cl.h"
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define SKIP    77
+
+#define N_PIXELS  1024
+#define TOLERANCE (1.5f / 255.0f)
+
+static const gchar *formats[] =
+{
+  "RGBA u8",   "RGBA u16",   "R'G'B'A float", "R'G'B'A u8", "R'G'B'A u16",
+  "RaGaBaA float", "R'aG'aB'aA float",
+  "RGB float", "RGB u8",     "RGB u16",
+  "R'G'B' float", "R'G'B' u8", "R'G'B' u16",
+  "YA float",  "YA u8",      "YA u16",
+  "Y'A float", "Y'A u8",     "Y'A u16",
+  "YaA float", "Y'aA float",
+  "Y float",   "Y u8",       "Y u16",
+  "Y' float",  "Y' u8",      "Y' u16",
+  NULL
+};
+
+static gboolean
+cl_convert (const Babl *in_format,
+            const Babl *out_format,
+            gpointer    in_data,
+            gpointer    out_data)
+{
+  cl_int errcode;
+  gboolean ok;
+  size_t in_bytes  = N_PIXELS * babl_format_get_bytes_per_pixel (in_format);
+  size_t out_bytes = N_PIXELS * babl_format_get_bytes_per_pixel (out_format);
+  cl_mem in_tex, out_tex;
+
+  in_tex  = gegl_clCreateBuffer (gegl_cl_get_context (), CL_MEM_READ_WRITE,
+                                 in_bytes, NULL, &errcode);
+  out_tex = gegl_clCreateBuffer (gegl_cl_get_context (), CL_MEM_READ_WRITE,
+                                 out_bytes, NULL, &errcode);
+
+  gegl_clEnqueueWriteBuffer (gegl_cl_get_command_queue (), in_tex, CL_TRUE,
+                             0, in_bytes, in_data, 0, NULL, NULL);
+
+  ok = gegl_cl_color_conv (in_tex, out_tex, N_PIXELS, in_format, out_format);
+
+  gegl_clEnqueueReadBuffer (gegl_cl_get_command_queue (), out_tex, CL_TRUE,
+                            0, out_bytes, out_data, 0, NULL, NULL);
+
+  gegl_clReleaseMemObject (in_tex);
+  gegl_clReleaseMemObject (out_tex);
+
+  return ok;
+}
+
+static gboolean
+compare (const gchar  *what,
+         const gfloat *a,
+         const gfloat *b)
+{
+  gint i;
+
+  for (i = 0; i < N_PIXELS * 4; i++)
+    if (fabsf (a[i] - b[i]) > TOLERANCE)
+      {
+        g_printerr ("%s: pixel %d component %d differs, %f (babl) vs %f (OpenCL)\n",
+                    what, i / 4, i % 4, a[i], b[i]);
+        return FALSE;
+      }
+
+  return TRUE;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint retval = SUCCESS;
+  const Babl *rgbaf = babl_format ("RGBA float");
+  gfloat *source    = g_new (gfloat, N_PIXELS * 4);
+  gfloat *reference = g_new (gfloat, N_PIXELS * 4);
+  gfloat *result    = g_new (gfloat, N_PIXELS * 4);
+  gpointer native   = g_malloc (N_PIXELS * 4 * sizeof (gfloat));
+  gpointer cl_native = g_malloc (N_PIXELS * 4 * sizeof (gfloat));
+  GRand *rand;
+  gint i;
+
+  gegl_init (&argc, &argv);
+
+  if (!gegl_cl_is_accelerated ())
+    {
+      g_printerr ("OpenCL is not available, skipping\n");
+      gegl_exit ();
+      return SKIP;
+    }
+
+  rand = g_rand_new_with_seed (42);
+  for (i = 0; i < N_PIXELS * 4; i++)
+    source[i] = g_rand_double (rand);
+  /* include fully transparent pixels */
+  for (i = 0; i < N_PIXELS; i += 16)
+    source[i * 4 + 3] = 0.0f;
+  g_rand_free (rand);
+
+  for (i = 0; formats[i]; i++)
+    {
+      const Babl *format = babl_format (formats[i]);
+      gchar *what;
+
+      if (gegl_cl_color_supported (rgbaf, format) != GEGL_CL_COLOR_CONVERT ||
+          gegl_cl_color_supported (format, rgbaf) != GEGL_CL_COLOR_CONVERT)
+        {
+          g_printerr ("%s: not supported\n", formats[i]);
+          retval = FAILURE;
+          continue;
+        }
+
+      /* RGBA float -> format, compared after going back through babl */
+      babl_process (babl_fish (rgbaf, format), source, native, N_PIXELS);
+      babl_process (babl_fish (format, rgbaf), native, reference, N_PIXELS);
+
+      if (!cl_convert (rgbaf, format, source, cl_native))
+        {
+          g_printerr ("%s: conversion from RGBA float failed\n", formats[i]);
+          retval = FAILURE;
+          continue;
+        }
+      babl_process (babl_fish (format, rgbaf), cl_native, result, N_PIXELS);
+
+      what = g_strdup_printf ("RGBA float -> %s", formats[i]);
+      if (!compare (what, reference, result))
+        retval = FAILURE;
+      g_free (what);
+
+      /* format -> RGBA float, from the babl encoded data */
+      if (!cl_convert (format, rgbaf, native, result))
+        {
+          g_printerr ("%s: conversion to RGBA float failed\n", formats[i]);
+          retval = FAILURE;
+          continue;
+        }
+
+      what = g_strdup_printf ("%s -> RGBA float", formats[i]);
+      if (!compare (what, reference, result))
+        retval = FAILURE;
+      g_free (what);
+    }
+
+  /* a conversion that needs both steps */
+  {
+    const Babl *in_format  = babl_format ("Y' u16");
+    const Babl *out_format = babl_format ("R'G'B'A u8");
+
+    babl_process (babl_fish (rgbaf, in_format), source, native, N_PIXELS);
+    babl_process (babl_fish (in_format, rgbaf), native, reference, N_PIXELS);
+
+    if (!cl_convert (in_format, out_format, native, cl_native))
+      retval = FAILURE;
+    babl_process (babl_fish (out_format, rgbaf), cl_native, result, N_PIXELS);
+
+    if (!compare ("Y' u16 -> R'G'B'A u8", reference, result))
+      retval = FAILURE;
+  }
+
+  g_free (source);
+  g_free (reference);
+  g_free (result);
+  g_free (native);
+  g_free (cl_native);
+
+  gegl_exit ();
+
+  return retval;
+}
@@ -0,0 +1,111 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Renders gegl:invert with the OpenCL iterator spreading the work over all
+ * the devices found.  To get several devices from pocl run it with
+ *
+ *   POCL_DEVICES="pthread pthread pthread" ./test-cl-multi-device
+ */
+
+#include <string.h>
+#include <math.h>
+#include <babl/babl.h>
+
+#include "gegl.h"
+#include "gegl-types.h"
+#include "gegl-utils.h"
+#include "gegl-cl.h"
+
+#define SUCCESS 0
+#define FAILURE (-1)
+#define SKIP    77
+
+#define WIDTH  1000
+#define HEIGHT 777
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint          retval = SUCCESS;
+  GeglRectangle extent = {0, 0, WIDTH, HEIGHT};
+  gfloat       *source = g_new (gfloat, WIDTH * HEIGHT * 4);
+  gfloat       *result = g_new0 (gfloat, WIDTH * HEIGHT * 4);
+  GeglBuffer   *buffer;
+  GeglNode     *graph, *src, *invert;
+  GRand        *rand;
+  gint          i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  if (!gegl_cl_is_accelerated ())
+    {
+      g_printerr ("OpenCL is not available, skipping\n");
+      gegl_exit ();
+      return SKIP;
+    }
+
+  g_printerr ("running on %u OpenCL device(s)\n", gegl_cl_get_n_devices ());
+
+  rand = g_rand_new_with_seed (7);
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    source[i] = g_rand_double (rand);
+  g_rand_free (rand);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, &extent, babl_format ("RGBA float"), source, GEGL_AUTO_ROWSTRIDE);
+
+  graph  = gegl_node_new ();
+  src    = gegl_node_new_child (graph,
+                                "operation", "gegl:buffer-source",
+                                "buffer", buffer,
+                                NULL);
+  invert = gegl_node_new_child (graph,
+                                "operation", "gegl:invert",
+                                NULL);
+  gegl_node_link (src, invert);
+
+  gegl_node_blit (invert, 1.0, &extent, babl_format ("RGBA float"),
+                  result, GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (i = 0; i < WIDTH * HEIGHT && retval == SUCCESS; i++)
+    {
+      gint c;
+
+      for (c = 0; c < 4; c++)
+        {
+          gfloat expected = c < 3 ? 1.0f - source[i * 4 + c] : source[i * 4 + c];
+
+          if (fabsf (result[i * 4 + c] - expected) > 1e-5)
+            {
+              g_printerr ("pixel (%d, %d) component %d: expected %f got %f\n",
+                          i % WIDTH, i / WIDTH, c, expected, result[i * 4 + c]);
+              retval = FAILURE;
+              break;
+            }
+        }
+    }
+
+  g_object_unref (graph);
+  g_object_unref (buffer);
+  g_free (source);
+  g_free (result);
+
+  gegl_exit ();
+
+  return retval;
+}
@@ -0,0 +1,132 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Rotations by multiples of 90 degrees move every pixel onto another one,
+ * gegl:rotate must output the pixels of its input unchanged.
+ */
+
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define WIDTH    100
+#define HEIGHT   60
+
+typedef struct
+{
+  gdouble        degrees;
+  GeglRectangle  rect;        /* where the input lands */
+  gint           m[2][2];     /* output x,y is input m . (x,y) */
+} Rotation;
+
+static const Rotation rotations[] =
+{
+  { 90.0,  { 0, 1 - WIDTH, HEIGHT, WIDTH },
+           { { 0, -1 }, { 1, 0 } } },
+  { 180.0, { 1 - WIDTH, 1 - HEIGHT, WIDTH, HEIGHT },
+           { { -1, 0 }, { 0, -1 } } },
+  { 270.0, { 1 - HEIGHT, 0, HEIGHT, WIDTH },
+           { { 0, 1 }, { -1, 0 } } },
+  { -90.0, { 1 - HEIGHT, 0, HEIGHT, WIDTH },
+           { { 0, 1 }, { -1, 0 } } }
+};
+
+static gboolean
+test_rotate (const Rotation *rotation,
+             GeglBuffer     *buffer,
+             const guchar   *pixels)
+{
+  const GeglRectangle *rect   = &rotation->rect;
+  guchar              *result = g_new0 (guchar, rect->width * rect->height * 4);
+  GeglNode            *gegl, *source, *node;
+  gboolean             ok     = TRUE;
+  gint                 x, y;
+
+  gegl   = gegl_node_new ();
+  source = gegl_node_new_child (gegl,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  node   = gegl_node_new_child (gegl,
+                                "operation", "gegl:rotate",
+                                "degrees",   rotation->degrees,
+                                NULL);
+  gegl_node_link (source, node);
+
+  gegl_node_blit (node, 1.0, rect, babl_format ("R'G'B'A u8"), result,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (y = 0; y < rect->height && ok; y++)
+    for (x = 0; x < rect->width && ok; x++)
+      {
+        gint u = rotation->m[0][0] * (rect->x + x) +
+                 rotation->m[0][1] * (rect->y + y);
+        gint v = rotation->m[1][0] * (rect->x + x) +
+                 rotation->m[1][1] * (rect->y + y);
+
+        ok = ! memcmp (result + (y * rect->width + x) * 4,
+                       pixels + (v * WIDTH + u) * 4, 4);
+
+        if (!ok)
+          g_printerr ("rotating by %f: pixel %d,%d is not input pixel %d,%d\n",
+                      rotation->degrees,
+                      rect->x + x, rect->y + y, u, v);
+      }
+
+  g_object_unref (gegl);
+  g_free (result);
+
+  return ok;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle  extent = { 0, 0, WIDTH, HEIGHT };
+  GeglBuffer    *buffer;
+  guchar        *pixels;
+  GRand         *rand;
+  gint           retval = SUCCESS;
+  gint           i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  /* opaque, so that the premultiplication the operations do is lossless */
+  rand   = g_rand_new_with_seed (42);
+  pixels = g_new (guchar, WIDTH * HEIGHT * 4);
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    pixels[i] = i % 4 == 3 ? 255 : g_rand_int_range (rand, 0, 256);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("R'G'B'A u8"));
+  gegl_buffer_set (buffer, NULL, babl_format ("R'G'B'A u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  for (i = 0; i < G_N_ELEMENTS (rotations); i++)
+    if (!test_rotate (&rotations[i], buffer, pixels))
+      retval = FAILURE;
+
+  g_object_unref (buffer);
+  g_free (pixels);
+  g_rand_free (rand);
+  gegl_exit ();
+
+  return retval;
+}
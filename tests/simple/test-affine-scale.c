@@ -0,0 +1,164 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks the separable path gegl:scale takes for the filters it has one
+ * for: a ramp enlarged stays a ramp, and a checkerboard of single pixels
+ * reduced averages to grey instead of aliasing to black and white.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     256
+
+static const gchar *filters[] = { "linear", "cubic", "lanczos", "lohalo" };
+
+static GeglBuffer *
+source_buffer (gboolean checkerboard)
+{
+  GeglRectangle extent = { 0, 0, SIZE, SIZE };
+  GeglBuffer   *buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gfloat       *buf    = g_new (gfloat, SIZE * SIZE * 4);
+  gint          x, y, c;
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        gfloat value = checkerboard ? (x + y) % 2 : x / (gfloat) SIZE;
+
+        for (c = 0; c < 3; c++)
+          buf[(y * SIZE + x) * 4 + c] = value;
+        buf[(y * SIZE + x) * 4 + 3] = 1.0;
+      }
+
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), buf,
+                   GEGL_AUTO_ROWSTRIDE);
+  g_free (buf);
+
+  return buffer;
+}
+
+/* renders rect of buffer scaled by scale, away from the edges */
+static gfloat *
+scale (GeglBuffer          *buffer,
+       const gchar         *filter,
+       gdouble              scale,
+       const GeglRectangle *rect)
+{
+  GeglNode *gegl, *source, *node;
+  gfloat   *result = g_new (gfloat, rect->width * rect->height * 4);
+
+  gegl   = gegl_node_new ();
+  source = gegl_node_new_child (gegl,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  node   = gegl_node_new_child (gegl,
+                                "operation", "gegl:scale",
+                                "x",         scale,
+                                "y",         scale,
+                                "filter",    filter,
+                                NULL);
+  gegl_node_link (source, node);
+
+  gegl_node_blit (node, 1.0, rect, babl_format ("RGBA float"), result,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (gegl);
+
+  return result;
+}
+
+static gboolean
+test_enlarge (const gchar *filter)
+{
+  GeglBuffer   *buffer = source_buffer (FALSE);
+  GeglRectangle rect   = { 40, 40, 400, 8 };
+  gfloat       *result = scale (buffer, filter, 2.0, &rect);
+  gboolean      ok     = TRUE;
+  gint          i;
+
+  /* pixel x of the output is at x / 2 in the source */
+  for (i = 0; i < rect.width * rect.height && ok; i++)
+    {
+      gfloat expected = (rect.x + i % rect.width) / 2.0 / SIZE;
+
+      ok = fabs (result[i * 4] - expected) < 1e-4;
+
+      if (!ok)
+        g_printerr ("%s: enlarged ramp at %d expected %f got %f\n",
+                    filter, rect.x + i % rect.width, expected, result[i * 4]);
+    }
+
+  g_free (result);
+  g_object_unref (buffer);
+
+  return ok;
+}
+
+static gboolean
+test_reduce (const gchar *filter)
+{
+  GeglBuffer   *buffer = source_buffer (TRUE);
+  GeglRectangle rect   = { 4, 4, 56, 56 };
+  gfloat       *result = scale (buffer, filter, 0.25, &rect);
+  gboolean      ok     = TRUE;
+  gint          i;
+
+  for (i = 0; i < rect.width * rect.height && ok; i++)
+    {
+      ok = fabs (result[i * 4] - 0.5) < 0.02;
+
+      if (!ok)
+        g_printerr ("%s: reduced checkerboard at %d,%d got %f\n", filter,
+                    rect.x + i % rect.width, rect.y + i / rect.width,
+                    result[i * 4]);
+    }
+
+  g_free (result);
+  g_object_unref (buffer);
+
+  return ok;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint retval = SUCCESS;
+  gint i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (filters); i++)
+    {
+      /* lohalo only reduces through the separable path */
+      if (i != 3 && !test_enlarge (filters[i]))
+        retval = FAILURE;
+
+      if (!test_reduce (filters[i]))
+        retval = FAILURE;
+    }
+
+  gegl_exit ();
+
+  return retval;
+}
@@ -0,0 +1,151 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* With disk-cache set the outputs of nodes are kept in that directory.  A
+ * second graph like the first renders the same from the files the first
+ * one left, without adding any, and with disk-cache-size at 0 no file is
+ * kept.
+ */
+
+#include <glib/gstdio.h>
+#include <unistd.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     64
+
+static void
+render (gdouble  std_dev,
+        gfloat  *pixels)
+{
+  GeglRectangle extent = { 0, 0, SIZE, SIZE };
+  GeglNode     *gegl, *checkerboard, *blur;
+
+  gegl         = gegl_node_new ();
+  checkerboard = gegl_node_new_child (gegl,
+                                      "operation", "gegl:checkerboard",
+                                      "x",         5,
+                                      "y",         7,
+                                      NULL);
+  blur         = gegl_node_new_child (gegl,
+                                      "operation", "gegl:gaussian-blur",
+                                      "std-dev-x", std_dev,
+                                      "std-dev-y", std_dev,
+                                      NULL);
+  gegl_node_link (checkerboard, blur);
+
+  gegl_node_blit (blur, 1.0, &extent, babl_format ("RGBA float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (gegl);
+}
+
+/* the number of files kept in dir, removing them when remove is set */
+static gint
+count_files (const gchar *dir,
+             gboolean     remove)
+{
+  GDir        *gdir  = g_dir_open (dir, 0, NULL);
+  const gchar *name;
+  gint         count = 0;
+
+  if (!gdir)
+    return 0;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      if (remove)
+        {
+          gchar *path = g_build_filename (dir, name, NULL);
+
+          g_unlink (path);
+          g_free (path);
+        }
+      count++;
+    }
+  g_dir_close (gdir);
+
+  return count;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gfloat *computed, *loaded;
+  gchar  *name, *dir;
+  gint    retval = SUCCESS;
+  gint    files;
+  gint    i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  name = g_strdup_printf ("gegl-test-disk-cache-%i", getpid ());
+  dir  = g_build_filename (g_get_tmp_dir (), name, NULL);
+  g_object_set (gegl_config (), "disk-cache", dir, NULL);
+
+  computed = g_new (gfloat, SIZE * SIZE * 4);
+  loaded   = g_new (gfloat, SIZE * SIZE * 4);
+
+  render (3.0, computed);
+  files = count_files (dir, FALSE);
+  if (files == 0)
+    {
+      g_printerr ("no output was kept in %s\n", dir);
+      retval = FAILURE;
+    }
+
+  render (3.0, loaded);
+  if (retval == SUCCESS && count_files (dir, FALSE) != files)
+    {
+      g_printerr ("%i files were kept for the same outputs, %i before\n",
+                  count_files (dir, FALSE), files);
+      retval = FAILURE;
+    }
+
+  for (i = 0; i < SIZE * SIZE * 4 && retval == SUCCESS; i++)
+    if (loaded[i] != computed[i])
+      {
+        g_printerr ("pixel %d component %d is %f loaded, %f computed\n",
+                    i / 4, i % 4, loaded[i], computed[i]);
+        retval = FAILURE;
+      }
+
+  g_object_set (gegl_config (), "disk-cache-size", 0, NULL);
+  render (4.0, computed);
+  if (retval == SUCCESS && count_files (dir, FALSE) != 0)
+    {
+      g_printerr ("%i files were kept beyond the size of the cache\n",
+                  count_files (dir, FALSE));
+      retval = FAILURE;
+    }
+
+  count_files (dir, TRUE);
+  g_rmdir (dir);
+  g_object_set (gegl_config (), "disk-cache", NULL, NULL);
+
+  g_free (computed);
+  g_free (loaded);
+  g_free (name);
+  g_free (dir);
+  gegl_exit ();
+
+  return retval;
+}
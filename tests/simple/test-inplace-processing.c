@@ -0,0 +1,170 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Point operations process the buffers of their inputs in place once no
+ * other consumer is left to read them.  The output of an operation read
+ * by two branches must reach both unchanged, also when one of the
+ * branches passes it on as it is or as a sub-buffer, and the buffer of a
+ * buffer-source, which the caller still holds, must never be written to.
+ * The graphs don't cache, a cache is never processed in place.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     64
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle extent = { 0, 0, SIZE, SIZE };
+  GeglBuffer   *buffer;
+  GeglNode     *gegl, *source, *invert, *brighten, *restore, *add;
+  gfloat       *pixels, *result;
+  GRand        *rand;
+  gint          retval = SUCCESS;
+  gint          i, pass, swap;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  rand   = g_rand_new_with_seed (3);
+  pixels = g_new (gfloat, SIZE * SIZE * 4);
+  result = g_new (gfloat, SIZE * SIZE * 4);
+  for (i = 0; i < SIZE * SIZE * 4; i++)
+    pixels[i] = i % 4 == 3 ? 1.0 : g_rand_double (rand);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  /* (1 - v + 0.25) + (1 - (1 - v)) = 1.25 */
+  gegl     = gegl_node_new ();
+  g_object_set (gegl, "dont-cache", TRUE, NULL);
+  source   = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:buffer-source",
+                                  "buffer",     buffer,
+                                  NULL);
+  invert   = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:invert",
+                                  NULL);
+  brighten = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:brightness-contrast",
+                                  "brightness", 0.25,
+                                  NULL);
+  restore  = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:invert",
+                                  NULL);
+  add      = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:add",
+                                  NULL);
+  gegl_node_link_many (source, invert, brighten, add, NULL);
+  gegl_node_link (invert, restore);
+  gegl_node_connect_to (restore, "output", add, "aux");
+
+  gegl_node_blit (add, 1.0, &extent, babl_format ("RGBA float"), result,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (i = 0; i < SIZE * SIZE * 4 && retval == SUCCESS; i++)
+    if (i % 4 != 3 && fabs (result[i] - 1.25) > 1e-5)
+      {
+        g_printerr ("pixel %d component %d expected 1.25 got %f\n",
+                    i / 4, i % 4, result[i]);
+        retval = FAILURE;
+      }
+
+  gegl_buffer_get (buffer, 1.0, NULL, babl_format ("RGBA float"), result,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  for (i = 0; i < SIZE * SIZE * 4 && retval == SUCCESS; i++)
+    if (result[i] != pixels[i])
+      {
+        g_printerr ("the source buffer changed at pixel %d\n", i / 4);
+        retval = FAILURE;
+      }
+
+  g_object_unref (gegl);
+
+  /* (1 - v + 0.25) + (1 - v) = 2.25 - 2 v with the second branch a nop or
+   * a crop of the whole extent, connected to either input of the add
+   */
+  for (pass = 0; pass < 4 && retval == SUCCESS; pass++)
+    {
+      GeglNode *pass_on;
+
+      swap = pass % 2;
+
+      gegl     = gegl_node_new ();
+      g_object_set (gegl, "dont-cache", TRUE, NULL);
+      source   = gegl_node_new_child (gegl,
+                                      "operation",  "gegl:buffer-source",
+                                      "buffer",     buffer,
+                                      NULL);
+      invert   = gegl_node_new_child (gegl,
+                                      "operation",  "gegl:invert",
+                                      NULL);
+      brighten = gegl_node_new_child (gegl,
+                                      "operation",  "gegl:brightness-contrast",
+                                      "brightness", 0.25,
+                                      NULL);
+      if (pass < 2)
+        pass_on = gegl_node_new_child (gegl,
+                                       "operation", "gegl:nop",
+                                       NULL);
+      else
+        pass_on = gegl_node_new_child (gegl,
+                                       "operation", "gegl:crop",
+                                       "x",         0.0,
+                                       "y",         0.0,
+                                       "width",     (gdouble) SIZE,
+                                       "height",    (gdouble) SIZE,
+                                       NULL);
+      add      = gegl_node_new_child (gegl,
+                                      "operation",  "gegl:add",
+                                      NULL);
+      gegl_node_link_many (source, invert, brighten, NULL);
+      gegl_node_link (invert, pass_on);
+      gegl_node_connect_to (swap ? pass_on : brighten, "output", add, "input");
+      gegl_node_connect_to (swap ? brighten : pass_on, "output", add, "aux");
+
+      gegl_node_blit (add, 1.0, &extent, babl_format ("RGBA float"), result,
+                      GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+      for (i = 0; i < SIZE * SIZE * 4 && retval == SUCCESS; i++)
+        if (i % 4 != 3 && fabs (result[i] - (2.25 - 2 * pixels[i])) > 1e-5)
+          {
+            g_printerr ("%s on %s: pixel %d component %d expected %f got %f\n",
+                        pass < 2 ? "nop" : "crop", swap ? "input" : "aux",
+                        i / 4, i % 4, 2.25 - 2 * pixels[i], result[i]);
+            retval = FAILURE;
+          }
+
+      g_object_unref (gegl);
+    }
+
+  g_object_unref (buffer);
+  g_free (pixels);
+  g_free (result);
+  g_rand_free (rand);
+  gegl_exit ();
+
+  return retval;
+}
@@ -0,0 +1,193 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* With merge-duplicates set, nodes with the same operation, properties and
+ * inputs compute their output once per evaluation.  The graph below has
+ * two identical blurred branches, one of them cropped so that it needs
+ * less of its blur, and a third blur differing from them by a tiny
+ * amount; it must render the same with and without merging.  Each blur
+ * is followed by an operation counting the pixels it processes, merging
+ * the identical branches must make them fewer.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "gegl.h"
+#include "gegl-plugin.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     128
+
+typedef GeglOperationPointFilter      TestCount;
+typedef GeglOperationPointFilterClass TestCountClass;
+
+GType test_count_get_type (void);
+G_DEFINE_TYPE (TestCount, test_count, GEGL_TYPE_OPERATION_POINT_FILTER)
+
+static volatile gint counted = 0;
+
+static gboolean
+test_count_process (GeglOperation       *operation,
+                    void                *in_buf,
+                    void                *out_buf,
+                    glong                samples,
+                    const GeglRectangle *roi)
+{
+  if (out_buf != in_buf)
+    memcpy (out_buf, in_buf, samples * 4 * sizeof (gfloat));
+  g_atomic_int_add (&counted, samples);
+
+  return TRUE;
+}
+
+static void
+test_count_class_init (TestCountClass *klass)
+{
+  GeglOperationClass *operation_class = GEGL_OPERATION_CLASS (klass);
+
+  GEGL_OPERATION_POINT_FILTER_CLASS (klass)->process = test_count_process;
+  operation_class->name        = "test:count";
+  operation_class->categories  = "hidden";
+  operation_class->description = "Counts the pixels passing through it.";
+}
+
+static void
+test_count_init (TestCount *self)
+{
+}
+
+static GeglNode *
+blur (GeglNode *gegl,
+      GeglNode *source,
+      gdouble   std_dev)
+{
+  GeglNode *node = gegl_node_new_child (gegl,
+                                        "operation", "gegl:gaussian-blur",
+                                        "std-dev-x", std_dev,
+                                        "std-dev-y", std_dev,
+                                        NULL);
+
+  GeglNode *count = gegl_node_new_child (gegl,
+                                         "operation", "test:count",
+                                         NULL);
+
+  gegl_node_link_many (source, node, count, NULL);
+
+  return count;
+}
+
+/* returns the pixels counted */
+static gint
+render (GeglNode *node,
+        gboolean  merge,
+        gfloat   *pixels)
+{
+  GeglRectangle extent = { 0, 0, SIZE, SIZE };
+
+  counted = 0;
+  g_object_set (gegl_config (), "merge-duplicates", merge, NULL);
+  gegl_node_blit (node, 1.0, &extent, babl_format ("RGBA float"), pixels,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  return g_atomic_int_get (&counted);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle extent = { 0, 0, SIZE, SIZE };
+  GeglBuffer   *buffer;
+  GeglNode     *gegl, *source, *crop, *over, *add;
+  gfloat       *pixels, *merged, *separate;
+  GRand        *rand;
+  gint          retval = SUCCESS;
+  gint          merged_count, separate_count;
+  gint          i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+  g_type_class_unref (g_type_class_ref (test_count_get_type ()));
+
+  rand     = g_rand_new_with_seed (7);
+  pixels   = g_new (gfloat, SIZE * SIZE * 4);
+  merged   = g_new (gfloat, SIZE * SIZE * 4);
+  separate = g_new (gfloat, SIZE * SIZE * 4);
+  for (i = 0; i < SIZE * SIZE * 4; i++)
+    pixels[i] = g_rand_double (rand);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  gegl   = gegl_node_new ();
+  g_object_set (gegl, "dont-cache", TRUE, NULL);
+  source = gegl_node_new_child (gegl,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  crop   = gegl_node_new_child (gegl,
+                                "operation", "gegl:crop",
+                                "x",         16.0,
+                                "y",         16.0,
+                                "width",     64.0,
+                                "height",    64.0,
+                                NULL);
+  over   = gegl_node_new_child (gegl,
+                                "operation", "gegl:over",
+                                NULL);
+  add    = gegl_node_new_child (gegl,
+                                "operation", "gegl:add",
+                                NULL);
+
+  gegl_node_link_many (blur (gegl, source, 2.0), crop, NULL);
+  gegl_node_link_many (blur (gegl, source, 2.0), over, add, NULL);
+  gegl_node_connect_to (crop, "output", over, "aux");
+  gegl_node_connect_to (blur (gegl, source, 2.0000001), "output", add, "aux");
+
+  separate_count = render (add, FALSE, separate);
+  merged_count   = render (add, TRUE, merged);
+
+  if (merged_count >= separate_count)
+    {
+      g_printerr ("%d pixels blurred merged, %d separately\n",
+                  merged_count, separate_count);
+      retval = FAILURE;
+    }
+
+  for (i = 0; i < SIZE * SIZE * 4 && retval == SUCCESS; i++)
+    if (merged[i] != separate[i])
+      {
+        g_printerr ("pixel %d component %d is %f merged, %f separately\n",
+                    i / 4, i % 4, merged[i], separate[i]);
+        retval = FAILURE;
+      }
+
+  g_object_set (gegl_config (), "merge-duplicates", FALSE, NULL);
+  g_object_unref (gegl);
+  g_object_unref (buffer);
+  g_free (pixels);
+  g_free (merged);
+  g_free (separate);
+  g_rand_free (rand);
+  gegl_exit ();
+
+  return retval;
+}
@@ -0,0 +1,145 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Chains of point operations in a graph that is not cached are computed
+ * in one pass.  The operations of the chain below differ in the formats
+ * they work in and one of them reads an aux input, the pixels rendered
+ * must be the same as those of the operations computed one by one, also
+ * for rectangles not aligned with the tiles.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     300
+
+static gint
+check_rect (GeglNode            *node,
+            const GeglRectangle *rect,
+            const gfloat        *pixels)
+{
+  gfloat *result = g_new (gfloat, rect->width * rect->height * 4);
+  gint    retval = SUCCESS;
+  gint    x, y, c;
+
+  gegl_node_blit (node, 1.0, rect, babl_format ("RGBA float"), result,
+                  GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+  for (y = 0; y < rect->height && retval == SUCCESS; y++)
+    for (x = 0; x < rect->width && retval == SUCCESS; x++)
+      for (c = 0; c < 3 && retval == SUCCESS; c++)
+        {
+          gfloat v        = pixels[((rect->y + y) * SIZE + rect->x + x) * 4];
+          gfloat expected = (1.0 - (v + 0.1) + 0.25) * 2.0;
+          gfloat got      = result[(y * rect->width + x) * 4 + c];
+
+          if (fabs (got - expected) > 1e-5)
+            {
+              g_printerr ("pixel %d,%d component %d expected %f got %f\n",
+                          rect->x + x, rect->y + y, c, expected, got);
+              retval = FAILURE;
+            }
+        }
+
+  g_free (result);
+
+  return retval;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglRectangle  extent  = { 0, 0, SIZE, SIZE };
+  GeglRectangle  odd     = { 37, 101, 213, 77 };
+  GeglBuffer    *buffer, *quarter;
+  GeglNode      *gegl, *source, *constant, *brighten, *grey, *invert, *add,
+                *multiply;
+  gfloat        *pixels;
+  GeglColor     *color;
+  GRand         *rand;
+  gint           retval  = SUCCESS;
+  gint           i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  /* grey pixels, which the conversion to and from YA keeps as they are */
+  rand   = g_rand_new_with_seed (5);
+  pixels = g_new (gfloat, SIZE * SIZE * 4);
+  for (i = 0; i < SIZE * SIZE; i++)
+    {
+      pixels[i * 4 + 0] = pixels[i * 4 + 1] = pixels[i * 4 + 2] =
+        g_rand_double (rand);
+      pixels[i * 4 + 3] = 1.0;
+    }
+
+  buffer  = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+  quarter = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  color   = gegl_color_new ("rgba(0.25, 0.25, 0.25, 1.0)");
+  gegl_buffer_set_color (quarter, NULL, color);
+
+  /* (1 - (v + 0.1) + 0.25) * 2 */
+  gegl     = gegl_node_new ();
+  g_object_set (gegl, "dont-cache", TRUE, NULL);
+  source   = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:buffer-source",
+                                  "buffer",     buffer,
+                                  NULL);
+  constant = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:buffer-source",
+                                  "buffer",     quarter,
+                                  NULL);
+  brighten = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:brightness-contrast",
+                                  "brightness", 0.1,
+                                  NULL);
+  grey     = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:grey",
+                                  NULL);
+  invert   = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:invert",
+                                  NULL);
+  add      = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:add",
+                                  NULL);
+  multiply = gegl_node_new_child (gegl,
+                                  "operation",  "gegl:multiply",
+                                  "value",      2.0,
+                                  NULL);
+  gegl_node_link_many (source, brighten, grey, invert, add, multiply, NULL);
+  gegl_node_connect_to (constant, "output", add, "aux");
+
+  retval = check_rect (multiply, &extent, pixels);
+  if (retval == SUCCESS)
+    retval = check_rect (multiply, &odd, pixels);
+
+  g_object_unref (gegl);
+  g_object_unref (buffer);
+  g_object_unref (quarter);
+  g_object_unref (color);
+  g_free (pixels);
+  g_rand_free (rand);
+  gegl_exit ();
+
+  return retval;
+}
@@ -0,0 +1,115 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compares the pixels samplers read from the tiles of buffers with those
+ * of gegl_buffer_get, for a buffer in the format the sampler interpolates
+ * in, which is read in place, one in another format, which is converted,
+ * and sub-buffers of both, whose abyss and tiles are shifted.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+/* pixels visited along a spiral, going in and out of the abyss and
+ * crossing tiles in every direction
+ */
+#define N_PIXELS 20000
+
+static gboolean
+compare (GeglBuffer  *buffer,
+         const gchar *name)
+{
+  GeglSampler *sampler;
+  gboolean     ok = TRUE;
+  gint         i;
+
+  sampler = gegl_buffer_sampler_new (buffer, babl_format ("RGBA float"),
+                                     GEGL_SAMPLER_NEAREST);
+
+  for (i = 0; i < N_PIXELS && ok; i++)
+    {
+      gdouble       angle  = i * 0.01;
+      gdouble       radius = 10.0 + i * 0.01;
+      GeglRectangle pixel  = { 60 + radius * cos (angle),
+                               40 + radius * sin (angle), 1, 1 };
+      gfloat        expected[4];
+      gfloat        result[4];
+
+      gegl_buffer_get (buffer, 1.0, &pixel, babl_format ("RGBA float"),
+                       expected, GEGL_AUTO_ROWSTRIDE);
+      gegl_sampler_get (sampler, pixel.x, pixel.y, NULL, result);
+
+      ok = memcmp (expected, result, sizeof (expected)) == 0;
+
+      if (!ok)
+        g_printerr ("%s: pixel (%d, %d) expected %f %f %f %f "
+                    "got %f %f %f %f\n", name, pixel.x, pixel.y,
+                    expected[0], expected[1], expected[2], expected[3],
+                    result[0], result[1], result[2], result[3]);
+    }
+
+  g_object_unref (sampler);
+
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  const gchar  *formats[] = { "RGBA float", "R'G'B'A u8" };
+  GeglRectangle extent    = { -20, -10, 300, 200 };
+  GeglRectangle sub       = { 37, 21, 150, 100 };
+  gint          result    = SUCCESS;
+  gint          i, j;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    {
+      const Babl *format = babl_format (formats[i]);
+      GeglBuffer *buffer = gegl_buffer_new (&extent, format);
+      GeglBuffer *sub_buffer;
+      gfloat     *buf;
+      GRand      *rand;
+
+      rand = g_rand_new_with_seed (i);
+      buf  = g_new (gfloat, extent.width * extent.height * 4);
+      for (j = 0; j < extent.width * extent.height * 4; j++)
+        buf[j] = g_rand_double (rand);
+      gegl_buffer_set (buffer, &extent, babl_format ("RGBA float"), buf,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      sub_buffer = gegl_buffer_create_sub_buffer (buffer, &sub);
+
+      if (!compare (buffer, formats[i]) ||
+          !compare (sub_buffer, formats[i]))
+        result = FAILURE;
+
+      g_object_unref (sub_buffer);
+      g_object_unref (buffer);
+      g_free (buf);
+      g_rand_free (rand);
+    }
+
+  gegl_exit ();
+
+  return result;
+}
@@ -0,0 +1,249 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Checks the levels of the pyramid the samplers read for a scale: a
+ * checkerboard of single pixels sampled for a reduction averages to grey
+ * instead of aliasing to black and white, sampled with no scale it is
+ * read as it is, and sampling a level keeps the positions of a ramp.
+ * A reduction along one axis only leaves the other axis sharp.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     512
+
+static GeglSamplerType types[] = { GEGL_SAMPLER_NEAREST,
+                                   GEGL_SAMPLER_LINEAR,
+                                   GEGL_SAMPLER_CUBIC,
+                                   GEGL_SAMPLER_LANCZOS };
+
+enum
+{
+  CHECKERBOARD,
+  RAMP,
+  STRIPES
+};
+
+static GeglBuffer *
+source_buffer (gint pattern)
+{
+  GeglRectangle extent = { 0, 0, SIZE, SIZE };
+  GeglBuffer   *buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gfloat       *buf    = g_new (gfloat, SIZE * SIZE * 4);
+  gint          x, y, c;
+
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      {
+        gfloat value;
+
+        switch (pattern)
+          {
+            case CHECKERBOARD: value = (x + y) % 2;       break;
+            case RAMP:         value = x / (gfloat) SIZE; break;
+            default:           value = y % 2;             break;
+          }
+
+        for (c = 0; c < 3; c++)
+          buf[(y * SIZE + x) * 4 + c] = value;
+        buf[(y * SIZE + x) * 4 + 3] = 1.0;
+      }
+
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), buf,
+                   GEGL_AUTO_ROWSTRIDE);
+  g_free (buf);
+
+  return buffer;
+}
+
+static gboolean
+test_levels (void)
+{
+  GeglSampler *sampler;
+  GeglMatrix2  identity  = { { { 1.0, 0.0 }, { 0.0, 1.0 } } };
+  GeglMatrix2  reduce    = { { { 100.0, 0.0 }, { 0.0, 100.0 } } };
+  GeglMatrix2  rotated   = { { { 3.0, -3.0 }, { 3.0, 3.0 } } };
+  GeglMatrix2  stretched = { { { 1.0, 0.0 }, { 0.0, 9.0 } } };
+  GeglMatrix2  squashed  = { { { 100.0, 0.0 }, { 0.0, 1.0 } } };
+  GeglMatrix2  uneven    = { { { 100.0, 0.0 }, { 0.0, 8.0 } } };
+  gboolean     ok;
+
+  sampler = gegl_buffer_sampler_new (NULL, babl_format ("RGBA float"),
+                                     GEGL_SAMPLER_LINEAR);
+
+  ok = gegl_sampler_get_level (sampler, NULL)       == 0 &&
+       gegl_sampler_get_level (sampler, &identity)  == 0 &&
+       gegl_sampler_get_level (sampler, &reduce)    == 6 &&
+       gegl_sampler_get_level (sampler, &rotated)   == 2 &&
+       gegl_sampler_get_level (sampler, &stretched) == 0 &&
+       gegl_sampler_get_level (sampler, &squashed)  == 0 &&
+       gegl_sampler_get_level (sampler, &uneven)    == 3;
+
+  if (!ok)
+    g_printerr ("unexpected levels\n");
+
+  g_object_unref (sampler);
+
+  return ok;
+}
+
+static gboolean
+test_checkerboard (GeglBuffer      *buffer,
+                   GeglSamplerType  type)
+{
+  GeglSampler *sampler;
+  GeglMatrix2  reduce = { { { 8.0, 0.0 }, { 0.0, 8.0 } } };
+  gfloat       pixel[4];
+  gboolean     ok = TRUE;
+  gint         x, y;
+
+  sampler = gegl_buffer_sampler_new (buffer, babl_format ("RGBA float"), type);
+
+  for (y = 64; y < SIZE - 64 && ok; y += 37)
+    for (x = 64; x < SIZE - 64 && ok; x += 29)
+      {
+        gegl_sampler_get (sampler, x + 0.3, y + 0.6, &reduce, pixel);
+        ok = fabs (pixel[0] - 0.5) < 0.01;
+
+        if (!ok)
+          g_printerr ("sampler %d reducing at %d,%d got %f\n",
+                      type, x, y, pixel[0]);
+
+        /* the cubic and lanczos samplers do not hit the pixels exactly */
+        if (ok && (type == GEGL_SAMPLER_NEAREST ||
+                   type == GEGL_SAMPLER_LINEAR))
+          {
+            gegl_sampler_get (sampler, x, y, NULL, pixel);
+            ok = pixel[0] == (x + y) % 2;
+
+            if (!ok)
+              g_printerr ("sampler %d at %d,%d got %f\n",
+                          type, x, y, pixel[0]);
+          }
+      }
+
+  g_object_unref (sampler);
+
+  return ok;
+}
+
+static gboolean
+test_ramp (GeglBuffer      *buffer,
+           GeglSamplerType  type)
+{
+  GeglSampler *sampler;
+  GeglMatrix2  reduce = { { { 16.0, 0.0 }, { 0.0, 16.0 } } };
+  gfloat       pixels[8 * 4];
+  gboolean     ok = TRUE;
+  gint         i;
+
+  sampler = gegl_buffer_sampler_new (buffer, babl_format ("RGBA float"), type);
+
+  gegl_sampler_get_span (sampler, 128.0, 200.0, 32.0, 0.0, &reduce, 8, pixels);
+
+  /* nearest reads the pixel of the level the position falls in, 16 pixels
+   * wide
+   */
+  for (i = 0; i < 8 && ok; i++)
+    {
+      ok = fabs (pixels[i * 4] - (128.0 + i * 32.0) / SIZE) <
+           (type == GEGL_SAMPLER_NEAREST ? 16.0 : 0.5) / SIZE;
+
+      if (!ok)
+        g_printerr ("sampler %d reducing a ramp at %f got %f\n",
+                    type, 128.0 + i * 32.0, pixels[i * 4] * SIZE);
+    }
+
+  g_object_unref (sampler);
+
+  return ok;
+}
+
+/* rows alternating between black and white, reduced horizontally only */
+static gboolean
+test_stripes (GeglBuffer      *buffer,
+              GeglSamplerType  type)
+{
+  GeglSampler *sampler;
+  GeglMatrix2  squash = { { { 100.0, 0.0 }, { 0.0, 1.0 } } };
+  gfloat       pixel[4];
+  gboolean     ok = TRUE;
+  gint         x, y;
+
+  sampler = gegl_buffer_sampler_new (buffer, babl_format ("RGBA float"), type);
+
+  for (y = 64; y < SIZE - 64 && ok; y += 37)
+    for (x = 64; x < SIZE - 64 && ok; x += 29)
+      {
+        gegl_sampler_get (sampler, x, y, &squash, pixel);
+        ok = pixel[0] == y % 2;
+
+        if (!ok)
+          g_printerr ("sampler %d squashing stripes at %d,%d got %f\n",
+                      type, x, y, pixel[0]);
+      }
+
+  g_object_unref (sampler);
+
+  return ok;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GeglBuffer *checkerboard;
+  GeglBuffer *ramp;
+  GeglBuffer *stripes;
+  gint        retval = SUCCESS;
+  gint        i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  checkerboard = source_buffer (CHECKERBOARD);
+  ramp         = source_buffer (RAMP);
+  stripes      = source_buffer (STRIPES);
+
+  if (!test_levels ())
+    retval = FAILURE;
+
+  for (i = 0; i < G_N_ELEMENTS (types); i++)
+    {
+      if (!test_checkerboard (checkerboard, types[i]))
+        retval = FAILURE;
+
+      if (!test_ramp (ramp, types[i]))
+        retval = FAILURE;
+    }
+
+  /* the cubic and lanczos samplers do not hit the pixels exactly */
+  if (!test_stripes (stripes, GEGL_SAMPLER_NEAREST) ||
+      !test_stripes (stripes, GEGL_SAMPLER_LINEAR))
+    retval = FAILURE;
+
+  g_object_unref (checkerboard);
+  g_object_unref (ramp);
+  g_object_unref (stripes);
+  gegl_exit ();
+
+  return retval;
+}
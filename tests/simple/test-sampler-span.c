@@ -0,0 +1,115 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compares the spans of samples of gegl_sampler_get_span with the samples
+ * of gegl_sampler_get at the same points, for every sampler.
+ */
+
+#include <math.h>
+
+#include "gegl.h"
+
+#define SUCCESS  0
+#define FAILURE -1
+
+#define SIZE     256
+
+/* longer than a row of the fetched rectangle of the samplers, and not a
+ * multiple of the blocks they interpolate
+ */
+#define N_PIXELS 301
+
+static gboolean
+compare (GeglBuffer      *buffer,
+         GeglSamplerType  type,
+         gdouble          x,
+         gdouble          y,
+         gdouble          dx,
+         gdouble          dy)
+{
+  GeglSampler *sampler;
+  gfloat       expected[N_PIXELS * 4];
+  gfloat       result[N_PIXELS * 4];
+  gboolean     ok = TRUE;
+  gint         i;
+
+  sampler = gegl_buffer_sampler_new (buffer, babl_format ("RGBA float"), type);
+
+  for (i = 0; i < N_PIXELS; i++)
+    gegl_sampler_get (sampler, x + i * dx, y + i * dy, NULL, expected + i * 4);
+
+  gegl_sampler_get_span (sampler, x, y, dx, dy, NULL, N_PIXELS, result);
+
+  for (i = 0; i < N_PIXELS * 4 && ok; i++)
+    {
+      ok = fabs (expected[i] - result[i]) <= 1e-4;
+
+      if (!ok)
+        g_printerr ("sampler %d, (%f, %f) step (%f, %f): pixel %d component %d "
+                    "expected %f got %f\n", type, x, y, dx, dy,
+                    i / 4, i % 4, expected[i], result[i]);
+    }
+
+  g_object_unref (sampler);
+
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  GeglSamplerType types[] = { GEGL_SAMPLER_NEAREST,
+                              GEGL_SAMPLER_LINEAR,
+                              GEGL_SAMPLER_CUBIC,
+                              GEGL_SAMPLER_LANCZOS,
+                              GEGL_SAMPLER_LOHALO };
+  /* starts and steps: a row scaled down, one scaled up and rotated, and
+   * one going up and left across the edge of the buffer
+   */
+  gdouble       spans[][4] = { { 10.25,  20.5,  0.7,   0.0  },
+                               { 30.5,   12.75, 0.35,  0.2  },
+                               { 200.1,  100.3, -0.7, -0.35 } };
+  GeglRectangle extent     = { 0, 0, SIZE, SIZE };
+  GeglBuffer   *buffer;
+  gfloat       *buf;
+  GRand        *rand;
+  gint          result = SUCCESS;
+  gint          i, j;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  rand = g_rand_new_with_seed (11);
+  buf  = g_new (gfloat, SIZE * SIZE * 4);
+  for (i = 0; i < SIZE * SIZE * 4; i++)
+    buf[i] = g_rand_double (rand);
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), buf,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  for (i = 0; i < G_N_ELEMENTS (types); i++)
+    for (j = 0; j < G_N_ELEMENTS (spans); j++)
+      if (!compare (buffer, types[i],
+                    spans[j][0], spans[j][1], spans[j][2], spans[j][3]))
+        result = FAILURE;
+
+  g_object_unref (buffer);
+  g_free (buf);
+  g_rand_free (rand);
+  gegl_exit ();
+
+  return result;
+}
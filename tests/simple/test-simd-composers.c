@@ -0,0 +1,145 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compares the SSE "simd" and AVX "avx" processors the compositor
+ * generators in operations/generated emit with the reference loops they
+ * emit for the same formulas.  The generators write the loops of every
+ * operation to the *-kernels.h headers included here, they are only
+ * compiled for targets with SSE, the avx loops for targets with AVX.
+ */
+
+#include <glib.h>
+#include <math.h>
+
+#define SUCCESS 0
+#define FAILURE (-1)
+
+/* not a multiple of the size of the blocks, the pixels left over go
+ * through the reference loop
+ */
+#define N_PIXELS 1003
+
+typedef struct
+{
+  const gchar *name;
+  void (*reference) (gfloat *in, gfloat *aux, gfloat *out, glong n_pixels);
+  void (*simd)      (gfloat *in, gfloat *aux, gfloat *out, glong n_pixels);
+} SimdKernel;
+
+#ifdef __SSE__
+#include "svg-12-porter-duff-kernels.h"
+#include "svg-12-blend-kernels.h"
+#endif
+
+/* premultiplied pixels, with some fully transparent, opaque, black and
+ * saturated ones among the noise
+ */
+static void
+fill (GRand  *rand,
+      gfloat *buf)
+{
+  gint i, c;
+
+  for (i = 0; i < N_PIXELS; i++)
+    {
+      gfloat alpha;
+
+      switch (g_rand_int_range (rand, 0, 8))
+        {
+          case 0:  alpha = 0.0; break;
+          case 1:  alpha = 1.0; break;
+          default: alpha = g_rand_double (rand); break;
+        }
+
+      for (c = 0; c < 3; c++)
+        switch (g_rand_int_range (rand, 0, 8))
+          {
+            case 0:  buf[i * 4 + c] = 0.0; break;
+            case 1:  buf[i * 4 + c] = alpha; break;
+            default: buf[i * 4 + c] = g_rand_double (rand) * alpha; break;
+          }
+      buf[i * 4 + 3] = alpha;
+    }
+}
+
+static gboolean
+compare (const SimdKernel *kernel,
+         gfloat           *in,
+         gfloat           *aux)
+{
+  gfloat   expected[N_PIXELS * 4];
+  gfloat   result[N_PIXELS * 4];
+  gboolean ok = TRUE;
+  gint     i;
+
+  kernel->reference (in, aux, expected, N_PIXELS);
+  kernel->simd (in, aux, result, N_PIXELS);
+
+  for (i = 0; i < N_PIXELS * 4 && ok; i++)
+    {
+      ok = fabs (expected[i] - result[i]) <= 1e-5;
+
+      if (!ok)
+        g_printerr ("%s: pixel %d component %d expected %f got %f\n",
+                    kernel->name, i / 4, i % 4, expected[i], result[i]);
+    }
+
+  return ok;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint    retval = SUCCESS;
+  gfloat *in     = g_new (gfloat, N_PIXELS * 4);
+  gfloat *aux    = g_new (gfloat, N_PIXELS * 4);
+  GRand  *rand   = g_rand_new_with_seed (7);
+  gint    i;
+
+  fill (rand, in);
+  fill (rand, aux);
+
+#ifdef __SSE__
+  for (i = 0; i < G_N_ELEMENTS (svg_12_porter_duff_kernels); i++)
+    if (!compare (&svg_12_porter_duff_kernels[i], in, aux))
+      retval = FAILURE;
+
+  for (i = 0; i < G_N_ELEMENTS (svg_12_blend_kernels); i++)
+    if (!compare (&svg_12_blend_kernels[i], in, aux))
+      retval = FAILURE;
+#endif
+
+#ifdef __AVX__
+  for (i = 0; i < G_N_ELEMENTS (svg_12_porter_duff_avx_kernels); i++)
+    if (!compare (&svg_12_porter_duff_avx_kernels[i], in, aux))
+      retval = FAILURE;
+
+  for (i = 0; i < G_N_ELEMENTS (svg_12_blend_avx_kernels); i++)
+    if (!compare (&svg_12_blend_avx_kernels[i], in, aux))
+      retval = FAILURE;
+#endif
+
+#ifndef __SSE__
+  g_printerr ("no SSE on this target, skipped\n");
+#endif
+
+  g_rand_free (rand);
+  g_free (in);
+  g_free (aux);
+
+  return retval;
+}
@@ -0,0 +1,414 @@
+/* This file is part of GEGL.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GEGL; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Compares the sliding histograms used by the workshop percentile filters
+ * and the output of the filters with the sorted lists they replaced.  On
+ * gray images with 8 bit levels every bin holds a single level and the
+ * results must be the same, on colored noise the result must be a pixel of
+ * the window with its luminance in the same bin as the pixel the list
+ * picked.  The filters must give the same result whichever chunks they are
+ * processed in.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "gegl.h"
+#include "sliding-histogram.h"
+
+#define SUCCESS 0
+#define FAILURE (-1)
+
+#define WIDTH  150
+#define HEIGHT 41
+
+#define MAX_SAMPLES 20000
+
+typedef struct
+{
+  int       head;
+  int       next[MAX_SAMPLES];
+  float     luma[MAX_SAMPLES];
+  float    *pixel[MAX_SAMPLES];
+  int       items;
+} RankList;
+
+static void
+list_clear (RankList * p)
+{
+  p->items = 0;
+  p->next[0] = -1;
+}
+
+static void
+list_add (RankList *p,
+          gfloat    lumniosity,
+          gfloat   *pixel)
+{
+  gint location;
+
+  location = p->items;
+
+  p->items++;
+  p->luma[location] = lumniosity;
+  p->pixel[location] = pixel;
+  p->next[location] = -1;
+
+  if (p->items == 1)
+    {
+      p->head = location;
+      return;
+    }
+  if (lumniosity <= p->luma[p->head])
+    {
+      p->next[location] = p->head;
+      p->head = location;
+    }
+  else
+    {
+      gint   prev, i;
+      prev = p->head;
+      i = prev;
+      while (i >= 0 && p->luma[i] < lumniosity)
+        {
+          prev = i;
+          i = p->next[i];
+        }
+      p->next[location] = p->next[prev];
+      p->next[prev] = location;
+    }
+}
+
+static gfloat *
+list_percentile (RankList *p,
+                 gdouble   percentile)
+{
+  gint       i = p->head;
+  gint       pos = 0;
+  if (!p->items)
+    return NULL;
+  if (percentile >= 1.0)
+    percentile = 1.0;
+  while (pos < p->items * percentile &&
+         p->next[i] >= 0)
+    {
+      i = p->next[i];
+      pos++;
+    }
+  return p->pixel[i];
+}
+
+/* the percentile filters as they were before using histograms */
+static void
+reference (gfloat   *src,
+           gint      width,
+           gint      height,
+           gint      radius,
+           gdouble   percentile,
+           gboolean  disc,
+           gfloat   *dst)
+{
+  static RankList list;
+  gint x, y;
+
+  for (y = 0; y < height; y++)
+    for (x = 0; x < width; x++)
+      {
+        gfloat *pix;
+        gint u, v;
+
+        list_clear (&list);
+
+        for (v = y - radius; v <= y + radius; v++)
+          for (u = x - radius; u <= x + radius; u++)
+            if (u >= 0 && u < width && v >= 0 && v < height &&
+                (!disc || (x - u) * (x - u) + (y - v) * (y - v) < radius * radius))
+              {
+                gfloat *src_pix = src + (v * width + u) * 4;
+
+                list_add (&list, SLIDING_HISTOGRAM_LUMA (src_pix), src_pix);
+              }
+
+        pix = list_percentile (&list, percentile);
+        for (u = 0; u < 4; u++)
+          dst[(y * width + x) * 4 + u] = pix[u];
+      }
+}
+
+/* checks the result g for pixel (x, y) of a width x height source against
+ * the pixel e the list picked
+ */
+static gboolean
+check_pixel (gfloat   *src,
+             gint      width,
+             gint      height,
+             gint      x,
+             gint      y,
+             gint      radius,
+             gboolean  disc,
+             gboolean  gray,
+             gfloat   *e,
+             gfloat   *g)
+{
+  gint n_bins = 1 << SLIDING_HISTOGRAM_BITS;
+  gint u, v;
+
+  if (gray)
+    return e[0] == g[0] && e[1] == g[1] && e[2] == g[2] && e[3] == g[3];
+
+  if (sliding_histogram_bin (SLIDING_HISTOGRAM_LUMA (e), n_bins) !=
+      sliding_histogram_bin (SLIDING_HISTOGRAM_LUMA (g), n_bins))
+    return FALSE;
+
+  for (v = MAX (0, y - radius); v <= MIN (height - 1, y + radius); v++)
+    for (u = MAX (0, x - radius); u <= MIN (width - 1, x + radius); u++)
+      if (!disc || (x - u) * (x - u) + (y - v) * (y - v) < radius * radius)
+        {
+          gfloat *pix = src + (v * width + u) * 4;
+
+          if (pix[0] == g[0] && pix[1] == g[1] && pix[2] == g[2] && pix[3] == g[3])
+            return TRUE;
+        }
+
+  return FALSE;
+}
+
+static gboolean
+compare (const gchar *what,
+         gfloat      *src,
+         gboolean     gray)
+{
+  static const gint    radii[]       = { 1, 2, 5, 9 };
+  static const gdouble percentiles[] = { 0.0, 0.25, 0.5, 0.9, 1.0 };
+  gfloat  *expected = g_new (gfloat, WIDTH * HEIGHT * 4);
+  gfloat  *result   = g_new (gfloat, WIDTH * HEIGHT * 4);
+  gboolean ok = TRUE;
+  gint     i, r, p, disc;
+
+  for (disc = 0; disc <= 1; disc++)
+    for (r = 0; r < G_N_ELEMENTS (radii); r++)
+      for (p = 0; p < G_N_ELEMENTS (percentiles) && ok; p++)
+        {
+          reference (src, WIDTH, HEIGHT, radii[r], percentiles[p], disc,
+                     expected);
+
+          if (disc)
+            sliding_histogram_disc (src, WIDTH, WIDTH, HEIGHT, radii[r],
+                                    percentiles[p], SLIDING_HISTOGRAM_BITS, result);
+          else
+            sliding_histogram_box (src, WIDTH, WIDTH, HEIGHT, radii[r],
+                                   percentiles[p], SLIDING_HISTOGRAM_BITS, result);
+
+          for (i = 0; i < WIDTH * HEIGHT && ok; i++)
+            {
+              gfloat *e = expected + i * 4;
+              gfloat *g = result + i * 4;
+
+              ok = check_pixel (src, WIDTH, HEIGHT, i % WIDTH, i / WIDTH,
+                                radii[r], disc, gray, e, g);
+
+              if (!ok)
+                g_printerr ("%s %s radius %d percentile %.2f: pixel (%d, %d) "
+                            "expected %f %f %f %f got %f %f %f %f\n",
+                            what, disc ? "disc" : "box", radii[r], percentiles[p],
+                            i % WIDTH, i / WIDTH,
+                            e[0], e[1], e[2], e[3], g[0], g[1], g[2], g[3]);
+            }
+        }
+
+  g_free (expected);
+  g_free (result);
+
+  return ok;
+}
+
+/* renders the filter over the source in strips chunk rows high */
+static void
+render (const gchar *operation,
+        gfloat      *src,
+        gint         radius,
+        gdouble      percentile,
+        gint         chunk,
+        gfloat      *dst)
+{
+  GeglRectangle extent = { 0, 0, WIDTH, HEIGHT };
+  GeglBuffer   *buffer;
+  GeglNode     *gegl, *source, *filter;
+  gint          y;
+
+  buffer = gegl_buffer_new (&extent, babl_format ("RGBA float"));
+  gegl_buffer_set (buffer, NULL, babl_format ("RGBA float"), src,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  gegl   = gegl_node_new ();
+  source = gegl_node_new_child (gegl,
+                                "operation", "gegl:buffer-source",
+                                "buffer",    buffer,
+                                NULL);
+  filter = gegl_node_new_child (gegl,
+                                "operation",  operation,
+                                "radius",     (gdouble) radius,
+                                "percentile", percentile * 100.0,
+                                NULL);
+  gegl_node_link (source, filter);
+
+  for (y = 0; y < HEIGHT; y += chunk)
+    {
+      GeglRectangle roi = { 0, y, WIDTH, MIN (chunk, HEIGHT - y) };
+
+      gegl_node_blit (filter, 1.0, &roi, babl_format ("RGBA float"),
+                      dst + y * WIDTH * 4, GEGL_AUTO_ROWSTRIDE,
+                      GEGL_BLIT_DEFAULT);
+    }
+
+  g_object_unref (gegl);
+  g_object_unref (buffer);
+}
+
+static gboolean
+has_operation (const gchar *name)
+{
+  gchar  **operations;
+  guint    n_operations;
+  gboolean found = FALSE;
+  guint    i;
+
+  operations = gegl_list_operations (&n_operations);
+  for (i = 0; i < n_operations && !found; i++)
+    found = ! strcmp (operations[i], name);
+  g_free (operations);
+
+  return found;
+}
+
+/* the filters rank the transparent black around the source too, the list
+ * gets a source padded with it
+ */
+static gboolean
+compare_operations (const gchar *what,
+                    gfloat      *src,
+                    gboolean     gray)
+{
+  static const gchar  *operations[]  = { "gegl:box-percentile",
+                                         "gegl:disc-percentile" };
+  static const gdouble percentiles[] = { 0.0, 0.5, 0.9 };
+  const gint radius = 5;
+  const gint pwidth  = WIDTH + 2 * radius;
+  const gint pheight = HEIGHT + 2 * radius;
+  gfloat  *padded   = g_new0 (gfloat, pwidth * pheight * 4);
+  gfloat  *expected = g_new (gfloat, pwidth * pheight * 4);
+  gfloat  *whole    = g_new (gfloat, WIDTH * HEIGHT * 4);
+  gfloat  *strips   = g_new (gfloat, WIDTH * HEIGHT * 4);
+  gboolean ok = TRUE;
+  gint     i, o, p;
+
+  for (i = 0; i < HEIGHT; i++)
+    memcpy (padded + ((i + radius) * pwidth + radius) * 4, src + i * WIDTH * 4,
+            WIDTH * 4 * sizeof (gfloat));
+
+  for (o = 0; o < G_N_ELEMENTS (operations); o++)
+    {
+      gboolean disc = o == 1;
+
+      if (!has_operation (operations[o]))
+        {
+          g_printerr ("%s not found, skipped\n", operations[o]);
+          continue;
+        }
+
+      for (p = 0; p < G_N_ELEMENTS (percentiles) && ok; p++)
+        {
+          reference (padded, pwidth, pheight, radius, percentiles[p], disc,
+                     expected);
+          render (operations[o], src, radius, percentiles[p], HEIGHT, whole);
+          render (operations[o], src, radius, percentiles[p], 7, strips);
+
+          for (i = 0; i < WIDTH * HEIGHT && ok; i++)
+            {
+              gint    x = i % WIDTH + radius;
+              gint    y = i / WIDTH + radius;
+              gfloat *e = expected + (y * pwidth + x) * 4;
+              gfloat *g = whole + i * 4;
+              gfloat *s = strips + i * 4;
+
+              ok = check_pixel (padded, pwidth, pheight, x, y, radius, disc,
+                                gray, e, g) &&
+                   s[0] == g[0] && s[1] == g[1] && s[2] == g[2] && s[3] == g[3];
+
+              if (!ok)
+                g_printerr ("%s %s percentile %.2f: pixel (%d, %d) "
+                            "expected %f %f %f %f got %f %f %f %f "
+                            "in strips %f %f %f %f\n",
+                            what, operations[o], percentiles[p],
+                            i % WIDTH, i / WIDTH,
+                            e[0], e[1], e[2], e[3], g[0], g[1], g[2], g[3],
+                            s[0], s[1], s[2], s[3]);
+            }
+        }
+    }
+
+  g_free (padded);
+  g_free (expected);
+  g_free (whole);
+  g_free (strips);
+
+  return ok;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  gint    retval = SUCCESS;
+  gfloat *src    = g_new (gfloat, WIDTH * HEIGHT * 4);
+  GRand  *rand   = g_rand_new_with_seed (3);
+  gint    i;
+
+  g_thread_init (NULL);
+  gegl_init (&argc, &argv);
+
+  /* gray levels, a ramp with some noise so the windows hold repeated
+   * and distinct values, none of them black so they don't tie with the
+   * transparent black around the source
+   */
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    {
+      gint level = (i % WIDTH) * 2 + g_rand_int_range (rand, -40, 40);
+
+      level = CLAMP (level, 1, 255);
+
+      src[i * 4 + 0] = src[i * 4 + 1] = src[i * 4 + 2] = level / 255.0;
+      src[i * 4 + 3] = 1.0;
+    }
+
+  if (!compare ("gray", src, TRUE) ||
+      !compare_operations ("gray", src, TRUE))
+    retval = FAILURE;
+
+  for (i = 0; i < WIDTH * HEIGHT * 4; i++)
+    src[i] = g_rand_double_range (rand, -0.2, 1.5);
+
+  if (!compare ("color", src, FALSE) ||
+      !compare_operations ("color", src, FALSE))
+    retval = FAILURE;
+
+  g_rand_free (rand);
+  g_free (src);
+
+  gegl_exit ();
+
+  return retval;
+}